@@ -0,0 +1,182 @@
+#include "SpatialBenchmark.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace nlohmann;
+
+namespace SpatialBenchmark
+{
+	void to_json(json& j, const Timing& t)
+	{
+		j = json{
+			{ "operation", t.Operation },
+			{ "operations", t.OperationCount },
+			{ "milliseconds", t.Milliseconds },
+			{ "operations_per_second", t.Milliseconds > 0.0 ? t.OperationCount * 1000.0 / t.Milliseconds : 0.0 },
+			{ "results", t.ResultCount }
+		};
+	}
+
+	void to_json(json& j, const Result& r)
+	{
+		json metrics = json::object();
+		for (const Metric& metric : r.Metrics)
+		{
+			metrics[metric.Name] = metric.Value;
+		}
+
+		j = json{
+			{ "structure", r.Structure },
+			{ "distribution", r.Distribution },
+			{ "objects", r.ObjectCount },
+			{ "memory_bytes", r.MemoryBytes },
+			{ "metrics", metrics },
+			{ "timings", r.Timings }
+		};
+	}
+}
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::printf(
+			"usage: Benchmark [options]\n"
+			"  --counts <n,n,...>   object counts (default 1000,10000,100000,1000000)\n"
+			"  --edits <n>          objects inserted and removed per run (default 10000)\n"
+			"  --queries <n>        aabb and ray queries per run (default 1000)\n"
+			"  --frustums <n>       frustum queries per run (default 20)\n"
+			"  --seed <n>           data set seed (default 1)\n"
+			"  --json <file>        json report (default spatial_benchmark.json)\n"
+			"  --csv <file>         csv report, one row per timing (default spatial_benchmark.csv)\n");
+	}
+
+	std::vector<unsigned int> ParseCounts(const char* text)
+	{
+		std::vector<unsigned int> counts;
+		std::stringstream stream(text);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			counts.push_back(static_cast<unsigned int>(std::strtoul(item.c_str(), nullptr, 10)));
+		}
+		return counts;
+	}
+
+	bool WriteJson(const std::string& path, const SpatialBenchmark::Settings& settings, const std::vector<SpatialBenchmark::Result>& results)
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			return false;
+		}
+
+		json report = {
+			{ "seed", settings.Seed },
+			{ "hardware_threads", std::thread::hardware_concurrency() },
+			{ "results", results }
+		};
+		file << report.dump(4) << std::endl;
+		return true;
+	}
+
+	bool WriteCsv(const std::string& path, const std::vector<SpatialBenchmark::Result>& results)
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			return false;
+		}
+
+		file << "structure,distribution,objects,operation,operations,milliseconds,operations_per_second,results,memory_bytes\n";
+		for (const SpatialBenchmark::Result& result : results)
+		{
+			for (const SpatialBenchmark::Timing& timing : result.Timings)
+			{
+				const double throughput = timing.Milliseconds > 0.0 ? timing.OperationCount * 1000.0 / timing.Milliseconds : 0.0;
+				file << result.Structure << ',' << result.Distribution << ',' << result.ObjectCount << ','
+					<< timing.Operation << ',' << timing.OperationCount << ',' << timing.Milliseconds << ','
+					<< throughput << ',' << timing.ResultCount << ',' << result.MemoryBytes << '\n';
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	SpatialBenchmark::Settings settings;
+	std::string jsonPath = "spatial_benchmark.json";
+	std::string csvPath = "spatial_benchmark.csv";
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0 || !value)
+		{
+			PrintUsage();
+			return std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0 ? 0 : 1;
+		}
+
+		if (std::strcmp(arg, "--counts") == 0)
+		{
+			settings.ObjectCounts = ParseCounts(value);
+		}
+		else if (std::strcmp(arg, "--edits") == 0)
+		{
+			settings.EditCount = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+		}
+		else if (std::strcmp(arg, "--queries") == 0)
+		{
+			settings.AabbQueryCount = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+			settings.RayQueryCount = settings.AabbQueryCount;
+		}
+		else if (std::strcmp(arg, "--frustums") == 0)
+		{
+			settings.FrustumQueryCount = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+		}
+		else if (std::strcmp(arg, "--seed") == 0)
+		{
+			settings.Seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		}
+		else if (std::strcmp(arg, "--json") == 0)
+		{
+			jsonPath = value;
+		}
+		else if (std::strcmp(arg, "--csv") == 0)
+		{
+			csvPath = value;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+		++i;
+	}
+
+	std::vector<SpatialBenchmark::Result> results;
+	SpatialBenchmark::Run(settings, results);
+
+	if (!WriteJson(jsonPath, settings, results))
+	{
+		std::fprintf(stderr, "failed to write %s\n", jsonPath.c_str());
+		return 1;
+	}
+	if (!WriteCsv(csvPath, results))
+	{
+		std::fprintf(stderr, "failed to write %s\n", csvPath.c_str());
+		return 1;
+	}
+	std::printf("wrote %s and %s\n", jsonPath.c_str(), csvPath.c_str());
+	return 0;
+}
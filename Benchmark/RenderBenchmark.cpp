@@ -0,0 +1,173 @@
+#include "RenderBenchmark.h"
+
+#include "Camera/Camera.h"
+#include "Lighting/DirectionalLight.h"
+#include "Mesh/Plane.h"
+#include "Mesh/Sphere.h"
+#include "Renderer/DebugDraw.h"
+#include "Renderer/GeometryArena.h"
+#include "Renderer/SimpleRenderer.h"
+#include "Resources/Resources.h"
+#include "Scene/Scene.h"
+#include "Scene/SceneNode.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+
+namespace RenderBenchmark
+{
+	namespace
+	{
+		const float s_spacing = 7.2f;
+		const float s_deltaTime = 1.0f / 60.0f;
+
+		// grid sphere scales repeat this pattern instead of using rand(), so every run is the same scene.
+		const float s_scales[] = { 0.5f, 1.7f, 0.9f, 2.3f, 1.2f, 0.7f, 2.0f };
+
+		struct BenchmarkScene
+		{
+			PlaneMesh* Plane = nullptr;
+			Sphere* Ball = nullptr;
+			SceneNode* PlaneNode = nullptr;
+			std::vector<SceneNode*> Nodes;
+			std::vector<glm::vec3> BoundsMin;
+			std::vector<glm::vec3> BoundsMax;
+			DirectionalLight Light;
+		};
+
+		void BuildScene(SimpleRenderer& renderer, unsigned int gridSize, bool packedVertices, BenchmarkScene& scene)
+		{
+			scene.Plane = new PlaneMesh(50, 50);
+			scene.Ball = new Sphere(32, 32);
+			if (packedVertices)
+			{
+				scene.Plane->Encoding = VERTEX_ENCODING::PACKED;
+				scene.Plane->Finalize();
+				scene.Ball->Encoding = VERTEX_ENCODING::PACKED;
+				scene.Ball->Finalize();
+			}
+
+			Material* material = renderer.CreateMaterial("default-fwd");
+			scene.PlaneNode = Scene::MakeSceneNode(scene.Plane, material);
+			scene.PlaneNode->SetScale(10.0f);
+			scene.PlaneNode->SetRotation(glm::vec4(1.0f, 0.0f, 0.0f, 90.0f));
+
+			const int half = static_cast<int>(gridSize) / 2;
+			for (unsigned int x = 0; x < gridSize; ++x)
+			{
+				for (unsigned int z = 0; z < gridSize; ++z)
+				{
+					for (unsigned int y = 0; y < gridSize; ++y)
+					{
+						const glm::vec3 position = glm::vec3(0.0f, 0.5f, 0.0f) + glm::vec3(static_cast<int>(x) - half, y, static_cast<int>(z) - half) * s_spacing;
+						const float scale = s_scales[scene.Nodes.size() % (sizeof(s_scales) / sizeof(s_scales[0]))];
+
+						SceneNode* node = Scene::MakeSceneNode(scene.Ball, material);
+						node->SetPosition(position);
+						node->SetScale(scale);
+						scene.Nodes.push_back(node);
+						scene.BoundsMin.push_back(position + node->BoxMin * scale);
+						scene.BoundsMax.push_back(position + node->BoxMax * scale);
+					}
+				}
+			}
+
+			scene.Light.m_direction = -glm::normalize(glm::vec3(0.2f, 10.0f, 0.1f));
+			scene.Light.m_intensity = 10.0f;
+			scene.Light.m_color = glm::vec3(0.9f, 0.8f, 0.8f);
+			renderer.AddLight(&scene.Light);
+		}
+
+		// a slow pass over the grid, looking down the z axis.
+		void MoveCamera(Camera& camera, unsigned int frame)
+		{
+			const float t = frame * s_deltaTime;
+			camera.SetPosition(glm::vec3(std::sin(t * 0.5f) * 20.0f, 8.0f + std::sin(t * 0.3f) * 4.0f, 60.0f - std::fmod(t * 5.0f, 80.0f)));
+			camera.Update(s_deltaTime);
+		}
+
+		void RenderFrame(SimpleRenderer& renderer, const BenchmarkScene& scene, const Camera& camera, bool debugLines)
+		{
+			if (debugLines)
+			{
+				DebugDraw::Clear();
+				for (size_t i = 0; i < scene.BoundsMin.size(); ++i)
+				{
+					DebugDraw::AddAABB(scene.BoundsMin[i], scene.BoundsMax[i], { 0.0f, 1.0f, 0.0f, 1.0f });
+				}
+				DebugDraw::Update(camera.GetProjection() * camera.GetView());
+			}
+
+			renderer.PushRender(scene.PlaneNode);
+			renderer.PushRender(scene.Nodes);
+			renderer.RenderPushedCommands();
+
+			if (debugLines)
+			{
+				DebugDraw::Draw(false);
+			}
+		}
+	}
+
+	void Run(const Settings& settings, RecordingRenderDevice& device, Result& outResult)
+	{
+		RenderDevice::Set(&device);
+		device.BeginFrame();
+
+		Resources::Init();
+		SimpleRenderer* renderer = new SimpleRenderer();
+		renderer->Init();
+		renderer->SetRenderSize(settings.Width, settings.Height);
+		DebugDraw::Init();
+
+		Camera camera(glm::vec3(0.0f, 8.0f, 60.0f));
+		camera.SetPerspective(glm::radians(90.0f), static_cast<float>(settings.Width) / settings.Height, 0.01f, 200.0f);
+		renderer->SetCamera(&camera);
+
+		BenchmarkScene scene;
+		BuildScene(*renderer, settings.GridSize, settings.PackedVertices, scene);
+		outResult.ObjectCount = static_cast<unsigned int>(scene.Nodes.size()) + 1;
+		GeometryArena& arena = GeometryArena::Get();
+		for (unsigned int i = 0; i < arena.GetPoolCount(); ++i)
+		{
+			const GeometryArena::PoolStats stats = arena.GetPoolStats(i);
+			outResult.VertexBytes += stats.Vertices.Used * stats.Stride;
+		}
+		outResult.InitStats = device.GetFrameStats();
+
+		outResult.FrameMilliseconds.reserve(settings.FrameCount);
+		outResult.FrameStats.reserve(settings.FrameCount);
+		for (unsigned int frame = 0; frame < settings.WarmupFrames + settings.FrameCount; ++frame)
+		{
+			MoveCamera(camera, frame);
+			device.BeginFrame();
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			RenderFrame(*renderer, scene, camera, settings.DebugLines);
+			const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			if (frame < settings.WarmupFrames)
+			{
+				continue;
+			}
+			outResult.FrameMilliseconds.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+			outResult.FrameStats.push_back(device.GetFrameStats());
+			if (frame == settings.WarmupFrames && settings.StreamDump)
+			{
+				device.Dump(settings.StreamDump);
+			}
+		}
+
+		DebugDraw::Clean();
+		delete renderer;
+		delete scene.Plane;
+		delete scene.Ball;
+		Scene::Clear();
+		Resources::Clean();
+		GeometryArena::Get().Clean();
+
+		RenderDevice::Set(nullptr);
+	}
+}
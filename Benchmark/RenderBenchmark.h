@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "Renderer/RecordingRenderDevice.h"
+
+/*
+
+  Headless benchmark of the CPU side of a frame: a StubState-like scene (a ground plane and a
+  grid of spheres with the default forward material, a directional shadow caster and the debug
+  lines) is rendered by the SimpleRenderer into a RecordingRenderDevice for a number of frames.
+
+  The camera moves along a fixed path, so every run issues the same commands and the command
+  statistics are exact and comparable between commits; the frame times are wall clock CPU
+  time from pushing the scene to the end of the debug draw. Shaders and textures are loaded
+  from the data directory like in the game, run it from the same working directory.
+
+*/
+namespace RenderBenchmark
+{
+	struct Settings
+	{
+		unsigned int FrameCount = 300;
+		unsigned int WarmupFrames = 10;		// rendered before measuring, not part of the results
+		unsigned int GridSize = 10;			// spheres per side of the grid
+		int Width = 1280;
+		int Height = 720;
+		bool DebugLines = true;				// draw the sphere bounds like StubState does, up to the debug line limit
+		bool PackedVertices = false;		// store the plane and sphere vertices packed instead of as floats
+		FILE* StreamDump = nullptr;			// receives the commands of the first measured frame
+	};
+
+	struct Result
+	{
+		// commands issued while loading and initialising, before the first frame.
+		RecordingRenderDevice::Stats InitStats;
+		// one entry per measured frame.
+		std::vector<double> FrameMilliseconds;
+		std::vector<RecordingRenderDevice::Stats> FrameStats;
+		unsigned int ObjectCount = 0;
+		// bytes of the vertices in the geometry arena.
+		size_t VertexBytes = 0;
+	};
+
+	// renders the scene into device, which is made the current render device for the run.
+	void Run(const Settings& settings, RecordingRenderDevice& device, Result& outResult);
+}
@@ -0,0 +1,217 @@
+#include "RenderBenchmark.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace nlohmann;
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::printf(
+			"usage: RenderBenchmark [options]\n"
+			"  --frames <n>         measured frames (default 300)\n"
+			"  --warmup <n>         frames rendered before measuring (default 10)\n"
+			"  --grid <n>           spheres per side of the sphere grid (default 10)\n"
+			"  --lines <0|1>        draw the debug lines (default 1)\n"
+			"  --packed <0|1>       store the scene's vertices packed (default 0)\n"
+			"  --json <file>        json report (default render_benchmark.json)\n"
+			"  --dump <file>        command stream of the first measured frame, one command per line\n");
+	}
+
+	json StatsToJson(const RecordingRenderDevice::Stats& stats)
+	{
+		json ops = json::object();
+		for (int i = 0; i < static_cast<int>(RecordingRenderDevice::Op::Count); ++i)
+		{
+			if (stats.OpCounts[i] > 0)
+			{
+				ops[RecordingRenderDevice::GetOpName(static_cast<RecordingRenderDevice::Op>(i))] = stats.OpCounts[i];
+			}
+		}
+
+		return json{
+			{ "commands", stats.Commands },
+			{ "draw_calls", stats.DrawCalls },
+			{ "instances", stats.Instances },
+			{ "vertices", stats.Vertices },
+			{ "state_changes", stats.StateChanges },
+			{ "binds", stats.Binds },
+			{ "uniform_uploads", stats.UniformUploads },
+			{ "uniform_bytes", stats.UniformBytes },
+			{ "buffer_uploads", stats.BufferUploads },
+			{ "buffer_bytes", stats.BufferBytes },
+			{ "texture_uploads", stats.TextureUploads },
+			{ "texture_bytes", stats.TextureBytes },
+			{ "clears", stats.Clears },
+			{ "ops", ops }
+		};
+	}
+
+	bool WriteJson(const std::string& path, const RenderBenchmark::Settings& settings, const RenderBenchmark::Result& result)
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			return false;
+		}
+
+		std::vector<double> sorted = result.FrameMilliseconds;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (double ms : sorted)
+		{
+			total += ms;
+		}
+		const size_t count = sorted.size();
+
+		// the scene and camera path are deterministic, so the stats of every frame are reported
+		// to catch changes in a part of the path.
+		json frames = json::array();
+		for (size_t i = 0; i < count; ++i)
+		{
+			const RecordingRenderDevice::Stats& stats = result.FrameStats[i];
+			frames.push_back(json{
+				{ "milliseconds", result.FrameMilliseconds[i] },
+				{ "commands", stats.Commands },
+				{ "draw_calls", stats.DrawCalls },
+				{ "state_changes", stats.StateChanges },
+				{ "binds", stats.Binds },
+				{ "uniform_bytes", stats.UniformBytes },
+				{ "buffer_bytes", stats.BufferBytes }
+			});
+		}
+
+		RecordingRenderDevice::Stats frameTotal;
+		for (const RecordingRenderDevice::Stats& stats : result.FrameStats)
+		{
+			frameTotal.Commands += stats.Commands;
+			frameTotal.DrawCalls += stats.DrawCalls;
+			frameTotal.Instances += stats.Instances;
+			frameTotal.Vertices += stats.Vertices;
+			frameTotal.StateChanges += stats.StateChanges;
+			frameTotal.Binds += stats.Binds;
+			frameTotal.UniformUploads += stats.UniformUploads;
+			frameTotal.UniformBytes += stats.UniformBytes;
+			frameTotal.BufferUploads += stats.BufferUploads;
+			frameTotal.BufferBytes += stats.BufferBytes;
+			frameTotal.TextureUploads += stats.TextureUploads;
+			frameTotal.TextureBytes += stats.TextureBytes;
+			frameTotal.Clears += stats.Clears;
+			for (int i = 0; i < static_cast<int>(RecordingRenderDevice::Op::Count); ++i)
+			{
+				frameTotal.OpCounts[i] += stats.OpCounts[i];
+			}
+		}
+
+		json report = {
+			{ "frames", settings.FrameCount },
+			{ "warmup_frames", settings.WarmupFrames },
+			{ "objects", result.ObjectCount },
+			{ "debug_lines", settings.DebugLines },
+			{ "packed_vertices", settings.PackedVertices },
+			{ "vertex_bytes", result.VertexBytes },
+			{ "cpu_milliseconds", {
+				{ "average", count > 0 ? total / count : 0.0 },
+				{ "median", count > 0 ? sorted[count / 2] : 0.0 },
+				{ "p95", count > 0 ? sorted[std::min(count - 1, count * 95 / 100)] : 0.0 },
+				{ "min", count > 0 ? sorted.front() : 0.0 },
+				{ "max", count > 0 ? sorted.back() : 0.0 }
+			} },
+			{ "init", StatsToJson(result.InitStats) },
+			{ "all_frames", StatsToJson(frameTotal) },
+			{ "per_frame", frames }
+		};
+		file << report.dump(4) << std::endl;
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	RenderBenchmark::Settings settings;
+	std::string jsonPath = "render_benchmark.json";
+	std::string dumpPath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0 || !value)
+		{
+			PrintUsage();
+			return std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0 ? 0 : 1;
+		}
+
+		if (std::strcmp(arg, "--frames") == 0)
+		{
+			settings.FrameCount = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+		}
+		else if (std::strcmp(arg, "--warmup") == 0)
+		{
+			settings.WarmupFrames = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+		}
+		else if (std::strcmp(arg, "--grid") == 0)
+		{
+			settings.GridSize = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+		}
+		else if (std::strcmp(arg, "--lines") == 0)
+		{
+			settings.DebugLines = std::strtoul(value, nullptr, 10) != 0;
+		}
+		else if (std::strcmp(arg, "--packed") == 0)
+		{
+			settings.PackedVertices = std::strtoul(value, nullptr, 10) != 0;
+		}
+		else if (std::strcmp(arg, "--json") == 0)
+		{
+			jsonPath = value;
+		}
+		else if (std::strcmp(arg, "--dump") == 0)
+		{
+			dumpPath = value;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+		++i;
+	}
+
+	FILE* dump = nullptr;
+	if (!dumpPath.empty())
+	{
+		dump = std::fopen(dumpPath.c_str(), "w");
+		if (!dump)
+		{
+			std::fprintf(stderr, "failed to write %s\n", dumpPath.c_str());
+			return 1;
+		}
+		settings.StreamDump = dump;
+	}
+
+	RecordingRenderDevice device;
+	RenderBenchmark::Result result;
+	RenderBenchmark::Run(settings, device, result);
+
+	if (dump)
+	{
+		std::fclose(dump);
+	}
+
+	if (!WriteJson(jsonPath, settings, result))
+	{
+		std::fprintf(stderr, "failed to write %s\n", jsonPath.c_str());
+		return 1;
+	}
+	std::printf("wrote %s\n", jsonPath.c_str());
+	return 0;
+}
@@ -0,0 +1,620 @@
+#include "SpatialBenchmark.h"
+
+#include "Camera/CameraFrustum.h"
+#include "Systems/AABB.h"
+#include "Systems/BoundingFrustum.h"
+#include "Systems/Octree.h"
+#include "Systems/QuadTree.h"
+#include "Systems/Rect.h"
+#include "Systems/SpatialHashGrid.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace SpatialBenchmark
+{
+	namespace
+	{
+		// object half extents are in [s_minExtent, s_maxExtent], boxes are s_spacing apart on average.
+		const float s_minExtent = 0.25f;
+		const float s_maxExtent = 1.0f;
+		const float s_spacing = 4.0f;
+		const unsigned int s_clusterCount = 32;
+
+		const float s_queryHalfSize = 4.0f;
+		const float s_frustumFar = 32.0f;
+		const float s_rayLength = 64.0f;
+		const float s_gridCellSize = 4.0f;
+
+		// splitmix64; <random>'s distributions differ between standard libraries.
+		class Random
+		{
+		public:
+			explicit Random(uint64_t seed)
+				: m_state(seed)
+			{ }
+
+			uint64_t Next()
+			{
+				uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+				return z ^ (z >> 31);
+			}
+
+			// [0, 1)
+			float Float() { return static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f); }
+			float Range(float min, float max) { return min + (max - min) * Float(); }
+			unsigned int Index(unsigned int count) { return static_cast<unsigned int>(Next() % count); }
+
+			glm::vec3 Direction()
+			{
+				for (;;)
+				{
+					const glm::vec3 v(Range(-1.0f, 1.0f), Range(-1.0f, 1.0f), Range(-1.0f, 1.0f));
+					const float lengthSq = glm::dot(v, v);
+					if (lengthSq > 0.01f && lengthSq <= 1.0f)
+					{
+						return v / std::sqrt(lengthSq);
+					}
+				}
+			}
+
+		private:
+			uint64_t m_state;
+		};
+
+		class Timer
+		{
+		public:
+			Timer()
+				: m_start(std::chrono::high_resolution_clock::now())
+			{ }
+
+			double GetMilliseconds() const
+			{
+				const auto elapsed = std::chrono::high_resolution_clock::now() - m_start;
+				return std::chrono::duration<double, std::milli>(elapsed).count();
+			}
+
+		private:
+			std::chrono::high_resolution_clock::time_point m_start;
+		};
+
+		struct Ray
+		{
+			glm::vec3 Origin;
+			glm::vec3 Direction;
+		};
+
+		struct Frustum
+		{
+			glm::mat4 ViewProjection;
+			CameraFrustum Planes;
+		};
+
+		// the queries every structure runs for one data set.
+		struct Workload
+		{
+			const Dataset* Data;
+			std::vector<bvh::Bounds> EditBoxes;
+			std::vector<bvh::Bounds> AabbQueries;
+			std::vector<Frustum> Frustums;
+			std::vector<Ray> Rays;
+		};
+
+		// inward facing planes in CameraFrustum order (left, right, top, bottom, near, far).
+		void ExtractPlanes(const glm::mat4& m, CameraFrustum& outFrustum)
+		{
+			const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+			const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+			const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+			const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+			const glm::vec4 planes[6] = { row3 + row0, row3 - row0, row3 - row1, row3 + row1, row3 + row2, row3 - row2 };
+
+			for (int i = 0; i < 6; ++i)
+			{
+				outFrustum.Planes[i].Normal = glm::vec3(planes[i].x, planes[i].y, planes[i].z);
+				outFrustum.Planes[i].D = planes[i].w;
+				outFrustum.Planes[i].Normalize();
+			}
+		}
+
+		// slab test; entry distance in outT, 0 when the origin is inside.
+		bool IntersectRay(const bvh::Bounds& box, const Ray& ray, float maxT, float& outT)
+		{
+			float tMin = 0.0f;
+			float tMax = maxT;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float invD = 1.0f / ray.Direction[axis];
+				float t0 = (box.min[axis] - ray.Origin[axis]) * invD;
+				float t1 = (box.max[axis] - ray.Origin[axis]) * invD;
+				if (t0 > t1)
+				{
+					std::swap(t0, t1);
+				}
+				tMin = t0 > tMin ? t0 : tMin;
+				tMax = t1 < tMax ? t1 : tMax;
+				if (tMin > tMax)
+				{
+					return false;
+				}
+			}
+			outT = tMin;
+			return true;
+		}
+
+		glm::vec3 Center(const bvh::Bounds& box)
+		{
+			return (box.min + box.max) * 0.5f;
+		}
+
+		Workload CreateWorkload(const Dataset& data, const Settings& settings, uint32_t seed)
+		{
+			Workload workload;
+			workload.Data = &data;
+
+			const unsigned int count = static_cast<unsigned int>(data.Boxes.size());
+			const unsigned int editCount = std::min(settings.EditCount, count);
+			workload.EditBoxes = GenerateDataset(data.Type, count, seed + 1).Boxes;
+			workload.EditBoxes.resize(editCount);
+
+			// queries start at existing objects so they hit something at every density.
+			Random random(seed + 2);
+			for (unsigned int i = 0; i < settings.AabbQueryCount; ++i)
+			{
+				const glm::vec3 center = Center(data.Boxes[random.Index(count)]);
+				workload.AabbQueries.push_back(bvh::Bounds(center - glm::vec3(s_queryHalfSize), center + glm::vec3(s_queryHalfSize)));
+			}
+
+			for (unsigned int i = 0; i < settings.FrustumQueryCount; ++i)
+			{
+				const glm::vec3 eye = Center(data.Boxes[random.Index(count)]);
+				const glm::vec3 forward = random.Direction();
+				const glm::vec3 up = std::fabs(forward.y) > 0.95f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+				Frustum frustum;
+				frustum.ViewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, s_frustumFar)
+					* glm::lookAt(eye, eye + forward, up);
+				ExtractPlanes(frustum.ViewProjection, frustum.Planes);
+				workload.Frustums.push_back(frustum);
+			}
+
+			for (unsigned int i = 0; i < settings.RayQueryCount; ++i)
+			{
+				const glm::vec3 origin = Center(data.Boxes[random.Index(count)]) + random.Direction() * s_spacing;
+				workload.Rays.push_back({ origin, random.Direction() });
+			}
+			return workload;
+		}
+
+		void AddTiming(Result& result, const char* operation, unsigned int operationCount, double milliseconds, uint64_t resultCount = 0)
+		{
+			result.Timings.push_back({ operation, operationCount, milliseconds, resultCount });
+		}
+
+		void AddMetric(Result& result, const char* name, double value)
+		{
+			result.Metrics.push_back({ name, value });
+		}
+
+		Result CreateResult(const char* structure, const Workload& workload)
+		{
+			Result result;
+			result.Structure = structure;
+			result.Distribution = GetDistributionName(workload.Data->Type);
+			result.ObjectCount = static_cast<unsigned int>(workload.Data->Boxes.size());
+			result.MemoryBytes = 0;
+			return result;
+		}
+
+		Result RunBruteForce(const Workload& workload)
+		{
+			Result result = CreateResult("BruteForce", workload);
+			const std::vector<bvh::Bounds>& boxes = workload.Data->Boxes;
+			const unsigned int count = static_cast<unsigned int>(boxes.size());
+
+			std::vector<bvh::Bounds> objects;
+			std::vector<unsigned int> ids;
+			std::vector<unsigned int> slots;	// id -> position in objects
+
+			Timer buildTimer;
+			objects = boxes;
+			ids.resize(count);
+			slots.resize(count);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				ids[i] = i;
+				slots[i] = i;
+			}
+			AddTiming(result, "build", count, buildTimer.GetMilliseconds());
+			result.MemoryBytes = objects.capacity() * sizeof(bvh::Bounds) + (ids.capacity() + slots.capacity()) * sizeof(unsigned int);
+
+			const unsigned int editCount = static_cast<unsigned int>(workload.EditBoxes.size());
+			Timer insertTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				slots.push_back(static_cast<unsigned int>(objects.size()));
+				ids.push_back(count + i);
+				objects.push_back(workload.EditBoxes[i]);
+			}
+			AddTiming(result, "insert", editCount, insertTimer.GetMilliseconds());
+
+			Timer removeTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				// swap with the last object.
+				const unsigned int slot = slots[count + i];
+				objects[slot] = objects.back();
+				ids[slot] = ids.back();
+				slots[ids[slot]] = slot;
+				objects.pop_back();
+				ids.pop_back();
+			}
+			slots.resize(count);
+			AddTiming(result, "remove", editCount, removeTimer.GetMilliseconds());
+
+			uint64_t found = 0;
+			Timer aabbTimer;
+			for (const bvh::Bounds& query : workload.AabbQueries)
+			{
+				for (const bvh::Bounds& box : objects)
+				{
+					found += box.Overlaps(query);
+				}
+			}
+			AddTiming(result, "aabb_query", static_cast<unsigned int>(workload.AabbQueries.size()), aabbTimer.GetMilliseconds(), found);
+
+			found = 0;
+			Timer frustumTimer;
+			for (const Frustum& query : workload.Frustums)
+			{
+				CameraFrustum frustum = query.Planes;
+				for (const bvh::Bounds& box : objects)
+				{
+					found += frustum.Intersect(box.min, box.max);
+				}
+			}
+			AddTiming(result, "frustum_query", static_cast<unsigned int>(workload.Frustums.size()), frustumTimer.GetMilliseconds(), found);
+
+			found = 0;
+			Timer rayTimer;
+			for (const Ray& ray : workload.Rays)
+			{
+				float closest = s_rayLength;
+				bool hit = false;
+				for (const bvh::Bounds& box : objects)
+				{
+					float t;
+					if (IntersectRay(box, ray, closest, t))
+					{
+						closest = t;
+						hit = true;
+					}
+				}
+				found += hit;
+			}
+			AddTiming(result, "ray_query", static_cast<unsigned int>(workload.Rays.size()), rayTimer.GetMilliseconds(), found);
+			return result;
+		}
+
+		Result RunOctree(const Workload& workload)
+		{
+			Result result = CreateResult("Octree", workload);
+			const std::vector<bvh::Bounds>& boxes = workload.Data->Boxes;
+			const unsigned int count = static_cast<unsigned int>(boxes.size());
+
+			Timer buildTimer;
+			Octree tree(glm::vec3(0.0f), workload.Data->HalfSize);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				tree.Insert(i, AABB(boxes[i].min, boxes[i].max));
+			}
+			AddTiming(result, "build", count, buildTimer.GetMilliseconds());
+			result.MemoryBytes = tree.GetMemoryUsage();
+			AddMetric(result, "nodes", static_cast<double>(tree.GetNodeCount()));
+
+			const unsigned int editCount = static_cast<unsigned int>(workload.EditBoxes.size());
+			Timer insertTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				tree.Insert(count + i, AABB(workload.EditBoxes[i].min, workload.EditBoxes[i].max));
+			}
+			AddTiming(result, "insert", editCount, insertTimer.GetMilliseconds());
+
+			Timer removeTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				tree.Remove(count + i);
+			}
+			AddTiming(result, "remove", editCount, removeTimer.GetMilliseconds());
+
+			std::vector<unsigned int> found;
+			Timer aabbTimer;
+			for (const bvh::Bounds& query : workload.AabbQueries)
+			{
+				tree.Search(AABB(query.min, query.max), found);
+			}
+			AddTiming(result, "aabb_query", static_cast<unsigned int>(workload.AabbQueries.size()), aabbTimer.GetMilliseconds(), found.size());
+
+			found.clear();
+			Timer frustumTimer;
+			for (const Frustum& query : workload.Frustums)
+			{
+				tree.Search(BoundingFrustum(query.ViewProjection), found);
+			}
+			AddTiming(result, "frustum_query", static_cast<unsigned int>(workload.Frustums.size()), frustumTimer.GetMilliseconds(), found.size());
+			return result;
+		}
+
+		// points at the box centers on the xz plane; box queries become square range queries.
+		Result RunQuadTree(const Workload& workload)
+		{
+			Result result = CreateResult("QuadTree", workload);
+			const std::vector<bvh::Bounds>& boxes = workload.Data->Boxes;
+			const unsigned int count = static_cast<unsigned int>(boxes.size());
+
+			Timer buildTimer;
+			QuadTree tree(glm::vec2(0.0f), workload.Data->HalfSize);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				tree.Insert(i, Center(boxes[i]));
+			}
+			AddTiming(result, "build", count, buildTimer.GetMilliseconds());
+			result.MemoryBytes = tree.GetMemoryUsage();
+			AddMetric(result, "nodes", static_cast<double>(tree.GetNodeCount()));
+
+			const unsigned int editCount = static_cast<unsigned int>(workload.EditBoxes.size());
+			Timer insertTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				tree.Insert(count + i, Center(workload.EditBoxes[i]));
+			}
+			AddTiming(result, "insert", editCount, insertTimer.GetMilliseconds());
+
+			Timer removeTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				tree.Remove(count + i);
+			}
+			AddTiming(result, "remove", editCount, removeTimer.GetMilliseconds());
+
+			std::vector<unsigned int> found;
+			Timer aabbTimer;
+			for (const bvh::Bounds& query : workload.AabbQueries)
+			{
+				const glm::vec3 center = Center(query);
+				tree.Search(Rect(glm::vec2(center.x, center.z), s_queryHalfSize), found);
+			}
+			AddTiming(result, "aabb_query", static_cast<unsigned int>(workload.AabbQueries.size()), aabbTimer.GetMilliseconds(), found.size());
+			return result;
+		}
+
+		void AddTreeMetrics(Result& result, const bvh::Tree& tree, const char* suffix)
+		{
+			const std::string postfix = suffix;
+			result.Metrics.push_back({ "sah_cost" + postfix, tree.ComputeCost() });
+			result.Metrics.push_back({ "area_ratio" + postfix, tree.GetAreaRatio() });
+			result.Metrics.push_back({ "height" + postfix, static_cast<double>(tree.GetHeight()) });
+			result.Metrics.push_back({ "max_balance" + postfix, static_cast<double>(tree.GetMaxBalance()) });
+		}
+
+		Result RunBVH(const Workload& workload)
+		{
+			Result result = CreateResult("BVH", workload);
+			const std::vector<bvh::Bounds>& boxes = workload.Data->Boxes;
+			const unsigned int count = static_cast<unsigned int>(boxes.size());
+
+			Timer buildTimer;
+			bvh::Tree tree = bvh::BuildLinear(boxes.data(), static_cast<int>(count));
+			AddTiming(result, "build", count, buildTimer.GetMilliseconds());
+			result.MemoryBytes = tree.m_nodes.capacity() * sizeof(bvh::Node);
+			AddMetric(result, "nodes", static_cast<double>(tree.nodeCount));
+			AddTreeMetrics(result, tree, "");
+
+			const unsigned int editCount = static_cast<unsigned int>(workload.EditBoxes.size());
+			std::vector<int> proxies(editCount);
+			Timer insertTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				proxies[i] = tree.InsertNode(static_cast<int>(count + i), workload.EditBoxes[i]);
+			}
+			AddTiming(result, "insert", editCount, insertTimer.GetMilliseconds());
+			AddTreeMetrics(result, tree, "_after_insert");
+
+			Timer removeTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				tree.Remove(proxies[i]);
+			}
+			AddTiming(result, "remove", editCount, removeTimer.GetMilliseconds());
+
+			std::vector<int> found;
+			Timer aabbTimer;
+			for (const bvh::Bounds& query : workload.AabbQueries)
+			{
+				tree.Overlap(query, found);
+			}
+			AddTiming(result, "aabb_query", static_cast<unsigned int>(workload.AabbQueries.size()), aabbTimer.GetMilliseconds(), found.size());
+
+			found.clear();
+			Timer frustumTimer;
+			for (const Frustum& query : workload.Frustums)
+			{
+				tree.CullFrustum(query.Planes, found);
+			}
+			AddTiming(result, "frustum_query", static_cast<unsigned int>(workload.Frustums.size()), frustumTimer.GetMilliseconds(), found.size());
+
+			uint64_t hits = 0;
+			Timer rayTimer;
+			for (const Ray& ray : workload.Rays)
+			{
+				bvh::RayHit hit;
+				hits += tree.RayCast(ray.Origin, ray.Direction, s_rayLength, hit);
+			}
+			AddTiming(result, "ray_query", static_cast<unsigned int>(workload.Rays.size()), rayTimer.GetMilliseconds(), hits);
+			return result;
+		}
+
+		Result RunHashGrid(const Workload& workload)
+		{
+			Result result = CreateResult("SpatialHashGrid", workload);
+			const std::vector<bvh::Bounds>& boxes = workload.Data->Boxes;
+			const unsigned int count = static_cast<unsigned int>(boxes.size());
+
+			std::vector<unsigned int> ids(count);
+			std::vector<glm::vec3> mins(count);
+			std::vector<glm::vec3> maxs(count);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				ids[i] = i;
+				mins[i] = boxes[i].min;
+				maxs[i] = boxes[i].max;
+			}
+
+			SpatialHashGrid grid(s_gridCellSize);
+			Timer buildTimer;
+			grid.Rebuild(ids.data(), mins.data(), maxs.data(), count);
+			AddTiming(result, "build", count, buildTimer.GetMilliseconds());
+			result.MemoryBytes = grid.GetMemoryUsage();
+			AddMetric(result, "cells", static_cast<double>(grid.GetCellCount()));
+			AddMetric(result, "entries_per_object", static_cast<double>(grid.GetEntryCount()) / std::max(1u, count));
+
+			// a second rebuild reuses the scratch buffers, which is the per frame cost.
+			Timer rebuildTimer;
+			grid.Rebuild(ids.data(), mins.data(), maxs.data(), count);
+			AddTiming(result, "rebuild", count, rebuildTimer.GetMilliseconds());
+
+			const unsigned int editCount = static_cast<unsigned int>(workload.EditBoxes.size());
+			Timer insertTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				grid.Insert(count + i, workload.EditBoxes[i].min, workload.EditBoxes[i].max);
+			}
+			AddTiming(result, "insert", editCount, insertTimer.GetMilliseconds());
+
+			Timer removeTimer;
+			for (unsigned int i = 0; i < editCount; ++i)
+			{
+				grid.Remove(count + i);
+			}
+			AddTiming(result, "remove", editCount, removeTimer.GetMilliseconds());
+
+			std::vector<unsigned int> found;
+			Timer aabbTimer;
+			for (const bvh::Bounds& query : workload.AabbQueries)
+			{
+				grid.Search(AABB(query.min, query.max), found);
+			}
+			AddTiming(result, "aabb_query", static_cast<unsigned int>(workload.AabbQueries.size()), aabbTimer.GetMilliseconds(), found.size());
+
+			found.clear();
+			Timer frustumTimer;
+			for (const Frustum& query : workload.Frustums)
+			{
+				grid.Search(query.Planes, found);
+			}
+			AddTiming(result, "frustum_query", static_cast<unsigned int>(workload.Frustums.size()), frustumTimer.GetMilliseconds(), found.size());
+			return result;
+		}
+	}
+
+	const char* GetDistributionName(Distribution distribution)
+	{
+		switch (distribution)
+		{
+		case Distribution::Uniform: return "uniform";
+		case Distribution::Clustered: return "clustered";
+		case Distribution::Planar: return "planar";
+		}
+		return "unknown";
+	}
+
+	Dataset GenerateDataset(Distribution distribution, unsigned int count, uint32_t seed)
+	{
+		Dataset data;
+		data.Type = distribution;
+		data.Boxes.reserve(count);
+
+		Random random((static_cast<uint64_t>(seed) << 32) ^ (static_cast<uint64_t>(distribution) << 24) ^ count);
+
+		// planar sets spread over an area instead of a volume to keep the same spacing.
+		const float volumeHalfSize = 0.5f * s_spacing * std::cbrt(static_cast<float>(count));
+		const float areaHalfSize = 0.5f * s_spacing * std::sqrt(static_cast<float>(count));
+		data.HalfSize = (distribution == Distribution::Planar ? areaHalfSize : volumeHalfSize) + s_maxExtent;
+
+		std::vector<glm::vec3> clusters(s_clusterCount);
+		for (glm::vec3& cluster : clusters)
+		{
+			cluster = glm::vec3(random.Range(-0.75f, 0.75f), random.Range(-0.75f, 0.75f), random.Range(-0.75f, 0.75f)) * volumeHalfSize;
+		}
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			glm::vec3 center;
+			switch (distribution)
+			{
+			case Distribution::Uniform:
+				center = glm::vec3(random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f)) * volumeHalfSize;
+				break;
+			case Distribution::Clustered:
+			{
+				// sum of three uniforms approximates a normal distribution around the cluster.
+				const glm::vec3& cluster = clusters[random.Index(s_clusterCount)];
+				glm::vec3 offset;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					offset[axis] = random.Float() + random.Float() + random.Float() - 1.5f;
+				}
+				center = glm::clamp(cluster + offset * (volumeHalfSize * 0.125f), glm::vec3(-volumeHalfSize), glm::vec3(volumeHalfSize));
+				break;
+			}
+			case Distribution::Planar:
+				center = glm::vec3(random.Range(-areaHalfSize, areaHalfSize), random.Range(-2.0f, 2.0f), random.Range(-areaHalfSize, areaHalfSize));
+				break;
+			}
+
+			const glm::vec3 extent(random.Range(s_minExtent, s_maxExtent), random.Range(s_minExtent, s_maxExtent), random.Range(s_minExtent, s_maxExtent));
+			data.Boxes.push_back(bvh::Bounds(center - extent, center + extent));
+		}
+		return data;
+	}
+
+	void Run(const Settings& settings, std::vector<Result>& outResults)
+	{
+		for (Distribution distribution : settings.Distributions)
+		{
+			for (unsigned int count : settings.ObjectCounts)
+			{
+				if (count == 0)
+				{
+					continue;
+				}
+
+				const Dataset data = GenerateDataset(distribution, count, settings.Seed);
+				const Workload workload = CreateWorkload(data, settings, settings.Seed);
+				std::printf("%s, %u objects\n", GetDistributionName(distribution), count);
+
+				Result (*runs[])(const Workload&) = { RunBruteForce, RunOctree, RunQuadTree, RunBVH, RunHashGrid };
+				for (auto run : runs)
+				{
+					outResults.push_back(run(workload));
+
+					const Result& result = outResults.back();
+					std::printf("  %-16s %10.1f KB\n", result.Structure.c_str(), result.MemoryBytes / 1024.0);
+					for (const Timing& timing : result.Timings)
+					{
+						std::printf("    %-14s %10.3f ms %14.0f ops/s %12llu results\n", timing.Operation.c_str(), timing.Milliseconds,
+							timing.Milliseconds > 0.0 ? timing.OperationCount * 1000.0 / timing.Milliseconds : 0.0,
+							static_cast<unsigned long long>(timing.ResultCount));
+					}
+				}
+			}
+		}
+	}
+}
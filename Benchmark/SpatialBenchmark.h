@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Systems/BVH.h"
+
+/*
+
+  Headless benchmark of the spatial structures in Engine/Systems (Octree, QuadTree, bvh::Tree,
+  SpatialHashGrid) against a brute force baseline.
+
+  Every structure is built from the same deterministic box set and runs the same edits and
+  queries, so result counts can be compared across structures and timings across runs. Data
+  sets keep a constant object density, so query selectivity stays similar from 1e3 to 1e6
+  objects. Operations a structure doesn't support (rays on the octree, frustums on the 2D
+  quadtree, ...) are left out of its results rather than emulated.
+
+*/
+namespace SpatialBenchmark
+{
+	enum class Distribution
+	{
+		Uniform = 0,	// boxes spread evenly through a cube
+		Clustered,		// boxes gathered around a few dozen centers
+		Planar			// boxes on a thin slab, like props on terrain
+	};
+
+	const char* GetDistributionName(Distribution distribution);
+
+	struct Dataset
+	{
+		Distribution Type;
+		float HalfSize;		// every box lies within [-HalfSize, HalfSize] on all axes
+		std::vector<bvh::Bounds> Boxes;
+	};
+
+	// same output for a given seed on every platform and standard library.
+	Dataset GenerateDataset(Distribution distribution, unsigned int count, uint32_t seed);
+
+	struct Timing
+	{
+		std::string Operation;
+		unsigned int OperationCount;
+		double Milliseconds;
+		uint64_t ResultCount;	// objects reported by the queries, 0 for build and edits
+	};
+
+	struct Metric
+	{
+		std::string Name;
+		double Value;
+	};
+
+	struct Result
+	{
+		std::string Structure;
+		std::string Distribution;
+		unsigned int ObjectCount;
+		size_t MemoryBytes;		// after the build, before the edits
+		std::vector<Timing> Timings;
+		std::vector<Metric> Metrics;
+	};
+
+	struct Settings
+	{
+		std::vector<unsigned int> ObjectCounts = { 1000, 10000, 100000, 1000000 };
+		std::vector<Distribution> Distributions = { Distribution::Uniform, Distribution::Clustered, Distribution::Planar };
+		unsigned int EditCount = 10000;		// objects inserted and removed again, capped at the object count
+		unsigned int AabbQueryCount = 1000;
+		unsigned int FrustumQueryCount = 20;
+		unsigned int RayQueryCount = 1000;
+		uint32_t Seed = 1;
+	};
+
+	// runs every structure on every distribution and object count, appending one result per run.
+	void Run(const Settings& settings, std::vector<Result>& outResults);
+}
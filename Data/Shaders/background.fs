@@ -4,7 +4,10 @@ in vec3 WorldPos;
 
 uniform samplerCube background;
 
-uniform float lodLevel;
+layout (std140) uniform Material
+{
+    float lodLevel;
+};
 
 void main()
 {
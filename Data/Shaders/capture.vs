@@ -11,11 +11,13 @@ uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+#include common/vertex_decode.glsl
+
 void main()
 {
 	TexCoords = texCoords;
-	FragPos   = vec3(model * vec4(pos, 1.0f));
-	Normal    = mat3(model) * normal;
+	FragPos   = vec3(model * vec4(DecodePosition(pos, PackedOrigin, PackedExtent), 1.0f));
+	Normal    = mat3(model) * DecodeNormal(normal, PackedExtent);
 	
 	gl_Position =  projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -39,4 +39,36 @@ float ShadowFactor(sampler2D shadowMap, vec4 fragPosLightSpace, vec3 N, vec3 L)
         return 1.0;
     }
 }
+// cascaded shadow maps of a directional light, see ShadowCascades. CascadeSplits holds the far
+// view depth of each cascade; unused entries repeat the last one.
+uniform int CascadeCount;
+uniform vec4 CascadeSplits;
+uniform sampler2D CascadeShadowMap0;
+uniform sampler2D CascadeShadowMap1;
+uniform sampler2D CascadeShadowMap2;
+uniform sampler2D CascadeShadowMap3;
+uniform mat4 CascadeViewProjection0;
+uniform mat4 CascadeViewProjection1;
+uniform mat4 CascadeViewProjection2;
+uniform mat4 CascadeViewProjection3;
+
+float CascadedShadowFactor(vec3 worldPos, float viewDepth, vec3 N, vec3 L)
+{
+    if(!ShadowsEnabled)
+        return 0.0;
+
+    // first cascade whose far split is past the fragment; no shadows beyond the last one.
+    int cascade = int(viewDepth > CascadeSplits.x) + int(viewDepth > CascadeSplits.y) + int(viewDepth > CascadeSplits.z) + int(viewDepth > CascadeSplits.w);
+    if(cascade >= CascadeCount)
+        return 0.0;
+
+    // samplers can only be indexed with constants in 330.
+    if(cascade == 0)
+        return ShadowFactor(CascadeShadowMap0, CascadeViewProjection0 * vec4(worldPos, 1.0), N, L);
+    else if(cascade == 1)
+        return ShadowFactor(CascadeShadowMap1, CascadeViewProjection1 * vec4(worldPos, 1.0), N, L);
+    else if(cascade == 2)
+        return ShadowFactor(CascadeShadowMap2, CascadeViewProjection2 * vec4(worldPos, 1.0), N, L);
+    return ShadowFactor(CascadeShadowMap3, CascadeViewProjection3 * vec4(worldPos, 1.0), N, L);
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef VERTEX_DECODE_GLSL
+#define VERTEX_DECODE_GLSL
+// decoding of packed vertices (VERTEX_ENCODING::PACKED, see VertexPacking.h). Packed meshes
+// have PackedExtent.w set to 1; for float vertices the attributes pass through unchanged.
+uniform vec4 PackedOrigin;
+uniform vec4 PackedExtent;
+
+// ----------------------------------------------------------------------------
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0);
+	v.x += v.x >= 0.0 ? -t : t;
+	v.y += v.y >= 0.0 ? -t : t;
+	return normalize(v);
+}
+
+// ----------------------------------------------------------------------------
+// the position is unsigned normalized within the mesh's bounding box.
+vec3 DecodePosition(vec3 position, vec4 origin, vec4 extent)
+{
+	return extent.w > 0.0 ? origin.xyz + position * extent.xyz : position;
+}
+
+// ----------------------------------------------------------------------------
+// octahedral in 2 x 16 bit, read as integers.
+vec3 DecodeNormal(vec3 normal, vec4 extent)
+{
+	return extent.w > 0.0 ? OctahedralDecode(clamp(normal.xy / 32767.0, -1.0, 1.0)) : normal;
+}
+
+// ----------------------------------------------------------------------------
+// octahedral in the 10 bit x and y, read as integers, and the handedness in w. Float tangents
+// come with w = 1 as the attribute has 3 components.
+vec4 DecodeTangent(vec4 tangent, vec4 extent)
+{
+	if (extent.w > 0.0)
+		return vec4(OctahedralDecode(clamp(tangent.xy / 511.0, -1.0, 1.0)), tangent.w < 0.0 ? -1.0 : 1.0);
+	return tangent;
+}
+#endif
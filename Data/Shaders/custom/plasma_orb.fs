@@ -7,7 +7,10 @@ in vec3 Normal;
 
 #include ../common/uniforms.glsl
 
-uniform vec3 PlasmaColor;
+layout (std140) uniform Material
+{
+    vec3 PlasmaColor;
+};
 
 void main()
 {
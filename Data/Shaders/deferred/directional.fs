@@ -15,9 +15,6 @@ uniform sampler2D gAlbedoAO;
 uniform vec3 lightDir;
 uniform vec3 lightColor;
 
-uniform sampler2D lightShadowMap;
-uniform mat4 lightShadowViewProjection;
-
 void main()
 {
     vec4 albedoAO = texture(gAlbedoAO, TexCoords);
@@ -43,8 +40,8 @@ void main()
     vec3 radiance = lightColor;        
     
     // light shadow
-    vec4 fragPosLightSpace = lightShadowViewProjection * vec4(worldPos, 1.0);
-    float shadow = ShadowFactor(lightShadowMap, fragPosLightSpace, N, L);
+    float viewDepth = -(view * vec4(worldPos, 1.0)).z;
+    float shadow = CascadedShadowFactor(worldPos, viewDepth, N, L);
     
     // cook-torrance brdf
     float NDF = DistributionGGX(N, H, roughness);        
@@ -16,13 +16,21 @@ uniform sampler2D TexMetallic;
 uniform sampler2D TexRoughness;
 uniform sampler2D TexAO;
 
+layout (std140) uniform Material
+{
+    vec4 AlbedoFactor;
+    float MetallicFactor;
+    float RoughnessFactor;
+    float AOFactor;
+};
+
 void main()
 {    
     // store the fragment position vector in the first gbuffer texture
     gPositionMetallic.rgb = FragPos;
-    gPositionMetallic.a = texture(TexMetallic, UV0).r;
+    gPositionMetallic.a = texture(TexMetallic, UV0).r * MetallicFactor;
     // also store the per-fragment (bump-)normals into the gbuffer
-    float roughness = texture(TexRoughness, UV0).r;
+    float roughness = texture(TexRoughness, UV0).r * RoughnessFactor;
     vec3 N = texture(TexNormal, UV0).rgb;    
     N = normalize(N * 2.0 - 1.0);
     // N = mix(N, vec3(0.0, 0.0, 1.0), pow(roughness, 0.5)); // smooth normal based on roughness (to reduce specular aliasing)
@@ -33,8 +41,8 @@ void main()
     gNormalRoughness.rgb = normalize(N);
     gNormalRoughness.a = roughness;
     // and the diffuse per-fragment color
-    gAlbedoAO.rgb = texture(TexAlbedo, UV0).rgb;
-    gAlbedoAO.a = texture(TexAO, UV0).r;
+    gAlbedoAO.rgb = texture(TexAlbedo, UV0).rgb * AlbedoFactor.rgb;
+    gAlbedoAO.a = texture(TexAO, UV0).r * AOFactor;
     // per-fragment motion vector
     vec2 clipSpace = ClipSpacePos.xy / ClipSpacePos.w;
     vec2 prevClipSpace = PrevClipSpacePos.xy / PrevClipSpacePos.w;
@@ -2,7 +2,7 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aUV0;
 layout (location = 2) in vec3 aNormal;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
 out vec2 UV0;
@@ -12,6 +12,7 @@ out vec4 ClipSpacePos;
 out vec4 PrevClipSpacePos;
 
 #include ../common/uniforms.glsl
+#include ../common/vertex_decode.glsl
 
 uniform mat4 model;
 uniform mat4 prevModel;
@@ -20,14 +21,17 @@ float time;
 
 void main()
 {
+	vec3 position = DecodePosition(aPos, PackedOrigin, PackedExtent);
+	vec4 tangent = DecodeTangent(aTangent, PackedExtent);
+
 	UV0 = aUV0;
-	FragPos = vec3(model * vec4(aPos, 1.0));
+	FragPos = vec3(model * vec4(position, 1.0));
         
-    vec3 N = normalize(mat3(model) * aNormal);
-    vec3 T = normalize(mat3(model) * aTangent);
+    vec3 N = normalize(mat3(model) * DecodeNormal(aNormal, PackedExtent));
+    vec3 T = normalize(mat3(model) * tangent.xyz);
     T = normalize(T - dot(N, T) * N);
-    // vec3 B = cross(N, T);
-    vec3 B = normalize(mat3(model) * aBitangent);
+    // packed vertices have no bitangent but its handedness.
+    vec3 B = PackedExtent.w > 0.0 ? cross(N, T) * tangent.w : normalize(mat3(model) * aBitangent);
 
     // TBN must form a right handed coord system.
     // Some models have symetric UVs. Check and fix.
@@ -36,8 +40,8 @@ void main()
     
     TBN = mat3(T, B, N);
     
-    ClipSpacePos     = viewProjection * model * vec4(aPos, 1.0);
-    PrevClipSpacePos = prevViewProjection * prevModel * vec4(aPos, 1.0);
+    ClipSpacePos     = viewProjection * model * vec4(position, 1.0);
+    PrevClipSpacePos = prevViewProjection * prevModel * vec4(position, 1.0);
 	
 	gl_Position =  projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -16,19 +16,24 @@ uniform sampler2D TexMetallic;
 uniform sampler2D TexRoughness;
 uniform sampler2D TexAO;
 
-uniform sampler2D lightShadowMap1;
-uniform mat4 lightShadowViewProjection1;
+layout (std140) uniform Material
+{
+    vec4 AlbedoFactor;
+    float MetallicFactor;
+    float RoughnessFactor;
+    float AOFactor;
+};
 
 void main()
 {
-    vec4 albedo = texture(TexAlbedo, TexCoords);
+    vec4 albedo = texture(TexAlbedo, TexCoords) * AlbedoFactor;
 
     #ifdef ALPHA_BLEND
         albedo.rgb *= albedo.a; // pre-multiplied alpha
     #endif
 
-    float metallic = texture(TexMetallic, TexCoords).r;
-    float roughness = texture(TexRoughness, TexCoords).r;
+    float metallic = texture(TexMetallic, TexCoords).r * MetallicFactor;
+    float roughness = texture(TexRoughness, TexCoords).r * RoughnessFactor;
     vec3 N = normalize(Normal); // TODO: normal mapping
     vec3 L = normalize(-dirLight0_Dir.xyz);
     
@@ -39,8 +44,8 @@ void main()
 
     vec3 color = 0.3 + albedo.xyz * dot(N, L);
 
-    vec4 fragPosLightSpace = lightShadowViewProjection1 * vec4(FragPos, 1.0);
-    float shadow = ShadowFactor(lightShadowMap1, fragPosLightSpace, N, L);
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    float shadow = CascadedShadowFactor(FragPos, viewDepth, N, L);
     color.rgb *= max(1.0 - shadow, 0.1);
                       
     #ifdef ALPHA_DISCARD
@@ -1,21 +1,71 @@
 #version 330 core
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+#endif
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec2 texCoords;
 layout (location = 2) in vec3 normal;
+#ifdef MULTI_DRAW
+// multi draw indirect: drawIndex reads a buffer of consecutive indices with a divisor of 1, so
+// every draw of a command fetches its own entry starting at the command's base instance.
+layout (location = 9) in uint drawIndex;
+
+struct DrawData
+{
+	uint TransformIndex;
+	uint MaterialIndex;
+	uint MeshIndex;
+};
+layout (std430, binding = 0) readonly buffer Draws
+{
+	DrawData draws[];
+};
+layout (std430, binding = 1) readonly buffer Transforms
+{
+	mat4 transforms[];
+};
+// what the PackedOrigin and PackedExtent uniforms are to the other draws, per mesh.
+struct MeshData
+{
+	vec4 PackedOrigin;
+	vec4 PackedExtent;
+};
+layout (std430, binding = 2) readonly buffer Meshes
+{
+	MeshData meshes[];
+};
+#else
+// per instance transform of instanced draws, one column per location 5 to 8.
+layout (location = 5) in mat4 instanceModel;
+#endif
 
 out vec2 TexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 
 #include common/uniforms.glsl
+#include common/vertex_decode.glsl
 
 uniform mat4 model;
+uniform bool Instanced;
 
 void main()
 {
+#ifdef MULTI_DRAW
+	DrawData draw = draws[drawIndex];
+	mat4 world = transforms[draw.TransformIndex];
+	vec4 packedOrigin = meshes[draw.MeshIndex].PackedOrigin;
+	vec4 packedExtent = meshes[draw.MeshIndex].PackedExtent;
+#else
+	mat4 world = Instanced ? instanceModel : model;
+	vec4 packedOrigin = PackedOrigin;
+	vec4 packedExtent = PackedExtent;
+#endif
+
 	TexCoords = texCoords;
-	FragPos   = vec3(model * vec4(pos, 1.0));
-	Normal    = mat3(model) * normal;
+	FragPos   = vec3(world * vec4(DecodePosition(pos, packedOrigin, packedExtent), 1.0));
+	Normal    = mat3(world) * DecodeNormal(normal, packedExtent);
     
 	gl_Position =  projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -5,7 +5,9 @@ uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+#include common/vertex_decode.glsl
+
 void main()
 {	
-	gl_Position =  projection * view * model * vec4(aPos, 1.0);
+	gl_Position =  projection * view * model * vec4(DecodePosition(aPos, PackedOrigin, PackedExtent), 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "FrustumCulling.h"
+
+#include "CameraFrustum.h"
+
+#include <bitset>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define FRUSTUM_CULLING_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define FRUSTUM_CULLING_TARGET_SSE
+#define FRUSTUM_CULLING_TARGET_AVX2
+#else
+#define FRUSTUM_CULLING_TARGET_SSE __attribute__((target("sse2")))
+#define FRUSTUM_CULLING_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace FrustumCulling
+{
+	namespace
+	{
+		// plane with the bounds arrays holding its positive vertex already picked, so the
+		// kernels don't need per box selects.
+		struct CullPlane
+		{
+			float NormalX, NormalY, NormalZ, D;
+			const float* X;
+			const float* Y;
+			const float* Z;
+		};
+
+		typedef void(*CullKernel)(const CullPlane* planes, unsigned int count, uint32_t* outMask);
+
+		bool IsVisibleScalar(const CullPlane* planes, unsigned int i)
+		{
+			for (int p = 0; p < 6; ++p)
+			{
+				const CullPlane& plane = planes[p];
+				// same operation order as FrustumPlane::Distance so all kernels agree.
+				const float distance = plane.NormalX * plane.X[i] + plane.NormalY * plane.Y[i] + plane.NormalZ * plane.Z[i] + plane.D;
+				if (distance < 0.0f)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		uint32_t CullWordScalar(const CullPlane* planes, unsigned int begin, unsigned int end)
+		{
+			uint32_t bits = 0;
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				if (IsVisibleScalar(planes, i))
+				{
+					bits |= 1u << (i - begin);
+				}
+			}
+			return bits;
+		}
+
+		void CullScalar(const CullPlane* planes, unsigned int count, uint32_t* outMask)
+		{
+			const unsigned int wordCount = GetMaskWordCount(count);
+			for (unsigned int w = 0; w < wordCount; ++w)
+			{
+				const unsigned int begin = w * 32;
+				const unsigned int end = begin + 32 < count ? begin + 32 : count;
+				outMask[w] = CullWordScalar(planes, begin, end);
+			}
+		}
+
+#if FRUSTUM_CULLING_X86
+		FRUSTUM_CULLING_TARGET_SSE
+		void CullSSE(const CullPlane* planes, unsigned int count, uint32_t* outMask)
+		{
+			__m128 normalX[6], normalY[6], normalZ[6], d[6];
+			for (int p = 0; p < 6; ++p)
+			{
+				normalX[p] = _mm_set1_ps(planes[p].NormalX);
+				normalY[p] = _mm_set1_ps(planes[p].NormalY);
+				normalZ[p] = _mm_set1_ps(planes[p].NormalZ);
+				d[p] = _mm_set1_ps(planes[p].D);
+			}
+			const __m128 zero = _mm_setzero_ps();
+
+			const unsigned int fullWords = count / 32;
+			for (unsigned int w = 0; w < fullWords; ++w)
+			{
+				uint32_t bits = 0;
+				for (unsigned int lane = 0; lane < 32; lane += 4)
+				{
+					const unsigned int i = w * 32 + lane;
+					__m128 outside = zero;
+					for (int p = 0; p < 6; ++p)
+					{
+						const __m128 x = _mm_mul_ps(normalX[p], _mm_loadu_ps(planes[p].X + i));
+						const __m128 y = _mm_mul_ps(normalY[p], _mm_loadu_ps(planes[p].Y + i));
+						const __m128 z = _mm_mul_ps(normalZ[p], _mm_loadu_ps(planes[p].Z + i));
+						const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(x, y), z), d[p]);
+						outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+					}
+					bits |= static_cast<uint32_t>(~_mm_movemask_ps(outside) & 0xf) << lane;
+				}
+				outMask[w] = bits;
+			}
+
+			if (fullWords * 32 < count)
+			{
+				outMask[fullWords] = CullWordScalar(planes, fullWords * 32, count);
+			}
+		}
+
+		FRUSTUM_CULLING_TARGET_AVX2
+		void CullAVX2(const CullPlane* planes, unsigned int count, uint32_t* outMask)
+		{
+			__m256 normalX[6], normalY[6], normalZ[6], d[6];
+			for (int p = 0; p < 6; ++p)
+			{
+				normalX[p] = _mm256_set1_ps(planes[p].NormalX);
+				normalY[p] = _mm256_set1_ps(planes[p].NormalY);
+				normalZ[p] = _mm256_set1_ps(planes[p].NormalZ);
+				d[p] = _mm256_set1_ps(planes[p].D);
+			}
+			const __m256 zero = _mm256_setzero_ps();
+
+			const unsigned int fullWords = count / 32;
+			for (unsigned int w = 0; w < fullWords; ++w)
+			{
+				uint32_t bits = 0;
+				for (unsigned int lane = 0; lane < 32; lane += 8)
+				{
+					const unsigned int i = w * 32 + lane;
+					__m256 outside = zero;
+					for (int p = 0; p < 6; ++p)
+					{
+						// no fma on purpose, it would round differently than the other kernels.
+						const __m256 x = _mm256_mul_ps(normalX[p], _mm256_loadu_ps(planes[p].X + i));
+						const __m256 y = _mm256_mul_ps(normalY[p], _mm256_loadu_ps(planes[p].Y + i));
+						const __m256 z = _mm256_mul_ps(normalZ[p], _mm256_loadu_ps(planes[p].Z + i));
+						const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), d[p]);
+						outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+					}
+					bits |= static_cast<uint32_t>(~_mm256_movemask_ps(outside) & 0xff) << lane;
+				}
+				outMask[w] = bits;
+			}
+
+			if (fullWords * 32 < count)
+			{
+				outMask[fullWords] = CullWordScalar(planes, fullWords * 32, count);
+			}
+		}
+#endif
+
+		Isa DetectIsa()
+		{
+#if FRUSTUM_CULLING_X86
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			const bool sse2 = (info[3] & (1 << 26)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+
+			bool avx2 = false;
+			if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+			{
+				__cpuidex(info, 7, 0);
+				avx2 = (info[1] & (1 << 5)) != 0;
+			}
+#else
+			__builtin_cpu_init();
+			const bool sse2 = __builtin_cpu_supports("sse2") != 0;
+			const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+			if (avx2)
+			{
+				return Isa::AVX2;
+			}
+			if (sse2)
+			{
+				return Isa::SSE;
+			}
+#endif
+			return Isa::Scalar;
+		}
+
+		Isa s_activeIsa = GetSupportedIsa();
+
+		CullKernel GetKernel(Isa isa)
+		{
+			switch (isa)
+			{
+#if FRUSTUM_CULLING_X86
+			case Isa::AVX2: return CullAVX2;
+			case Isa::SSE: return CullSSE;
+#endif
+			default: return CullScalar;
+			}
+		}
+
+		void BuildCullPlanes(const glm::vec4 planes[6], const BoundsView& bounds, CullPlane outPlanes[6])
+		{
+			for (int p = 0; p < 6; ++p)
+			{
+				const glm::vec4& plane = planes[p];
+				CullPlane& cullPlane = outPlanes[p];
+				cullPlane.NormalX = plane.x;
+				cullPlane.NormalY = plane.y;
+				cullPlane.NormalZ = plane.z;
+				cullPlane.D = plane.w;
+				cullPlane.X = plane.x >= 0.0f ? bounds.MaxX : bounds.MinX;
+				cullPlane.Y = plane.y >= 0.0f ? bounds.MaxY : bounds.MinY;
+				cullPlane.Z = plane.z >= 0.0f ? bounds.MaxZ : bounds.MinZ;
+			}
+		}
+
+		unsigned int CountBits(uint32_t value)
+		{
+			return static_cast<unsigned int>(std::bitset<32>(value).count());
+		}
+
+		unsigned int LowestBit(uint32_t value)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, value);
+			return static_cast<unsigned int>(index);
+#else
+			return static_cast<unsigned int>(__builtin_ctz(value));
+#endif
+		}
+	}
+
+	void BoundsArray::Clear()
+	{
+		MinX.clear();
+		MinY.clear();
+		MinZ.clear();
+		MaxX.clear();
+		MaxY.clear();
+		MaxZ.clear();
+	}
+
+	void BoundsArray::Reserve(unsigned int count)
+	{
+		MinX.reserve(count);
+		MinY.reserve(count);
+		MinZ.reserve(count);
+		MaxX.reserve(count);
+		MaxY.reserve(count);
+		MaxZ.reserve(count);
+	}
+
+	void BoundsArray::Push(const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		MinX.push_back(boxMin.x);
+		MinY.push_back(boxMin.y);
+		MinZ.push_back(boxMin.z);
+		MaxX.push_back(boxMax.x);
+		MaxY.push_back(boxMax.y);
+		MaxZ.push_back(boxMax.z);
+	}
+
+	BoundsView BoundsArray::View() const
+	{
+		BoundsView view;
+		view.MinX = MinX.data();
+		view.MinY = MinY.data();
+		view.MinZ = MinZ.data();
+		view.MaxX = MaxX.data();
+		view.MaxY = MaxY.data();
+		view.MaxZ = MaxZ.data();
+		view.Count = Size();
+		return view;
+	}
+
+	Isa GetSupportedIsa()
+	{
+		static const Isa supported = DetectIsa();
+		return supported;
+	}
+
+	Isa GetActiveIsa()
+	{
+		return s_activeIsa;
+	}
+
+	void SetActiveIsa(Isa isa)
+	{
+		s_activeIsa = static_cast<int>(isa) <= static_cast<int>(GetSupportedIsa()) ? isa : GetSupportedIsa();
+	}
+
+	const char* GetIsaName(Isa isa)
+	{
+		switch (isa)
+		{
+		case Isa::AVX2: return "AVX2";
+		case Isa::SSE: return "SSE";
+		default: return "Scalar";
+		}
+	}
+
+	unsigned int CullBoxes(const glm::vec4 planes[6], const BoundsView& bounds, uint32_t* outMask)
+	{
+		if (bounds.Count == 0)
+		{
+			return 0;
+		}
+
+		CullPlane cullPlanes[6];
+		BuildCullPlanes(planes, bounds, cullPlanes);
+		GetKernel(s_activeIsa)(cullPlanes, bounds.Count, outMask);
+
+		unsigned int visibleCount = 0;
+		const unsigned int wordCount = GetMaskWordCount(bounds.Count);
+		for (unsigned int w = 0; w < wordCount; ++w)
+		{
+			visibleCount += CountBits(outMask[w]);
+		}
+		return visibleCount;
+	}
+
+	unsigned int CullBoxes(const CameraFrustum& frustum, const BoundsView& bounds, uint32_t* outMask)
+	{
+		glm::vec4 planes[6];
+		GetPlanes(frustum, planes);
+		return CullBoxes(planes, bounds, outMask);
+	}
+
+	unsigned int CullBoxesToIndices(const glm::vec4 planes[6], const BoundsView& bounds, unsigned int* outIndices)
+	{
+		// cull in chunks through a small mask on the stack and expand the bits right away.
+		const unsigned int chunkWords = 64;
+		const unsigned int chunkSize = chunkWords * 32;
+		uint32_t mask[chunkWords];
+
+		const CullKernel kernel = GetKernel(s_activeIsa);
+
+		unsigned int visibleCount = 0;
+		for (unsigned int begin = 0; begin < bounds.Count; begin += chunkSize)
+		{
+			const unsigned int count = bounds.Count - begin < chunkSize ? bounds.Count - begin : chunkSize;
+
+			BoundsView chunk = bounds;
+			chunk.MinX += begin;
+			chunk.MinY += begin;
+			chunk.MinZ += begin;
+			chunk.MaxX += begin;
+			chunk.MaxY += begin;
+			chunk.MaxZ += begin;
+			chunk.Count = count;
+
+			CullPlane cullPlanes[6];
+			BuildCullPlanes(planes, chunk, cullPlanes);
+			kernel(cullPlanes, count, mask);
+
+			const unsigned int wordCount = GetMaskWordCount(count);
+			for (unsigned int w = 0; w < wordCount; ++w)
+			{
+				uint32_t bits = mask[w];
+				while (bits != 0)
+				{
+					outIndices[visibleCount++] = begin + w * 32 + LowestBit(bits);
+					bits &= bits - 1;
+				}
+			}
+		}
+		return visibleCount;
+	}
+
+	unsigned int CullBoxesToIndices(const CameraFrustum& frustum, const BoundsView& bounds, unsigned int* outIndices)
+	{
+		glm::vec4 planes[6];
+		GetPlanes(frustum, planes);
+		return CullBoxesToIndices(planes, bounds, outIndices);
+	}
+
+	void GetPlanes(const CameraFrustum& frustum, glm::vec4 outPlanes[6])
+	{
+		for (int p = 0; p < 6; ++p)
+		{
+			outPlanes[p] = glm::vec4(frustum.Planes[p].Normal, frustum.Planes[p].D);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class CameraFrustum;
+
+/*
+
+  Batch frustum culling of axis aligned boxes stored as structure of arrays.
+
+  Every box is tested against the six frustum planes the same way CameraFrustum::Intersect
+  does it (positive vertex against the inward facing plane), 4 boxes at a time with SSE or 8
+  with AVX2. The kernel is picked at runtime from what the CPU supports; the scalar fallback
+  gives bit identical results, so switching ISA never changes the visible set.
+
+*/
+namespace FrustumCulling
+{
+	enum class Isa
+	{
+		Scalar = 0,
+		SSE,
+		AVX2
+	};
+
+	// read only view of SoA box bounds; all arrays hold Count floats.
+	struct BoundsView
+	{
+		const float* MinX;
+		const float* MinY;
+		const float* MinZ;
+		const float* MaxX;
+		const float* MaxY;
+		const float* MaxZ;
+		unsigned int Count;
+	};
+
+	// owning SoA box bounds, reused between frames to avoid reallocating.
+	struct BoundsArray
+	{
+		void Clear();
+		void Reserve(unsigned int count);
+		void Push(const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+		unsigned int Size() const { return static_cast<unsigned int>(MinX.size()); }
+		BoundsView View() const;
+
+		std::vector<float> MinX;
+		std::vector<float> MinY;
+		std::vector<float> MinZ;
+		std::vector<float> MaxX;
+		std::vector<float> MaxY;
+		std::vector<float> MaxZ;
+	};
+
+	// best ISA supported by the CPU, detected once.
+	Isa GetSupportedIsa();
+	// ISA used by the culling kernels; defaults to the supported one.
+	Isa GetActiveIsa();
+	// forces a kernel, clamped to what the CPU supports.
+	void SetActiveIsa(Isa isa);
+	const char* GetIsaName(Isa isa);
+
+	// number of 32 bit words CullBoxes writes for count boxes.
+	inline unsigned int GetMaskWordCount(unsigned int count) { return (count + 31) / 32; }
+
+	// writes bit (i % 32) of outMask[i / 32] for every box i that is inside or intersects the frustum.
+	// planes are inward facing, xyz = normal, w = d; returns the number of visible boxes.
+	unsigned int CullBoxes(const glm::vec4 planes[6], const BoundsView& bounds, uint32_t* outMask);
+	unsigned int CullBoxes(const CameraFrustum& frustum, const BoundsView& bounds, uint32_t* outMask);
+
+	// writes the indices of the visible boxes in ascending order; returns how many were written.
+	// outIndices must hold bounds.Count entries.
+	unsigned int CullBoxesToIndices(const glm::vec4 planes[6], const BoundsView& bounds, unsigned int* outIndices);
+	unsigned int CullBoxesToIndices(const CameraFrustum& frustum, const BoundsView& bounds, unsigned int* outIndices);
+
+	void GetPlanes(const CameraFrustum& frustum, glm::vec4 outPlanes[6]);
+}
@@ -0,0 +1,551 @@
+#include "OcclusionCulling.h"
+
+#include "Utils/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OCCLUSION_CULLING_X86 1
+#include <immintrin.h>
+#else
+#define OCCLUSION_CULLING_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define OCCLUSION_CULLING_TARGET_SSE
+#else
+#define OCCLUSION_CULLING_TARGET_SSE __attribute__((target("sse2")))
+#endif
+
+namespace
+{
+	// work split granularity of the three parallel stages.
+	const unsigned int s_OccludersPerWorker = 4;
+	const unsigned int s_TilesPerWorker = 8;
+	const unsigned int s_MaskWordsPerWorker = 64;
+
+	// hierarchy texels covered at most per axis by a box test.
+	const int s_MaxTestTexels = 4;
+	// rasterized depth can be a few ulps off the exact plane; keeps an occluder's own box visible.
+	const float s_DepthEpsilon = 1e-6f;
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height)
+	: m_ViewProjection(1.0f)
+	, m_RenderCount(0)
+	, m_HierarchyValid(false)
+{
+	SetResolution(width, height);
+}
+
+void OcclusionCuller::SetResolution(unsigned int width, unsigned int height)
+{
+	m_Width = std::max(1u, width);
+	m_Height = std::max(1u, height);
+	m_TilesX = (m_Width + s_TileWidth - 1) / s_TileWidth;
+	m_TilesY = (m_Height + s_TileHeight - 1) / s_TileHeight;
+	m_Stride = m_TilesX * s_TileWidth;
+
+	m_Depth.assign(m_Stride * m_TilesY * s_TileHeight, 1.0f);
+	m_TileBins.resize(m_TilesX * m_TilesY);
+
+	m_Hierarchy.clear();
+	unsigned int levelWidth = m_Width;
+	unsigned int levelHeight = m_Height;
+	while (true)
+	{
+		DepthLevel level;
+		level.Width = levelWidth;
+		level.Height = levelHeight;
+		level.Depth.assign(levelWidth * levelHeight, 1.0f);
+		m_Hierarchy.push_back(level);
+
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+	m_HierarchyValid = false;
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const glm::mat4& transform, bool triangleStrip)
+{
+	Occluder occluder;
+	occluder.Positions = positions;
+	occluder.Indices = indices;
+	occluder.VertexCount = vertexCount;
+	occluder.IndexCount = indices ? indexCount : 0;
+	occluder.Transform = transform;
+	occluder.TriangleStrip = triangleStrip;
+	m_Occluders.push_back(occluder);
+}
+
+void OcclusionCuller::ClearOccluders()
+{
+	m_Occluders.clear();
+}
+
+void OcclusionCuller::Render(const glm::mat4& viewProjection)
+{
+	m_ViewProjection = viewProjection;
+	++m_RenderCount;
+	m_Stats = Stats();
+
+	std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+
+	// 1. triangle setup, the occluders split over the workers.
+	const unsigned int occluderCount = static_cast<unsigned int>(m_Occluders.size());
+	const unsigned int setupWorkers = Utils::GetWorkerCount(occluderCount, s_OccludersPerWorker);
+	if (m_WorkerTriangles.size() < setupWorkers)
+	{
+		m_WorkerTriangles.resize(setupWorkers);
+		m_WorkerClipPositions.resize(setupWorkers);
+	}
+
+	std::atomic<unsigned int> occludersDrawn(0);
+	Utils::ParallelRun(setupWorkers, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(occluderCount, setupWorkers, worker, begin, end);
+		m_WorkerTriangles[worker].clear();
+		occludersDrawn += SetupTriangles(begin, end, m_WorkerClipPositions[worker], m_WorkerTriangles[worker]);
+	});
+
+	m_Triangles.clear();
+	for (unsigned int worker = 0; worker < setupWorkers; ++worker)
+	{
+		m_Triangles.insert(m_Triangles.end(), m_WorkerTriangles[worker].begin(), m_WorkerTriangles[worker].end());
+	}
+	m_Stats.OccludersDrawn = occludersDrawn;
+	m_Stats.TrianglesDrawn = static_cast<unsigned int>(m_Triangles.size());
+
+	// 2. binning, then every tile rasterized by a single worker so no two write the same pixels.
+	BinTriangles();
+
+	const unsigned int tileCount = m_TilesX * m_TilesY;
+	const unsigned int rasterWorkers = Utils::GetWorkerCount(tileCount, s_TilesPerWorker);
+	Utils::ParallelRun(rasterWorkers, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(tileCount, rasterWorkers, worker, begin, end);
+		for (unsigned int tile = begin; tile < end; ++tile)
+		{
+			RasterizeTile(tile);
+		}
+	});
+
+	// 3. max depth hierarchy for the box tests.
+	BuildHierarchy();
+}
+
+unsigned int OcclusionCuller::SetupTriangles(unsigned int begin, unsigned int end, std::vector<glm::vec4>& clipPositions, std::vector<Triangle>& outTriangles) const
+{
+	const float width = static_cast<float>(m_Width);
+	const float height = static_cast<float>(m_Height);
+
+	unsigned int occludersDrawn = 0;
+	for (unsigned int o = begin; o < end; ++o)
+	{
+		const Occluder& occluder = m_Occluders[o];
+		const glm::mat4 transform = m_ViewProjection * occluder.Transform;
+
+		clipPositions.resize(occluder.VertexCount);
+		for (unsigned int v = 0; v < occluder.VertexCount; ++v)
+		{
+			clipPositions[v] = transform * glm::vec4(occluder.Positions[v], 1.0f);
+		}
+
+		const unsigned int elementCount = occluder.Indices ? occluder.IndexCount : occluder.VertexCount;
+		const unsigned int triangleCount = occluder.TriangleStrip ? (elementCount >= 3 ? elementCount - 2 : 0) : elementCount / 3;
+		const size_t firstTriangle = outTriangles.size();
+		for (unsigned int t = 0; t < triangleCount; ++t)
+		{
+			unsigned int elements[3];
+			if (occluder.TriangleStrip)
+			{
+				// every other strip triangle has its winding flipped.
+				elements[0] = t + (t & 1);
+				elements[1] = t + 1 - (t & 1);
+				elements[2] = t + 2;
+			}
+			else
+			{
+				elements[0] = t * 3;
+				elements[1] = t * 3 + 1;
+				elements[2] = t * 3 + 2;
+			}
+
+			float x[3], y[3], z[3];
+			bool clipped = false;
+			for (int i = 0; i < 3 && !clipped; ++i)
+			{
+				const unsigned int vertex = occluder.Indices ? occluder.Indices[elements[i]] : elements[i];
+				if (vertex >= occluder.VertexCount)
+				{
+					clipped = true;
+					break;
+				}
+				// no near plane clipping: dropping the triangle only loses occlusion.
+				const glm::vec4& clip = clipPositions[vertex];
+				if (clip.w <= 0.0f || clip.z < -clip.w)
+				{
+					clipped = true;
+					break;
+				}
+				const float invW = 1.0f / clip.w;
+				x[i] = (clip.x * invW * 0.5f + 0.5f) * width;
+				y[i] = (clip.y * invW * 0.5f + 0.5f) * height;
+				z[i] = clip.z * invW * 0.5f + 0.5f;
+			}
+			if (clipped)
+			{
+				continue;
+			}
+
+			// counter clockwise is front facing; back faces and degenerate triangles are skipped.
+			const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (!(area > 0.0f) || std::min(z[0], std::min(z[1], z[2])) > 1.0f)
+			{
+				continue;
+			}
+
+			const float minX = std::max(std::min(x[0], std::min(x[1], x[2])), 0.0f);
+			const float maxX = std::min(std::max(x[0], std::max(x[1], x[2])), width - 1.0f);
+			const float minY = std::max(std::min(y[0], std::min(y[1], y[2])), 0.0f);
+			const float maxY = std::min(std::max(y[0], std::max(y[1], y[2])), height - 1.0f);
+			if (minX > maxX || minY > maxY)
+			{
+				continue;
+			}
+
+			Triangle triangle;
+			for (int i = 0; i < 3; ++i)
+			{
+				// the neighbour sharing an edge walks it the other way, so it gets the negated a and
+				// b; taking c from the same endpoint in both makes its edge function the exact
+				// negation too. The top-left rule then gives pixel centers on the edge to exactly
+				// one of the two, which leaves no cracks along the shared edges of an occluder.
+				const int next = (i + 1) % 3;
+				const int origin = x[i] < x[next] || (x[i] == x[next] && y[i] < y[next]) ? i : next;
+				triangle.EdgeA[i] = y[i] - y[next];
+				triangle.EdgeB[i] = x[next] - x[i];
+				triangle.EdgeC[i] = -(triangle.EdgeA[i] * x[origin] + triangle.EdgeB[i] * y[origin]);
+				triangle.EdgeInclusive[i] = triangle.EdgeA[i] > 0.0f || (triangle.EdgeA[i] == 0.0f && triangle.EdgeB[i] > 0.0f);
+			}
+			const float invArea = 1.0f / area;
+			triangle.DepthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * invArea;
+			triangle.DepthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * invArea;
+			triangle.DepthC = z[0] - triangle.DepthA * x[0] - triangle.DepthB * y[0];
+			triangle.MinX = static_cast<int>(minX);
+			triangle.MaxX = static_cast<int>(maxX);
+			triangle.MinY = static_cast<int>(minY);
+			triangle.MaxY = static_cast<int>(maxY);
+			outTriangles.push_back(triangle);
+		}
+
+		if (outTriangles.size() > firstTriangle)
+		{
+			++occludersDrawn;
+		}
+	}
+	return occludersDrawn;
+}
+
+void OcclusionCuller::BinTriangles()
+{
+	for (std::vector<unsigned int>& bin : m_TileBins)
+	{
+		bin.clear();
+	}
+
+	for (unsigned int i = 0; i < m_Triangles.size(); ++i)
+	{
+		const Triangle& triangle = m_Triangles[i];
+		const unsigned int tileX0 = triangle.MinX / s_TileWidth;
+		const unsigned int tileX1 = triangle.MaxX / s_TileWidth;
+		const unsigned int tileY0 = triangle.MinY / s_TileHeight;
+		const unsigned int tileY1 = triangle.MaxY / s_TileHeight;
+		for (unsigned int tileY = tileY0; tileY <= tileY1; ++tileY)
+		{
+			for (unsigned int tileX = tileX0; tileX <= tileX1; ++tileX)
+			{
+				m_TileBins[tileY * m_TilesX + tileX].push_back(i);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(unsigned int tile)
+{
+	const int tileX0 = static_cast<int>((tile % m_TilesX) * s_TileWidth);
+	const int tileY0 = static_cast<int>((tile / m_TilesX) * s_TileHeight);
+	const int tileX1 = tileX0 + static_cast<int>(s_TileWidth) - 1;
+	const int tileY1 = tileY0 + static_cast<int>(s_TileHeight) - 1;
+
+#if OCCLUSION_CULLING_X86
+	const bool simd = FrustumCulling::GetActiveIsa() != FrustumCulling::Isa::Scalar;
+#else
+	const bool simd = false;
+#endif
+
+	for (unsigned int index : m_TileBins[tile])
+	{
+		const Triangle& triangle = m_Triangles[index];
+		// groups start on multiples of 4, the tile edges are aligned so they never cross tiles.
+		const int x0 = std::max(triangle.MinX, tileX0) & ~3;
+		const int x1 = std::min(triangle.MaxX, tileX1);
+		const int y0 = std::max(triangle.MinY, tileY0);
+		const int y1 = std::min(triangle.MaxY, tileY1);
+
+		if (simd)
+		{
+			RasterizeSSE(triangle, m_Depth.data(), m_Stride, x0, x1, y0, y1);
+		}
+		else
+		{
+			RasterizeScalar(triangle, m_Depth.data(), m_Stride, x0, x1, y0, y1);
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeScalar(const Triangle& triangle, float* depth, unsigned int stride, int x0, int x1, int y0, int y1)
+{
+	const int xEnd = x0 + (x1 - x0) / 4 * 4 + 3;
+	for (int y = y0; y <= y1; ++y)
+	{
+		const float py = static_cast<float>(y) + 0.5f;
+		const float edgeY0 = triangle.EdgeB[0] * py;
+		const float edgeY1 = triangle.EdgeB[1] * py;
+		const float edgeY2 = triangle.EdgeB[2] * py;
+		const float depthY = triangle.DepthB * py;
+
+		float* row = depth + y * stride;
+		for (int x = x0; x <= xEnd; ++x)
+		{
+			// same operation order as the SIMD kernel.
+			const float px = static_cast<float>(x) + 0.5f;
+			const float edge0 = triangle.EdgeA[0] * px + edgeY0 + triangle.EdgeC[0];
+			const float edge1 = triangle.EdgeA[1] * px + edgeY1 + triangle.EdgeC[1];
+			const float edge2 = triangle.EdgeA[2] * px + edgeY2 + triangle.EdgeC[2];
+			const bool inside0 = edge0 > 0.0f || (edge0 == 0.0f && triangle.EdgeInclusive[0]);
+			const bool inside1 = edge1 > 0.0f || (edge1 == 0.0f && triangle.EdgeInclusive[1]);
+			const bool inside2 = edge2 > 0.0f || (edge2 == 0.0f && triangle.EdgeInclusive[2]);
+			if (inside0 && inside1 && inside2)
+			{
+				const float z = triangle.DepthA * px + depthY + triangle.DepthC;
+				row[x] = std::min(row[x], z);
+			}
+		}
+	}
+}
+
+#if OCCLUSION_CULLING_X86
+OCCLUSION_CULLING_TARGET_SSE
+void OcclusionCuller::RasterizeSSE(const Triangle& triangle, float* depth, unsigned int stride, int x0, int x1, int y0, int y1)
+{
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 edgeA0 = _mm_set1_ps(triangle.EdgeA[0]);
+	const __m128 edgeA1 = _mm_set1_ps(triangle.EdgeA[1]);
+	const __m128 edgeA2 = _mm_set1_ps(triangle.EdgeA[2]);
+	const __m128 edgeC0 = _mm_set1_ps(triangle.EdgeC[0]);
+	const __m128 edgeC1 = _mm_set1_ps(triangle.EdgeC[1]);
+	const __m128 edgeC2 = _mm_set1_ps(triangle.EdgeC[2]);
+	const __m128 depthA = _mm_set1_ps(triangle.DepthA);
+	const __m128 depthC = _mm_set1_ps(triangle.DepthC);
+	const __m128 inclusive0 = _mm_castsi128_ps(_mm_set1_epi32(triangle.EdgeInclusive[0] ? -1 : 0));
+	const __m128 inclusive1 = _mm_castsi128_ps(_mm_set1_epi32(triangle.EdgeInclusive[1] ? -1 : 0));
+	const __m128 inclusive2 = _mm_castsi128_ps(_mm_set1_epi32(triangle.EdgeInclusive[2] ? -1 : 0));
+
+	for (int y = y0; y <= y1; ++y)
+	{
+		const float py = static_cast<float>(y) + 0.5f;
+		const __m128 edgeY0 = _mm_set1_ps(triangle.EdgeB[0] * py);
+		const __m128 edgeY1 = _mm_set1_ps(triangle.EdgeB[1] * py);
+		const __m128 edgeY2 = _mm_set1_ps(triangle.EdgeB[2] * py);
+		const __m128 depthY = _mm_set1_ps(triangle.DepthB * py);
+
+		float* row = depth + y * stride;
+		for (int x = x0; x <= x1; x += 4)
+		{
+			// pixel centers are small integers plus a half, exact in float either way.
+			const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+			const __m128 edge0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA0, px), edgeY0), edgeC0);
+			const __m128 edge1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA1, px), edgeY1), edgeC1);
+			const __m128 edge2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA2, px), edgeY2), edgeC2);
+			const __m128 inside0 = _mm_or_ps(_mm_cmpgt_ps(edge0, zero), _mm_and_ps(_mm_cmpeq_ps(edge0, zero), inclusive0));
+			const __m128 inside1 = _mm_or_ps(_mm_cmpgt_ps(edge1, zero), _mm_and_ps(_mm_cmpeq_ps(edge1, zero), inclusive1));
+			const __m128 inside2 = _mm_or_ps(_mm_cmpgt_ps(edge2, zero), _mm_and_ps(_mm_cmpeq_ps(edge2, zero), inclusive2));
+			const __m128 inside = _mm_and_ps(_mm_and_ps(inside0, inside1), inside2);
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			const __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depthA, px), depthY), depthC);
+			const __m128 current = _mm_loadu_ps(row + x);
+			const __m128 nearest = _mm_min_ps(current, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+		}
+	}
+}
+#else
+void OcclusionCuller::RasterizeSSE(const Triangle& triangle, float* depth, unsigned int stride, int x0, int x1, int y0, int y1)
+{
+	RasterizeScalar(triangle, depth, stride, x0, x1, y0, y1);
+}
+#endif
+
+void OcclusionCuller::BuildHierarchy()
+{
+	DepthLevel& base = m_Hierarchy[0];
+	for (unsigned int y = 0; y < m_Height; ++y)
+	{
+		std::copy(m_Depth.begin() + y * m_Stride, m_Depth.begin() + y * m_Stride + m_Width, base.Depth.begin() + y * m_Width);
+	}
+
+	for (size_t l = 1; l < m_Hierarchy.size(); ++l)
+	{
+		const DepthLevel& source = m_Hierarchy[l - 1];
+		DepthLevel& level = m_Hierarchy[l];
+		for (unsigned int y = 0; y < level.Height; ++y)
+		{
+			// odd sizes clamp to the last row and column of the level below.
+			const unsigned int sourceY0 = y * 2;
+			const unsigned int sourceY1 = std::min(sourceY0 + 1, source.Height - 1);
+			for (unsigned int x = 0; x < level.Width; ++x)
+			{
+				const unsigned int sourceX0 = x * 2;
+				const unsigned int sourceX1 = std::min(sourceX0 + 1, source.Width - 1);
+				const float top = std::max(source.Depth[sourceY0 * source.Width + sourceX0], source.Depth[sourceY0 * source.Width + sourceX1]);
+				const float bottom = std::max(source.Depth[sourceY1 * source.Width + sourceX0], source.Depth[sourceY1 * source.Width + sourceX1]);
+				level.Depth[y * level.Width + x] = std::max(top, bottom);
+			}
+		}
+	}
+	m_HierarchyValid = true;
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	if (!m_HierarchyValid)
+	{
+		return true;
+	}
+
+	float minX = static_cast<float>(m_Width);
+	float maxX = 0.0f;
+	float minY = static_cast<float>(m_Height);
+	float maxY = 0.0f;
+	float minZ = 1.0f;
+	for (int i = 0; i < 8; ++i)
+	{
+		const glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+		const glm::vec4 clip = m_ViewProjection * glm::vec4(corner, 1.0f);
+		if (clip.w <= 0.0f || clip.z < -clip.w)
+		{
+			return true;
+		}
+
+		const float invW = 1.0f / clip.w;
+		const float x = (clip.x * invW * 0.5f + 0.5f) * m_Width;
+		const float y = (clip.y * invW * 0.5f + 0.5f) * m_Height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z * invW * 0.5f + 0.5f);
+	}
+
+	// off screen boxes are left to frustum culling.
+	if (maxX < 0.0f || maxY < 0.0f || minX >= m_Width || minY >= m_Height)
+	{
+		return true;
+	}
+
+	int x0 = static_cast<int>(std::max(minX, 0.0f));
+	int x1 = static_cast<int>(std::min(maxX, m_Width - 1.0f));
+	int y0 = static_cast<int>(std::max(minY, 0.0f));
+	int y1 = static_cast<int>(std::min(maxY, m_Height - 1.0f));
+
+	// coarsest level first where the box covers only a few texels.
+	size_t level = 0;
+	while ((x1 - x0 >= s_MaxTestTexels || y1 - y0 >= s_MaxTestTexels) && level + 1 < m_Hierarchy.size())
+	{
+		x0 >>= 1;
+		x1 >>= 1;
+		y0 >>= 1;
+		y1 >>= 1;
+		++level;
+	}
+
+	const DepthLevel& depth = m_Hierarchy[level];
+	float maxDepth = 0.0f;
+	for (int y = y0; y <= y1; ++y)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			maxDepth = std::max(maxDepth, depth.Depth[y * depth.Width + x]);
+		}
+	}
+	return minZ <= maxDepth + s_DepthEpsilon;
+}
+
+unsigned int OcclusionCuller::CullBoxes(const FrustumCulling::BoundsView& bounds, uint32_t* inOutMask)
+{
+	const unsigned int wordCount = FrustumCulling::GetMaskWordCount(bounds.Count);
+	std::atomic<unsigned int> tested(0);
+	std::atomic<unsigned int> visible(0);
+	Utils::ParallelFor(wordCount, s_MaskWordsPerWorker, [&](unsigned int begin, unsigned int end)
+	{
+		unsigned int localTested = 0;
+		unsigned int localVisible = 0;
+		for (unsigned int w = begin; w < end; ++w)
+		{
+			uint32_t bits = inOutMask[w];
+			if (bits == 0)
+			{
+				continue;
+			}
+
+			const unsigned int first = w * 32;
+			const unsigned int last = std::min(first + 32, bounds.Count);
+			for (unsigned int i = first; i < last; ++i)
+			{
+				const uint32_t bit = 1u << (i - first);
+				if ((bits & bit) == 0)
+				{
+					continue;
+				}
+
+				++localTested;
+				const glm::vec3 boxMin(bounds.MinX[i], bounds.MinY[i], bounds.MinZ[i]);
+				const glm::vec3 boxMax(bounds.MaxX[i], bounds.MaxY[i], bounds.MaxZ[i]);
+				if (IsVisible(boxMin, boxMax))
+				{
+					++localVisible;
+				}
+				else
+				{
+					bits &= ~bit;
+				}
+			}
+			// bits past the last box don't belong to any box.
+			if (last - first < 32)
+			{
+				bits &= (1u << (last - first)) - 1u;
+			}
+			inOutMask[w] = bits;
+		}
+		tested += localTested;
+		visible += localVisible;
+	});
+
+	m_Stats.BoxesTested += tested;
+	m_Stats.BoxesRejected += tested - visible;
+	return visible;
+}
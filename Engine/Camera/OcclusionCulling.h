@@ -0,0 +1,143 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+/*
+
+  Software occlusion culling on the CPU.
+
+  A few designated occluders, usually large and simple meshes like walls and floors, are drawn
+  depth only into a small depth buffer. The buffer is split into tiles: triangles are set up in
+  parallel, binned to the tiles they touch and every tile is then rasterized by one worker, 4
+  pixels at a time with SSE (or one at a time on the scalar kernel, which gives bit identical
+  results; the kernel follows FrustumCulling's active ISA). A max depth hierarchy is built on
+  top, so a box is tested by projecting it to screen and comparing its nearest depth with the
+  farthest occluder depth over a handful of texels of the right level.
+
+  Everything stays conservative: occluder triangles crossing the near plane are dropped and
+  boxes crossing the near plane are always visible, so culling can only miss hidden objects,
+  never hide visible ones. Pixel coverage follows the top-left rule, so the triangles of an
+  occluder leave no cracks along their shared edges. Depth is the [0, 1] window depth of the
+  view projection the occluders were drawn with.
+
+*/
+class OcclusionCuller
+{
+public:
+	struct Stats
+	{
+		unsigned int OccludersDrawn = 0;	// occluders with at least one triangle on screen
+		unsigned int TrianglesDrawn = 0;
+		unsigned int BoxesTested = 0;		// since the last Render()
+		unsigned int BoxesRejected = 0;
+	};
+
+public:
+	OcclusionCuller(unsigned int width = 320, unsigned int height = 180);
+
+	void SetResolution(unsigned int width, unsigned int height);
+	unsigned int GetWidth() const { return m_Width; }
+	unsigned int GetHeight() const { return m_Height; }
+
+	// adds an occluder for the next Render(). The vertex and index data is read in Render(), it
+	// has to stay alive until then; without indices the positions are drawn as a triangle list.
+	void AddOccluder(const glm::vec3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const glm::mat4& transform, bool triangleStrip = false);
+	void ClearOccluders();
+	unsigned int GetOccluderCount() const { return static_cast<unsigned int>(m_Occluders.size()); }
+
+	// draws all occluders with viewProjection and builds the depth hierarchy.
+	void Render(const glm::mat4& viewProjection);
+	// incremented by every Render(), so cached culling results can tell they're outdated.
+	unsigned int GetRenderCount() const { return m_RenderCount; }
+
+	// clears bit (i % 32) of inOutMask[i / 32] for every box i hidden behind the occluders; boxes
+	// whose bit is already clear aren't tested. Same mask layout as FrustumCulling, so it runs
+	// on the result of frustum culling. Returns the number of boxes left visible.
+	unsigned int CullBoxes(const FrustumCulling::BoundsView& bounds, uint32_t* inOutMask);
+	// whether the box would survive CullBoxes.
+	bool IsVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+	// rows of GetDepthStride() floats, 1.0 where nothing was drawn.
+	const float* GetDepthBuffer() const { return m_Depth.data(); }
+	unsigned int GetDepthStride() const { return m_Stride; }
+
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct Occluder
+	{
+		const glm::vec3* Positions;
+		const unsigned int* Indices;
+		unsigned int VertexCount;
+		unsigned int IndexCount;
+		glm::mat4 Transform;
+		bool TriangleStrip;
+	};
+
+	// screen space triangle set up for rasterization; edge functions and depth are planes
+	// a * x + b * y + c over the pixel centers, edges positive inside. Pixel centers exactly on
+	// an edge are covered only on the triangle's top and left edges, EdgeInclusive.
+	struct Triangle
+	{
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+		bool EdgeInclusive[3];
+		float DepthA;
+		float DepthB;
+		float DepthC;
+		int MinX;
+		int MaxX;
+		int MinY;
+		int MaxY;
+	};
+
+	struct DepthLevel
+	{
+		unsigned int Width;
+		unsigned int Height;
+		std::vector<float> Depth;
+	};
+
+	// sets up the on screen triangles of the occluders in [begin, end); returns how many occluders had any.
+	unsigned int SetupTriangles(unsigned int begin, unsigned int end, std::vector<glm::vec4>& clipPositions, std::vector<Triangle>& outTriangles) const;
+	void BinTriangles();
+	void RasterizeTile(unsigned int tile);
+	void BuildHierarchy();
+
+	// depth test and write of a triangle over rows [y0, y1], in groups of 4 pixels starting at x0
+	// (a multiple of 4) until the group holding x1. Both kernels give the same result.
+	static void RasterizeScalar(const Triangle& triangle, float* depth, unsigned int stride, int x0, int x1, int y0, int y1);
+	static void RasterizeSSE(const Triangle& triangle, float* depth, unsigned int stride, int x0, int x1, int y0, int y1);
+
+private:
+	static const unsigned int s_TileWidth = 32;		// multiple of the 4 pixel SIMD width
+	static const unsigned int s_TileHeight = 16;
+
+	unsigned int m_Width;
+	unsigned int m_Height;
+	unsigned int m_Stride;			// row pitch of m_Depth, padded to whole tiles
+	unsigned int m_TilesX;
+	unsigned int m_TilesY;
+
+	glm::mat4 m_ViewProjection;
+	unsigned int m_RenderCount;
+
+	std::vector<Occluder> m_Occluders;
+	std::vector<std::vector<glm::vec4>> m_WorkerClipPositions;
+	std::vector<std::vector<Triangle>> m_WorkerTriangles;
+	std::vector<Triangle> m_Triangles;
+	std::vector<std::vector<unsigned int>> m_TileBins;
+
+	std::vector<float> m_Depth;
+	// level 0 is the depth buffer at m_Width x m_Height, every next level keeps the max of 2x2 texels.
+	std::vector<DepthLevel> m_Hierarchy;
+	bool m_HierarchyValid;
+
+	Stats m_Stats;
+};
@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "State.h"
+#include "Renderer/GeometryArena.h"
 #include "Resources/Resources.h"
 #include "Scene/Scene.h"
 
@@ -52,6 +53,7 @@ void Game::CleanupSystems()
 
 	Scene::Clear();
 	Resources::Clean();
+	GeometryArena::Get().Clean();
 
 	m_systemComponents->Cleanup();
 
@@ -2,6 +2,8 @@
 
 #include <glm/glm.hpp>
 
+#include "ShadowCascades.h"
+
 class RenderTarget;
 
 class DirectionalLight
@@ -12,8 +14,10 @@ public:
 	float m_intensity = 1.0f;
 
 	bool m_castShadows = true;
-	RenderTarget* m_shadowMatRenderTarget;
-	glm::mat4 m_lightSpaceViewPrrojection;
+	// fitted to the camera by the renderer every frame; 0 cascades when the light has no shadow maps.
+	unsigned int m_shadowCascadeCount = 0;
+	ShadowCascades::Cascade m_shadowCascades[ShadowCascades::MaxCascadeCount];
+	RenderTarget* m_shadowCascadeRenderTargets[ShadowCascades::MaxCascadeCount] = {};
 };
 
 
@@ -0,0 +1,129 @@
+#include "ShadowCascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ShadowCascades
+{
+	void ComputeSplits(float nearPlane, float farPlane, unsigned int count, float lambda, float* outSplits)
+	{
+		for (unsigned int i = 1; i <= count; ++i)
+		{
+			const float fraction = static_cast<float>(i) / count;
+			const float logSplit = nearPlane * std::pow(farPlane / nearPlane, fraction);
+			const float uniformSplit = nearPlane + (farPlane - nearPlane) * fraction;
+			outSplits[i - 1] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+		}
+		// no rounding error on the last split, it has to end exactly where the shadows do.
+		if (count > 0)
+		{
+			outSplits[count - 1] = farPlane;
+		}
+	}
+
+	unsigned int FitCascades(const glm::mat4& cameraView, const glm::mat4& cameraProjection, float nearPlane, float farPlane, const glm::vec3& lightDirection, const Settings& settings, unsigned int count, Cascade* outCascades)
+	{
+		count = std::min(count, MaxCascadeCount);
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		// the corners of the whole camera frustum in view space; a slice's corners lie on the edges
+		// between the near and far corners, where view depth changes linearly. staying in view space
+		// keeps the slice's shape, and with it the cascade size, exactly the same while the camera
+		// moves and turns.
+		const glm::mat4 inverseProjection = glm::inverse(cameraProjection);
+		const glm::mat4 inverseView = glm::inverse(cameraView);
+		glm::vec3 nearCorners[4];
+		glm::vec3 farCorners[4];
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			const float x = (i & 1) ? 1.0f : -1.0f;
+			const float y = (i & 2) ? 1.0f : -1.0f;
+			const glm::vec4 nearCorner = inverseProjection * glm::vec4(x, y, -1.0f, 1.0f);
+			const glm::vec4 farCorner = inverseProjection * glm::vec4(x, y, 1.0f, 1.0f);
+			nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+			farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+		}
+
+		float splits[MaxCascadeCount];
+		const float shadowFar = std::min(farPlane, settings.MaxDistance);
+		ComputeSplits(nearPlane, shadowFar, count, settings.SplitLambda, splits);
+
+		// the light view only rotates; with no translation the texel grid is fixed in world space.
+		const glm::vec3 direction = glm::normalize(lightDirection);
+		const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+		const float depthRange = farPlane - nearPlane;
+		for (unsigned int c = 0; c < count; ++c)
+		{
+			Cascade& cascade = outCascades[c];
+			cascade.SplitNear = c == 0 ? nearPlane : splits[c - 1];
+			cascade.SplitFar = splits[c];
+
+			glm::vec3 corners[8];
+			const float tNear = (cascade.SplitNear - nearPlane) / depthRange;
+			const float tFar = (cascade.SplitFar - nearPlane) / depthRange;
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				corners[i] = nearCorners[i] + (farCorners[i] - nearCorners[i]) * tNear;
+				corners[i + 4] = nearCorners[i] + (farCorners[i] - nearCorners[i]) * tFar;
+			}
+
+			// bounding sphere around the slice, the radius rounded up to hide float noise.
+			glm::vec3 center(0.0f);
+			for (unsigned int i = 0; i < 8; ++i)
+			{
+				center += corners[i];
+			}
+			center = center * (1.0f / 8.0f);
+
+			float radius = 0.0f;
+			for (unsigned int i = 0; i < 8; ++i)
+			{
+				radius = std::max(radius, glm::length(corners[i] - center));
+			}
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+
+			// move the center in whole texels, so world positions always map to the same texel.
+			const float texelSize = 2.0f * radius / settings.Resolution;
+			glm::vec3 lightCenter = glm::vec3(lightView * inverseView * glm::vec4(center, 1.0f));
+			lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+			lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+			// the view looks along -z, the light is towards +z.
+			cascade.View = lightView;
+			cascade.Projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+			                                lightCenter.y - radius, lightCenter.y + radius,
+			                                -(lightCenter.z + radius + settings.CasterDistance), -(lightCenter.z - radius));
+			cascade.ViewProjection = cascade.Projection * cascade.View;
+
+			// planes from the rows of the view projection matrix: left, right, bottom, top, near, far.
+			const glm::mat4& m = cascade.ViewProjection;
+			const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+			const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+			const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+			const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+			cascade.Planes[0] = row3 + row0;
+			cascade.Planes[1] = row3 - row0;
+			cascade.Planes[2] = row3 + row1;
+			cascade.Planes[3] = row3 - row1;
+			cascade.Planes[4] = row3 + row2;
+			cascade.Planes[5] = row3 - row2;
+			for (unsigned int i = 0; i < 6; ++i)
+			{
+				cascade.Planes[i] = cascade.Planes[i] * (1.0f / glm::length(glm::vec3(cascade.Planes[i])));
+			}
+		}
+		return count;
+	}
+
+	unsigned int CullCasters(const Cascade& cascade, const FrustumCulling::BoundsView& bounds, unsigned int* outIndices)
+	{
+		return FrustumCulling::CullBoxesToIndices(cascade.Planes, bounds, outIndices);
+	}
+}
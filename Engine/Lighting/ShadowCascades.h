@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Camera/FrustumCulling.h"
+
+/*
+
+  Cascaded shadow maps for directional lights.
+
+  The camera frustum is sliced along the view direction with the practical split scheme, a
+  blend of logarithmic and uniform split distances, and every slice gets its own orthographic
+  light projection. A slice is fitted with its bounding sphere rather than its box, so the
+  cascade keeps the same size while the camera turns, and the sphere center is snapped to the
+  shadow map texel grid in light space, so moving the camera doesn't make the shadow edges
+  shimmer. The light projection is pulled back towards the light to keep casters that are
+  outside the slice but throw shadows into it.
+
+  Everything here is plain math on the CPU: fitting takes the camera matrices rather than a
+  Camera, and casters are culled against the cascade planes with FrustumCulling.
+
+*/
+namespace ShadowCascades
+{
+	const unsigned int MaxCascadeCount = 4;
+
+	struct Settings
+	{
+		unsigned int CascadeCount = 4;
+		float SplitLambda = 0.8f;		// 0 is uniform splits, 1 is logarithmic
+		float MaxDistance = 150.0f;		// shadows end here, or at the camera far plane if it's closer
+		float CasterDistance = 100.0f;	// how far towards the light casters are kept in front of a slice
+		unsigned int Resolution = 2048;	// shadow map size the cascades are snapped to
+	};
+
+	struct Cascade
+	{
+		float SplitNear;	// view depth range of the slice
+		float SplitFar;
+		glm::mat4 View;
+		glm::mat4 Projection;
+		glm::mat4 ViewProjection;
+		glm::vec4 Planes[6];	// inward facing light frustum planes, for FrustumCulling
+	};
+
+	// writes the far view depth of each of count slices of [nearPlane, farPlane].
+	void ComputeSplits(float nearPlane, float farPlane, unsigned int count, float lambda, float* outSplits);
+
+	// fits count cascades, at most MaxCascadeCount, to the camera frustum for a light shining
+	// along lightDirection; returns the number of cascades written.
+	unsigned int FitCascades(const glm::mat4& cameraView, const glm::mat4& cameraProjection, float nearPlane, float farPlane, const glm::vec3& lightDirection, const Settings& settings, unsigned int count, Cascade* outCascades);
+
+	// writes the indices of the boxes that can cast a shadow into the cascade, in ascending
+	// order; returns how many were written. outIndices must hold bounds.Count entries.
+	unsigned int CullCasters(const Cascade& cascade, const FrustumCulling::BoundsView& bounds, unsigned int* outIndices);
+}
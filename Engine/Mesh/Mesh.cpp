@@ -3,7 +3,10 @@
 
 #include <GL/glew.h>
 
+#include "Renderer/GeometryArena.h"
+#include "Renderer/RenderDevice.h"
 #include "Utils/Logger.h"
+#include "VertexPacking.h"
 
 Mesh::Mesh()
 {
@@ -41,6 +44,11 @@ Mesh::Mesh(std::vector<glm::vec3> positions, std::vector<glm::vec2> uv, std::vec
 	Indices = indices;
 }
 
+Mesh::~Mesh()
+{
+	GeometryArena::Get().Release(this);
+}
+
 void Mesh::SetPositions(std::vector<glm::vec3> positions)
 {
 	Positions = positions;
@@ -64,13 +72,15 @@ void Mesh::SetTangents(std::vector<glm::vec3> tangents, std::vector<glm::vec3> b
 
 void Mesh::Finalize(bool interleaved)
 {
-	// initialize object IDs if not configured before
-	if (!m_VAO)
+	if (interleaved && Encoding == VERTEX_ENCODING::PACKED)
 	{
-		glGenVertexArrays(1, &m_VAO);
-		glGenBuffers(1, &m_VBO);
-		glGenBuffers(1, &m_EBO);
+		finalizePacked();
+		return;
 	}
+	m_PackedOrigin = glm::vec4(0.0f);
+	m_PackedExtent = glm::vec4(0.0f);
+
+	RenderDevice& device = RenderDevice::Get();
 
 	// preprocess buffer data as interleaved or seperate when specified
 	std::vector<float> data;
@@ -140,86 +150,134 @@ void Mesh::Finalize(bool interleaved)
 		}
 	}
 
+	if (interleaved)
+	{
+		// the vertices go into the arena's buffers of their layout, shared with all other meshes
+		// of the layout.
+		unsigned int layout = 0;
+		if (UV.size() > 0)         layout |= GeometryArena::LayoutUV;
+		if (Normals.size() > 0)    layout |= GeometryArena::LayoutNormal;
+		if (Tangents.size() > 0)   layout |= GeometryArena::LayoutTangent;
+		if (Bitangents.size() > 0) layout |= GeometryArena::LayoutBitangent;
+		releaseBuffers();
+		GeometryArena::Get().Upload(this, layout, data.data(), static_cast<unsigned int>(Positions.size()), Indices.data(), static_cast<unsigned int>(Indices.size()));
+		return;
+	}
+
+	// initialize object IDs if not configured before
+	GeometryArena::Get().Release(this);
+	if (!m_VAO)
+	{
+		m_VAO = device.CreateVertexArray();
+	}
+	if (!m_VBO)
+	{
+		m_VBO = device.CreateBuffer();
+		m_EBO = device.CreateBuffer();
+	}
+	m_BaseVertex = 0;
+	m_FirstIndex = 0;
+
 	// configure vertex attributes (only on vertex data size() > 0)
-	glBindVertexArray(m_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
+	device.BindVertexArray(m_VAO);
+	device.BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	device.BufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
 	// only fill the index buffer if the index array is non-empty.
 	if (Indices.size() > 0)
 	{
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), &Indices[0], GL_STATIC_DRAW);
+		device.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+		device.BufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), &Indices[0], GL_STATIC_DRAW);
 	}
-	if (interleaved)
+	size_t offset = 0;
+	device.EnableVertexAttribute(0, 3, GL_FLOAT, false, 0, offset);
+	offset += Positions.size() * 3 * sizeof(float);
+	if (UV.size() > 0)
 	{
-		// calculate stride from number of non-empty vertex attribute arrays
-		size_t stride = 3 * sizeof(float);
-		if (UV.size() > 0)         stride += 2 * sizeof(float);
-		if (Normals.size() > 0)    stride += 3 * sizeof(float);
-		if (Tangents.size() > 0)   stride += 3 * sizeof(float);
-		if (Bitangents.size() > 0) stride += 3 * sizeof(float);
-
-		size_t offset = 0;
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
-		offset += 3 * sizeof(float);
-		if (UV.size() > 0)
-		{
-			glEnableVertexAttribArray(1);
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
-			offset += 2 * sizeof(float);
-		}
-		if (Normals.size() > 0)
-		{
-			glEnableVertexAttribArray(2);
-			glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
-			offset += 3 * sizeof(float);
-		}
-		if (Tangents.size() > 0)
-		{
-			glEnableVertexAttribArray(3);
-			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
-			offset += 3 * sizeof(float);
-		}
-		if (Bitangents.size() > 0)
-		{
-			glEnableVertexAttribArray(4);
-			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
-			offset += 3 * sizeof(float);
-		}
+		device.EnableVertexAttribute(1, 2, GL_FLOAT, false, 0, offset);
+		offset += UV.size() * 2 * sizeof(float);
 	}
-	else
+	if (Normals.size() > 0)
 	{
-		size_t offset = 0;
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)offset);
-		offset += Positions.size() * sizeof(float);
-		if (UV.size() > 0)
-		{
-			glEnableVertexAttribArray(1);
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)offset);
-			offset += UV.size() * sizeof(float);
-		}
-		if (Normals.size() > 0)
-		{
-			glEnableVertexAttribArray(2);
-			glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)offset);
-			offset += Normals.size() * sizeof(float);
-		}
-		if (Tangents.size() > 0)
-		{
-			glEnableVertexAttribArray(3);
-			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)offset);
-			offset += Tangents.size() * sizeof(float);
-		}
-		if (Bitangents.size() > 0)
+		device.EnableVertexAttribute(2, 3, GL_FLOAT, false, 0, offset);
+		offset += Normals.size() * 3 * sizeof(float);
+	}
+	if (Tangents.size() > 0)
+	{
+		device.EnableVertexAttribute(3, 3, GL_FLOAT, false, 0, offset);
+		offset += Tangents.size() * 3 * sizeof(float);
+	}
+	if (Bitangents.size() > 0)
+	{
+		device.EnableVertexAttribute(4, 3, GL_FLOAT, false, 0, offset);
+		offset += Bitangents.size() * 3 * sizeof(float);
+	}
+	device.BindVertexArray(0);
+}
+
+void Mesh::finalizePacked()
+{
+	unsigned int layout = GeometryArena::LayoutPacked;
+	if (UV.size() > 0)       layout |= GeometryArena::LayoutUV;
+	if (Normals.size() > 0)  layout |= GeometryArena::LayoutNormal;
+	if (Tangents.size() > 0) layout |= GeometryArena::LayoutTangent;
+	const unsigned int stride = GeometryArena::GetStride(layout);
+	const unsigned int count = static_cast<unsigned int>(Positions.size());
+
+	// positions are quantized within the bounding box.
+	glm::vec3 boxMin(0.0f);
+	glm::vec3 boxMax(0.0f);
+	if (count > 0)
+	{
+		boxMin = boxMax = Positions[0];
+		for (const glm::vec3& position : Positions)
 		{
-			glEnableVertexAttribArray(4);
-			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)offset);
-			offset += Bitangents.size() * sizeof(float);
+			boxMin = glm::min(boxMin, position);
+			boxMax = glm::max(boxMax, position);
 		}
 	}
-	glBindVertexArray(0);
+
+	std::vector<uint8_t> data(count * stride);
+	uint8_t* attribute = data.data();
+	VertexPacking::PackPositions(Positions.data(), count, boxMin, boxMax - boxMin, attribute, stride);
+	attribute += VertexPacking::PositionSize;
+	if (layout & GeometryArena::LayoutUV)
+	{
+		VertexPacking::PackUVs(UV.data(), count, attribute, stride);
+		attribute += VertexPacking::UVSize;
+	}
+	if (layout & GeometryArena::LayoutNormal)
+	{
+		VertexPacking::PackNormals(Normals.data(), count, attribute, stride);
+		attribute += VertexPacking::NormalSize;
+	}
+	if (layout & GeometryArena::LayoutTangent)
+	{
+		// the bitangents only leave their handedness.
+		VertexPacking::PackTangents(Tangents.data(), Normals.empty() ? nullptr : Normals.data(), Bitangents.empty() ? nullptr : Bitangents.data(), count, attribute, stride);
+		attribute += VertexPacking::TangentSize;
+	}
+
+	releaseBuffers();
+	GeometryArena::Get().Upload(this, layout, data.data(), count, Indices.data(), static_cast<unsigned int>(Indices.size()));
+	m_PackedOrigin = glm::vec4(boxMin, 0.0f);
+	m_PackedExtent = glm::vec4(boxMax - boxMin, 1.0f);
+}
+
+void Mesh::releaseBuffers()
+{
+	// only meshes outside of the arena have buffers of their own, and then m_VAO is theirs too.
+	if (!m_VBO)
+	{
+		return;
+	}
+
+	RenderDevice& device = RenderDevice::Get();
+	device.DeleteVertexArray(m_VAO);
+	device.DeleteBuffer(m_VBO);
+	device.DeleteBuffer(m_EBO);
+	m_VAO = 0;
+	m_VBO = 0;
+	m_EBO = 0;
 }
 
 void Mesh::FromSDF(std::function<float(glm::vec3)>& sdf, float maxDistance, uint16_t gridResolution)
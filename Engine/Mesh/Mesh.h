@@ -31,6 +31,20 @@ enum class TOPOLOGY
 	TRIANGLE_FAN,
 };
 
+/*
+
+  How interleaved vertices are stored on the GPU: FLOAT keeps all attributes as 32 bit floats,
+  PACKED quantizes them (see VertexPacking.h) and leaves out the bitangents, which the shaders
+  derive from the normal, the tangent and its handedness. Only shaders that include
+  common/vertex_decode.glsl can draw packed meshes.
+
+*/
+enum class VERTEX_ENCODING
+{
+	FLOAT,
+	PACKED,
+};
+
 /*
 
   Base Mesh class. A mesh in its simplest form is purely a list of vertices, with some added
@@ -42,8 +56,21 @@ class Mesh
 	// NOTE(Joey): public for now for testing and easy access; will eventually be private and only visible to renderer (as a friend class)
 public:
 	unsigned int m_VAO = 0;
-	unsigned int m_VBO;
-	unsigned int m_EBO;
+	unsigned int m_VBO = 0;
+	unsigned int m_EBO = 0;
+	// where the mesh's vertices and indices start in the buffers of m_VAO. Interleaved meshes
+	// share their buffers and vertex array with all meshes of their layout, see GeometryArena.
+	int m_BaseVertex = 0;
+	unsigned int m_FirstIndex = 0;
+	// the mesh's pool and ranges in the GeometryArena, if it's in there.
+	unsigned int m_GeometryPool = ~0u;
+	unsigned int m_GeometryVertices = ~0u;
+	unsigned int m_GeometryIndices = ~0u;
+	// packed positions decode as m_PackedOrigin + position * m_PackedExtent, the mesh's bounding
+	// box; the w of m_PackedExtent is 1 for packed meshes and 0 otherwise. Shaders get both as
+	// the PackedOrigin and PackedExtent uniforms.
+	glm::vec4 m_PackedOrigin = glm::vec4(0.0f);
+	glm::vec4 m_PackedExtent = glm::vec4(0.0f);
 public:
 	std::vector<glm::vec3> Positions;
 	std::vector<glm::vec2> UV;
@@ -52,6 +79,8 @@ public:
 	std::vector<glm::vec3> Bitangents;
 
 	TOPOLOGY Topology = TOPOLOGY::TRIANGLES;
+	// applies to interleaved meshes, at the next Finalize().
+	VERTEX_ENCODING Encoding = VERTEX_ENCODING::FLOAT;
 	std::vector<unsigned int> Indices;
 
 	// support multiple ways of initializing a mesh
@@ -60,6 +89,11 @@ public:
 	Mesh(std::vector<glm::vec3> positions, std::vector<glm::vec2> uv, std::vector<unsigned int> indices);
 	Mesh(std::vector<glm::vec3> positions, std::vector<glm::vec2> uv, std::vector<glm::vec3> normals, std::vector<unsigned int> indices);
 	Mesh(std::vector<glm::vec3> positions, std::vector<glm::vec2> uv, std::vector<glm::vec3> normals, std::vector<glm::vec3> tangents, std::vector<glm::vec3> bitangents, std::vector<unsigned int> indices);
+	virtual ~Mesh();
+
+	// the arena keeps a pointer to the mesh, copies would share its ranges.
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
 
 	// set vertex data manually
 	// TODO(Joey): not sure if these are required if we can directly set vertex data from public fields; construct several use-cases to test.
@@ -68,13 +102,17 @@ public:
 	void SetNormals(std::vector<glm::vec3> normals);
 	void SetTangents(std::vector<glm::vec3> tangents, std::vector<glm::vec3> bitangents); // NOTE(Joey): you can only set both tangents and bitangents at the same time to prevent mismatches
 
-	// commits all buffers and attributes to the GPU driver
+	// commits all buffers and attributes to the GPU driver; interleaved meshes go into the
+	// GeometryArena in their Encoding, the others get float buffers and a vertex array of their own.
 	void Finalize(bool interleaved = true);
 
 	// generate triangulated mesh from signed distance field
 	void FromSDF(std::function<float(glm::vec3)>& sdf, float maxDistance, uint16_t gridResolution);
 
 private:
+	void finalizePacked();
+	// deletes the vertex array and buffers a non interleaved Finalize() created for the mesh alone.
+	void releaseBuffers();
 	void calculateNormals(bool smooth = true);
 	void calculateTangents();
 };
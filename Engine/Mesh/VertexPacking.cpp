@@ -0,0 +1,454 @@
+#include "VertexPacking.h"
+
+#include "Camera/FrustumCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VERTEX_PACKING_X86 1
+#include <immintrin.h>
+#else
+#define VERTEX_PACKING_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define VERTEX_PACKING_TARGET_SSE
+#else
+#define VERTEX_PACKING_TARGET_SSE __attribute__((target("sse2")))
+#endif
+
+namespace VertexPacking
+{
+	namespace
+	{
+		// keeps zero length vectors from dividing by zero; they encode as +z.
+		const float s_MinLength = 1e-20f;
+
+		// the handedness in the top 2 bits of a tangent, 1 and -1 as signed 2 bit values.
+		const uint32_t s_RightHanded = 1u << 30;
+		const uint32_t s_LeftHanded = 3u << 30;
+
+		// the scalar code does the operations of the SSE code in the same order, so both give
+		// the same bits; rounding is to nearest even in both.
+		float signNotZero(float value)
+		{
+			return value >= 0.0f ? 1.0f : -1.0f;
+		}
+
+		int quantize(float value, float lowest, float highest, float scale)
+		{
+			return static_cast<int>(std::nearbyint(std::min(std::max(value, lowest), highest) * scale));
+		}
+
+		void octEncode(const glm::vec3& v, float& outX, float& outY)
+		{
+			const float length = std::max(std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z), s_MinLength);
+			const float x = v.x / length;
+			const float y = v.y / length;
+			// the lower half folds over the diagonals onto the corners of the square.
+			if (v.z < 0.0f)
+			{
+				outX = (1.0f - std::fabs(y)) * signNotZero(x);
+				outY = (1.0f - std::fabs(x)) * signNotZero(y);
+			}
+			else
+			{
+				outX = x;
+				outY = y;
+			}
+		}
+
+		glm::vec3 octDecode(float x, float y)
+		{
+			glm::vec3 v(x, y, 1.0f - std::fabs(x) - std::fabs(y));
+			const float t = std::max(-v.z, 0.0f);
+			v.x += v.x >= 0.0f ? -t : t;
+			v.y += v.y >= 0.0f ? -t : t;
+			return glm::normalize(v);
+		}
+
+		uint32_t packTangent(const glm::vec3& tangent, float handedness)
+		{
+			float x, y;
+			octEncode(tangent, x, y);
+			const uint32_t qx = static_cast<uint32_t>(quantize(x, -1.0f, 1.0f, TangentMax)) & 0x3ff;
+			const uint32_t qy = static_cast<uint32_t>(quantize(y, -1.0f, 1.0f, TangentMax)) & 0x3ff;
+			return qx | (qy << 10) | (handedness < 0.0f ? s_LeftHanded : s_RightHanded);
+		}
+
+		float getHandedness(const glm::vec3& tangent, const glm::vec3& normal, const glm::vec3& bitangent)
+		{
+			const float cx = normal.y * tangent.z - normal.z * tangent.y;
+			const float cy = normal.z * tangent.x - normal.x * tangent.z;
+			const float cz = normal.x * tangent.y - normal.y * tangent.x;
+			return cx * bitangent.x + cy * bitangent.y + cz * bitangent.z;
+		}
+
+#if VERTEX_PACKING_X86
+		// x, y and z of v[0] to v[3], reading v[4].x as well.
+		VERTEX_PACKING_TARGET_SSE
+		void loadVec3x4(const glm::vec3* v, __m128& outX, __m128& outY, __m128& outZ)
+		{
+			__m128 r0 = _mm_loadu_ps(&v[0].x);
+			__m128 r1 = _mm_loadu_ps(&v[1].x);
+			__m128 r2 = _mm_loadu_ps(&v[2].x);
+			__m128 r3 = _mm_loadu_ps(&v[3].x);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			outX = r0;
+			outY = r1;
+			outZ = r2;
+		}
+
+		// writes the 4 32 bit lanes of words to out, stride bytes apart.
+		VERTEX_PACKING_TARGET_SSE
+		void storeWords(__m128i words, uint8_t* out, unsigned int stride)
+		{
+			for (unsigned int lane = 0; lane < 4; ++lane)
+			{
+				const uint32_t word = static_cast<uint32_t>(_mm_cvtsi128_si32(words));
+				std::memcpy(out + lane * stride, &word, sizeof(word));
+				words = _mm_srli_si128(words, 4);
+			}
+		}
+
+		VERTEX_PACKING_TARGET_SSE
+		__m128 signNotZero(__m128 value)
+		{
+			const __m128 positive = _mm_cmpge_ps(value, _mm_setzero_ps());
+			return _mm_or_ps(_mm_and_ps(positive, _mm_set1_ps(1.0f)), _mm_andnot_ps(positive, _mm_set1_ps(-1.0f)));
+		}
+
+		VERTEX_PACKING_TARGET_SSE
+		__m128i quantize(__m128 value, float lowest, float highest, float scale)
+		{
+			const __m128 clamped = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(lowest)), _mm_set1_ps(highest));
+			return _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(scale)));
+		}
+
+		VERTEX_PACKING_TARGET_SSE
+		void octEncode(__m128 x, __m128 y, __m128 z, __m128& outX, __m128& outY)
+		{
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+			const __m128 length = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_and_ps(x, absMask), _mm_and_ps(y, absMask)), _mm_and_ps(z, absMask)), _mm_set1_ps(s_MinLength));
+			x = _mm_div_ps(x, length);
+			y = _mm_div_ps(y, length);
+
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(y, absMask)), signNotZero(x));
+			const __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(x, absMask)), signNotZero(y));
+			const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+			outX = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, x));
+			outY = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, y));
+		}
+
+		// 4 floats to halves in the low 16 bits of the lanes, sign extended; same steps as
+		// FloatToHalf.
+		VERTEX_PACKING_TARGET_SSE
+		__m128i floatToHalf(__m128 value)
+		{
+			const __m128i halfMax = _mm_set1_epi32((127 + 16) << 23);
+			const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+			const __m128i subnormalMagic = _mm_set1_epi32(126 << 23);
+			const __m128i normalBias = _mm_set1_epi32(static_cast<int>(0xfffu - (112u << 23)));
+
+			const __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u))));
+			const __m128 absolute = _mm_xor_ps(value, sign);
+			const __m128i bits = _mm_castps_si128(absolute);
+
+			// infinity, or the quiet NaN for NaNs.
+			const __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(absolute, absolute));
+			const __m128i special = _mm_or_si128(_mm_and_si128(nan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+			const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+			const __m128i odd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+			const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, normalBias), odd), 13);
+
+			const __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, bits);
+			const __m128i isRegular = _mm_cmpgt_epi32(halfMax, bits);
+			const __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+			const __m128i half = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+			return _mm_or_si128(half, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+		}
+
+		VERTEX_PACKING_TARGET_SSE
+		unsigned int packPositionsSSE(const glm::vec3* positions, unsigned int count, const glm::vec3& origin, const glm::vec3& scale, uint8_t* out, unsigned int stride)
+		{
+			const __m128 originX = _mm_set1_ps(origin.x), originY = _mm_set1_ps(origin.y), originZ = _mm_set1_ps(origin.z);
+			const __m128 scaleX = _mm_set1_ps(scale.x), scaleY = _mm_set1_ps(scale.y), scaleZ = _mm_set1_ps(scale.z);
+			// SSE2 only packs signed, so the values are biased into the signed range and back.
+			const __m128i bias = _mm_set1_epi32(32768);
+			const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+
+			unsigned int i = 0;
+			for (; i + 4 < count; i += 4)
+			{
+				__m128 x, y, z;
+				loadVec3x4(positions + i, x, y, z);
+				const __m128i qx = _mm_sub_epi32(quantize(_mm_mul_ps(_mm_sub_ps(x, originX), scaleX), 0.0f, PositionMax, 1.0f), bias);
+				const __m128i qy = _mm_sub_epi32(quantize(_mm_mul_ps(_mm_sub_ps(y, originY), scaleY), 0.0f, PositionMax, 1.0f), bias);
+				const __m128i qz = _mm_sub_epi32(quantize(_mm_mul_ps(_mm_sub_ps(z, originZ), scaleZ), 0.0f, PositionMax, 1.0f), bias);
+
+				// x0..x3 y0..y3 and z0..z3 followed by the zero padding.
+				const __m128i xy = _mm_xor_si128(_mm_packs_epi32(qx, qy), flip);
+				const __m128i zw = _mm_xor_si128(_mm_packs_epi32(qz, _mm_sub_epi32(_mm_setzero_si128(), bias)), flip);
+				const __m128i xz = _mm_unpacklo_epi16(xy, zw);
+				const __m128i yw = _mm_unpackhi_epi16(xy, zw);
+				const __m128i vertices01 = _mm_unpacklo_epi16(xz, yw);
+				const __m128i vertices23 = _mm_unpackhi_epi16(xz, yw);
+
+				uint8_t* vertex = out + i * stride;
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(vertex), vertices01);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(vertex + stride), _mm_srli_si128(vertices01, 8));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(vertex + 2 * stride), vertices23);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(vertex + 3 * stride), _mm_srli_si128(vertices23, 8));
+			}
+			return i;
+		}
+
+		VERTEX_PACKING_TARGET_SSE
+		unsigned int packUVsSSE(const glm::vec2* uv, unsigned int count, uint8_t* out, unsigned int stride)
+		{
+			unsigned int i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128i uv01 = floatToHalf(_mm_loadu_ps(&uv[i].x));
+				const __m128i uv23 = floatToHalf(_mm_loadu_ps(&uv[i + 2].x));
+				storeWords(_mm_packs_epi32(uv01, uv23), out + i * stride, stride);
+			}
+			return i;
+		}
+
+		VERTEX_PACKING_TARGET_SSE
+		unsigned int packNormalsSSE(const glm::vec3* normals, unsigned int count, uint8_t* out, unsigned int stride)
+		{
+			unsigned int i = 0;
+			for (; i + 4 < count; i += 4)
+			{
+				__m128 x, y, z, octX, octY;
+				loadVec3x4(normals + i, x, y, z);
+				octEncode(x, y, z, octX, octY);
+				const __m128i packed = _mm_packs_epi32(quantize(octX, -1.0f, 1.0f, NormalMax), quantize(octY, -1.0f, 1.0f, NormalMax));
+				storeWords(_mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8)), out + i * stride, stride);
+			}
+			return i;
+		}
+
+		VERTEX_PACKING_TARGET_SSE
+		unsigned int packTangentsSSE(const glm::vec3* tangents, const glm::vec3* normals, const glm::vec3* bitangents, unsigned int count, uint8_t* out, unsigned int stride)
+		{
+			const __m128i mask = _mm_set1_epi32(0x3ff);
+			const __m128i rightHanded = _mm_set1_epi32(static_cast<int>(s_RightHanded));
+			const __m128i leftHanded = _mm_set1_epi32(static_cast<int>(s_LeftHanded));
+
+			unsigned int i = 0;
+			for (; i + 4 < count; i += 4)
+			{
+				__m128 tx, ty, tz, octX, octY;
+				loadVec3x4(tangents + i, tx, ty, tz);
+				octEncode(tx, ty, tz, octX, octY);
+				const __m128i qx = _mm_and_si128(quantize(octX, -1.0f, 1.0f, TangentMax), mask);
+				const __m128i qy = _mm_slli_epi32(_mm_and_si128(quantize(octY, -1.0f, 1.0f, TangentMax), mask), 10);
+
+				__m128i handedness = rightHanded;
+				if (normals && bitangents)
+				{
+					__m128 nx, ny, nz, bx, by, bz;
+					loadVec3x4(normals + i, nx, ny, nz);
+					loadVec3x4(bitangents + i, bx, by, bz);
+					const __m128 cx = _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty));
+					const __m128 cy = _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz));
+					const __m128 cz = _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx));
+					const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, bx), _mm_mul_ps(cy, by)), _mm_mul_ps(cz, bz));
+					const __m128i left = _mm_castps_si128(_mm_cmplt_ps(dot, _mm_setzero_ps()));
+					handedness = _mm_or_si128(_mm_and_si128(left, leftHanded), _mm_andnot_si128(left, rightHanded));
+				}
+				storeWords(_mm_or_si128(_mm_or_si128(qx, qy), handedness), out + i * stride, stride);
+			}
+			return i;
+		}
+#endif
+
+		bool useSIMD()
+		{
+#if VERTEX_PACKING_X86
+			return FrustumCulling::GetActiveIsa() != FrustumCulling::Isa::Scalar;
+#else
+			return false;
+#endif
+		}
+	}
+
+	void PackPositions(const glm::vec3* positions, unsigned int count, const glm::vec3& origin, const glm::vec3& extent, uint8_t* out, unsigned int stride)
+	{
+		glm::vec3 scale;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			scale[axis] = extent[axis] > 0.0f ? PositionMax / extent[axis] : 0.0f;
+		}
+
+		unsigned int i = 0;
+#if VERTEX_PACKING_X86
+		if (useSIMD())
+		{
+			i = packPositionsSSE(positions, count, origin, scale, out, stride);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const uint16_t packed[4] =
+			{
+				static_cast<uint16_t>(quantize((positions[i].x - origin.x) * scale.x, 0.0f, PositionMax, 1.0f)),
+				static_cast<uint16_t>(quantize((positions[i].y - origin.y) * scale.y, 0.0f, PositionMax, 1.0f)),
+				static_cast<uint16_t>(quantize((positions[i].z - origin.z) * scale.z, 0.0f, PositionMax, 1.0f)),
+				0
+			};
+			std::memcpy(out + i * stride, packed, sizeof(packed));
+		}
+	}
+
+	void PackUVs(const glm::vec2* uv, unsigned int count, uint8_t* out, unsigned int stride)
+	{
+		unsigned int i = 0;
+#if VERTEX_PACKING_X86
+		if (useSIMD())
+		{
+			i = packUVsSSE(uv, count, out, stride);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const uint16_t packed[2] = { FloatToHalf(uv[i].x), FloatToHalf(uv[i].y) };
+			std::memcpy(out + i * stride, packed, sizeof(packed));
+		}
+	}
+
+	void PackNormals(const glm::vec3* normals, unsigned int count, uint8_t* out, unsigned int stride)
+	{
+		unsigned int i = 0;
+#if VERTEX_PACKING_X86
+		if (useSIMD())
+		{
+			i = packNormalsSSE(normals, count, out, stride);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			float x, y;
+			octEncode(normals[i], x, y);
+			const int16_t packed[2] =
+			{
+				static_cast<int16_t>(quantize(x, -1.0f, 1.0f, NormalMax)),
+				static_cast<int16_t>(quantize(y, -1.0f, 1.0f, NormalMax))
+			};
+			std::memcpy(out + i * stride, packed, sizeof(packed));
+		}
+	}
+
+	void PackTangents(const glm::vec3* tangents, const glm::vec3* normals, const glm::vec3* bitangents, unsigned int count, uint8_t* out, unsigned int stride)
+	{
+		unsigned int i = 0;
+#if VERTEX_PACKING_X86
+		if (useSIMD())
+		{
+			i = packTangentsSSE(tangents, normals, bitangents, count, out, stride);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const float handedness = normals && bitangents ? getHandedness(tangents[i], normals[i], bitangents[i]) : 1.0f;
+			const uint32_t packed = packTangent(tangents[i], handedness);
+			std::memcpy(out + i * stride, &packed, sizeof(packed));
+		}
+	}
+
+	glm::vec3 UnpackPosition(const uint8_t* packed, const glm::vec3& origin, const glm::vec3& extent)
+	{
+		uint16_t q[3];
+		std::memcpy(q, packed, sizeof(q));
+		return origin + glm::vec3(q[0], q[1], q[2]) / PositionMax * extent;
+	}
+
+	glm::vec2 UnpackUV(const uint8_t* packed)
+	{
+		uint16_t q[2];
+		std::memcpy(q, packed, sizeof(q));
+		return glm::vec2(HalfToFloat(q[0]), HalfToFloat(q[1]));
+	}
+
+	glm::vec3 UnpackNormal(const uint8_t* packed)
+	{
+		int16_t q[2];
+		std::memcpy(q, packed, sizeof(q));
+		return octDecode(std::min(std::max(q[0] / NormalMax, -1.0f), 1.0f), std::min(std::max(q[1] / NormalMax, -1.0f), 1.0f));
+	}
+
+	glm::vec4 UnpackTangent(const uint8_t* packed)
+	{
+		uint32_t word;
+		std::memcpy(&word, packed, sizeof(word));
+		// sign extend the 10 bit fields.
+		const int32_t qx = static_cast<int32_t>(word << 22) >> 22;
+		const int32_t qy = static_cast<int32_t>(word << 12) >> 22;
+		const int32_t qw = static_cast<int32_t>(word) >> 30;
+		const glm::vec3 tangent = octDecode(std::min(std::max(qx / TangentMax, -1.0f), 1.0f), std::min(std::max(qy / TangentMax, -1.0f), 1.0f));
+		return glm::vec4(tangent, qw < 0 ? -1.0f : 1.0f);
+	}
+
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint32_t half;
+		if (bits >= (127u + 16u) << 23)
+		{
+			// too large for a half, infinity or NaN.
+			half = bits > 0x7f800000u ? 0x7e00u : 0x7c00u;
+		}
+		else if (bits < (127u - 14u) << 23)
+		{
+			// adding 0.5 leaves the subnormal's mantissa, rounded, in the low bits.
+			const uint32_t magicBits = 126u << 23;
+			float magic, sum;
+			std::memcpy(&magic, &magicBits, sizeof(magic));
+			std::memcpy(&sum, &bits, sizeof(sum));
+			sum += magic;
+			std::memcpy(&half, &sum, sizeof(half));
+			half -= magicBits;
+		}
+		else
+		{
+			const uint32_t odd = (bits >> 13) & 1u;
+			half = (bits + 0xfffu - (112u << 23) + odd) >> 13;
+		}
+		return static_cast<uint16_t>(half | (sign >> 16));
+	}
+
+	float HalfToFloat(uint16_t value)
+	{
+		const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+		const uint32_t exponent = (value >> 10) & 0x1fu;
+		const uint32_t mantissa = value & 0x3ffu;
+
+		float result;
+		if (exponent == 0)
+		{
+			result = std::ldexp(static_cast<float>(mantissa), -24);
+		}
+		else if (exponent == 31)
+		{
+			result = mantissa ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+		}
+		else
+		{
+			const uint32_t bits = ((exponent + 112u) << 23) | (mantissa << 13);
+			std::memcpy(&result, &bits, sizeof(result));
+		}
+		return sign ? -result : result;
+	}
+}
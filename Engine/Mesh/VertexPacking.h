@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/*
+
+  Encoders of the packed vertex attributes of meshes with VERTEX_ENCODING::PACKED, writing
+  into interleaved vertices of any stride:
+
+    position  3 x 16 bit unsigned normalized within the mesh's bounding box, padded to 8 bytes
+    uv        2 x half float
+    normal    octahedral, 2 x 16 bit signed
+    tangent   octahedral in 10:10:10:2, x and y signed 10 bit, z unused and w the handedness
+              of the tangent frame (-1 or 1); the bitangent is cross(normal, tangent) * w
+
+  That's 20 bytes a vertex with all attributes instead of 56 as floats. Normals and tangents
+  are read as plain integers and scaled in the shader, which doesn't depend on how the GL
+  version maps signed normalized values. The encoders take 4 vertices at a time with SSE2 when
+  the culling kernels are not forced to scalar, with bit identical results. The decoders do
+  what common/vertex_decode.glsl does, for checking the encodings on the CPU.
+
+*/
+namespace VertexPacking
+{
+	// bytes of a packed attribute.
+	const unsigned int PositionSize = 8;
+	const unsigned int UVSize = 4;
+	const unsigned int NormalSize = 4;
+	const unsigned int TangentSize = 4;
+
+	// largest quantized value of an attribute; shaders divide by the same.
+	const float PositionMax = 65535.0f;
+	const float NormalMax = 32767.0f;
+	const float TangentMax = 511.0f;
+
+	// positions are quantized within the box at origin of size extent, extent 0 on an axis puts
+	// all positions at the origin on that axis.
+	void PackPositions(const glm::vec3* positions, unsigned int count, const glm::vec3& origin, const glm::vec3& extent, uint8_t* out, unsigned int stride);
+	void PackUVs(const glm::vec2* uv, unsigned int count, uint8_t* out, unsigned int stride);
+	// only the direction of normals and tangents is kept.
+	void PackNormals(const glm::vec3* normals, unsigned int count, uint8_t* out, unsigned int stride);
+	// the handedness is the sign of dot(cross(normal, tangent), bitangent); without normals or
+	// bitangents it's 1.
+	void PackTangents(const glm::vec3* tangents, const glm::vec3* normals, const glm::vec3* bitangents, unsigned int count, uint8_t* out, unsigned int stride);
+
+	glm::vec3 UnpackPosition(const uint8_t* packed, const glm::vec3& origin, const glm::vec3& extent);
+	glm::vec2 UnpackUV(const uint8_t* packed);
+	glm::vec3 UnpackNormal(const uint8_t* packed);
+	// xyz is the tangent, w the handedness.
+	glm::vec4 UnpackTangent(const uint8_t* packed);
+
+	// round to nearest even; values beyond the half range become infinity, tiny ones subnormals.
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+}
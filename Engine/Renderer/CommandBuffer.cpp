@@ -2,13 +2,73 @@
 
 #include "Renderer.h"
 #include "Camera/Camera.h"
+#include "Camera/FrustumCulling.h"
+#include "Camera/OcclusionCulling.h"
 #include "Shading/Material.h"
 #include "Mesh/Mesh.h"
+#include "Utils/RadixSort.h"
 
 #include <algorithm>
-#include <tuple>
+#include <cstdint>
+#include <limits>
+
+/*
+
+  Sort key layout, from the most to the least significant bit:
+
+	opaque: queue (3) | blend (1) | shader (12) | material (16) | vao (8) | mesh (8) | depth (16)
+	alpha:  queue (3) | blend (1) | inverted depth (16) | shader (12) | material (16) | vao (8) | mesh (8)
+
+  Opaque commands are grouped by the most expensive state switch first (program, then the
+  material's textures and uniforms, then the VAO) and only go front-to-back within equal state,
+  which still helps early depth rejection for instances of the same mesh. Interleaved meshes
+  share their VAO with all meshes of their layout (see GeometryArena), so the mesh itself
+  follows the VAO to keep commands of one mesh together. Alpha commands have to blend
+  back-to-front, so depth comes first and state only groups commands at equal depth.
+  The material and mesh fields are hashes of their address; collisions only cost grouping,
+  never order between queues or depth.
+
+*/
+static const int s_QueueShift = 61;
+static const int s_BlendShift = 60;
+static const uint64_t s_ShaderMask = 0xfff;
+static const uint64_t s_FieldMask = 0xffff;
+static const uint64_t s_MeshMask = 0xff;
+
+CommandBuffer::CommandQueue::CommandQueue(std::atomic<size_t>* allocationCounter)
+	: Commands(Utils::CountingAllocator<unsigned int>(allocationCounter))
+	, Visible(Utils::CountingAllocator<unsigned int>(allocationCounter))
+{
+}
 
 CommandBuffer::CommandBuffer(Renderer* renderer)
+	: m_AllocationCount(0)
+	, m_SortKeys(Utils::CountingAllocator<uint64_t>(&m_AllocationCount))
+	, m_BoundsMinX(Utils::CountingAllocator<float>(&m_AllocationCount))
+	, m_BoundsMinY(Utils::CountingAllocator<float>(&m_AllocationCount))
+	, m_BoundsMinZ(Utils::CountingAllocator<float>(&m_AllocationCount))
+	, m_BoundsMaxX(Utils::CountingAllocator<float>(&m_AllocationCount))
+	, m_BoundsMaxY(Utils::CountingAllocator<float>(&m_AllocationCount))
+	, m_BoundsMaxZ(Utils::CountingAllocator<float>(&m_AllocationCount))
+	, m_TransformIndices(Utils::CountingAllocator<unsigned int>(&m_AllocationCount))
+	, m_Meshes(Utils::CountingAllocator<Mesh*>(&m_AllocationCount))
+	, m_Materials(Utils::CountingAllocator<Material*>(&m_AllocationCount))
+	, m_Transforms(Utils::CountingAllocator<glm::mat4>(&m_AllocationCount))
+	, m_PrevTransforms(Utils::CountingAllocator<glm::mat4>(&m_AllocationCount))
+	, m_DeferredRenderCommands(&m_AllocationCount)
+	, m_AlphaRenderCommands(&m_AllocationCount)
+	, m_PostProcessingRenderCommands(&m_AllocationCount)
+	, m_CustomRenderCommands(CustomQueueMap::allocator_type(&m_AllocationCount))
+	, m_ShadowCastRenderCommands(Utils::CountingAllocator<unsigned int>(&m_AllocationCount))
+	, m_CullMask(Utils::CountingAllocator<uint32_t>(&m_AllocationCount))
+	, m_CullCommandCount(0)
+	, m_CullValid(false)
+	, m_OcclusionCuller(nullptr)
+	, m_CullOcclusionRender(0)
+	, m_SortKeysScratch(Utils::CountingAllocator<uint64_t>(&m_AllocationCount))
+	, m_SortKeysTemp(Utils::CountingAllocator<uint64_t>(&m_AllocationCount))
+	, m_SortIndicesTemp(Utils::CountingAllocator<unsigned int>(&m_AllocationCount))
+	, m_Buckets(Utils::CountingAllocator<Bucket>(&m_AllocationCount))
 {
 	m_Renderer = renderer;
 }
@@ -20,188 +80,376 @@ CommandBuffer::~CommandBuffer()
 
 void CommandBuffer::Push(Mesh* mesh, Material* material, glm::mat4 transform, glm::mat4 prevTransform, glm::vec3 boxMin, glm::vec3 boxMax, RenderTarget* target)
 {
-	RenderCommand command = {};
-	command.Mesh = mesh;
-	command.Material = material;
-	command.Transform = transform;
-	command.PrevTransform = prevTransform;
-	command.BoxMin = boxMin;
-	command.BoxMax = boxMax;
+	const RenderQueue queue = GetRenderQueue(material);
+	Append(queue, BuildSortKey(queue, mesh, material, transform), mesh, material, transform, prevTransform, boxMin, boxMax, target);
+}
 
-	// if material requires alpha support, add it to alpha render commands for later rendering.
+RenderQueue CommandBuffer::GetRenderQueue(const Material* material)
+{
 	if (material->Blend)
 	{
-		material->Type = MATERIAL_CUSTOM;
-		m_AlphaRenderCommands.push_back(command);
+		return RENDER_QUEUE_ALPHA;
 	}
-	else
+	switch (material->Type)
 	{
-		// check the type of the material and process differently where necessary
-		if (material->Type == MATERIAL_DEFAULT)
-		{
-			m_DeferredRenderCommands.push_back(command);
-		}
-		else if (material->Type == MATERIAL_CUSTOM)
-		{
-			// check if this render target has been pushed before, if so add to vector, 
-			// otherwise create new vector with this render target.
-			if (m_CustomRenderCommands.find(target) != m_CustomRenderCommands.end())
-				m_CustomRenderCommands[target].push_back(command);
-			else
-			{
-				m_CustomRenderCommands[target] = std::vector<RenderCommand>();
-				m_CustomRenderCommands[target].push_back(command);
-			}
-		}
-		else if (material->Type == MATERIAL_POST_PROCESS)
+	case MATERIAL_DEFAULT:
+		return RENDER_QUEUE_DEFERRED;
+	case MATERIAL_POST_PROCESS:
+		return RENDER_QUEUE_POST_PROCESS;
+	default:
+		return RENDER_QUEUE_CUSTOM;
+	}
+}
+
+void CommandBuffer::Append(RenderQueue queue, uint64_t sortKey, Mesh* mesh, Material* material, const glm::mat4& transform, const glm::mat4& prevTransform, const glm::vec3& boxMin, const glm::vec3& boxMax, RenderTarget* target)
+{
+	FrameVector<unsigned int>* queueCommands = nullptr;
+	switch (queue)
+	{
+	case RENDER_QUEUE_DEFERRED:
+		queueCommands = &m_DeferredRenderCommands.Commands;
+		break;
+	case RENDER_QUEUE_ALPHA:
+		// alpha blended materials are always rendered forward.
+		material->Type = MATERIAL_CUSTOM;
+		queueCommands = &m_AlphaRenderCommands.Commands;
+		break;
+	case RENDER_QUEUE_POST_PROCESS:
+		queueCommands = &m_PostProcessingRenderCommands.Commands;
+		break;
+	case RENDER_QUEUE_CUSTOM:
+	{
+		// check if this render target has been pushed before, if so add to its queue, 
+		// otherwise create a new queue for this render target.
+		auto rtIt = m_CustomRenderCommands.find(target);
+		if (rtIt == m_CustomRenderCommands.end())
 		{
-			m_PostProcessingRenderCommands.push_back(command);
+			rtIt = m_CustomRenderCommands.emplace(target, CommandQueue(&m_AllocationCount)).first;
 		}
+		queueCommands = &rtIt->second.Commands;
+		break;
+	}
 	}
+
+	queueCommands->push_back(static_cast<unsigned int>(m_SortKeys.size()));
+
+	m_SortKeys.push_back(sortKey);
+	m_BoundsMinX.push_back(boxMin.x);
+	m_BoundsMinY.push_back(boxMin.y);
+	m_BoundsMinZ.push_back(boxMin.z);
+	m_BoundsMaxX.push_back(boxMax.x);
+	m_BoundsMaxY.push_back(boxMax.y);
+	m_BoundsMaxZ.push_back(boxMax.z);
+	m_TransformIndices.push_back(static_cast<unsigned int>(m_Transforms.size()));
+	m_Meshes.push_back(mesh);
+	m_Materials.push_back(material);
+
+	m_Transforms.push_back(transform);
+	m_PrevTransforms.push_back(prevTransform);
 }
 
-void CommandBuffer::Clear()
+CommandBuffer::Bucket::Bucket(CommandBuffer* owner)
+	: m_Owner(owner)
+	, m_Commands(Utils::CountingAllocator<RenderCommand>(&owner->m_AllocationCount))
+	, m_Targets(Utils::CountingAllocator<RenderTarget*>(&owner->m_AllocationCount))
 {
-	m_DeferredRenderCommands.clear();
-	m_CustomRenderCommands.clear();
-	m_PostProcessingRenderCommands.clear();
-	m_AlphaRenderCommands.clear();
 }
 
-// custom per-element sort compare function used by the CommandBuffer::Sort() function.
-bool renderSortDeferred(const RenderCommand& a, const RenderCommand& b)
+void CommandBuffer::Bucket::Push(Mesh* mesh, Material* material, glm::mat4 transform, glm::mat4 prevTransform, glm::vec3 boxMin, glm::vec3 boxMax, RenderTarget* target)
 {
-	return a.Material->GetShader()->ID < b.Material->GetShader()->ID;
+	// the material isn't written to here; marking alpha materials forward happens when merging.
+	const RenderQueue queue = CommandBuffer::GetRenderQueue(material);
+
+	RenderCommand command;
+	command.Transform = transform;
+	command.PrevTransform = prevTransform;
+	command.BoxMin = boxMin;
+	command.BoxMax = boxMax;
+	command.Material = material;
+	command.Mesh = mesh;
+	command.SortKey = m_Owner->BuildSortKey(queue, mesh, material, transform);
+	m_Commands.push_back(command);
+	m_Targets.push_back(target);
 }
-// sort render state
-bool renderSortCustom(const RenderCommand& a, const RenderCommand& b)
+
+void CommandBuffer::ReserveBuckets(unsigned int count)
 {
-	/*
+	while (m_Buckets.size() < count)
+	{
+		m_Buckets.emplace_back(this);
+	}
+}
 
-	  We want strict weak ordering, which states that if two objects x and y are equivalent
-	  then both f(x,y) and f(y,x) should be false. Thus when comparing the object to itself
-	  the comparison should always equal false.
+void CommandBuffer::MergeBuckets()
+{
+	for (Bucket& bucket : m_Buckets)
+	{
+		for (unsigned int i = 0; i < bucket.GetCommandCount(); ++i)
+		{
+			const RenderCommand& command = bucket.m_Commands[i];
+			const RenderQueue queue = static_cast<RenderQueue>(command.SortKey >> s_QueueShift);
+			Append(queue, command.SortKey, command.Mesh, command.Material, command.Transform, command.PrevTransform, command.BoxMin, command.BoxMax, bucket.m_Targets[i]);
+		}
+		bucket.m_Commands.clear();
+		bucket.m_Targets.clear();
+	}
+}
 
-	  We also want to do multiple sort comparisons in a single pass, so we encapsulate all
-	  relevant properties inside an n-tuple with n being equal to the number of sort queries
-	  we want to do. The tuple < comparison operator initially compares its left-most element
-	  and then works along the next elements of the tuple until an outcome is clear.
+void CommandBuffer::Clear()
+{
+	m_SortKeys.clear();
+	m_BoundsMinX.clear();
+	m_BoundsMinY.clear();
+	m_BoundsMinZ.clear();
+	m_BoundsMaxX.clear();
+	m_BoundsMaxY.clear();
+	m_BoundsMaxZ.clear();
+	m_TransformIndices.clear();
+	m_Meshes.clear();
+	m_Materials.clear();
+	m_Transforms.clear();
+	m_PrevTransforms.clear();
 
-	  Another (non C++11) alternative is to write out both the < and > case with the == case
-	  defaulting to false as in:
+	m_DeferredRenderCommands.Commands.clear();
+	m_AlphaRenderCommands.Commands.clear();
+	m_PostProcessingRenderCommands.Commands.clear();
+	for (auto rtIt = m_CustomRenderCommands.begin(); rtIt != m_CustomRenderCommands.end(); rtIt++)
+	{
+		rtIt->second.Commands.clear();
+	}
+	m_ShadowCastRenderCommands.clear();
+	for (Bucket& bucket : m_Buckets)
+	{
+		bucket.m_Commands.clear();
+		bucket.m_Targets.clear();
+	}
+	m_CullValid = false;
+}
 
-	  if(a1 < b1)
-		return true;
-	  if(b1 > a1)
-		return false;
+uint64_t CommandBuffer::BuildSortKey(RenderQueue queue, Mesh* mesh, Material* material, const glm::mat4& transform) const
+{
+	const uint64_t shader = material->GetShader() ? material->GetShader()->ID & s_ShaderMask : 0;
+	const uint64_t materialHash = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(material)) * 0x9e3779b97f4a7c15ull) >> 48;
+	const uint64_t vao = mesh ? mesh->m_VAO & s_MeshMask : 0;
+	const uint64_t meshHash = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(mesh)) * 0x9e3779b97f4a7c15ull) >> 56;
+	const uint64_t meshField = (vao << 8) | meshHash;
 
-	  if(a2 < b2)
-		return true;
-	  if(b2 > a2)
-		return false;
-	  [...] and so on for each query you want to perform
-	  return false;
+	// view depth of the object's origin, quantized over the camera's depth range.
+	uint64_t depth = 0;
+	Camera* camera = m_Renderer->GetCamera();
+	if (camera)
+	{
+		const float nearPlane = camera->GetNearPlane();
+		const float farPlane = camera->GetFarPlane();
+		const float viewDepth = glm::dot(glm::vec3(transform[3]) - camera->GetPosition(), camera->GetForward());
+		const float t = glm::clamp((viewDepth - nearPlane) / (farPlane - nearPlane), 0.0f, 1.0f);
+		depth = static_cast<uint64_t>(t * static_cast<float>(s_FieldMask));
+	}
 
-	*/
-	return std::make_tuple(a.Material->Blend, a.Material->GetShader()->ID) <
-		std::make_tuple(b.Material->Blend, b.Material->GetShader()->ID);
+	uint64_t key = static_cast<uint64_t>(queue) << s_QueueShift;
+	if (material->Blend)
+	{
+		key |= 1ull << s_BlendShift;
+		key |= (s_FieldMask - depth) << 44;
+		key |= shader << 32;
+		key |= materialHash << 16;
+		key |= meshField;
+	}
+	else
+	{
+		key |= shader << 48;
+		key |= materialHash << 32;
+		key |= meshField << 16;
+		key |= depth;
+	}
+	return key;
 }
-bool renderSortShader(const RenderCommand& a, const RenderCommand& b)
+
+void CommandBuffer::SortRenderCommands(FrameVector<unsigned int>& commands)
 {
-	return a.Material->GetShader()->ID < b.Material->GetShader()->ID;
+	const unsigned int count = static_cast<unsigned int>(commands.size());
+	if (count < 2)
+	{
+		return;
+	}
+
+	m_SortKeysScratch.resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		m_SortKeysScratch[i] = m_SortKeys[commands[i]];
+	}
+
+	// sorted on the calling thread: a queue sorts in well under a millisecond and spawning
+	// workers would allocate every frame.
+	Utils::RadixSort(m_SortKeysScratch, commands, 64, m_SortKeysTemp, m_SortIndicesTemp, std::numeric_limits<unsigned int>::max());
 }
 
 void CommandBuffer::Sort()
 {
-	std::sort(m_DeferredRenderCommands.begin(), m_DeferredRenderCommands.end(), renderSortDeferred);
+	SortRenderCommands(m_DeferredRenderCommands.Commands);
 	for (auto rtIt = m_CustomRenderCommands.begin(); rtIt != m_CustomRenderCommands.end(); rtIt++)
 	{
-		std::sort(rtIt->second.begin(), rtIt->second.end(), renderSortCustom);
+		SortRenderCommands(rtIt->second.Commands);
+	}
+	SortRenderCommands(m_AlphaRenderCommands.Commands);
+}
+
+void CommandBuffer::SetOcclusionCuller(OcclusionCuller* culler)
+{
+	if (culler != m_OcclusionCuller)
+	{
+		m_OcclusionCuller = culler;
+		m_CullValid = false;
 	}
 }
 
-std::vector<RenderCommand> CommandBuffer::GetDeferredRenderCommands(bool cull)
+RenderCommandList CommandBuffer::GetDeferredRenderCommands(bool cull)
 {
 	if (cull)
 	{
-		std::vector<RenderCommand> commands;
-		for (auto it = m_DeferredRenderCommands.begin(); it != m_DeferredRenderCommands.end(); ++it)
-		{
-			RenderCommand command = *it;
-			if (m_Renderer->GetCamera()->GetFrustum().Intersect(command.BoxMin, command.BoxMax)) {
-				commands.push_back(command);
-			}
-		}
-		return commands;
+		return CullRenderCommands(m_DeferredRenderCommands);
 	}
 	else
 	{
-		return m_DeferredRenderCommands;
+		return GetRenderCommandList(m_DeferredRenderCommands.Commands);
 	}
 }
 
-std::vector<RenderCommand> CommandBuffer::GetCustomRenderCommands(RenderTarget* target, bool cull)
+RenderCommandList CommandBuffer::GetCustomRenderCommands(RenderTarget* target, bool cull)
 {
+	auto rtIt = m_CustomRenderCommands.find(target);
+	if (rtIt == m_CustomRenderCommands.end())
+	{
+		return RenderCommandList();
+	}
+
 	// only cull when on main/null render target
 	if (target == nullptr && cull)
 	{
-		std::vector<RenderCommand> commands;
-		for (auto it = m_CustomRenderCommands[target].begin(); it != m_CustomRenderCommands[target].end(); ++it)
-		{
-			RenderCommand command = *it;
-			if (m_Renderer->GetCamera()->GetFrustum().Intersect(command.BoxMin, command.BoxMax)) {
-				commands.push_back(command);
-			}
-		}
-		return commands;
+		return CullRenderCommands(rtIt->second);
 	}
 	else
 	{
-		return m_CustomRenderCommands[target];
+		return GetRenderCommandList(rtIt->second.Commands);
 	}
 }
 
-std::vector<RenderCommand> CommandBuffer::GetAlphaRenderCommands(bool cull)
+RenderCommandList CommandBuffer::GetAlphaRenderCommands(bool cull)
 {
 	if (cull)
 	{
-		std::vector<RenderCommand> commands;
-		for (auto it = m_AlphaRenderCommands.begin(); it != m_AlphaRenderCommands.end(); ++it)
+		return CullRenderCommands(m_AlphaRenderCommands);
+	}
+	else
+	{
+		return GetRenderCommandList(m_AlphaRenderCommands.Commands);
+	}
+}
+
+RenderCommandList CommandBuffer::GetPostProcessingRenderCommands()
+{
+	return GetRenderCommandList(m_PostProcessingRenderCommands.Commands);
+}
+
+RenderCommandList CommandBuffer::GetShadowCastRenderCommands()
+{
+	m_ShadowCastRenderCommands.clear();
+	for (unsigned int index : m_DeferredRenderCommands.Commands)
+	{
+		if (m_Materials[index]->ShadowCast)
 		{
-			RenderCommand command = *it;
-			if (m_Renderer->GetCamera()->GetFrustum().Intersect(command.BoxMin, command.BoxMax)) {
-				commands.push_back(command);
-			}
+			m_ShadowCastRenderCommands.push_back(index);
 		}
-		return commands;
 	}
-	else
+	auto rtIt = m_CustomRenderCommands.find(nullptr);
+	if (rtIt != m_CustomRenderCommands.end())
 	{
-		return m_AlphaRenderCommands;
+		for (unsigned int index : rtIt->second.Commands)
+		{
+			if (m_Materials[index]->ShadowCast)
+			{
+				m_ShadowCastRenderCommands.push_back(index);
+			}
+		}
 	}
+	return GetRenderCommandList(m_ShadowCastRenderCommands);
+}
+
+RenderCommandList CommandBuffer::GetRenderCommandList(const FrameVector<unsigned int>& commands) const
+{
+	RenderCommandList list;
+	list.Indices = commands.data();
+	list.Count = static_cast<unsigned int>(commands.size());
+	list.SortKeys = m_SortKeys.data();
+	list.TransformIndices = m_TransformIndices.data();
+	list.Transforms = m_Transforms.data();
+	list.PrevTransforms = m_PrevTransforms.data();
+	list.Meshes = m_Meshes.data();
+	list.Materials = m_Materials.data();
+	list.Bounds = GetBounds();
+	return list;
 }
 
-std::vector<RenderCommand> CommandBuffer::GetPostProcessingRenderCommands()
+FrustumCulling::BoundsView CommandBuffer::GetBounds() const
 {
-	return m_PostProcessingRenderCommands;
+	FrustumCulling::BoundsView bounds;
+	bounds.MinX = m_BoundsMinX.data();
+	bounds.MinY = m_BoundsMinY.data();
+	bounds.MinZ = m_BoundsMinZ.data();
+	bounds.MaxX = m_BoundsMaxX.data();
+	bounds.MaxY = m_BoundsMaxY.data();
+	bounds.MaxZ = m_BoundsMaxZ.data();
+	bounds.Count = static_cast<unsigned int>(m_SortKeys.size());
+	return bounds;
 }
 
-std::vector<RenderCommand> CommandBuffer::GetShadowCastRenderCommands()
+RenderCommandList CommandBuffer::CullRenderCommands(CommandQueue& queue)
 {
-	std::vector<RenderCommand> commands;
-	for (auto it = m_DeferredRenderCommands.begin(); it != m_DeferredRenderCommands.end(); ++it)
+	glm::vec4 planes[6];
+	FrustumCulling::GetPlanes(m_Renderer->GetCamera()->GetFrustum(), planes);
+
+	// all commands are culled in one pass over the bound columns; queues then only test bits.
+	const unsigned int commandCount = static_cast<unsigned int>(m_SortKeys.size());
+	const unsigned int occlusionRender = m_OcclusionCuller ? m_OcclusionCuller->GetRenderCount() : 0;
+	if (!m_CullValid || m_CullCommandCount != commandCount || !std::equal(planes, planes + 6, m_CullPlanes) || m_CullOcclusionRender != occlusionRender)
 	{
-		if (it->Material->ShadowCast)
+		m_CullMask.resize(FrustumCulling::GetMaskWordCount(commandCount));
+		FrustumCulling::CullBoxes(planes, GetBounds(), m_CullMask.data());
+		// only what survived the frustum is tested against the occluders.
+		if (m_OcclusionCuller)
 		{
-			commands.push_back(*it);
+			m_OcclusionCuller->CullBoxes(GetBounds(), m_CullMask.data());
 		}
+		std::copy(planes, planes + 6, m_CullPlanes);
+		m_CullCommandCount = commandCount;
+		m_CullOcclusionRender = occlusionRender;
+		m_CullValid = true;
 	}
-	for (auto it = m_CustomRenderCommands[nullptr].begin(); it != m_CustomRenderCommands[nullptr].end(); ++it)
+
+	queue.Visible.clear();
+	for (unsigned int index : queue.Commands)
 	{
-		if (it->Material->ShadowCast)
+		if ((m_CullMask[index / 32] >> (index % 32)) & 1u)
 		{
-			commands.push_back(*it);
+			queue.Visible.push_back(index);
 		}
 	}
-	return commands;
+
+	return GetRenderCommandList(queue.Visible);
+}
+
+RenderCommand RenderCommandList::operator[](unsigned int index) const
+{
+	const unsigned int command = Indices[index];
+	const unsigned int transform = TransformIndices[command];
+
+	RenderCommand result;
+	result.Transform = Transforms[transform];
+	result.PrevTransform = PrevTransforms[transform];
+	result.BoxMin = glm::vec3(Bounds.MinX[command], Bounds.MinY[command], Bounds.MinZ[command]);
+	result.BoxMax = glm::vec3(Bounds.MaxX[command], Bounds.MaxY[command], Bounds.MaxZ[command]);
+	result.Material = Materials[command];
+	result.Mesh = Meshes[command];
+	result.SortKey = SortKeys[command];
+	return result;
 }
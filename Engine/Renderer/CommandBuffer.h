@@ -1,6 +1,11 @@
 #pragma once
 #include "RenderCommand.h"
 
+#include "Camera/FrustumCulling.h"
+#include "Utils/CountingAllocator.h"
+
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -9,24 +14,146 @@ class Renderer;
 class Mesh;
 class Material;
 class RenderTarget;
+class OcclusionCuller;
+
+/*
+
+  Read only list of render commands, indexing into the command columns of the command buffer
+  that returned it. Passes read only the columns they need through the getters; operator[]
+  assembles a full RenderCommand. Lists stay valid until the command buffer is cleared, pushed
+  to or asked for the same list again; they're meant to be iterated right away by the pass that
+  requested them.
+
+*/
+struct RenderCommandList
+{
+	const unsigned int* Indices = nullptr;
+	unsigned int Count = 0;
+
+	// command columns, indexed by the entries of Indices.
+	const uint64_t* SortKeys = nullptr;
+	const unsigned int* TransformIndices = nullptr;
+	const glm::mat4* Transforms = nullptr;
+	const glm::mat4* PrevTransforms = nullptr;
+	Mesh* const* Meshes = nullptr;
+	Material* const* Materials = nullptr;
+	FrustumCulling::BoundsView Bounds = {};
+
+	unsigned int Size() const { return Count; }
+	bool Empty() const { return Count == 0; }
+
+	uint64_t GetSortKey(unsigned int index) const { return SortKeys[Indices[index]]; }
+	Mesh* GetMesh(unsigned int index) const { return Meshes[Indices[index]]; }
+	Material* GetMaterial(unsigned int index) const { return Materials[Indices[index]]; }
+	const glm::mat4& GetTransform(unsigned int index) const { return Transforms[TransformIndices[Indices[index]]]; }
+	const glm::mat4& GetPrevTransform(unsigned int index) const { return PrevTransforms[TransformIndices[Indices[index]]]; }
+
+	RenderCommand operator[](unsigned int index) const;
+};
 
 /*
 
   Render command buffer, managing all per-frame render/draw calls and converting them to a
   (more efficient) render-friendly format for the renderer to execute.
 
+  Commands are stored once, split into columns (sort keys, world bounds as SoA, transform
+  indices, mesh and material handles), with the transforms in their own arrays. Every queue
+  (deferred, alpha, post-processing and custom per render target) is a list of command indices,
+  and sorting, culling and retrieval only move indices around: the sort reads the key column,
+  culling runs the SIMD kernels straight over the bound columns and the transforms are only
+  touched when drawing. All storage is kept between frames, so once it has grown to the scene's
+  size a frame no longer allocates; GetAllocationCount() tracks this.
+
 */
 class CommandBuffer
 {
+private:
+	template <typename T>
+	using FrameVector = std::vector<T, Utils::CountingAllocator<T>>;
+
+	struct CommandQueue
+	{
+		CommandQueue(std::atomic<size_t>* allocationCounter);
+
+		FrameVector<unsigned int> Commands;
+		FrameVector<unsigned int> Visible;	// culling result, indices into the command storage
+	};
+
+	using CustomQueueMap = std::map<RenderTarget*, CommandQueue, std::less<RenderTarget*>,
+		Utils::CountingAllocator<std::pair<RenderTarget* const, CommandQueue>>>;
+
 public:
+	/*
+
+	  Recording bucket for a single thread. Workers each push the commands of their slice of the
+	  scene to their own bucket without touching any shared state; MergeBuckets() then appends
+	  all buckets to the command buffer in bucket order. The merged order only depends on which
+	  slice went to which bucket, never on thread timing, and Sort() is stable, so the final
+	  command order is deterministic.
+
+	*/
+	class Bucket
+	{
+	public:
+		Bucket(CommandBuffer* owner);
+
+		// same as CommandBuffer::Push(), safe to call concurrently on different buckets.
+		void Push(Mesh* mesh, Material* material, glm::mat4 transform = glm::mat4(), glm::mat4 prevTransform = glm::mat4(), glm::vec3 boxMin = glm::vec3(-99999.0f), glm::vec3 boxMax = glm::vec3(99999.0f), RenderTarget* target = nullptr);
+
+		unsigned int GetCommandCount() const { return static_cast<unsigned int>(m_Commands.size()); }
+
+	private:
+		friend class CommandBuffer;
+
+		CommandBuffer* m_Owner;
+		FrameVector<RenderCommand> m_Commands;
+		FrameVector<RenderTarget*> m_Targets;
+	};
 
 private:
 	Renderer* m_Renderer;
 
-	std::vector<RenderCommand> m_DeferredRenderCommands;
-	std::vector<RenderCommand> m_AlphaRenderCommands;
-	std::vector<RenderCommand> m_PostProcessingRenderCommands;
-	std::map<RenderTarget*, std::vector<RenderCommand>> m_CustomRenderCommands;
+	// counts every allocation of the containers below; declared first as they're constructed with it.
+	std::atomic<size_t> m_AllocationCount;
+
+	// command columns, element i of each belongs to command i.
+	FrameVector<uint64_t> m_SortKeys;
+	FrameVector<float> m_BoundsMinX;
+	FrameVector<float> m_BoundsMinY;
+	FrameVector<float> m_BoundsMinZ;
+	FrameVector<float> m_BoundsMaxX;
+	FrameVector<float> m_BoundsMaxY;
+	FrameVector<float> m_BoundsMaxZ;
+	FrameVector<unsigned int> m_TransformIndices;
+	FrameVector<Mesh*> m_Meshes;
+	FrameVector<Material*> m_Materials;
+
+	FrameVector<glm::mat4> m_Transforms;
+	FrameVector<glm::mat4> m_PrevTransforms;
+
+	CommandQueue m_DeferredRenderCommands;
+	CommandQueue m_AlphaRenderCommands;
+	CommandQueue m_PostProcessingRenderCommands;
+	// entries are kept when clearing so render targets reuse their queue's storage next frame.
+	CustomQueueMap m_CustomRenderCommands;
+	FrameVector<unsigned int> m_ShadowCastRenderCommands;
+
+	// visibility bit per command against m_CullPlanes and, if set, the occlusion culler; culled
+	// once for all queues and redone only when the frustum or the occluders change or commands
+	// are pushed.
+	FrameVector<uint32_t> m_CullMask;
+	glm::vec4 m_CullPlanes[6];
+	unsigned int m_CullCommandCount;
+	bool m_CullValid;
+	OcclusionCuller* m_OcclusionCuller;
+	unsigned int m_CullOcclusionRender;
+
+	// scratch buffers for the radix sort of (key, command index) pairs.
+	FrameVector<uint64_t> m_SortKeysScratch;
+	FrameVector<uint64_t> m_SortKeysTemp;
+	FrameVector<unsigned int> m_SortIndicesTemp;
+
+	FrameVector<Bucket> m_Buckets;
 
 
 public:
@@ -36,30 +163,62 @@ public:
 	// pushes render state relevant to a single render call to the command buffer.
 	void Push(Mesh* mesh, Material* material, glm::mat4 transform = glm::mat4(), glm::mat4 prevTransform = glm::mat4(), glm::vec3 boxMin = glm::vec3(-99999.0f), glm::vec3 boxMax = glm::vec3(99999.0f), RenderTarget* target = nullptr);
 
+	// makes sure there are at least count recording buckets. Not thread safe: call it before
+	// handing buckets out to workers.
+	void ReserveBuckets(unsigned int count);
+	Bucket& GetBucket(unsigned int index) { return m_Buckets[index]; }
+	// appends the commands recorded in all buckets in bucket order and empties the buckets.
+	void MergeBuckets();
+
 	// clears the command buffer; usually done after issuing all the stored render commands.
+	// storage is kept for the next frame.
 	void Clear();
-	// sorts the command buffer; first by shader, then by texture bind.
+	// sorts the command buffer by sort key: opaque queues by shader, material, mesh and then
+	// front-to-back, alpha commands back-to-front first. Post-processing keeps its push order.
 	// TODO: build an approach using texture arrays (every push would add relevant material textures
 	// to texture array (if it wans't there already), and then add a texture index to each material
 	// slot; profile if the added texture adjustments actually saves performance!
 	void Sort();
 
+	// commands frustum culling keeps are also tested against culler's depth buffer, which has to
+	// be rendered with the camera's view projection; null disables occlusion culling.
+	void SetOcclusionCuller(OcclusionCuller* culler);
+
 	// returns the list of render commands. For minimizing state changes it is advised to first 
 	// call Sort() before retrieving and issuing the render commands.
-	std::vector<RenderCommand> GetDeferredRenderCommands(bool cull = false);
+	RenderCommandList GetDeferredRenderCommands(bool cull = false);
 
 	// returns the list of render commands of both deferred and forward pushes that require 
 	// alpha blending; which have to be rendered last. 
-	std::vector<RenderCommand> GetAlphaRenderCommands(bool cull = false);
+	RenderCommandList GetAlphaRenderCommands(bool cull = false);
 
-	// returns the list of custom render commands per render target.
-	std::vector<RenderCommand> GetCustomRenderCommands(RenderTarget* target, bool cull = false);
+	// returns the list of custom render commands per render target; empty for targets nothing
+	// was pushed to.
+	RenderCommandList GetCustomRenderCommands(RenderTarget* target, bool cull = false);
 
 	// returns the list of post-processing render commands.
-	std::vector<RenderCommand> GetPostProcessingRenderCommands();
+	RenderCommandList GetPostProcessingRenderCommands();
 
 	// returns the list of all render commands with mesh shadow casting
-	std::vector<RenderCommand> GetShadowCastRenderCommands();
-};
+	RenderCommandList GetShadowCastRenderCommands();
 
+	// number of heap allocations the command buffer made since its creation; stays the same
+	// over a frame once the buffer has grown to the scene.
+	size_t GetAllocationCount() const { return m_AllocationCount.load(std::memory_order_relaxed); }
 
+private:
+	// queue the material's commands are pushed to; alpha blended materials always go to the alpha queue.
+	static RenderQueue GetRenderQueue(const Material* material);
+	// appends a command to the columns and its queue.
+	void Append(RenderQueue queue, uint64_t sortKey, Mesh* mesh, Material* material, const glm::mat4& transform, const glm::mat4& prevTransform, const glm::vec3& boxMin, const glm::vec3& boxMax, RenderTarget* target);
+
+	// packs queue, blend state, shader, material, mesh and quantized view depth in a single key.
+	uint64_t BuildSortKey(RenderQueue queue, Mesh* mesh, Material* material, const glm::mat4& transform) const;
+	// stable radix sort of the queue's command indices on their sort keys.
+	void SortRenderCommands(FrameVector<unsigned int>& commands);
+
+	RenderCommandList GetRenderCommandList(const FrameVector<unsigned int>& commands) const;
+	FrustumCulling::BoundsView GetBounds() const;
+	// returns the queue's commands whose bounds intersect the camera frustum, in queue order.
+	RenderCommandList CullRenderCommands(CommandQueue& queue);
+};
@@ -1,5 +1,7 @@
 
 #include "DebugDraw.h"
+#include "FrameRingBuffer.h"
+#include "RenderDevice.h"
 
 #include "Utils/Logger.h"
 
@@ -11,29 +13,13 @@
 namespace DebugDraw
 {
 	GLuint m_linesVAO;
-	GLuint m_linesVBO;
 	GLuint m_linesShader;
+	// the vertices of each frame's lines are written straight into a range of the ring.
+	FrameRingBuffer m_linesRing;
 
 	GLint m_viewProjecLoc = -1;
 
 	std::vector<Line> m_lines;
-	std::vector<float> m_scratchPadLineData;
-
-	void _print_shader_info_log(unsigned int shader_index) {
-		int max_length = 2048;
-		int actual_length = 0;
-		char log[2048];
-		glGetShaderInfoLog(shader_index, max_length, &actual_length, log);
-		printf("shader info log for GL index %u\n%s\n", shader_index, log);
-	}
-
-	void _print_programme_info_log(unsigned int m_programme_idx) {
-		int max_length = 2048;
-		int actual_length = 0;
-		char log[2048];
-		glGetProgramInfoLog(m_programme_idx, max_length, &actual_length, log);
-		printf("program info log for GL index %u\n%s\n", (int)m_programme_idx, log);
-	}
 
 	const char* vertexShader =
 		R"foo(
@@ -62,51 +48,26 @@ namespace DebugDraw
 	//
 	// reserve memory for drawing stuff
 	bool Init() {
-		// vao for drawing properties of lines
-		glGenVertexArrays(1, &m_linesVAO);
-		glBindVertexArray(m_linesVAO);
+		RenderDevice& device = RenderDevice::Get();
+
+		// vao for drawing properties of lines; the attributes point at the frame's range of the
+		// ring and are set when drawing.
+		m_linesVAO = device.CreateVertexArray();
 
 		// create GPU-side buffer
-		// size is 32-bits for GLfloat * num lines * 7 comps per vert * 2 per lines
-		glGenBuffers(1, &m_linesVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_linesVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * MAX_APG_GL_DB_LINES * 14, NULL,
-			GL_DYNAMIC_DRAW);
+		// size is 32-bits for GLfloat * num lines * 7 comps per vert * 2 per lines, for four frames
+		// so a full frame always fits next to the three in flight.
+		m_linesRing.Init(sizeof(float) * MAX_APG_GL_DB_LINES * 14 * 4);
 
-		GLsizei stride = sizeof(float) * 7;
-		GLintptr offs = sizeof(float) * 3;
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, NULL); // point
-		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offs); // colour
-		glEnableVertexAttribArray(0); // point
-		glEnableVertexAttribArray(1); // colour
-
-		GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-		GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(vs, 1, (const char**)&vertexShader, NULL);
-		glCompileShader(vs);
-		_print_shader_info_log(vs);
-		glShaderSource(fs, 1, (const char**)&fragmentShader, NULL);
-		glCompileShader(fs);
-		_print_shader_info_log(fs);
-		m_linesShader = glCreateProgram();
-		glAttachShader(m_linesShader, fs);
-		glAttachShader(m_linesShader, vs);
-		glBindAttribLocation(m_linesShader, 0, "pos");
-		glBindAttribLocation(m_linesShader, 1, "color");
-		glLinkProgram(m_linesShader);
-		_print_programme_info_log(m_linesShader);
-		m_viewProjecLoc = glGetUniformLocation(m_linesShader, "viewProj");
+		// the attribute locations are set in the shader; compile and link errors are logged by the device.
+		m_linesShader = device.CreateProgram("debug lines", { vertexShader }, { fragmentShader });
+		m_viewProjecLoc = device.GetUniformLocation(m_linesShader, "viewProj");
 		assert(m_viewProjecLoc >= -1);
-		// flag that shaders can be deleted whenever the program is deleted
-		glDeleteShader(fs);
-		glDeleteShader(vs);
 		float PV[16];
 		memset(PV, 0, 16 * sizeof(float));
 		PV[0] = PV[5] = PV[10] = PV[15] = 1.0f;
-		glUseProgram(m_linesShader);
-		glUniformMatrix4fv(m_viewProjecLoc, 1, GL_FALSE, PV);
-
-		m_scratchPadLineData.reserve(MAX_APG_GL_DB_LINES * 14); // 14 floats per line.
+		device.UseProgram(m_linesShader);
+		device.SetUniform(m_viewProjecLoc, SHADER_TYPE_MAT4, 1, PV);
 
 		return true;
 	}
@@ -119,10 +80,10 @@ namespace DebugDraw
 	//
 	// free memory
 	void Clean() {
-		glDeleteBuffers(1, &m_linesVBO);
-		glDeleteVertexArrays(1, &m_linesVAO);
+		m_linesRing.Release();
+		RenderDevice::Get().DeleteVertexArray(m_linesVAO);
 		// attached shaders have prev been flagged to delete so will also be deleted
-		glDeleteProgram(m_linesShader);
+		RenderDevice::Get().DeleteProgram(m_linesShader);
 	}
 
 	//
@@ -344,68 +305,81 @@ namespace DebugDraw
 	// world coord space
 	// matrix is a 16 float column-major matrix as 1d array in column order
 	void Update(const glm::mat4& viewProj) {
-		glUseProgram(m_linesShader);
-		glUniformMatrix4fv(m_viewProjecLoc, 1, GL_FALSE, &viewProj[0][0]);
+		RenderDevice::Get().UseProgram(m_linesShader);
+		RenderDevice::Get().SetUniform(m_viewProjecLoc, SHADER_TYPE_MAT4, 1, &viewProj[0][0]);
 	}
 
 	void Draw(bool x_ray) 
 	{
-		m_scratchPadLineData.clear();
-
 		const unsigned int lineCount = m_lines.size();
-		for (int i = 0; i < lineCount; ++i)
+		if (lineCount == 0)
+		{
+			return;
+		}
+
+		m_linesRing.BeginFrame();
+		const FrameRingBuffer::Allocation vertices = m_linesRing.Allocate(sizeof(float) * lineCount * 14);
+		if (!vertices.IsValid())
+		{
+			m_linesRing.EndFrame();
+			return;
+		}
+
+		float* data = reinterpret_cast<float*>(vertices.Data);
+		for (unsigned int i = 0; i < lineCount; ++i, data += 14)
 		{
 			auto& l = m_lines[i];
-			m_scratchPadLineData.push_back(l.start.x);
-			m_scratchPadLineData.push_back(l.start.y);
-			m_scratchPadLineData.push_back(l.start.z);
-			m_scratchPadLineData.push_back(l.col.x);
-			m_scratchPadLineData.push_back(l.col.y);
-			m_scratchPadLineData.push_back(l.col.z);
-			m_scratchPadLineData.push_back(l.col.a);
-			m_scratchPadLineData.push_back(l.end.x);
-			m_scratchPadLineData.push_back(l.end.y);
-			m_scratchPadLineData.push_back(l.end.z);
-			m_scratchPadLineData.push_back(l.col.x);
-			m_scratchPadLineData.push_back(l.col.y);
-			m_scratchPadLineData.push_back(l.col.z);
-			m_scratchPadLineData.push_back(l.col.a);
+			data[0] = l.start.x;
+			data[1] = l.start.y;
+			data[2] = l.start.z;
+			data[3] = l.col.x;
+			data[4] = l.col.y;
+			data[5] = l.col.z;
+			data[6] = l.col.a;
+			data[7] = l.end.x;
+			data[8] = l.end.y;
+			data[9] = l.end.z;
+			data[10] = l.col.x;
+			data[11] = l.col.y;
+			data[12] = l.col.z;
+			data[13] = l.col.a;
 		}
+		m_linesRing.Commit(vertices);
 
-		GLintptr offset = sizeof(float) * m_scratchPadLineData.size() * 0;
-		GLsizei size = sizeof(float) * m_scratchPadLineData.size();
-		glBindBuffer(GL_ARRAY_BUFFER, m_linesVBO);
-		glBufferSubData(GL_ARRAY_BUFFER, offset, size, &m_scratchPadLineData[0]);
+		RenderDevice& device = RenderDevice::Get();
+		GLsizei stride = sizeof(float) * 7;
+		device.BindVertexArray(m_linesVAO);
+		device.BindBuffer(GL_ARRAY_BUFFER, vertices.Buffer);
+		device.EnableVertexAttribute(0, 3, GL_FLOAT, false, stride, vertices.Offset); // point
+		device.EnableVertexAttribute(1, 4, GL_FLOAT, false, stride, vertices.Offset + sizeof(float) * 3); // colour
 
-		GLboolean dwe = false;
-		glGetBooleanv(GL_DEPTH_TEST, &dwe);
+		bool dwe = device.IsEnabled(GL_DEPTH_TEST);
 		if (dwe && x_ray) {
-			glDisable(GL_DEPTH_TEST);
+			device.Toggle(GL_DEPTH_TEST, false);
 		}
 		else if (!dwe && !x_ray) {
-			glEnable(GL_DEPTH_TEST);
+			device.Toggle(GL_DEPTH_TEST, true);
 		}
 
-		GLboolean blendBool = false;
-		glGetBooleanv(GL_BLEND, &blendBool);
+		bool blendBool = device.IsEnabled(GL_BLEND);
 		
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		device.Toggle(GL_BLEND, true);
+		device.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		glUseProgram(m_linesShader);
-		glBindVertexArray(m_linesVAO);
-		glDrawArrays(GL_LINES, 0, lineCount * 2);
+		device.UseProgram(m_linesShader);
+		device.DrawArrays(GL_LINES, 0, lineCount * 2);
+		m_linesRing.EndFrame();
 
 		if( !blendBool )
 		{
-			glDisable(GL_BLEND);
+			device.Toggle(GL_BLEND, false);
 		}
 
 		if (dwe && x_ray) {
-			glEnable(GL_DEPTH_TEST);
+			device.Toggle(GL_DEPTH_TEST, true);
 		}
 		else if (!dwe && !x_ray) {
-			glDisable(GL_DEPTH_TEST);
+			device.Toggle(GL_DEPTH_TEST, false);
 		}
 	}
 }
@@ -0,0 +1,179 @@
+#include "FrameRingBuffer.h"
+#include "RenderDevice.h"
+
+#include "Utils/Logger.h"
+
+#include <cstring>
+
+// buffer operations bind to the copy target, leaving the array and uniform bindings alone.
+static const GLenum s_Target = GL_COPY_WRITE_BUFFER;
+static const GLbitfield s_PersistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+// how long a single fence wait blocks before checking again, in nanoseconds.
+static const uint64_t s_FenceTimeout = 1000000;
+
+FrameRingBuffer::~FrameRingBuffer()
+{
+	Release();
+}
+
+void FrameRingBuffer::Init(size_t capacity, unsigned int frameCount)
+{
+	Release();
+
+	RenderDevice& device = RenderDevice::Get();
+	capacity = (capacity + 4095) / 4096 * 4096;
+
+	m_Buffer = device.CreateBuffer();
+	device.BindBuffer(s_Target, m_Buffer);
+	if (device.SupportsBufferStorage())
+	{
+		device.BufferStorage(s_Target, capacity, nullptr, s_PersistentFlags);
+		m_Mapped = static_cast<uint8_t*>(device.MapBufferRange(s_Target, 0, capacity, s_PersistentFlags));
+		if (!m_Mapped)
+		{
+			// storage is immutable, orphaning needs a new buffer.
+			LOG_WARNING("Persistent mapping of a %u byte ring buffer failed, orphaning instead.", static_cast<unsigned int>(capacity));
+			device.DeleteBuffer(m_Buffer);
+			m_Buffer = device.CreateBuffer();
+			device.BindBuffer(s_Target, m_Buffer);
+		}
+	}
+
+	if (m_Mapped)
+	{
+		m_Allocator.Init(capacity, frameCount);
+		m_Fences.assign(m_Allocator.GetSlotCount(), nullptr);
+	}
+	else
+	{
+		// orphaned storage is never read again, every frame has the whole buffer.
+		device.BufferData(s_Target, capacity, nullptr, GL_STREAM_DRAW);
+		m_Staging.resize(capacity);
+		m_Allocator.Init(capacity, 1);
+	}
+}
+
+void FrameRingBuffer::BeginFrame()
+{
+	if (m_Buffer == 0)
+	{
+		return;
+	}
+
+	RenderDevice& device = RenderDevice::Get();
+	if (m_Mapped)
+	{
+		GLsync& fence = m_Fences[m_Allocator.GetNextSlot()];
+		if (fence)
+		{
+			RenderDevice::FenceStatus status = device.WaitFence(fence, 0);
+			if (status == RenderDevice::FenceStatus::TimedOut)
+			{
+				++m_StallCount;
+				do
+				{
+					status = device.WaitFence(fence, s_FenceTimeout);
+				} while (status == RenderDevice::FenceStatus::TimedOut);
+			}
+			// a failed wait won't ever signal; waiting on would hang the frame for good.
+			if (status == RenderDevice::FenceStatus::Failed)
+			{
+				LOG_ERROR("Waiting on the fence of ring buffer slot %u failed.", m_Allocator.GetNextSlot());
+			}
+			device.DeleteFence(fence);
+			fence = nullptr;
+		}
+	}
+	else
+	{
+		device.BindBuffer(s_Target, m_Buffer);
+		device.BufferData(s_Target, m_Allocator.GetCapacity(), nullptr, GL_STREAM_DRAW);
+	}
+
+	m_Allocator.BeginFrame();
+	m_FrameAllocationCount = 0;
+}
+
+void FrameRingBuffer::EndFrame()
+{
+	if (m_Buffer == 0)
+	{
+		return;
+	}
+
+	m_Allocator.EndFrame();
+	if (m_Mapped)
+	{
+		m_Fences[m_Allocator.GetSlot()] = RenderDevice::Get().CreateFence();
+	}
+}
+
+FrameRingBuffer::Allocation FrameRingBuffer::Allocate(size_t size, size_t alignment)
+{
+	Allocation allocation;
+	const size_t offset = m_Buffer != 0 ? m_Allocator.Allocate(size, alignment) : RingAllocator::InvalidOffset;
+	if (offset == RingAllocator::InvalidOffset)
+	{
+		++m_FailedCount;
+		return allocation;
+	}
+
+	allocation.Data = (m_Mapped ? m_Mapped : m_Staging.data()) + offset;
+	allocation.Buffer = m_Buffer;
+	allocation.Offset = offset;
+	allocation.Size = size;
+	++m_FrameAllocationCount;
+	return allocation;
+}
+
+void FrameRingBuffer::Commit(const Allocation& allocation)
+{
+	// coherent mappings are seen by every command issued after the write.
+	if (m_Mapped || !allocation.IsValid())
+	{
+		return;
+	}
+
+	RenderDevice& device = RenderDevice::Get();
+	device.BindBuffer(s_Target, m_Buffer);
+	device.BufferSubData(s_Target, allocation.Offset, allocation.Size, allocation.Data);
+}
+
+FrameRingBuffer::Allocation FrameRingBuffer::Upload(const void* data, size_t size, size_t alignment)
+{
+	Allocation allocation = Allocate(size, alignment);
+	if (allocation.IsValid())
+	{
+		std::memcpy(allocation.Data, data, size);
+		Commit(allocation);
+	}
+	return allocation;
+}
+
+void FrameRingBuffer::Release()
+{
+	if (m_Buffer == 0)
+	{
+		return;
+	}
+
+	RenderDevice& device = RenderDevice::Get();
+	for (GLsync fence : m_Fences)
+	{
+		if (fence)
+		{
+			device.DeleteFence(fence);
+		}
+	}
+	m_Fences.clear();
+
+	if (m_Mapped)
+	{
+		device.BindBuffer(s_Target, m_Buffer);
+		device.UnmapBuffer(s_Target);
+		m_Mapped = nullptr;
+	}
+	device.DeleteBuffer(m_Buffer);
+	m_Buffer = 0;
+	m_Staging.clear();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RingAllocator.h"
+
+/*
+
+  Buffer for data written once per frame (uniform blocks, per-draw constants, dynamic vertices),
+  handed out as aligned suballocations that stay valid until the frame ends.
+
+  Where buffer storage is available the buffer is persistently mapped with
+  GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT and allocations are written in place; a fence per
+  frame slot guards the ranges the GPU may still read, BeginFrame() waits for it before the slot
+  is reused (with the default three slots that only happens when the GPU is three frames
+  behind). Without buffer storage the buffer is orphaned every frame instead, allocations are
+  written to a host copy and uploaded by Commit().
+
+  The offsets, wrapping and slots are kept by a RingAllocator; this class adds the GL buffer,
+  mapping and fences, all through the RenderDevice.
+
+*/
+class FrameRingBuffer
+{
+public:
+	struct Allocation
+	{
+		uint8_t*     Data = nullptr;	// where the allocation's bytes are written; null if it failed
+		unsigned int Buffer = 0;
+		size_t       Offset = 0;
+		size_t       Size = 0;
+
+		bool IsValid() const { return Data != nullptr; }
+	};
+
+public:
+	FrameRingBuffer() = default;
+	~FrameRingBuffer();
+
+	FrameRingBuffer(const FrameRingBuffer&) = delete;
+	FrameRingBuffer& operator=(const FrameRingBuffer&) = delete;
+
+	// capacity is shared by all frames in flight; it's rounded up to a multiple of 4096 so every
+	// power of two alignment up to that divides it.
+	void Init(size_t capacity, unsigned int frameCount = 3);
+
+	// frees the buffer and fences; Init() may be called again.
+	void Release();
+
+	void BeginFrame();
+	void EndFrame();
+
+	// size bytes aligned to alignment in the current frame, or an invalid allocation when the
+	// frames in flight leave no room. Write the data, then Commit() before GL reads it.
+	Allocation Allocate(size_t size, size_t alignment = 16);
+	// makes what was written to allocation visible to GL; free for persistent mappings.
+	void Commit(const Allocation& allocation);
+	// allocates, copies data and commits.
+	Allocation Upload(const void* data, size_t size, size_t alignment = 16);
+
+	unsigned int GetBuffer() const { return m_Buffer; }
+	bool IsPersistent() const { return m_Mapped != nullptr; }
+	const RingAllocator& GetAllocator() const { return m_Allocator; }
+
+	// allocations and allocated bytes (with padding) of the current frame.
+	unsigned int GetFrameAllocationCount() const { return m_FrameAllocationCount; }
+	size_t GetFrameBytes() const { return m_Allocator.GetFrameUsed(); }
+	// frames that had to wait for the GPU, and allocations that failed, since Init().
+	unsigned int GetStallCount() const { return m_StallCount; }
+	unsigned int GetFailedCount() const { return m_FailedCount; }
+
+private:
+	RingAllocator m_Allocator;
+	unsigned int m_Buffer = 0;
+
+	// persistent mapping of the whole buffer, or null when orphaning.
+	uint8_t* m_Mapped = nullptr;
+	std::vector<GLsync> m_Fences;
+	// host copy of the buffer when orphaning.
+	std::vector<uint8_t> m_Staging;
+
+	unsigned int m_FrameAllocationCount = 0;
+	unsigned int m_StallCount = 0;
+	unsigned int m_FailedCount = 0;
+};
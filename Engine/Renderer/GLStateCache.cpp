@@ -1,76 +1,224 @@
 #include "GLStateCache.h"
+#include "RenderDevice.h"
 
+#include <algorithm>
+
+static const unsigned int s_Unknown = ~0u;
+
+GLStateCache::GLStateCache()
+	: m_backend(&RenderDevice::Get())
+{
+	Reset();
+}
+
+void GLStateCache::SetBackend(GLStateBackend* backend)
+{
+	m_backend = backend ? backend : &RenderDevice::Get();
+	Reset();
+}
+
+void GLStateCache::Reset()
+{
+	m_depthTest = -1;
+	m_depthWrite = -1;
+	m_blend = -1;
+	m_cullFace = -1;
+
+	m_depthFunc = s_Unknown;
+	m_blendSrc = s_Unknown;
+	m_blendDst = s_Unknown;
+	m_frontFace = s_Unknown;
+	m_polygonMode = s_Unknown;
+	std::fill(m_viewport, m_viewport + 4, -1);
+
+	m_activeShaderID = s_Unknown;
+	m_activeTextureUnit = s_Unknown;
+	std::fill(m_textureTargets, m_textureTargets + MaxTextureUnits, s_Unknown);
+	std::fill(m_textures, m_textures + MaxTextureUnits, s_Unknown);
+	std::fill(m_samplers, m_samplers + MaxTextureUnits, s_Unknown);
+	m_vertexArray = s_Unknown;
+	m_drawFramebuffer = s_Unknown;
+	m_readFramebuffer = s_Unknown;
+	std::fill(m_uniformBuffers, m_uniformBuffers + MaxUniformBuffers, s_Unknown);
+	std::fill(m_uniformBufferOffsets, m_uniformBufferOffsets + MaxUniformBuffers, 0);
+	std::fill(m_uniformBufferSizes, m_uniformBufferSizes + MaxUniformBuffers, -1);
+}
 
 void GLStateCache::SetDepthTest(bool enable)
 {
-	if (m_depthTest != enable)
+	if (Filter(Call::DepthTest, m_depthTest != enable))
 	{
 		m_depthTest = enable;
-		ToggleState(GL_DEPTH_TEST, enable);
+		m_backend->Toggle(GL_DEPTH_TEST, enable);
 	}
-
 }
 
 void GLStateCache::SetDepthFunc(GLenum depthFunc)
 {
-	if (m_depthFunc != depthFunc)
+	if (Filter(Call::DepthFunc, m_depthFunc != depthFunc))
 	{
 		m_depthFunc = depthFunc;
-		glDepthFunc(depthFunc);
+		m_backend->DepthFunc(depthFunc);
+	}
+}
+
+void GLStateCache::SetDepthWrite(bool enable)
+{
+	if (Filter(Call::DepthWrite, m_depthWrite != enable))
+	{
+		m_depthWrite = enable;
+		m_backend->DepthMask(enable);
 	}
 }
 
 void GLStateCache::SetBlend(bool enable)
 {
-	if (m_blend != enable)
+	if (Filter(Call::Blend, m_blend != enable))
 	{
 		m_blend = enable;
-		ToggleState(GL_BLEND, enable);
+		m_backend->Toggle(GL_BLEND, enable);
 	}
 }
 
 void GLStateCache::SetBlendFunc(GLenum src, GLenum dst)
 {
-	if (m_blendSrc != src || m_blendDst != dst)
+	if (Filter(Call::BlendFunc, m_blendSrc != src || m_blendDst != dst))
 	{
 		m_blendSrc = src;
 		m_blendDst = dst;
-		glBlendFunc(src, dst);
+		m_backend->BlendFunc(src, dst);
 	}
 }
 
 void GLStateCache::SetCull(bool enable)
 {
-	if (m_cullFace != enable)
+	if (Filter(Call::Cull, m_cullFace != enable))
 	{
 		m_cullFace = enable;
-		ToggleState(GL_CULL_FACE, enable);
+		m_backend->Toggle(GL_CULL_FACE, enable);
 	}
 }
 
 void GLStateCache::SetCullFace(GLenum face)
 {
-	if (m_frontFace != face)
+	if (Filter(Call::CullFace, m_frontFace != face))
 	{
 		m_frontFace = face;
-		glCullFace(face);
+		m_backend->CullFace(face);
 	}
 }
 
 void GLStateCache::SetPolygonMode(GLenum mode)
 {
-	if (m_polygonMode != mode)
+	if (Filter(Call::PolygonMode, m_polygonMode != mode))
 	{
 		m_polygonMode = mode;
-		glPolygonMode(GL_FRONT_AND_BACK, mode);
+		m_backend->PolygonMode(mode);
+	}
+}
+
+void GLStateCache::SetViewport(int x, int y, int width, int height)
+{
+	if (Filter(Call::Viewport, m_viewport[0] != x || m_viewport[1] != y || m_viewport[2] != width || m_viewport[3] != height))
+	{
+		m_viewport[0] = x;
+		m_viewport[1] = y;
+		m_viewport[2] = width;
+		m_viewport[3] = height;
+		m_backend->Viewport(x, y, width, height);
 	}
 }
 
 void GLStateCache::SwitchShader(unsigned int ID)
 {
-	if (m_activeShaderID != ID)
+	if (Filter(Call::Program, m_activeShaderID != ID))
 	{
-		glUseProgram(ID);
+		m_activeShaderID = ID;
+		m_backend->UseProgram(ID);
+	}
+}
+
+void GLStateCache::BindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+	// units past the tracked ones are always bound.
+	const bool tracked = unit < MaxTextureUnits;
+	if (Filter(Call::Texture, !tracked || m_textures[unit] != texture || m_textureTargets[unit] != target))
+	{
+		if (m_activeTextureUnit != unit || !m_enabled)
+		{
+			m_activeTextureUnit = unit;
+			m_backend->ActiveTexture(unit);
+		}
+		if (tracked)
+		{
+			m_textureTargets[unit] = target;
+			m_textures[unit] = texture;
+		}
+		m_backend->BindTexture(target, texture);
+	}
+}
+
+void GLStateCache::BindSampler(unsigned int unit, unsigned int sampler)
+{
+	const bool tracked = unit < MaxTextureUnits;
+	if (Filter(Call::Sampler, !tracked || m_samplers[unit] != sampler))
+	{
+		if (tracked)
+			m_samplers[unit] = sampler;
+		m_backend->BindSampler(unit, sampler);
+	}
+}
+
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+	if (Filter(Call::VertexArray, m_vertexArray != vertexArray))
+	{
+		m_vertexArray = vertexArray;
+		m_backend->BindVertexArray(vertexArray);
+	}
+}
+
+void GLStateCache::BindFramebuffer(GLenum target, unsigned int framebuffer)
+{
+	const bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+	const bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+	if (Filter(Call::Framebuffer, (draw && m_drawFramebuffer != framebuffer) || (read && m_readFramebuffer != framebuffer)))
+	{
+		if (draw)
+			m_drawFramebuffer = framebuffer;
+		if (read)
+			m_readFramebuffer = framebuffer;
+		m_backend->BindFramebuffer(target, framebuffer);
+	}
+}
+
+void GLStateCache::BindUniformBuffer(unsigned int index, unsigned int buffer)
+{
+	const bool tracked = index < MaxUniformBuffers;
+	if (Filter(Call::UniformBuffer, !tracked || m_uniformBuffers[index] != buffer || m_uniformBufferSizes[index] != -1))
+	{
+		if (tracked)
+		{
+			m_uniformBuffers[index] = buffer;
+			m_uniformBufferOffsets[index] = 0;
+			m_uniformBufferSizes[index] = -1;
+		}
+		m_backend->BindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+	}
+}
+
+void GLStateCache::BindUniformBufferRange(unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size)
+{
+	const bool tracked = index < MaxUniformBuffers;
+	if (Filter(Call::UniformBuffer, !tracked || m_uniformBuffers[index] != buffer || m_uniformBufferOffsets[index] != offset || m_uniformBufferSizes[index] != size))
+	{
+		if (tracked)
+		{
+			m_uniformBuffers[index] = buffer;
+			m_uniformBufferOffsets[index] = offset;
+			m_uniformBufferSizes[index] = size;
+		}
+		m_backend->BindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
 	}
 }
 
@@ -88,15 +236,55 @@ void GLStateCache::PopState()
 	ToggleState(state, false);
 }
 
-void GLStateCache::ToggleState(GLenum state, bool enable)
+const char* GLStateCache::GetCallName(Call call)
 {
-	if (enable)
+	switch (call)
 	{
-		glEnable(state);
+	case Call::DepthTest: return "Depth test";
+	case Call::DepthFunc: return "Depth func";
+	case Call::DepthWrite: return "Depth write";
+	case Call::Blend: return "Blend";
+	case Call::BlendFunc: return "Blend func";
+	case Call::Cull: return "Cull";
+	case Call::CullFace: return "Cull face";
+	case Call::PolygonMode: return "Polygon mode";
+	case Call::Program: return "Program";
+	case Call::Texture: return "Texture";
+	case Call::Sampler: return "Sampler";
+	case Call::VertexArray: return "Vertex array";
+	case Call::Framebuffer: return "Framebuffer";
+	case Call::UniformBuffer: return "Uniform buffer";
+	case Call::Viewport: return "Viewport";
+	default: return "Unknown";
 	}
-	else
+}
+
+void GLStateCache::ResetStats()
+{
+	std::fill(m_callCounts, m_callCounts + static_cast<int>(Call::Count), CallCount());
+}
+
+bool GLStateCache::Filter(Call call, bool changed)
+{
+	CallCount& count = m_callCounts[static_cast<int>(call)];
+	if (changed || !m_enabled)
 	{
-		glDisable(state);
+		++count.Issued;
+		return true;
 	}
+	++count.Skipped;
+	return false;
 }
 
+void GLStateCache::ToggleState(GLenum state, bool enable)
+{
+	// keep the tracked toggles in sync with pushed and popped states.
+	if (state == GL_DEPTH_TEST)
+		m_depthTest = enable;
+	else if (state == GL_BLEND)
+		m_blend = enable;
+	else if (state == GL_CULL_FACE)
+		m_cullFace = enable;
+
+	m_backend->Toggle(state, enable);
+}
@@ -3,40 +3,152 @@
 #include <GL/glew.h>
 #include <stack>
 
+/*
+
+  The GL calls the state cache forwards to once it decided a call changes state. The default
+  backend is the current RenderDevice; a different backend, e.g. one recording the calls, lets
+  the cache run on its own.
+
+*/
+class GLStateBackend
+{
+public:
+	virtual ~GLStateBackend() = default;
+
+	virtual void Toggle(GLenum state, bool enable) = 0;
+	virtual void DepthFunc(GLenum func) = 0;
+	virtual void DepthMask(bool write) = 0;
+	virtual void BlendFunc(GLenum src, GLenum dst) = 0;
+	virtual void CullFace(GLenum face) = 0;
+	virtual void PolygonMode(GLenum mode) = 0;
+	virtual void UseProgram(unsigned int program) = 0;
+	virtual void ActiveTexture(unsigned int unit) = 0;
+	virtual void BindTexture(GLenum target, unsigned int texture) = 0;
+	virtual void BindSampler(unsigned int unit, unsigned int sampler) = 0;
+	virtual void BindVertexArray(unsigned int vertexArray) = 0;
+	virtual void BindFramebuffer(GLenum target, unsigned int framebuffer) = 0;
+	virtual void BindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size) = 0;
+	virtual void BindBufferBase(GLenum target, unsigned int index, unsigned int buffer) = 0;
+	virtual void Viewport(int x, int y, int width, int height) = 0;
+};
+
+/*
+
+  Shadows the GL state a renderer changes per draw and only forwards a call when it changes
+  something. Every state starts out unknown, so the first call after Reset() always goes
+  through; call Reset() whenever GL state may have been changed behind the cache's back (e.g.
+  at the start of a frame). With the cache disabled every call goes through, which keeps the
+  tracked state valid and makes the issued counts comparable.
+
+*/
 class GLStateCache
 {
 public:
+	enum class Call
+	{
+		DepthTest,
+		DepthFunc,
+		DepthWrite,
+		Blend,
+		BlendFunc,
+		Cull,
+		CullFace,
+		PolygonMode,
+		Program,
+		Texture,
+		Sampler,
+		VertexArray,
+		Framebuffer,
+		UniformBuffer,
+		Viewport,
+		Count
+	};
+
+	struct CallCount
+	{
+		unsigned int Issued = 0;
+		unsigned int Skipped = 0;
+	};
+
+	static const unsigned int MaxTextureUnits = 32;
+	static const unsigned int MaxUniformBuffers = 16;
+
+public:
+	GLStateCache();
+
+	// null restores the current RenderDevice, which is also the backend of a new cache.
+	void SetBackend(GLStateBackend* backend);
+	void SetEnabled(bool enable) { m_enabled = enable; }
+	bool IsEnabled() const { return m_enabled; }
+
+	// forgets all tracked state.
+	void Reset();
+
 	void SetDepthTest(bool enable);
 	void SetDepthFunc(GLenum depthFunc);
+	void SetDepthWrite(bool enable);
 	void SetBlend(bool enable);
 	void SetBlendFunc(GLenum src, GLenum dst);
 	void SetCull(bool enable);
 	void SetCullFace(GLenum face);
 	void SetPolygonMode(GLenum mode);
+	void SetViewport(int x, int y, int width, int height);
 
 	void SwitchShader(unsigned int ID);
 
+	void BindTexture(unsigned int unit, GLenum target, unsigned int texture);
+	void BindSampler(unsigned int unit, unsigned int sampler);
+	void BindVertexArray(unsigned int vertexArray);
+	// GL_FRAMEBUFFER binds both the draw and the read framebuffer.
+	void BindFramebuffer(GLenum target, unsigned int framebuffer);
+	void BindUniformBuffer(unsigned int index, unsigned int buffer);
+	void BindUniformBufferRange(unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size);
+
 	void PushState(GLenum state);
 	void PopState();
 
+	// issued and skipped calls per call type since the last ResetStats().
+	const CallCount& GetCallCount(Call call) const { return m_callCounts[static_cast<int>(call)]; }
+	static const char* GetCallName(Call call);
+	void ResetStats();
+
 private:
+	// counts the call and returns whether it has to be issued.
+	bool Filter(Call call, bool changed);
 	void ToggleState(GLenum state, bool enable);
 
 private:
-	// toggles
-	bool m_depthTest;
-	bool m_blend;
-	bool m_cullFace;
+	GLStateBackend* m_backend;
+	bool m_enabled = true;
+
+	// toggles; -1 while unknown
+	signed char m_depthTest;
+	signed char m_depthWrite;
+	signed char m_blend;
+	signed char m_cullFace;
 
-	// state
+	// state; s_Unknown while unknown
 	GLenum m_depthFunc;
 	GLenum m_blendSrc;
 	GLenum m_blendDst;
 	GLenum m_frontFace;
 	GLenum m_polygonMode;
+	int m_viewport[4];
 
+	// bindings; s_Unknown while unknown
 	unsigned int m_activeShaderID;
+	unsigned int m_activeTextureUnit;
+	GLenum m_textureTargets[MaxTextureUnits];
+	unsigned int m_textures[MaxTextureUnits];
+	unsigned int m_samplers[MaxTextureUnits];
+	unsigned int m_vertexArray;
+	unsigned int m_drawFramebuffer;
+	unsigned int m_readFramebuffer;
+	unsigned int m_uniformBuffers[MaxUniformBuffers];
+	GLintptr m_uniformBufferOffsets[MaxUniformBuffers];
+	GLsizeiptr m_uniformBufferSizes[MaxUniformBuffers];	// -1 for a whole buffer binding
 
 	std::stack<GLenum> m_stateStack;
-};
 
+	CallCount m_callCounts[static_cast<int>(Call::Count)];
+};
@@ -0,0 +1,170 @@
+#include "GeometryAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+void GeometryAllocator::Init(size_t capacity)
+{
+	m_Capacity = capacity;
+	m_Used = 0;
+	m_Allocations.clear();
+	m_FreeHandles.clear();
+	m_FreeByOffset.clear();
+	m_FreeBySize.clear();
+	if (capacity > 0)
+	{
+		addFreeBlock(0, capacity);
+	}
+}
+
+GeometryAllocator::Handle GeometryAllocator::Allocate(size_t size)
+{
+	if (size == 0)
+	{
+		return InvalidHandle;
+	}
+
+	auto fit = m_FreeBySize.lower_bound(size);
+	if (fit == m_FreeBySize.end())
+	{
+		return InvalidHandle;
+	}
+
+	const size_t offset = fit->second;
+	const size_t blockSize = fit->first;
+	removeFreeBlock(m_FreeByOffset.find(offset));
+	if (blockSize > size)
+	{
+		addFreeBlock(offset + size, blockSize - size);
+	}
+
+	Handle handle;
+	if (!m_FreeHandles.empty())
+	{
+		handle = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<Handle>(m_Allocations.size());
+		m_Allocations.emplace_back();
+	}
+
+	Block& block = m_Allocations[handle];
+	block.Offset = offset;
+	block.Size = size;
+	block.Live = true;
+	m_Used += size;
+	return handle;
+}
+
+void GeometryAllocator::Free(Handle handle)
+{
+	if (!IsValid(handle))
+	{
+		return;
+	}
+
+	Block& block = m_Allocations[handle];
+	addFreeBlock(block.Offset, block.Size);
+	m_Used -= block.Size;
+	block.Live = false;
+	m_FreeHandles.push_back(handle);
+}
+
+void GeometryAllocator::Grow(size_t capacity)
+{
+	if (capacity <= m_Capacity)
+	{
+		return;
+	}
+
+	addFreeBlock(m_Capacity, capacity - m_Capacity);
+	m_Capacity = capacity;
+}
+
+void GeometryAllocator::Defragment(std::vector<Move>& outMoves)
+{
+	std::vector<Handle> live;
+	live.reserve(m_Allocations.size() - m_FreeHandles.size());
+	for (Handle handle = 0; handle < m_Allocations.size(); ++handle)
+	{
+		if (m_Allocations[handle].Live)
+		{
+			live.push_back(handle);
+		}
+	}
+	std::sort(live.begin(), live.end(), [this](Handle lhs, Handle rhs)
+	{
+		return m_Allocations[lhs].Offset < m_Allocations[rhs].Offset;
+	});
+
+	size_t cursor = 0;
+	for (Handle handle : live)
+	{
+		Block& block = m_Allocations[handle];
+		if (block.Offset != cursor)
+		{
+			outMoves.push_back({ handle, block.Offset, cursor, block.Size });
+			block.Offset = cursor;
+		}
+		cursor += block.Size;
+	}
+
+	m_FreeByOffset.clear();
+	m_FreeBySize.clear();
+	if (cursor < m_Capacity)
+	{
+		addFreeBlock(cursor, m_Capacity - cursor);
+	}
+}
+
+GeometryAllocator::Stats GeometryAllocator::GetStats() const
+{
+	Stats stats;
+	stats.Capacity = m_Capacity;
+	stats.Used = m_Used;
+	stats.LargestFree = m_FreeBySize.empty() ? 0 : m_FreeBySize.rbegin()->first;
+	stats.Allocations = static_cast<unsigned int>(m_Allocations.size() - m_FreeHandles.size());
+	stats.FreeBlocks = static_cast<unsigned int>(m_FreeByOffset.size());
+	return stats;
+}
+
+void GeometryAllocator::addFreeBlock(size_t offset, size_t size)
+{
+	// merge with the free blocks right after and right before.
+	auto next = m_FreeByOffset.lower_bound(offset);
+	if (next != m_FreeByOffset.end() && offset + size == next->first)
+	{
+		size += next->second;
+		auto merged = next++;
+		removeFreeBlock(merged);
+	}
+	if (next != m_FreeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			removeFreeBlock(previous);
+		}
+	}
+
+	m_FreeByOffset.emplace(offset, size);
+	m_FreeBySize.emplace(size, offset);
+}
+
+void GeometryAllocator::removeFreeBlock(std::map<size_t, size_t>::iterator block)
+{
+	auto range = m_FreeBySize.equal_range(block->second);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == block->first)
+		{
+			m_FreeBySize.erase(it);
+			break;
+		}
+	}
+	m_FreeByOffset.erase(block);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+/*
+
+  Bookkeeping of ranges of elements (vertices or indices) suballocated from a buffer of a fixed
+  capacity, without any GL: sizes and offsets are in elements, not bytes.
+
+  Free blocks are kept by offset, so a freed range merges with free neighbours, and by size, so
+  an allocation takes the smallest block it fits in (best fit, logarithmic in the number of free
+  blocks). Handles stay valid over Grow() and Defragment(); the latter slides every allocation
+  down to the start of the buffer in offset order and lists the moves the owner has to copy,
+  leaving all free space in one block at the end.
+
+*/
+class GeometryAllocator
+{
+public:
+	typedef unsigned int Handle;
+	static const Handle InvalidHandle = ~0u;
+
+	// range an allocation moved from and to by Defragment().
+	struct Move
+	{
+		Handle Allocation;
+		size_t From;
+		size_t To;
+		size_t Size;
+	};
+
+	struct Stats
+	{
+		size_t       Capacity = 0;
+		size_t       Used = 0;
+		size_t       LargestFree = 0;
+		unsigned int Allocations = 0;
+		unsigned int FreeBlocks = 0;
+
+		// share of the capacity in use.
+		float GetUtilisation() const { return Capacity > 0 ? static_cast<float>(Used) / Capacity : 0.0f; }
+		// share of the free elements outside the largest free block; 0 when the free space is a
+		// single block, close to 1 when it's scattered in small ones.
+		float GetFragmentation() const { return Capacity > Used ? 1.0f - static_cast<float>(LargestFree) / (Capacity - Used) : 0.0f; }
+	};
+
+public:
+	GeometryAllocator() = default;
+
+	// forgets all allocations.
+	void Init(size_t capacity);
+
+	// handle of size elements, or InvalidHandle when no free block is large enough (or size is 0).
+	Handle Allocate(size_t size);
+	void Free(Handle handle);
+
+	// extends the buffer to capacity elements; the new space is free.
+	void Grow(size_t capacity);
+	// packs all allocations at the start of the buffer, appending how each one moved to
+	// outMoves. Moves are in increasing offset order and never move a range up, so copying them
+	// in order within one buffer only overlaps a range with its own old location.
+	void Defragment(std::vector<Move>& outMoves);
+
+	bool IsValid(Handle handle) const { return handle < m_Allocations.size() && m_Allocations[handle].Live; }
+	size_t GetOffset(Handle handle) const { return m_Allocations[handle].Offset; }
+	size_t GetSize(Handle handle) const { return m_Allocations[handle].Size; }
+
+	size_t GetCapacity() const { return m_Capacity; }
+	size_t GetUsed() const { return m_Used; }
+	Stats GetStats() const;
+
+private:
+	struct Block
+	{
+		size_t Offset;
+		size_t Size;
+		bool   Live;
+	};
+
+	void addFreeBlock(size_t offset, size_t size);
+	void removeFreeBlock(std::map<size_t, size_t>::iterator block);
+
+private:
+	size_t m_Capacity = 0;
+	size_t m_Used = 0;
+
+	std::vector<Block> m_Allocations;
+	std::vector<Handle> m_FreeHandles;
+
+	// free blocks, offset to size and size to offset.
+	std::map<size_t, size_t> m_FreeByOffset;
+	std::multimap<size_t, size_t> m_FreeBySize;
+};
@@ -0,0 +1,319 @@
+#include "GeometryArena.h"
+#include "RenderDevice.h"
+
+#include "Mesh/Mesh.h"
+#include "Mesh/VertexPacking.h"
+
+#include <algorithm>
+
+// elements a pool starts with; pools double when they're full.
+static const size_t s_InitialVertexCapacity = 64 * 1024;
+static const size_t s_InitialIndexCapacity = 3 * 64 * 1024;
+// uploads and copies bind to the copy targets, leaving the array and element bindings alone.
+static const GLenum s_ReadTarget = GL_COPY_READ_BUFFER;
+static const GLenum s_WriteTarget = GL_COPY_WRITE_BUFFER;
+
+GeometryArena& GeometryArena::Get()
+{
+	static GeometryArena s_Arena;
+	return s_Arena;
+}
+
+unsigned int GeometryArena::GetStride(unsigned int layout)
+{
+	if (layout & LayoutPacked)
+	{
+		unsigned int size = VertexPacking::PositionSize;
+		if (layout & LayoutUV)      size += VertexPacking::UVSize;
+		if (layout & LayoutNormal)  size += VertexPacking::NormalSize;
+		if (layout & LayoutTangent) size += VertexPacking::TangentSize;
+		return size;
+	}
+
+	unsigned int floats = 3;
+	if (layout & LayoutUV)        floats += 2;
+	if (layout & LayoutNormal)    floats += 3;
+	if (layout & LayoutTangent)   floats += 3;
+	if (layout & LayoutBitangent) floats += 3;
+	return floats * sizeof(float);
+}
+
+void GeometryArena::Upload(Mesh* mesh, unsigned int layout, const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+	Release(mesh);
+	if (vertexCount == 0)
+	{
+		return;
+	}
+
+	const unsigned int poolIndex = getPool(layout);
+	Pool& pool = m_Pools[poolIndex];
+	RenderDevice& device = RenderDevice::Get();
+
+	const GeometryAllocator::Handle vertexRange = allocate(pool, false, vertexCount);
+	pool.VertexOwners[vertexRange] = mesh;
+	const size_t baseVertex = pool.Vertices.GetOffset(vertexRange);
+	device.BindBuffer(s_WriteTarget, pool.VertexBuffer);
+	device.BufferSubData(s_WriteTarget, baseVertex * pool.Stride, vertexCount * pool.Stride, vertices);
+
+	GeometryAllocator::Handle indexRange = GeometryAllocator::InvalidHandle;
+	size_t firstIndex = 0;
+	if (indexCount > 0)
+	{
+		indexRange = allocate(pool, true, indexCount);
+		pool.IndexOwners[indexRange] = mesh;
+		firstIndex = pool.Indices.GetOffset(indexRange);
+		device.BindBuffer(s_WriteTarget, pool.IndexBuffer);
+		device.BufferSubData(s_WriteTarget, firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+	}
+
+	mesh->m_VAO = pool.VertexArray;
+	mesh->m_BaseVertex = static_cast<int>(baseVertex);
+	mesh->m_FirstIndex = static_cast<unsigned int>(firstIndex);
+	mesh->m_GeometryPool = poolIndex;
+	mesh->m_GeometryVertices = vertexRange;
+	mesh->m_GeometryIndices = indexRange;
+}
+
+void GeometryArena::Release(Mesh* mesh)
+{
+	if (mesh->m_GeometryPool >= m_Pools.size())
+	{
+		return;
+	}
+
+	Pool& pool = m_Pools[mesh->m_GeometryPool];
+	if (pool.Vertices.IsValid(mesh->m_GeometryVertices))
+	{
+		pool.Vertices.Free(mesh->m_GeometryVertices);
+		pool.VertexOwners[mesh->m_GeometryVertices] = nullptr;
+	}
+	if (pool.Indices.IsValid(mesh->m_GeometryIndices))
+	{
+		pool.Indices.Free(mesh->m_GeometryIndices);
+		pool.IndexOwners[mesh->m_GeometryIndices] = nullptr;
+	}
+
+	mesh->m_VAO = 0;
+	mesh->m_BaseVertex = 0;
+	mesh->m_FirstIndex = 0;
+	mesh->m_GeometryPool = InvalidPool;
+	mesh->m_GeometryVertices = GeometryAllocator::InvalidHandle;
+	mesh->m_GeometryIndices = GeometryAllocator::InvalidHandle;
+}
+
+void GeometryArena::Defragment(float minFragmentation)
+{
+	for (Pool& pool : m_Pools)
+	{
+		const GeometryAllocator::Stats vertexStats = pool.Vertices.GetStats();
+		if (vertexStats.FreeBlocks > 1 && vertexStats.GetFragmentation() >= minFragmentation)
+		{
+			compact(pool, false, vertexStats.Capacity);
+		}
+		const GeometryAllocator::Stats indexStats = pool.Indices.GetStats();
+		if (indexStats.FreeBlocks > 1 && indexStats.GetFragmentation() >= minFragmentation)
+		{
+			compact(pool, true, indexStats.Capacity);
+		}
+	}
+}
+
+void GeometryArena::Clean()
+{
+	RenderDevice& device = RenderDevice::Get();
+	for (Pool& pool : m_Pools)
+	{
+		for (Mesh* mesh : pool.VertexOwners)
+		{
+			if (mesh)
+			{
+				mesh->m_VAO = 0;
+				mesh->m_GeometryPool = InvalidPool;
+				mesh->m_GeometryVertices = GeometryAllocator::InvalidHandle;
+				mesh->m_GeometryIndices = GeometryAllocator::InvalidHandle;
+			}
+		}
+		device.DeleteVertexArray(pool.VertexArray);
+		device.DeleteBuffer(pool.VertexBuffer);
+		device.DeleteBuffer(pool.IndexBuffer);
+	}
+	m_Pools.clear();
+}
+
+GeometryArena::PoolStats GeometryArena::GetPoolStats(unsigned int pool) const
+{
+	PoolStats stats;
+	stats.Layout = m_Pools[pool].Layout;
+	stats.Stride = m_Pools[pool].Stride;
+	stats.VertexArray = m_Pools[pool].VertexArray;
+	stats.Vertices = m_Pools[pool].Vertices.GetStats();
+	stats.Indices = m_Pools[pool].Indices.GetStats();
+	stats.Compactions = m_Pools[pool].Compactions;
+	return stats;
+}
+
+unsigned int GeometryArena::getPool(unsigned int layout)
+{
+	for (unsigned int i = 0; i < m_Pools.size(); ++i)
+	{
+		if (m_Pools[i].Layout == layout)
+		{
+			return i;
+		}
+	}
+
+	RenderDevice& device = RenderDevice::Get();
+	m_Pools.emplace_back();
+	Pool& pool = m_Pools.back();
+	pool.Layout = layout;
+	pool.Stride = GetStride(layout);
+	pool.Vertices.Init(s_InitialVertexCapacity);
+	pool.Indices.Init(s_InitialIndexCapacity);
+
+	pool.VertexBuffer = device.CreateBuffer();
+	device.BindBuffer(s_WriteTarget, pool.VertexBuffer);
+	device.BufferData(s_WriteTarget, s_InitialVertexCapacity * pool.Stride, nullptr, GL_STATIC_DRAW);
+	pool.IndexBuffer = device.CreateBuffer();
+	device.BindBuffer(s_WriteTarget, pool.IndexBuffer);
+	device.BufferData(s_WriteTarget, s_InitialIndexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+
+	pool.VertexArray = device.CreateVertexArray();
+	device.BindVertexArray(pool.VertexArray);
+	device.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.IndexBuffer);
+	setVertexAttributes(pool);
+	device.BindVertexArray(0);
+
+	return static_cast<unsigned int>(m_Pools.size() - 1);
+}
+
+GeometryAllocator::Handle GeometryArena::allocate(Pool& pool, bool indices, unsigned int count)
+{
+	GeometryAllocator& allocator = indices ? pool.Indices : pool.Vertices;
+	GeometryAllocator::Handle handle = allocator.Allocate(count);
+	if (handle == GeometryAllocator::InvalidHandle)
+	{
+		// packing is enough when the free space adds up to the request.
+		size_t capacity = allocator.GetCapacity();
+		while (capacity - allocator.GetUsed() < count)
+		{
+			capacity *= 2;
+		}
+		compact(pool, indices, capacity);
+		handle = allocator.Allocate(count);
+	}
+
+	std::vector<Mesh*>& owners = indices ? pool.IndexOwners : pool.VertexOwners;
+	if (owners.size() <= handle)
+	{
+		owners.resize(handle + 1, nullptr);
+	}
+	return handle;
+}
+
+void GeometryArena::compact(Pool& pool, bool indices, size_t capacity)
+{
+	RenderDevice& device = RenderDevice::Get();
+	GeometryAllocator& allocator = indices ? pool.Indices : pool.Vertices;
+	std::vector<Mesh*>& owners = indices ? pool.IndexOwners : pool.VertexOwners;
+	unsigned int& buffer = indices ? pool.IndexBuffer : pool.VertexBuffer;
+	const size_t elementSize = indices ? sizeof(unsigned int) : pool.Stride;
+
+	// moves only go down; a move overlapping its old range is copied in steps of its distance so
+	// no single copy reads what it writes.
+	std::vector<GeometryAllocator::Move> moves;
+	allocator.Defragment(moves);
+	device.BindBuffer(s_ReadTarget, buffer);
+	device.BindBuffer(s_WriteTarget, buffer);
+	for (const GeometryAllocator::Move& move : moves)
+	{
+		const size_t step = std::min(move.Size, move.From - move.To);
+		for (size_t copied = 0; copied < move.Size; copied += step)
+		{
+			const size_t size = std::min(step, move.Size - copied);
+			device.CopyBufferSubData(s_ReadTarget, s_WriteTarget, (move.From + copied) * elementSize, (move.To + copied) * elementSize, size * elementSize);
+		}
+
+		Mesh* owner = owners[move.Allocation];
+		if (indices)
+			owner->m_FirstIndex = static_cast<unsigned int>(move.To);
+		else
+			owner->m_BaseVertex = static_cast<int>(move.To);
+	}
+
+	if (capacity > allocator.GetCapacity())
+	{
+		const unsigned int grown = device.CreateBuffer();
+		device.BindBuffer(s_WriteTarget, grown);
+		device.BufferData(s_WriteTarget, capacity * elementSize, nullptr, GL_STATIC_DRAW);
+		if (allocator.GetUsed() > 0)
+		{
+			device.CopyBufferSubData(s_ReadTarget, s_WriteTarget, 0, 0, allocator.GetUsed() * elementSize);
+		}
+		device.DeleteBuffer(buffer);
+		buffer = grown;
+		allocator.Grow(capacity);
+
+		// the vertex array still points at the old buffer.
+		device.BindVertexArray(pool.VertexArray);
+		if (indices)
+			device.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+		else
+			setVertexAttributes(pool);
+		device.BindVertexArray(0);
+	}
+	++pool.Compactions;
+}
+
+void GeometryArena::setVertexAttributes(const Pool& pool)
+{
+	RenderDevice& device = RenderDevice::Get();
+	device.BindBuffer(GL_ARRAY_BUFFER, pool.VertexBuffer);
+
+	size_t offset = 0;
+	if (pool.Layout & LayoutPacked)
+	{
+		// normals and tangents are read as integers converted to float, the shaders scale them.
+		device.EnableVertexAttribute(0, 4, GL_UNSIGNED_SHORT, true, pool.Stride, offset);
+		offset += VertexPacking::PositionSize;
+		if (pool.Layout & LayoutUV)
+		{
+			device.EnableVertexAttribute(1, 2, GL_HALF_FLOAT, false, pool.Stride, offset);
+			offset += VertexPacking::UVSize;
+		}
+		if (pool.Layout & LayoutNormal)
+		{
+			device.EnableVertexAttribute(2, 2, GL_SHORT, false, pool.Stride, offset);
+			offset += VertexPacking::NormalSize;
+		}
+		if (pool.Layout & LayoutTangent)
+		{
+			device.EnableVertexAttribute(3, 4, GL_INT_2_10_10_10_REV, false, pool.Stride, offset);
+			offset += VertexPacking::TangentSize;
+		}
+		return;
+	}
+
+	device.EnableVertexAttribute(0, 3, GL_FLOAT, false, pool.Stride, offset);
+	offset += 3 * sizeof(float);
+	if (pool.Layout & LayoutUV)
+	{
+		device.EnableVertexAttribute(1, 2, GL_FLOAT, false, pool.Stride, offset);
+		offset += 2 * sizeof(float);
+	}
+	if (pool.Layout & LayoutNormal)
+	{
+		device.EnableVertexAttribute(2, 3, GL_FLOAT, false, pool.Stride, offset);
+		offset += 3 * sizeof(float);
+	}
+	if (pool.Layout & LayoutTangent)
+	{
+		device.EnableVertexAttribute(3, 3, GL_FLOAT, false, pool.Stride, offset);
+		offset += 3 * sizeof(float);
+	}
+	if (pool.Layout & LayoutBitangent)
+	{
+		device.EnableVertexAttribute(4, 3, GL_FLOAT, false, pool.Stride, offset);
+		offset += 3 * sizeof(float);
+	}
+}
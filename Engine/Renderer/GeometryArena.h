@@ -0,0 +1,102 @@
+#pragma once
+
+#include "GeometryAllocator.h"
+
+#include <vector>
+
+class Mesh;
+
+/*
+
+  Vertex and index storage shared by the meshes: all meshes with the same vertex layout are
+  suballocated from one vertex buffer and one index buffer, drawn through one vertex array, and
+  find their data in them by their base vertex and first index. Meshes that share a vertex
+  array need no vertex array bind between their draws and can go out in one multi draw.
+
+  A layout is the set of attributes an interleaved vertex has besides its position, in the
+  order position, uv, normal, tangent, bitangent at locations 0 to 4, as floats or, with
+  LayoutPacked, in the formats of VertexPacking.h without bitangents. When a pool runs out of
+  room its allocations are packed at the start of its buffers, and the buffers are replaced by
+  larger ones if that doesn't free enough; Defragment() packs the pools whose free space is
+  scattered. Data moves on the GPU and the meshes' base vertex and first index follow it.
+
+  All GL calls go through the RenderDevice; the ranges are kept by GeometryAllocators.
+
+*/
+class GeometryArena
+{
+public:
+	// attributes of a layout besides the position.
+	static const unsigned int LayoutUV = 1;
+	static const unsigned int LayoutNormal = 2;
+	static const unsigned int LayoutTangent = 4;
+	static const unsigned int LayoutBitangent = 8;
+	// the attributes are packed; there are no bitangents then.
+	static const unsigned int LayoutPacked = 16;
+
+	static const unsigned int InvalidPool = ~0u;
+
+	struct PoolStats
+	{
+		unsigned int             Layout = 0;
+		unsigned int             Stride = 0;
+		unsigned int             VertexArray = 0;
+		GeometryAllocator::Stats Vertices;
+		GeometryAllocator::Stats Indices;
+		unsigned int             Compactions = 0;
+	};
+
+public:
+	static GeometryArena& Get();
+
+	GeometryArena() = default;
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	// bytes of an interleaved vertex of layout.
+	static unsigned int GetStride(unsigned int layout);
+
+	// copies the mesh's interleaved vertices, GetStride(layout) bytes each, and its indices (if any) into the pool of layout,
+	// releasing the ranges it had before, and points the mesh's vertex array, base vertex and
+	// first index at them.
+	void Upload(Mesh* mesh, unsigned int layout, const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+	// frees the mesh's ranges; nothing happens for meshes that aren't in the arena.
+	void Release(Mesh* mesh);
+
+	// packs the vertex and index buffers whose fragmentation is at least minFragmentation.
+	void Defragment(float minFragmentation = 0.25f);
+	// deletes all pools; meshes still in the arena are left without geometry. Not done on
+	// destruction, the GL context may be gone by then.
+	void Clean();
+
+	unsigned int GetPoolCount() const { return static_cast<unsigned int>(m_Pools.size()); }
+	PoolStats GetPoolStats(unsigned int pool) const;
+
+private:
+	struct Pool
+	{
+		unsigned int Layout = 0;
+		unsigned int Stride = 0;
+		unsigned int VertexArray = 0;
+		unsigned int VertexBuffer = 0;
+		unsigned int IndexBuffer = 0;
+		GeometryAllocator Vertices;
+		GeometryAllocator Indices;
+		// the mesh of every vertex and index allocation, by handle.
+		std::vector<Mesh*> VertexOwners;
+		std::vector<Mesh*> IndexOwners;
+		unsigned int Compactions = 0;
+	};
+
+	unsigned int getPool(unsigned int layout);
+	// allocates count vertices or indices, compacting or growing the pool when it's full.
+	GeometryAllocator::Handle allocate(Pool& pool, bool indices, unsigned int count);
+	// packs the pool's vertex or index buffer and moves it to a buffer of capacity elements if
+	// that's more than it has.
+	void compact(Pool& pool, bool indices, size_t capacity);
+	void setVertexAttributes(const Pool& pool);
+
+private:
+	std::vector<Pool> m_Pools;
+};
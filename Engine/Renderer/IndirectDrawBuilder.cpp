@@ -0,0 +1,153 @@
+#include "IndirectDrawBuilder.h"
+
+#include "Utils/Parallel.h"
+
+namespace
+{
+	// what starts at a command, in the order of the sorted stream.
+	const uint8_t s_StartCommand = 1;
+	const uint8_t s_StartBucket = 2;
+	const uint8_t s_StartMaterial = 4;
+
+	// per worker: commands, buckets and materials started in its range.
+	const unsigned int s_CountsPerWorker = 3;
+}
+
+void IndirectDrawBuilder::Build(const RenderCommand* commands, const unsigned int* order, unsigned int count, MeshRangeFunc getMeshRange, unsigned int minBatchSize)
+{
+	Clear();
+	if (count == 0)
+	{
+		return;
+	}
+
+	const unsigned int workerCount = Utils::GetWorkerCount(count, minBatchSize);
+	m_Ranges.resize(count);
+	m_Starts.resize(count);
+	m_WorkerCounts.assign(workerCount * s_CountsPerWorker, 0);
+
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(count, workerCount, worker, begin, end);
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			m_Ranges[i] = getMeshRange(commands[order ? order[i] : i].Mesh);
+		}
+	});
+
+	// mark where commands, buckets and materials start and count them per worker.
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(count, workerCount, worker, begin, end);
+		unsigned int* counts = &m_WorkerCounts[worker * s_CountsPerWorker];
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			uint8_t starts = s_StartCommand | s_StartBucket | s_StartMaterial;
+			if (i > 0)
+			{
+				const RenderCommand& previous = commands[order ? order[i - 1] : i - 1];
+				const RenderCommand& current = commands[order ? order[i] : i];
+				const bool material = current.Material != previous.Material;
+				const bool bucket = material || m_Ranges[i].VertexArray != m_Ranges[i - 1].VertexArray || m_Ranges[i].Mode != m_Ranges[i - 1].Mode;
+				const bool command = bucket || current.Mesh != previous.Mesh;
+				starts = (command ? s_StartCommand : 0) | (bucket ? s_StartBucket : 0) | (material ? s_StartMaterial : 0);
+			}
+			m_Starts[i] = starts;
+			counts[0] += (starts & s_StartCommand) != 0;
+			counts[1] += (starts & s_StartBucket) != 0;
+			counts[2] += (starts & s_StartMaterial) != 0;
+		}
+	});
+
+	// the counts become each worker's first command, bucket and material.
+	unsigned int totals[s_CountsPerWorker] = {};
+	for (unsigned int worker = 0; worker < workerCount; ++worker)
+	{
+		for (unsigned int j = 0; j < s_CountsPerWorker; ++j)
+		{
+			const unsigned int workerTotal = m_WorkerCounts[worker * s_CountsPerWorker + j];
+			m_WorkerCounts[worker * s_CountsPerWorker + j] = totals[j];
+			totals[j] += workerTotal;
+		}
+	}
+
+	m_Commands.resize(totals[0]);
+	m_MeshData.resize(totals[0]);
+	m_Buckets.resize(totals[1]);
+	m_Materials.resize(totals[2]);
+	m_DrawData.resize(count);
+	m_Transforms.resize(count);
+
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(count, workerCount, worker, begin, end);
+		unsigned int nextCommand = m_WorkerCounts[worker * s_CountsPerWorker];
+		unsigned int nextBucket = m_WorkerCounts[worker * s_CountsPerWorker + 1];
+		unsigned int nextMaterial = m_WorkerCounts[worker * s_CountsPerWorker + 2];
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			const RenderCommand& rc = commands[order ? order[i] : i];
+			const uint8_t starts = m_Starts[i];
+
+			if (starts & s_StartMaterial)
+			{
+				m_Materials[nextMaterial++] = rc.Material;
+			}
+			if (starts & s_StartBucket)
+			{
+				// the bucket's commands are the command starts up to the next bucket.
+				unsigned int commandCount = 1;
+				for (unsigned int j = i + 1; j < count && (m_Starts[j] & s_StartBucket) == 0; ++j)
+				{
+					commandCount += (m_Starts[j] & s_StartCommand) != 0;
+				}
+
+				IndirectDrawBucket& bucket = m_Buckets[nextBucket++];
+				bucket.Material = rc.Material;
+				bucket.VertexArray = m_Ranges[i].VertexArray;
+				bucket.Mode = m_Ranges[i].Mode;
+				bucket.FirstCommand = nextCommand;
+				bucket.CommandCount = commandCount;
+			}
+			if (starts & s_StartCommand)
+			{
+				unsigned int instanceCount = 1;
+				while (i + instanceCount < count && (m_Starts[i + instanceCount] & s_StartCommand) == 0)
+				{
+					++instanceCount;
+				}
+
+				DrawElementsIndirectCommand& command = m_Commands[nextCommand++];
+				command.Count = m_Ranges[i].IndexCount;
+				command.InstanceCount = instanceCount;
+				command.FirstIndex = m_Ranges[i].FirstIndex;
+				command.BaseVertex = m_Ranges[i].BaseVertex;
+				command.BaseInstance = i;
+
+				IndirectMeshData& meshData = m_MeshData[nextCommand - 1];
+				meshData.PackedOrigin = m_Ranges[i].PackedOrigin;
+				meshData.PackedExtent = m_Ranges[i].PackedExtent;
+			}
+
+			// a range starting inside a material run or command gets the index of the one
+			// before its first one, which is that run or command.
+			m_DrawData[i].TransformIndex = i;
+			m_DrawData[i].MaterialIndex = nextMaterial - 1;
+			m_DrawData[i].MeshIndex = nextCommand - 1;
+			m_Transforms[i] = rc.Transform;
+		}
+	});
+}
+
+void IndirectDrawBuilder::Clear()
+{
+	m_Commands.clear();
+	m_DrawData.clear();
+	m_Transforms.clear();
+	m_MeshData.clear();
+	m_Buckets.clear();
+	m_Materials.clear();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "RenderCommand.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class Mesh;
+class Material;
+
+// layout of a glMultiDrawElementsIndirect command.
+struct DrawElementsIndirectCommand
+{
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t  BaseVertex;
+	uint32_t BaseInstance;	// index of the command's first draw in the per-draw data
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the GL layout");
+
+// per-draw data as read by the vertex shader (std430): which transform, which material of the
+// frame and which mesh data the draw uses.
+struct IndirectDrawData
+{
+	uint32_t TransformIndex;
+	uint32_t MaterialIndex;
+	uint32_t MeshIndex;
+};
+static_assert(sizeof(IndirectDrawData) == 12, "IndirectDrawData must match the std430 layout");
+
+// per-command data as read by the vertex shader (std430): how it decodes the mesh's vertices,
+// see Mesh::m_PackedOrigin.
+struct IndirectMeshData
+{
+	glm::vec4 PackedOrigin;
+	glm::vec4 PackedExtent;
+};
+static_assert(sizeof(IndirectMeshData) == 32, "IndirectMeshData must match the std430 layout");
+
+// where a mesh's indices are in the buffers of the vertex array it's drawn with.
+struct IndirectMeshRange
+{
+	unsigned int VertexArray;
+	unsigned int Mode;	// GL primitive type
+	unsigned int IndexCount;
+	unsigned int FirstIndex;
+	int          BaseVertex;
+	glm::vec4    PackedOrigin;
+	glm::vec4    PackedExtent;
+};
+
+// consecutive indirect commands sharing material and vertex array, issued as one multi draw.
+struct IndirectDrawBucket
+{
+	Material*    Material;
+	unsigned int VertexArray;
+	unsigned int Mode;
+	unsigned int FirstCommand;
+	unsigned int CommandCount;
+};
+
+/*
+
+  Turns state sorted render commands into the arrays of a multi draw indirect submission: one
+  indirect command per run of equal mesh and material (its instances being the run's draws),
+  one per-draw data entry and transform per render command, and a bucket for every run of
+  commands that can go out in a single glMultiDrawElementsIndirect, split wherever the
+  material, vertex array or primitive type changes. Meshes that share their vertex array differ
+  only in their index range, so they end up in the same bucket.
+
+  The build is linear in the number of commands and runs in parallel over contiguous ranges
+  of them; its result doesn't depend on the number of workers. No GL calls are made here: the
+  renderer uploads the arrays and issues a draw per bucket.
+
+*/
+class IndirectDrawBuilder
+{
+public:
+	typedef IndirectMeshRange (*MeshRangeFunc)(const Mesh* mesh);
+
+public:
+	IndirectDrawBuilder() = default;
+
+	// builds the arrays of commands[order[0]], commands[order[1]], ... or of the commands in
+	// sequence when order is null. getMeshRange tells where a mesh's indices are; every mesh
+	// must be indexed. Ranges of fewer than minBatchSize commands aren't split over workers.
+	void Build(const RenderCommand* commands, const unsigned int* order, unsigned int count, MeshRangeFunc getMeshRange, unsigned int minBatchSize = 1024);
+	void Clear();
+
+	const std::vector<DrawElementsIndirectCommand>& GetCommands() const { return m_Commands; }
+	const std::vector<IndirectDrawData>& GetDrawData() const { return m_DrawData; }
+	const std::vector<glm::mat4>& GetTransforms() const { return m_Transforms; }
+	// one entry per command, indexed by IndirectDrawData::MeshIndex.
+	const std::vector<IndirectMeshData>& GetMeshData() const { return m_MeshData; }
+	const std::vector<IndirectDrawBucket>& GetBuckets() const { return m_Buckets; }
+	// the material of every run of equal materials, indexed by IndirectDrawData::MaterialIndex.
+	const std::vector<Material*>& GetMaterials() const { return m_Materials; }
+
+	unsigned int GetDrawCount() const { return static_cast<unsigned int>(m_DrawData.size()); }
+
+private:
+	std::vector<DrawElementsIndirectCommand> m_Commands;
+	std::vector<IndirectDrawData> m_DrawData;
+	std::vector<glm::mat4> m_Transforms;
+	std::vector<IndirectMeshData> m_MeshData;
+	std::vector<IndirectDrawBucket> m_Buckets;
+	std::vector<Material*> m_Materials;
+
+	// scratch of the build: every command's mesh range and where runs start.
+	std::vector<IndirectMeshRange> m_Ranges;
+	std::vector<uint8_t> m_Starts;
+	std::vector<unsigned int> m_WorkerCounts;
+};
@@ -0,0 +1,68 @@
+#include "InstanceBatcher.h"
+
+InstanceBatcher::InstanceBatcher(unsigned int minInstanceCount)
+{
+	SetMinInstanceCount(minInstanceCount);
+}
+
+void InstanceBatcher::Build(const RenderCommand* commands, const unsigned int* order, unsigned int count, bool (*canInstance)(Material*))
+{
+	Clear();
+
+	unsigned int runStart = 0;
+	while (runStart < count)
+	{
+		const RenderCommand& first = commands[order ? order[runStart] : runStart];
+
+		unsigned int runEnd = runStart + 1;
+		while (runEnd < count)
+		{
+			const RenderCommand& next = commands[order ? order[runEnd] : runEnd];
+			if (next.Mesh != first.Mesh || next.Material != first.Material)
+			{
+				break;
+			}
+			++runEnd;
+		}
+
+		const unsigned int runLength = runEnd - runStart;
+		if (runLength >= m_MinInstanceCount && (!canInstance || canInstance(first.Material)))
+		{
+			InstanceBatch batch;
+			batch.Mesh = first.Mesh;
+			batch.Material = first.Material;
+			batch.FirstCommand = runStart;
+			batch.FirstInstance = static_cast<unsigned int>(m_InstanceTransforms.size());
+			batch.Count = runLength;
+			batch.Instanced = true;
+			m_Batches.push_back(batch);
+
+			for (unsigned int i = runStart; i < runEnd; ++i)
+			{
+				m_InstanceTransforms.push_back(commands[order ? order[i] : i].Transform);
+			}
+		}
+		else
+		{
+			for (unsigned int i = runStart; i < runEnd; ++i)
+			{
+				InstanceBatch batch;
+				batch.Mesh = first.Mesh;
+				batch.Material = first.Material;
+				batch.FirstCommand = i;
+				batch.FirstInstance = 0;
+				batch.Count = 1;
+				batch.Instanced = false;
+				m_Batches.push_back(batch);
+			}
+		}
+
+		runStart = runEnd;
+	}
+}
+
+void InstanceBatcher::Clear()
+{
+	m_Batches.clear();
+	m_InstanceTransforms.clear();
+}
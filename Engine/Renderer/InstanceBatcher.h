@@ -0,0 +1,58 @@
+#pragma once
+
+#include "RenderCommand.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class Mesh;
+class Material;
+
+struct InstanceBatch
+{
+	Mesh* Mesh;
+	Material* Material;
+	unsigned int FirstCommand;	// position of the batch's first command in the order it was built from
+	unsigned int FirstInstance;	// first transform in the instance array; instanced batches only
+	unsigned int Count;
+	bool Instanced;
+};
+
+/*
+
+  Collapses runs of render commands that share mesh and material (and with it all material
+  state) into instanced draws. Commands are expected in state sorted order so equal draws are
+  adjacent; every long enough run becomes a single batch whose transforms are stored back to
+  back in one per-frame instance array, ready to be uploaded as a single instance buffer.
+  Shorter runs, and materials whose shader has no instanced path, stay single draws.
+
+  No GL calls are made here: the renderer uploads the instance array and issues the batches.
+
+*/
+class InstanceBatcher
+{
+public:
+	InstanceBatcher(unsigned int minInstanceCount = 2);
+
+	// builds the batches of commands[order[0]], commands[order[1]], ... or of the commands in
+	// sequence when order is null. canInstance tells whether a material's shader can be drawn
+	// instanced; null means every material can.
+	void Build(const RenderCommand* commands, const unsigned int* order, unsigned int count, bool (*canInstance)(Material*) = nullptr);
+	void Clear();
+
+	const std::vector<InstanceBatch>& GetBatches() const { return m_Batches; }
+	const std::vector<glm::mat4>& GetInstanceTransforms() const { return m_InstanceTransforms; }
+
+	// number of commands drawn through instanced batches in the last build.
+	unsigned int GetInstancedCommandCount() const { return static_cast<unsigned int>(m_InstanceTransforms.size()); }
+
+	unsigned int GetMinInstanceCount() const { return m_MinInstanceCount; }
+	void SetMinInstanceCount(unsigned int count) { m_MinInstanceCount = count < 2 ? 2 : count; }
+
+private:
+	unsigned int m_MinInstanceCount;
+
+	std::vector<InstanceBatch> m_Batches;
+	std::vector<glm::mat4> m_InstanceTransforms;
+};
@@ -0,0 +1,69 @@
+#include "MaterialBlockBuffer.h"
+#include "GLStateCache.h"
+#include "RenderDevice.h"
+
+#include "Shading/Material.h"
+#include "Shading/Shader.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+
+// generations handed out over all buffers; 0 is never used, so new materials have no range.
+static unsigned int s_NextGeneration = 1;
+
+MaterialBlockBuffer::~MaterialBlockBuffer()
+{
+	RenderDevice::Get().DeleteBuffer(m_UBO);
+}
+
+void MaterialBlockBuffer::Init(unsigned int capacity)
+{
+	RenderDevice& device = RenderDevice::Get();
+	m_Alignment = std::max(device.GetInteger(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT), 1);
+
+	m_UBO = device.CreateBuffer();
+	device.BindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+	device.BufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+	m_Capacity = capacity;
+	m_Used = 0;
+	m_Generation = s_NextGeneration++;
+}
+
+void MaterialBlockBuffer::Bind(Material* material, GLStateCache& state)
+{
+	const unsigned int size = static_cast<unsigned int>(material->m_Block.size());
+	if (size == 0 || m_UBO == 0)
+	{
+		return;
+	}
+
+	// a range in the current allocation, growing the buffer if it's full.
+	if (material->m_BlockGeneration != m_Generation || material->m_BlockOwner != material)
+	{
+		const unsigned int alignedSize = (size + m_Alignment - 1) / m_Alignment * m_Alignment;
+		if (m_Used + alignedSize > m_Capacity)
+		{
+			m_Capacity = std::max(m_Capacity * 2, alignedSize);
+			m_Used = 0;
+			m_Generation = s_NextGeneration++;
+			RenderDevice::Get().BindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+			RenderDevice::Get().BufferData(GL_UNIFORM_BUFFER, m_Capacity, nullptr, GL_DYNAMIC_DRAW);
+		}
+		material->m_BlockOffset = m_Used;
+		material->m_BlockGeneration = m_Generation;
+		material->m_BlockOwner = material;
+		material->m_BlockDirty = true;
+		m_Used += alignedSize;
+	}
+
+	if (material->m_BlockDirty)
+	{
+		RenderDevice::Get().BindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+		RenderDevice::Get().BufferSubData(GL_UNIFORM_BUFFER, material->m_BlockOffset, size, material->m_Block.data());
+		material->m_BlockDirty = false;
+		++m_UploadCount;
+	}
+
+	state.BindUniformBufferRange(Shader::MaterialBlockBinding, m_UBO, material->m_BlockOffset, size);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+class Material;
+class GLStateCache;
+
+/*
+
+  Uniform buffer holding the std140 material blocks of all materials drawn with a renderer.
+  Every material gets its own range, aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, the first
+  time it's bound; after that its block is only uploaded again when a parameter changed, and
+  binding it is a single glBindBufferRange to Shader::MaterialBlockBinding.
+
+  When the buffer is full it's reallocated at twice the size and every material gets a new
+  range on its next bind, which also drops the ranges of materials that are no longer drawn.
+
+*/
+class MaterialBlockBuffer
+{
+public:
+	MaterialBlockBuffer() = default;
+	~MaterialBlockBuffer();
+
+	MaterialBlockBuffer(const MaterialBlockBuffer&) = delete;
+	MaterialBlockBuffer& operator=(const MaterialBlockBuffer&) = delete;
+
+	void Init(unsigned int capacity = 16384);
+
+	// uploads the material's block if it changed and binds its range through state; does
+	// nothing for materials whose shader has no material block.
+	void Bind(Material* material, GLStateCache& state);
+
+	// blocks uploaded since the last call to ResetStats().
+	unsigned int GetUploadCount() const { return m_UploadCount; }
+	void ResetStats() { m_UploadCount = 0; }
+
+private:
+	unsigned int m_UBO = 0;
+	unsigned int m_Capacity = 0;
+	unsigned int m_Used = 0;
+	unsigned int m_Alignment = 256;
+	// identifies the buffer's current allocation; unique over all buffers, so a material's range
+	// is only taken as valid by the buffer and allocation it came from.
+	unsigned int m_Generation = 0;
+
+	unsigned int m_UploadCount = 0;
+};
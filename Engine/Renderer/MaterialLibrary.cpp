@@ -4,10 +4,32 @@
 
 #include "Shading/Material.h"
 #include "Resources/Resources.h"
+#include "Lighting/ShadowCascades.h"
 
 #include "Utils/Utils.h"
 #include "Utils/Logger.h"
 
+#include <string>
+
+// the shadow cascades of a directional light take consecutive texture units from firstUnit on.
+static void setCascadeSamplers(Shader* shader, int firstUnit)
+{
+	shader->Use();
+	for (unsigned int i = 0; i < ShadowCascades::MaxCascadeCount; ++i)
+	{
+		shader->SetInt("CascadeShadowMap" + std::to_string(i), firstUnit + i);
+	}
+}
+
+// the lit shaders scale their texture samples by the factors of their material block; templates
+// start out at 1 so materials derived from them look as their textures say.
+static void setDefaultFactors(Material* material)
+{
+	material->SetVector("AlbedoFactor", glm::vec4(1.0f));
+	material->SetFloat("MetallicFactor", 1.0f);
+	material->SetFloat("RoughnessFactor", 1.0f);
+	material->SetFloat("AOFactor", 1.0f);
+}
 
 MaterialLibrary::MaterialLibrary(RenderTarget* gBuffer)
 {
@@ -63,11 +85,18 @@ Material* MaterialLibrary::CreatePostProcessingMaterial(Shader* shader)
 	return mat;
 }
 
+Shader* MaterialLibrary::GetMultiDrawShader(Shader* shader) const
+{
+	auto found = m_MultiDrawShaders.find(shader->ID);
+	return found != m_MultiDrawShaders.end() ? found->second : nullptr;
+}
+
 void MaterialLibrary::generateDefaultMaterials()
 {
 	// default render material (deferred path)
 	Shader* defaultShader = Resources::LoadShader("default", "shaders/deferred/g_buffer.vs", "shaders/deferred/g_buffer.fs");
 	Material* defaultMat = new Material(defaultShader);
+	setDefaultFactors(defaultMat);
 	defaultMat->Type = MATERIAL_DEFAULT;
 	defaultMat->SetTexture("TexAlbedo", Resources::LoadTexture("default albedo", "textures/checkerboard.png", GL_TEXTURE_2D, GL_RGB), 3);
 	defaultMat->SetTexture("TexNormal", Resources::LoadTexture("default normal", "textures/norm.png"), 4);
@@ -76,12 +105,9 @@ void MaterialLibrary::generateDefaultMaterials()
 	m_DefaultMaterials[Utils::Hash("default")] = defaultMat;
 	// glass material
 	Shader* glassShader = Resources::LoadShader("glass", "shaders/forward_render.vs", "shaders/forward_render.fs", { "ALPHA_BLEND" });
-	glassShader->Use();
-	glassShader->SetInt("lightShadowMap1", 10);
-	glassShader->SetInt("lightShadowMap2", 10);
-	glassShader->SetInt("lightShadowMap3", 10);
-	glassShader->SetInt("lightShadowMap4", 10);
+	setCascadeSamplers(glassShader, 10);
 	Material* glassMat = new Material(glassShader);
+	setDefaultFactors(glassMat);
 	glassMat->Type = MATERIAL_CUSTOM; // this material can't fit in the deferred rendering pipeline (due to transparency sorting).
 	glassMat->SetTexture("TexAlbedo", Resources::LoadTexture("glass albedo", "textures/glass.png", GL_TEXTURE_2D, GL_RGBA), 0);
 	glassMat->SetTexture("TexNormal", Resources::LoadTexture("glass normal", "textures/pbr/plastic/normal.png"), 1);
@@ -92,34 +118,38 @@ void MaterialLibrary::generateDefaultMaterials()
 	m_DefaultMaterials[Utils::Hash("glass")] = glassMat;
 	// alpha blend material
 	Shader* alphaBlendShader = Resources::LoadShader("alpha blend", "shaders/forward_render.vs", "shaders/forward_render.fs", { "ALPHA_BLEND" });
-	alphaBlendShader->Use();
-	alphaBlendShader->SetInt("lightShadowMap1", 10);
-	alphaBlendShader->SetInt("lightShadowMap2", 10);
-	alphaBlendShader->SetInt("lightShadowMap3", 10);
-	alphaBlendShader->SetInt("lightShadowMap4", 10);
+	setCascadeSamplers(alphaBlendShader, 10);
 	Material* alphaBlendMaterial = new Material(alphaBlendShader);
+	setDefaultFactors(alphaBlendMaterial);
 	alphaBlendMaterial->Type = MATERIAL_CUSTOM;
 	alphaBlendMaterial->Blend = true;
 	m_DefaultMaterials[Utils::Hash("alpha blend")] = alphaBlendMaterial;
 	// alpha cutout material
 	Shader* alphaDiscardShader = Resources::LoadShader("alpha discard", "shaders/forward_render.vs", "shaders/forward_render.fs", { "ALPHA_DISCARD" });
-	alphaDiscardShader->Use();
-	alphaDiscardShader->SetInt("lightShadowMap1", 10);
-	alphaDiscardShader->SetInt("lightShadowMap2", 10);
-	alphaDiscardShader->SetInt("lightShadowMap3", 10);
-	alphaDiscardShader->SetInt("lightShadowMap4", 10);
+	setCascadeSamplers(alphaDiscardShader, 10);
 	Material* alphaDiscardMaterial = new Material(alphaDiscardShader);
+	setDefaultFactors(alphaDiscardMaterial);
 	alphaDiscardMaterial->Type = MATERIAL_CUSTOM;
 	alphaDiscardMaterial->Cull = false;
 	m_DefaultMaterials[Utils::Hash("alpha discard")] = alphaDiscardMaterial;
+	Shader* alphaDiscardMultiDrawShader = Resources::LoadShader("alpha discard multidraw", "shaders/forward_render.vs", "shaders/forward_render.fs", { "ALPHA_DISCARD", "MULTI_DRAW" });
+	setCascadeSamplers(alphaDiscardMultiDrawShader, 10);
+	m_MultiDrawShaders[alphaDiscardShader->ID] = alphaDiscardMultiDrawShader;
 
 	Shader* defaultFwdShader = Resources::LoadShader("default-fwd", "shaders/forward_render.vs", "shaders/forward_render.fs");
+	setCascadeSamplers(defaultFwdShader, 10);
 	Material* defaultForwardMat = new Material(defaultFwdShader);
+	setDefaultFactors(defaultForwardMat);
 	defaultForwardMat->SetTexture("TexAlbedo", Resources::LoadTexture("default albedo", "textures/checkerboard.png", GL_TEXTURE_2D, GL_RGB), 3);
 	m_DefaultMaterials[Utils::Hash("default-fwd")] = defaultForwardMat;
+	Shader* defaultFwdMultiDrawShader = Resources::LoadShader("default-fwd-multidraw", "shaders/forward_render.vs", "shaders/forward_render.fs", { "MULTI_DRAW" });
+	setCascadeSamplers(defaultFwdMultiDrawShader, 10);
+	m_MultiDrawShaders[defaultFwdShader->ID] = defaultFwdMultiDrawShader;
 
 	Shader* fwdTransparentShader = Resources::LoadShader("default-fwd-alpha", "shaders/forward_render.vs", "shaders/forward_render.fs", { "ALPHA_BLEND" });
+	setCascadeSamplers(fwdTransparentShader, 10);
 	Material* fwdTransparentMat = new Material(fwdTransparentShader);
+	setDefaultFactors(fwdTransparentMat);
 	fwdTransparentMat->SetTexture("TexAlbedo", Resources::LoadTexture("default albedo", "textures/checkerboard.png", GL_TEXTURE_2D, GL_RGB), 3);
 	fwdTransparentMat->Blend = true;
 	m_DefaultMaterials[Utils::Hash("default-fwd-alpha")] = fwdTransparentMat;
@@ -158,7 +188,7 @@ void MaterialLibrary::generateInternalMaterials(RenderTarget* gBuffer)
 	deferredDirectionalShader->SetInt("gPositionMetallic", 0);
 	deferredDirectionalShader->SetInt("gNormalRoughness", 1);
 	deferredDirectionalShader->SetInt("gAlbedoAO", 2);
-	deferredDirectionalShader->SetInt("lightShadowMap", 3);
+	setCascadeSamplers(deferredDirectionalShader, 3);
 	deferredPointShader->Use();
 	deferredPointShader->SetInt("gPositionMetallic", 0);
 	deferredPointShader->SetInt("gNormalRoughness", 1);
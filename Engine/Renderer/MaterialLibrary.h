@@ -36,6 +36,9 @@ private:
 	Shader* deferredPointShader;
 
 	Shader* dirShadowShader;
+
+	// multi draw indirect variants of the forward shaders, by the ID of the shader they stand in for.
+	std::map<unsigned int, Shader*> m_MultiDrawShaders;
 public:
 	Material* debugLightMaterial;
 	Material* errorMaterial;
@@ -48,6 +51,10 @@ public:
 	Material* CreateMaterial(std::string base);             // these don't have the custom flag set (default material has default state and uses checkerboard texture as albedo (and black metallic, half roughness, purple normal, white ao)
 	Material* CreateCustomMaterial(Shader* shader);         // these have the custom flag set (will be rendered in forward pass)
 	Material* CreatePostProcessingMaterial(Shader* shader); // these have the post-processing flag set (will be rendered after deferred/forward pass)
+
+	// the variant of shader that reads its transforms from the per-draw data of a multi draw
+	// indirect submission, or null if it has none.
+	Shader* GetMultiDrawShader(Shader* shader) const;
 private:
 	// generate all default template materials
 	void generateDefaultMaterials();
@@ -183,7 +183,7 @@ void PBR::RenderProbes()
 
 	// first render the sky capture
 	m_ProbeDebugShader->SetVector("Position", glm::vec3(0.0f, 2.0, 0.0f));
-	m_SkyCapture->Prefiltered->Bind(0);
+	m_SkyCapture->Prefiltered->Bind(m_Renderer->m_GLCache, 0);
 	m_Renderer->renderMesh(m_ProbeDebugSphere, m_ProbeDebugShader);
 
 	// then do the same for each capture probe (at their respective location)
@@ -192,11 +192,11 @@ void PBR::RenderProbes()
 		m_ProbeDebugShader->SetVector("Position", m_CaptureProbes[i]->m_position);
 		if (m_CaptureProbes[i]->Prefiltered)
 		{
-			m_CaptureProbes[i]->Prefiltered->Bind(0);
+			m_CaptureProbes[i]->Prefiltered->Bind(m_Renderer->m_GLCache, 0);
 		}
 		else
 		{
-			m_CaptureProbes[i]->Irradiance->Bind(0);
+			m_CaptureProbes[i]->Irradiance->Bind(m_Renderer->m_GLCache, 0);
 		}
 		m_Renderer->renderMesh(m_ProbeDebugSphere, m_ProbeDebugShader);
 	}
@@ -174,16 +174,16 @@ void PostProcessor::ProcessPreLighting(Renderer* renderer, RenderTarget* gBuffer
 	// ssao
 	if (SSAO)
 	{
-		gBuffer->GetColorTexture(0)->Bind(0);
-		gBuffer->GetColorTexture(1)->Bind(1);
-		m_SSAONoise->Bind(2);
+		gBuffer->GetColorTexture(0)->Bind(renderer->m_GLCache, 0);
+		gBuffer->GetColorTexture(1)->Bind(renderer->m_GLCache, 1);
+		m_SSAONoise->Bind(renderer->m_GLCache, 2);
 
 		m_SSAOShader->Use();
 		m_SSAOShader->SetVector("renderSize", renderer->GetRenderSize());
 		m_SSAOShader->SetMatrix("projection", camera->GetProjection());
 		m_SSAOShader->SetMatrix("view", camera->GetView());
 
-		glBindFramebuffer(GL_FRAMEBUFFER, m_SSAORenderTarget->ID);
+		renderer->m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_SSAORenderTarget->ID);
 		glViewport(0, 0, m_SSAORenderTarget->Width, m_SSAORenderTarget->Height);
 		glClear(GL_COLOR_BUFFER_BIT);
 		renderer->renderMesh(renderer->m_NDCPlane, m_SSAOShader);
@@ -208,9 +208,9 @@ void PostProcessor::ProcessPostLighting(Renderer* renderer, RenderTarget* gBuffe
 	if (Bloom)
 	{
 		m_BloomShader->Use();
-		output->GetColorTexture(0)->Bind(0);
+		output->GetColorTexture(0)->Bind(renderer->m_GLCache, 0);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, m_BloomRenderTarget0->ID);
+		renderer->m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_BloomRenderTarget0->ID);
 		glViewport(0, 0, m_BloomRenderTarget0->Width, m_BloomRenderTarget0->Height);
 		glClear(GL_COLOR_BUFFER_BIT);
 		renderer->renderMesh(renderer->m_NDCPlane, m_BloomShader);
@@ -225,17 +225,17 @@ void PostProcessor::ProcessPostLighting(Renderer* renderer, RenderTarget* gBuffe
 
 void PostProcessor::Blit(Renderer* renderer, Texture* source)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	renderer->m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, renderer->GetRenderSize().x, renderer->GetRenderSize().y);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
 	// bind input texture data
-	source->Bind(0);
-	BloomOutput1->Bind(1);
-	BloomOutput2->Bind(2);
-	BloomOutput3->Bind(3);
-	BloomOutput4->Bind(4);
-	renderer->m_GBuffer->GetColorTexture(3)->Bind(5);
+	source->Bind(renderer->m_GLCache, 0);
+	BloomOutput1->Bind(renderer->m_GLCache, 1);
+	BloomOutput2->Bind(renderer->m_GLCache, 2);
+	BloomOutput3->Bind(renderer->m_GLCache, 3);
+	BloomOutput4->Bind(renderer->m_GLCache, 4);
+	renderer->m_GBuffer->GetColorTexture(3)->Bind(renderer->m_GLCache, 5);
 
 	// set settings 
 	m_PostProcessShader->Use();
@@ -254,10 +254,10 @@ void PostProcessor::Blit(Renderer* renderer, Texture* source)
 Texture* PostProcessor::downsample(Renderer* renderer, Texture* src, RenderTarget* dst)
 {
 	glViewport(0, 0, dst->Width, dst->Height);
-	glBindFramebuffer(GL_FRAMEBUFFER, dst->ID);
+	renderer->m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, dst->ID);
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	src->Bind(0);
+	src->Bind(renderer->m_GLCache, 0);
 	m_DownSampleShader->Use();
 	renderer->renderMesh(renderer->m_NDCPlane, m_DownSampleShader);
 
@@ -300,17 +300,17 @@ Texture* PostProcessor::blur(Renderer* renderer, Texture* src, RenderTarget* dst
 		m_OnePassGaussianShader->SetBool("horizontal", horizontal);
 		if (i == 0)
 		{
-			src->Bind(0);
+			src->Bind(renderer->m_GLCache, 0);
 		}
 		else if (horizontal)
 		{
-			rtVertical->GetColorTexture(0)->Bind(0);
+			rtVertical->GetColorTexture(0)->Bind(renderer->m_GLCache, 0);
 		}
 		else if (!horizontal)
 		{
-			rtHorizontal->GetColorTexture(0)->Bind(0);
+			rtHorizontal->GetColorTexture(0)->Bind(renderer->m_GLCache, 0);
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, horizontal ? rtHorizontal->ID : rtVertical->ID);
+		renderer->m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, horizontal ? rtHorizontal->ID : rtVertical->ID);
 		renderer->renderMesh(renderer->m_NDCPlane, m_OnePassGaussianShader);
 	}
 
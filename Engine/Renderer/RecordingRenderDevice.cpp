@@ -0,0 +1,784 @@
+#include "RecordingRenderDevice.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	struct TypeLayout
+	{
+		const char* Name;
+		SHADER_TYPE Type;
+		unsigned int Size;		// std140 size and alignment, 0 for opaque types
+		unsigned int Alignment;
+	};
+
+	const TypeLayout s_TypeLayouts[] = {
+		{ "bool", SHADER_TYPE_BOOL, 4, 4 },
+		{ "int", SHADER_TYPE_INT, 4, 4 },
+		{ "uint", SHADER_TYPE_INT, 4, 4 },
+		{ "float", SHADER_TYPE_FLOAT, 4, 4 },
+		{ "vec2", SHADER_TYPE_VEC2, 8, 8 },
+		{ "vec3", SHADER_TYPE_VEC3, 12, 16 },
+		{ "vec4", SHADER_TYPE_VEC4, 16, 16 },
+		{ "ivec2", SHADER_TYPE_VEC2, 8, 8 },
+		{ "ivec3", SHADER_TYPE_VEC3, 12, 16 },
+		{ "ivec4", SHADER_TYPE_VEC4, 16, 16 },
+		{ "mat2", SHADER_TYPE_MAT2, 32, 16 },	// matrix columns are 16 bytes apart
+		{ "mat3", SHADER_TYPE_MAT3, 48, 16 },
+		{ "mat4", SHADER_TYPE_MAT4, 64, 16 },
+		{ "sampler1D", SHADER_TYPE_SAMPLER1D, 0, 0 },
+		{ "sampler2D", SHADER_TYPE_SAMPLER2D, 0, 0 },
+		{ "sampler2DShadow", SHADER_TYPE_SAMPLER2D, 0, 0 },
+		{ "sampler2DArray", SHADER_TYPE_SAMPLER2D, 0, 0 },
+		{ "sampler3D", SHADER_TYPE_SAMPLER3D, 0, 0 },
+		{ "samplerCube", SHADER_TYPE_SAMPLERCUBE, 0, 0 },
+	};
+
+	const TypeLayout* findTypeLayout(const std::string& name)
+	{
+		for (const TypeLayout& layout : s_TypeLayouts)
+		{
+			if (name == layout.Name)
+				return &layout;
+		}
+		return nullptr;
+	}
+
+	bool isPrecision(const std::string& token)
+	{
+		return token == "highp" || token == "mediump" || token == "lowp";
+	}
+
+	// identifiers, numbers and single punctuation characters; comments and preprocessor lines
+	// are skipped, so both branches of an #ifdef are seen.
+	std::vector<std::string> tokenize(const std::string& source)
+	{
+		std::vector<std::string> tokens;
+		size_t i = 0;
+		const size_t length = source.size();
+		while (i < length)
+		{
+			const char c = source[i];
+			if (std::isspace(static_cast<unsigned char>(c)))
+			{
+				++i;
+			}
+			else if (c == '#' || (c == '/' && i + 1 < length && source[i + 1] == '/'))
+			{
+				i = source.find('\n', i);
+				if (i == std::string::npos)
+					break;
+			}
+			else if (c == '/' && i + 1 < length && source[i + 1] == '*')
+			{
+				i = source.find("*/", i + 2);
+				if (i == std::string::npos)
+					break;
+				i += 2;
+			}
+			else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_')
+			{
+				const size_t start = i;
+				while (i < length && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_'))
+					++i;
+				tokens.push_back(source.substr(start, i - start));
+			}
+			else
+			{
+				tokens.push_back(std::string(1, c));
+				++i;
+			}
+		}
+		return tokens;
+	}
+
+	// reads "[precision] type name[N]" starting at token i and returns the index past it, or
+	// 0 if the tokens don't form a declaration.
+	size_t readDeclaration(const std::vector<std::string>& tokens, size_t i, std::string& outType, std::string& outName, int& outArraySize)
+	{
+		while (i < tokens.size() && isPrecision(tokens[i]))
+			++i;
+		if (i + 1 >= tokens.size())
+			return 0;
+		outType = tokens[i];
+		outName = tokens[i + 1];
+		outArraySize = 0;
+		i += 2;
+		if (i + 2 < tokens.size() && tokens[i] == "[" && tokens[i + 2] == "]")
+		{
+			outArraySize = std::max(std::atoi(tokens[i + 1].c_str()), 1);
+			i += 3;
+		}
+		return i;
+	}
+
+	void addUniform(std::vector<Uniform>& uniforms, SHADER_TYPE type, const std::string& name, int arraySize, unsigned int location, int blockOffset)
+	{
+		// GL lists arrays by their first element.
+		const std::string listedName = arraySize > 0 ? name + "[0]" : name;
+		for (const Uniform& uniform : uniforms)
+		{
+			// declared in both stages
+			if (uniform.Name == listedName)
+				return;
+		}
+
+		Uniform uniform;
+		uniform.Type = type;
+		uniform.Name = listedName;
+		uniform.Size = std::max(arraySize, 1);
+		uniform.Location = location;
+		uniform.BlockOffset = blockOffset;
+		uniforms.push_back(uniform);
+	}
+
+	// lists the uniforms declared in source like GL lists the active uniforms of a program.
+	void reflectUniforms(const std::string& source, const char* blockName, std::vector<Uniform>& outUniforms, unsigned int& outBlockSize)
+	{
+		const std::vector<std::string> tokens = tokenize(source);
+		unsigned int nextLocation = 0;
+		outBlockSize = 0;
+
+		int depth = 0;
+		for (size_t i = 0; i < tokens.size(); ++i)
+		{
+			if (tokens[i] == "{")
+				++depth;
+			else if (tokens[i] == "}")
+				--depth;
+			if (depth != 0 || tokens[i] != "uniform")
+				continue;
+
+			if (i + 2 < tokens.size() && tokens[i + 2] == "{")
+			{
+				// uniform block; members have no location, the reflected block's members get their std140 offset.
+				const std::string& block = tokens[i + 1];
+				const bool reflected = block == blockName;
+				unsigned int offset = 0;
+				size_t j = i + 3;
+				std::vector<Uniform> members;
+				while (j < tokens.size() && tokens[j] != "}")
+				{
+					std::string type, name;
+					int arraySize;
+					const size_t end = readDeclaration(tokens, j, type, name, arraySize);
+					if (end == 0)
+						break;
+
+					const TypeLayout* layout = findTypeLayout(type);
+					if (layout && layout->Size > 0)
+					{
+						// array elements are padded to 16 bytes
+						const unsigned int alignment = arraySize > 0 ? 16 : layout->Alignment;
+						const unsigned int size = arraySize > 0 ? (layout->Size + 15) / 16 * 16 * arraySize : layout->Size;
+						offset = (offset + alignment - 1) / alignment * alignment;
+						addUniform(members, layout->Type, name, arraySize, ~0u, reflected ? static_cast<int>(offset) : -1);
+						offset += size;
+					}
+					j = end;
+					while (j < tokens.size() && tokens[j] != ";" && tokens[j] != "}")
+						++j;
+					if (j < tokens.size() && tokens[j] == ";")
+						++j;
+				}
+
+				// members of a named block instance are listed as "Block.member".
+				const bool named = j + 2 < tokens.size() && tokens[j + 2] == ";" && tokens[j + 1] != ";";
+				for (const Uniform& member : members)
+					addUniform(outUniforms, member.Type, named ? block + "." + member.Name : member.Name, 0, member.Location, member.BlockOffset);
+				if (reflected)
+					outBlockSize = (offset + 15) / 16 * 16;
+
+				i = j;
+				continue;
+			}
+
+			// plain uniforms, possibly several per declaration.
+			size_t j = i + 1;
+			std::string type, name;
+			int arraySize;
+			size_t end = readDeclaration(tokens, j, type, name, arraySize);
+			const TypeLayout* layout = end ? findTypeLayout(type) : nullptr;
+			while (end != 0)
+			{
+				if (layout)
+				{
+					addUniform(outUniforms, layout->Type, name, arraySize, nextLocation, -1);
+					nextLocation += std::max(arraySize, 1);
+				}
+				if (end >= tokens.size() || tokens[end] != ",")
+					break;
+				// the next name of the list
+				name = end + 1 < tokens.size() ? tokens[end + 1] : std::string();
+				arraySize = 0;
+				end += 2;
+				if (end + 2 < tokens.size() && tokens[end] == "[" && tokens[end + 2] == "]")
+				{
+					arraySize = std::max(std::atoi(tokens[end + 1].c_str()), 1);
+					end += 3;
+				}
+			}
+		}
+	}
+
+	unsigned int getUniformTypeSize(SHADER_TYPE type)
+	{
+		switch (type)
+		{
+		case SHADER_TYPE_VEC2: return 8;
+		case SHADER_TYPE_VEC3: return 12;
+		case SHADER_TYPE_VEC4: return 16;
+		case SHADER_TYPE_MAT2: return 16;
+		case SHADER_TYPE_MAT3: return 36;
+		case SHADER_TYPE_MAT4: return 64;
+		default: return 4;
+		}
+	}
+
+	uint64_t getTextureBytes(int width, int height, int depth, GLenum format, GLenum type)
+	{
+		unsigned int components = 4;
+		switch (format)
+		{
+		case GL_RED:
+		case GL_DEPTH_COMPONENT:
+		case GL_DEPTH_STENCIL:
+			components = 1;
+			break;
+		case GL_RG:
+			components = 2;
+			break;
+		case GL_RGB:
+		case GL_BGR:
+			components = 3;
+			break;
+		}
+
+		unsigned int texelSize;
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+			texelSize = components;
+			break;
+		case GL_HALF_FLOAT:
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+			texelSize = components * 2;
+			break;
+		case GL_FLOAT:
+		case GL_UNSIGNED_INT:
+		case GL_INT:
+			texelSize = components * 4;
+			break;
+		default:
+			// packed formats like GL_UNSIGNED_INT_24_8
+			texelSize = 4;
+			break;
+		}
+		return static_cast<uint64_t>(std::max(width, 1)) * std::max(height, 1) * std::max(depth, 1) * texelSize;
+	}
+
+	uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+}
+
+void RecordingRenderDevice::BeginFrame()
+{
+	m_Stream.clear();
+	m_FrameStats = Stats();
+	++m_FrameCount;
+}
+
+size_t RecordingRenderDevice::ReadCommand(size_t offset, Command& outCommand) const
+{
+	const uint32_t header = m_Stream[offset];
+	outCommand.Type = static_cast<Op>(header & 0xFF);
+	outCommand.ArgumentCount = header >> 8;
+	outCommand.Arguments = m_Stream.data() + offset + 1;
+	return offset + 1 + outCommand.ArgumentCount;
+}
+
+const char* RecordingRenderDevice::GetOpName(Op op)
+{
+	switch (op)
+	{
+	case Op::Toggle: return "Toggle";
+	case Op::DepthFunc: return "DepthFunc";
+	case Op::DepthMask: return "DepthMask";
+	case Op::BlendFunc: return "BlendFunc";
+	case Op::CullFace: return "CullFace";
+	case Op::PolygonMode: return "PolygonMode";
+	case Op::Viewport: return "Viewport";
+	case Op::UseProgram: return "UseProgram";
+	case Op::ActiveTexture: return "ActiveTexture";
+	case Op::BindTexture: return "BindTexture";
+	case Op::BindSampler: return "BindSampler";
+	case Op::BindVertexArray: return "BindVertexArray";
+	case Op::BindFramebuffer: return "BindFramebuffer";
+	case Op::BindBuffer: return "BindBuffer";
+	case Op::BindBufferRange: return "BindBufferRange";
+	case Op::BindBufferBase: return "BindBufferBase";
+	case Op::SetUniform: return "SetUniform";
+	case Op::BufferData: return "BufferData";
+	case Op::BufferSubData: return "BufferSubData";
+	case Op::CopyBuffer: return "CopyBuffer";
+	case Op::TexImage: return "TexImage";
+	case Op::TexSubImage: return "TexSubImage";
+	case Op::CreateProgram: return "CreateProgram";
+	case Op::CreateBuffer: return "CreateBuffer";
+	case Op::CreateVertexArray: return "CreateVertexArray";
+	case Op::CreateTexture: return "CreateTexture";
+	case Op::CreateFramebuffer: return "CreateFramebuffer";
+	case Op::Delete: return "Delete";
+	case Op::VertexAttribute: return "VertexAttribute";
+	case Op::TexParameter: return "TexParameter";
+	case Op::GenerateMipmap: return "GenerateMipmap";
+	case Op::FramebufferTexture: return "FramebufferTexture";
+	case Op::BufferStorage: return "BufferStorage";
+	case Op::MapBuffer: return "MapBuffer";
+	case Op::UnmapBuffer: return "UnmapBuffer";
+	case Op::CreateFence: return "CreateFence";
+	case Op::WaitFence: return "WaitFence";
+	case Op::ClearColor: return "ClearColor";
+	case Op::Clear: return "Clear";
+	case Op::Draw: return "Draw";
+	case Op::MultiDraw: return "MultiDraw";
+	default: return "Unknown";
+	}
+}
+
+void RecordingRenderDevice::Dump(FILE* file) const
+{
+	Command command;
+	for (size_t offset = 0; offset < m_Stream.size(); )
+	{
+		offset = ReadCommand(offset, command);
+		std::fprintf(file, "%s", GetOpName(command.Type));
+		for (unsigned int i = 0; i < command.ArgumentCount; ++i)
+			std::fprintf(file, " %u", command.Arguments[i]);
+		std::fprintf(file, "\n");
+	}
+}
+
+// state
+
+void RecordingRenderDevice::Toggle(GLenum state, bool enable)
+{
+	auto it = std::find(m_EnabledStates.begin(), m_EnabledStates.end(), state);
+	if (enable && it == m_EnabledStates.end())
+		m_EnabledStates.push_back(state);
+	else if (!enable && it != m_EnabledStates.end())
+		m_EnabledStates.erase(it);
+	record(Op::Toggle, { state, enable });
+}
+
+void RecordingRenderDevice::DepthFunc(GLenum func) { record(Op::DepthFunc, { func }); }
+void RecordingRenderDevice::DepthMask(bool write) { record(Op::DepthMask, { write }); }
+void RecordingRenderDevice::BlendFunc(GLenum src, GLenum dst) { record(Op::BlendFunc, { src, dst }); }
+void RecordingRenderDevice::CullFace(GLenum face) { record(Op::CullFace, { face }); }
+void RecordingRenderDevice::PolygonMode(GLenum mode) { record(Op::PolygonMode, { mode }); }
+
+void RecordingRenderDevice::Viewport(int x, int y, int width, int height)
+{
+	record(Op::Viewport, { static_cast<uint32_t>(x), static_cast<uint32_t>(y), static_cast<uint32_t>(width), static_cast<uint32_t>(height) });
+}
+
+int RecordingRenderDevice::GetInteger(GLenum name)
+{
+	// the largest alignment GL allows, so layouts fit any driver.
+	if (name == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT || name == GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT)
+		return 256;
+	return 0;
+}
+
+bool RecordingRenderDevice::IsEnabled(GLenum state)
+{
+	return std::find(m_EnabledStates.begin(), m_EnabledStates.end(), state) != m_EnabledStates.end();
+}
+
+// binds
+
+void RecordingRenderDevice::UseProgram(unsigned int program) { record(Op::UseProgram, { program }); }
+void RecordingRenderDevice::ActiveTexture(unsigned int unit) { record(Op::ActiveTexture, { unit }); }
+void RecordingRenderDevice::BindTexture(GLenum target, unsigned int texture) { record(Op::BindTexture, { target, texture }); }
+void RecordingRenderDevice::BindSampler(unsigned int unit, unsigned int sampler) { record(Op::BindSampler, { unit, sampler }); }
+void RecordingRenderDevice::BindVertexArray(unsigned int vertexArray) { record(Op::BindVertexArray, { vertexArray }); }
+void RecordingRenderDevice::BindFramebuffer(GLenum target, unsigned int framebuffer) { record(Op::BindFramebuffer, { target, framebuffer }); }
+void RecordingRenderDevice::BindBuffer(GLenum target, unsigned int buffer)
+{
+	auto it = std::find_if(m_BoundBuffers.begin(), m_BoundBuffers.end(), [target](const std::pair<GLenum, unsigned int>& binding) { return binding.first == target; });
+	if (it != m_BoundBuffers.end())
+		it->second = buffer;
+	else
+		m_BoundBuffers.emplace_back(target, buffer);
+	record(Op::BindBuffer, { target, buffer });
+}
+
+void RecordingRenderDevice::BindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size)
+{
+	record(Op::BindBufferRange, { target, index, buffer, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) });
+}
+
+void RecordingRenderDevice::BindBufferBase(GLenum target, unsigned int index, unsigned int buffer)
+{
+	record(Op::BindBufferBase, { target, index, buffer });
+}
+
+// programs
+
+unsigned int RecordingRenderDevice::CreateProgram(const std::string& name, const std::vector<const char*>& vsSources, const std::vector<const char*>& fsSources)
+{
+	Program program;
+	program.ID = m_NextName++;
+	for (const char* source : vsSources)
+		program.Source += source;
+	program.Source += "\n";
+	for (const char* source : fsSources)
+		program.Source += source;
+	m_Programs.push_back(program);
+
+	record(Op::CreateProgram, { program.ID, static_cast<uint32_t>(program.Source.size()) });
+	return program.ID;
+}
+
+void RecordingRenderDevice::DeleteProgram(unsigned int program)
+{
+	m_Programs.erase(std::remove_if(m_Programs.begin(), m_Programs.end(), [program](const Program& p) { return p.ID == program; }), m_Programs.end());
+	record(Op::Delete, { program });
+}
+
+void RecordingRenderDevice::GetProgramInfo(unsigned int program, const char* blockName, unsigned int blockBinding, ProgramInfo& outInfo)
+{
+	outInfo.Uniforms.clear();
+	outInfo.Attributes.clear();
+	outInfo.BlockSize = 0;
+	if (const Program* found = findProgram(program))
+		reflectUniforms(found->Source, blockName, outInfo.Uniforms, outInfo.BlockSize);
+}
+
+int RecordingRenderDevice::GetUniformLocation(unsigned int program, const char* name)
+{
+	const Program* found = findProgram(program);
+	if (!found)
+		return -1;
+
+	std::vector<Uniform> uniforms;
+	unsigned int blockSize;
+	reflectUniforms(found->Source, "", uniforms, blockSize);
+	const std::string arrayName = std::string(name) + "[0]";
+	for (const Uniform& uniform : uniforms)
+	{
+		if (uniform.Name == name || uniform.Name == arrayName)
+			return static_cast<int>(uniform.Location);
+	}
+	return -1;
+}
+
+void RecordingRenderDevice::SetUniform(int location, SHADER_TYPE type, int count, const void* values)
+{
+	const uint32_t size = getUniformTypeSize(type) * count;
+	record(Op::SetUniform, { static_cast<uint32_t>(location), static_cast<uint32_t>(type), static_cast<uint32_t>(count), size });
+	for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+	{
+		++stats->UniformUploads;
+		stats->UniformBytes += size;
+	}
+}
+
+// buffers
+
+unsigned int RecordingRenderDevice::CreateBuffer()
+{
+	const unsigned int buffer = m_NextName++;
+	record(Op::CreateBuffer, { buffer });
+	return buffer;
+}
+
+void RecordingRenderDevice::DeleteBuffer(unsigned int buffer)
+{
+	m_MappedMemory.erase(buffer);
+	record(Op::Delete, { buffer });
+}
+
+void RecordingRenderDevice::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	record(Op::BufferData, { target, static_cast<uint32_t>(size), usage, data != nullptr });
+	// allocations without data upload nothing
+	if (data)
+	{
+		for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+		{
+			++stats->BufferUploads;
+			stats->BufferBytes += size;
+		}
+	}
+}
+
+void RecordingRenderDevice::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	record(Op::BufferSubData, { target, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) });
+	for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+	{
+		++stats->BufferUploads;
+		stats->BufferBytes += size;
+	}
+}
+
+void RecordingRenderDevice::CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+	// a copy on the GPU, nothing is uploaded.
+	record(Op::CopyBuffer, { readTarget, writeTarget, static_cast<uint32_t>(readOffset), static_cast<uint32_t>(writeOffset), static_cast<uint32_t>(size) });
+}
+
+void RecordingRenderDevice::BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+	record(Op::BufferStorage, { target, static_cast<uint32_t>(size), flags, data != nullptr });
+	if (data)
+	{
+		for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+		{
+			++stats->BufferUploads;
+			stats->BufferBytes += size;
+		}
+	}
+}
+
+void* RecordingRenderDevice::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access)
+{
+	const unsigned int buffer = getBoundBuffer(target);
+	record(Op::MapBuffer, { target, buffer, static_cast<uint32_t>(offset), static_cast<uint32_t>(size), access });
+
+	std::vector<uint8_t>& memory = m_MappedMemory[buffer];
+	if (memory.size() < static_cast<size_t>(offset + size))
+		memory.resize(offset + size);
+	return memory.data() + offset;
+}
+
+void RecordingRenderDevice::UnmapBuffer(GLenum target) { record(Op::UnmapBuffer, { target }); }
+
+// fences
+
+GLsync RecordingRenderDevice::CreateFence()
+{
+	const unsigned int fence = m_NextName++;
+	record(Op::CreateFence, { fence });
+	return reinterpret_cast<GLsync>(static_cast<uintptr_t>(fence));
+}
+
+RenderDevice::FenceStatus RecordingRenderDevice::WaitFence(GLsync fence, uint64_t timeout)
+{
+	record(Op::WaitFence, { static_cast<uint32_t>(reinterpret_cast<uintptr_t>(fence)) });
+	return FenceStatus::Signaled;
+}
+
+void RecordingRenderDevice::DeleteFence(GLsync fence) { record(Op::Delete, { static_cast<uint32_t>(reinterpret_cast<uintptr_t>(fence)) }); }
+
+// vertex arrays
+
+unsigned int RecordingRenderDevice::CreateVertexArray()
+{
+	const unsigned int vertexArray = m_NextName++;
+	record(Op::CreateVertexArray, { vertexArray });
+	return vertexArray;
+}
+
+void RecordingRenderDevice::DeleteVertexArray(unsigned int vertexArray) { record(Op::Delete, { vertexArray }); }
+
+void RecordingRenderDevice::EnableVertexAttribute(unsigned int index, int components, GLenum type, bool normalized, int stride, size_t offset)
+{
+	record(Op::VertexAttribute, { index, static_cast<uint32_t>(components), type, normalized, static_cast<uint32_t>(stride), static_cast<uint32_t>(offset) });
+}
+
+void RecordingRenderDevice::EnableIntegerVertexAttribute(unsigned int index, int components, GLenum type, int stride, size_t offset)
+{
+	record(Op::VertexAttribute, { index, static_cast<uint32_t>(components), type, static_cast<uint32_t>(stride), static_cast<uint32_t>(offset) });
+}
+
+void RecordingRenderDevice::DisableVertexAttribute(unsigned int index) { record(Op::VertexAttribute, { index }); }
+void RecordingRenderDevice::VertexAttribDivisor(unsigned int index, unsigned int divisor) { record(Op::VertexAttribute, { index, divisor }); }
+
+// textures
+
+unsigned int RecordingRenderDevice::CreateTexture()
+{
+	const unsigned int texture = m_NextName++;
+	record(Op::CreateTexture, { texture });
+	return texture;
+}
+
+void RecordingRenderDevice::DeleteTexture(unsigned int texture) { record(Op::Delete, { texture }); }
+
+void RecordingRenderDevice::TexImage(GLenum target, int level, GLenum internalFormat, int width, int height, int depth, GLenum format, GLenum type, const void* data)
+{
+	const uint64_t size = data ? getTextureBytes(width, height, depth, format, type) : 0;
+	record(Op::TexImage, { target, static_cast<uint32_t>(level), internalFormat, static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(depth), static_cast<uint32_t>(size) });
+	if (data)
+	{
+		for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+		{
+			++stats->TextureUploads;
+			stats->TextureBytes += size;
+		}
+	}
+}
+
+void RecordingRenderDevice::TexSubImage2D(GLenum target, int level, int width, int height, GLenum format, GLenum type, const void* data)
+{
+	const uint64_t size = getTextureBytes(width, height, 1, format, type);
+	record(Op::TexSubImage, { target, static_cast<uint32_t>(level), static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(size) });
+	for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+	{
+		++stats->TextureUploads;
+		stats->TextureBytes += size;
+	}
+}
+
+void RecordingRenderDevice::TexParameter(GLenum target, GLenum name, GLint value) { record(Op::TexParameter, { target, name, static_cast<uint32_t>(value) }); }
+void RecordingRenderDevice::TexParameter(GLenum target, GLenum name, const float* values) { record(Op::TexParameter, { target, name, floatBits(values[0]) }); }
+void RecordingRenderDevice::GenerateMipmap(GLenum target) { record(Op::GenerateMipmap, { target }); }
+
+// framebuffers
+
+unsigned int RecordingRenderDevice::CreateFramebuffer()
+{
+	const unsigned int framebuffer = m_NextName++;
+	record(Op::CreateFramebuffer, { framebuffer });
+	return framebuffer;
+}
+
+void RecordingRenderDevice::DeleteFramebuffer(unsigned int framebuffer) { record(Op::Delete, { framebuffer }); }
+
+void RecordingRenderDevice::FramebufferTexture2D(GLenum attachment, GLenum textureTarget, unsigned int texture, int level)
+{
+	record(Op::FramebufferTexture, { attachment, textureTarget, texture, static_cast<uint32_t>(level) });
+}
+
+// drawing
+
+void RecordingRenderDevice::ClearColor(float r, float g, float b, float a) { record(Op::ClearColor, { floatBits(r), floatBits(g), floatBits(b), floatBits(a) }); }
+void RecordingRenderDevice::Clear(GLbitfield mask) { record(Op::Clear, { mask }); }
+
+void RecordingRenderDevice::DrawArrays(GLenum mode, int first, int count)
+{
+	record(Op::Draw, { mode, static_cast<uint32_t>(first), static_cast<uint32_t>(count), 1, 0 });
+	countDraw(count, 1);
+}
+
+void RecordingRenderDevice::DrawElements(GLenum mode, int count, GLenum type, size_t offset)
+{
+	record(Op::Draw, { mode, static_cast<uint32_t>(offset), static_cast<uint32_t>(count), 1, type });
+	countDraw(count, 1);
+}
+
+void RecordingRenderDevice::DrawArraysInstanced(GLenum mode, int first, int count, int instanceCount)
+{
+	record(Op::Draw, { mode, static_cast<uint32_t>(first), static_cast<uint32_t>(count), static_cast<uint32_t>(instanceCount), 0 });
+	countDraw(count, instanceCount);
+}
+
+void RecordingRenderDevice::DrawElementsInstanced(GLenum mode, int count, GLenum type, size_t offset, int instanceCount)
+{
+	record(Op::Draw, { mode, static_cast<uint32_t>(offset), static_cast<uint32_t>(count), static_cast<uint32_t>(instanceCount), type });
+	countDraw(count, instanceCount);
+}
+
+void RecordingRenderDevice::DrawElementsBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int baseVertex)
+{
+	record(Op::Draw, { mode, static_cast<uint32_t>(offset), static_cast<uint32_t>(count), 1, type, static_cast<uint32_t>(baseVertex) });
+	countDraw(count, 1);
+}
+
+void RecordingRenderDevice::DrawElementsInstancedBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int instanceCount, int baseVertex)
+{
+	record(Op::Draw, { mode, static_cast<uint32_t>(offset), static_cast<uint32_t>(count), static_cast<uint32_t>(instanceCount), type, static_cast<uint32_t>(baseVertex) });
+	countDraw(count, instanceCount);
+}
+
+void RecordingRenderDevice::MultiDrawElementsIndirect(GLenum mode, GLenum type, size_t offset, int drawCount, int stride)
+{
+	const unsigned int buffer = getBoundBuffer(GL_DRAW_INDIRECT_BUFFER);
+	record(Op::MultiDraw, { mode, buffer, static_cast<uint32_t>(offset), static_cast<uint32_t>(drawCount), static_cast<uint32_t>(stride), type });
+
+	// count, instance count, first index, base vertex and base instance per command.
+	uint64_t instances = 0;
+	uint64_t vertices = 0;
+	auto memory = m_MappedMemory.find(buffer);
+	if (memory != m_MappedMemory.end())
+	{
+		const size_t commandSize = 5 * sizeof(uint32_t);
+		const size_t commandStride = stride > 0 ? stride : commandSize;
+		for (int i = 0; i < drawCount && offset + i * commandStride + commandSize <= memory->second.size(); ++i)
+		{
+			uint32_t command[5];
+			std::memcpy(command, memory->second.data() + offset + i * commandStride, commandSize);
+			instances += command[1];
+			vertices += static_cast<uint64_t>(command[0]) * command[1];
+		}
+	}
+
+	for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+	{
+		++stats->DrawCalls;
+		stats->Instances += instances;
+		stats->Vertices += vertices;
+	}
+}
+
+void RecordingRenderDevice::record(Op op, std::initializer_list<uint32_t> arguments)
+{
+	const int opIndex = static_cast<int>(op);
+	const bool stateChange = op <= Op::Viewport || op == Op::ClearColor;
+	const bool bind = op >= Op::UseProgram && op <= Op::BindBufferBase;
+	for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+	{
+		++stats->Commands;
+		++stats->OpCounts[opIndex];
+		stats->StateChanges += stateChange;
+		stats->Binds += bind;
+		stats->Clears += op == Op::Clear;
+	}
+
+	if (m_RecordStream)
+	{
+		m_Stream.push_back(static_cast<uint32_t>(opIndex) | static_cast<uint32_t>(arguments.size()) << 8);
+		m_Stream.insert(m_Stream.end(), arguments.begin(), arguments.end());
+	}
+}
+
+void RecordingRenderDevice::countDraw(int count, int instanceCount)
+{
+	for (Stats* stats : { &m_FrameStats, &m_TotalStats })
+	{
+		++stats->DrawCalls;
+		stats->Instances += instanceCount;
+		stats->Vertices += static_cast<uint64_t>(count) * instanceCount;
+	}
+}
+
+unsigned int RecordingRenderDevice::getBoundBuffer(GLenum target) const
+{
+	for (const std::pair<GLenum, unsigned int>& binding : m_BoundBuffers)
+	{
+		if (binding.first == target)
+			return binding.second;
+	}
+	return 0;
+}
+
+const RecordingRenderDevice::Program* RecordingRenderDevice::findProgram(unsigned int program) const
+{
+	for (const Program& p : m_Programs)
+	{
+		if (p.ID == program)
+			return &p;
+	}
+	return nullptr;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "RenderDevice.h"
+
+/*
+
+  Render device that doesn't render: every call is appended to an in-memory command stream and
+  counted, so the CPU side of a frame runs and can be measured on machines without a GPU.
+
+  The stream holds one header word per command (opcode in the low byte, argument count above)
+  followed by its arguments; uploads record their target, offset and byte count but not the
+  data. Object names are handed out from counters. Programs are reflected from their GLSL
+  source: uniforms declared outside of blocks get consecutive locations, members of the
+  reflected block get their std140 offsets, which is what GL reports for the shaders here.
+  Attributes aren't reflected. Mapped buffers are backed by host memory, so writes through
+  them work but aren't seen as uploads; fences are always signaled. A multi draw counts as one
+  draw call, its instances and indices are counted when the indirect commands were written
+  through a mapping.
+
+*/
+class RecordingRenderDevice
+	: public RenderDevice
+{
+public:
+	enum class Op : uint8_t
+	{
+		// state
+		Toggle,
+		DepthFunc,
+		DepthMask,
+		BlendFunc,
+		CullFace,
+		PolygonMode,
+		Viewport,
+		// binds
+		UseProgram,
+		ActiveTexture,
+		BindTexture,
+		BindSampler,
+		BindVertexArray,
+		BindFramebuffer,
+		BindBuffer,
+		BindBufferRange,
+		BindBufferBase,
+		// uploads
+		SetUniform,
+		BufferData,
+		BufferSubData,
+		CopyBuffer,
+		TexImage,
+		TexSubImage,
+		// resources
+		CreateProgram,
+		CreateBuffer,
+		CreateVertexArray,
+		CreateTexture,
+		CreateFramebuffer,
+		Delete,
+		VertexAttribute,
+		TexParameter,
+		GenerateMipmap,
+		FramebufferTexture,
+		BufferStorage,
+		MapBuffer,
+		UnmapBuffer,
+		// sync
+		CreateFence,
+		WaitFence,
+		// drawing
+		ClearColor,
+		Clear,
+		Draw,
+		MultiDraw,
+
+		Count
+	};
+
+	struct Stats
+	{
+		unsigned int Commands = 0;
+		unsigned int DrawCalls = 0;
+		uint64_t     Instances = 0;		// 1 per draw without instancing
+		uint64_t     Vertices = 0;		// vertices or indices over all instances
+		unsigned int StateChanges = 0;	// toggles, depth, blend, cull and polygon state, viewports
+		unsigned int Binds = 0;			// programs, textures, samplers, vertex arrays, framebuffers, buffers
+		unsigned int UniformUploads = 0;
+		uint64_t     UniformBytes = 0;
+		unsigned int BufferUploads = 0;
+		uint64_t     BufferBytes = 0;
+		unsigned int TextureUploads = 0;
+		uint64_t     TextureBytes = 0;
+		unsigned int Clears = 0;
+		unsigned int OpCounts[static_cast<int>(Op::Count)] = {};
+	};
+
+	// a decoded command of the stream.
+	struct Command
+	{
+		Op              Type;
+		unsigned int    ArgumentCount;
+		const uint32_t* Arguments;
+	};
+
+public:
+	RecordingRenderDevice() = default;
+
+	// starts a new frame: clears the stream and the frame's stats.
+	void BeginFrame();
+	// with recording off only the stats are kept; on by default.
+	void SetRecordStream(bool record) { m_RecordStream = record; }
+	// whether the device reports buffer storage support; on by default.
+	void SetBufferStorage(bool supported) { m_BufferStorage = supported; }
+
+	const Stats& GetFrameStats() const { return m_FrameStats; }
+	const Stats& GetTotalStats() const { return m_TotalStats; }
+	unsigned int GetFrameCount() const { return m_FrameCount; }
+
+	// the commands since the last BeginFrame().
+	const std::vector<uint32_t>& GetStream() const { return m_Stream; }
+	// decodes the command starting at word offset; returns the offset of the next command.
+	size_t ReadCommand(size_t offset, Command& outCommand) const;
+	static const char* GetOpName(Op op);
+	// writes the stream one command per line.
+	void Dump(FILE* file) const;
+
+	// RenderDevice
+	void Toggle(GLenum state, bool enable) override;
+	void DepthFunc(GLenum func) override;
+	void DepthMask(bool write) override;
+	void BlendFunc(GLenum src, GLenum dst) override;
+	void CullFace(GLenum face) override;
+	void PolygonMode(GLenum mode) override;
+	void UseProgram(unsigned int program) override;
+	void ActiveTexture(unsigned int unit) override;
+	void BindTexture(GLenum target, unsigned int texture) override;
+	void BindSampler(unsigned int unit, unsigned int sampler) override;
+	void BindVertexArray(unsigned int vertexArray) override;
+	void BindFramebuffer(GLenum target, unsigned int framebuffer) override;
+	void BindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size) override;
+	void BindBufferBase(GLenum target, unsigned int index, unsigned int buffer) override;
+	void Viewport(int x, int y, int width, int height) override;
+
+	int GetInteger(GLenum name) override;
+	bool IsEnabled(GLenum state) override;
+
+	unsigned int CreateProgram(const std::string& name, const std::vector<const char*>& vsSources, const std::vector<const char*>& fsSources) override;
+	void DeleteProgram(unsigned int program) override;
+	void GetProgramInfo(unsigned int program, const char* blockName, unsigned int blockBinding, ProgramInfo& outInfo) override;
+	int GetUniformLocation(unsigned int program, const char* name) override;
+	void SetUniform(int location, SHADER_TYPE type, int count, const void* values) override;
+
+	unsigned int CreateBuffer() override;
+	void DeleteBuffer(unsigned int buffer) override;
+	void BindBuffer(GLenum target, unsigned int buffer) override;
+	void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+	void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+	void CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) override;
+	bool SupportsBufferStorage() override { return m_BufferStorage; }
+	void BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) override;
+	void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access) override;
+	void UnmapBuffer(GLenum target) override;
+
+	GLsync CreateFence() override;
+	FenceStatus WaitFence(GLsync fence, uint64_t timeout) override;
+	void DeleteFence(GLsync fence) override;
+
+	unsigned int CreateVertexArray() override;
+	void DeleteVertexArray(unsigned int vertexArray) override;
+	void EnableVertexAttribute(unsigned int index, int components, GLenum type, bool normalized, int stride, size_t offset) override;
+	void EnableIntegerVertexAttribute(unsigned int index, int components, GLenum type, int stride, size_t offset) override;
+	void DisableVertexAttribute(unsigned int index) override;
+	void VertexAttribDivisor(unsigned int index, unsigned int divisor) override;
+
+	unsigned int CreateTexture() override;
+	void DeleteTexture(unsigned int texture) override;
+	void TexImage(GLenum target, int level, GLenum internalFormat, int width, int height, int depth, GLenum format, GLenum type, const void* data) override;
+	void TexSubImage2D(GLenum target, int level, int width, int height, GLenum format, GLenum type, const void* data) override;
+	void TexParameter(GLenum target, GLenum name, GLint value) override;
+	void TexParameter(GLenum target, GLenum name, const float* values) override;
+	void GenerateMipmap(GLenum target) override;
+
+	unsigned int CreateFramebuffer() override;
+	void DeleteFramebuffer(unsigned int framebuffer) override;
+	void FramebufferTexture2D(GLenum attachment, GLenum textureTarget, unsigned int texture, int level) override;
+	bool IsFramebufferComplete() override { return true; }
+
+	void ClearColor(float r, float g, float b, float a) override;
+	void Clear(GLbitfield mask) override;
+	void DrawArrays(GLenum mode, int first, int count) override;
+	void DrawElements(GLenum mode, int count, GLenum type, size_t offset) override;
+	void DrawArraysInstanced(GLenum mode, int first, int count, int instanceCount) override;
+	void DrawElementsInstanced(GLenum mode, int count, GLenum type, size_t offset, int instanceCount) override;
+	void DrawElementsBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int baseVertex) override;
+	void DrawElementsInstancedBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int instanceCount, int baseVertex) override;
+	bool SupportsMultiDrawIndirect() override { return true; }
+	void MultiDrawElementsIndirect(GLenum mode, GLenum type, size_t offset, int drawCount, int stride) override;
+
+private:
+	struct Program
+	{
+		unsigned int ID;
+		std::string  Source;	// vertex and fragment source, concatenated
+	};
+
+	// appends a command, counting it in the stats.
+	void record(Op op, std::initializer_list<uint32_t> arguments);
+	void countDraw(int count, int instanceCount);
+	const Program* findProgram(unsigned int program) const;
+	unsigned int getBoundBuffer(GLenum target) const;
+
+private:
+	std::vector<uint32_t> m_Stream;
+	bool m_RecordStream = true;
+
+	Stats m_FrameStats;
+	Stats m_TotalStats;
+	unsigned int m_FrameCount = 0;
+
+	std::vector<Program> m_Programs;
+	unsigned int m_NextName = 1;
+	// toggles that were enabled, for IsEnabled()
+	std::vector<GLenum> m_EnabledStates;
+
+	// buffer bindings, and host memory standing in for mapped buffers; allocated on first map.
+	std::vector<std::pair<GLenum, unsigned int>> m_BoundBuffers;
+	std::unordered_map<unsigned int, std::vector<uint8_t>> m_MappedMemory;
+	bool m_BufferStorage = true;
+};
@@ -2,9 +2,20 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+
 class Mesh;
 class Material;
 
+// queue a render command is pushed to, stored in the top bits of its sort key.
+enum RenderQueue
+{
+	RENDER_QUEUE_DEFERRED,
+	RENDER_QUEUE_CUSTOM,
+	RENDER_QUEUE_ALPHA,
+	RENDER_QUEUE_POST_PROCESS,
+};
+
 struct RenderCommand
 {
 	glm::mat4 Transform;
@@ -16,6 +27,7 @@ struct RenderCommand
 
 	Material* Material;
 	Mesh* Mesh;
-};
-
 
+	// packed state and depth sort key, built by the command buffer on push; see CommandBuffer::Sort().
+	uint64_t SortKey;
+};
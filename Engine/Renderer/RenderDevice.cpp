@@ -0,0 +1,279 @@
+#include "RenderDevice.h"
+
+#include "Utils/Logger.h"
+
+namespace
+{
+	class GLRenderDevice
+		: public RenderDevice
+	{
+	public:
+		// state
+		void Toggle(GLenum state, bool enable) override
+		{
+			if (enable)
+				glEnable(state);
+			else
+				glDisable(state);
+		}
+		void DepthFunc(GLenum func) override { glDepthFunc(func); }
+		void DepthMask(bool write) override { glDepthMask(write ? GL_TRUE : GL_FALSE); }
+		void BlendFunc(GLenum src, GLenum dst) override { glBlendFunc(src, dst); }
+		void CullFace(GLenum face) override { glCullFace(face); }
+		void PolygonMode(GLenum mode) override { glPolygonMode(GL_FRONT_AND_BACK, mode); }
+		void UseProgram(unsigned int program) override { glUseProgram(program); }
+		void ActiveTexture(unsigned int unit) override { glActiveTexture(GL_TEXTURE0 + unit); }
+		void BindTexture(GLenum target, unsigned int texture) override { glBindTexture(target, texture); }
+		void BindSampler(unsigned int unit, unsigned int sampler) override { glBindSampler(unit, sampler); }
+		void BindVertexArray(unsigned int vertexArray) override { glBindVertexArray(vertexArray); }
+		void BindFramebuffer(GLenum target, unsigned int framebuffer) override { glBindFramebuffer(target, framebuffer); }
+		void BindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size) override { glBindBufferRange(target, index, buffer, offset, size); }
+		void BindBufferBase(GLenum target, unsigned int index, unsigned int buffer) override { glBindBufferBase(target, index, buffer); }
+		void Viewport(int x, int y, int width, int height) override { glViewport(x, y, width, height); }
+
+		int GetInteger(GLenum name) override
+		{
+			int value = 0;
+			glGetIntegerv(name, &value);
+			return value;
+		}
+		bool IsEnabled(GLenum state) override { return glIsEnabled(state) == GL_TRUE; }
+
+		// programs
+		unsigned int CreateProgram(const std::string& name, const std::vector<const char*>& vsSources, const std::vector<const char*>& fsSources) override
+		{
+			unsigned int vs = compileShader(name, GL_VERTEX_SHADER, vsSources);
+			unsigned int fs = compileShader(name, GL_FRAGMENT_SHADER, fsSources);
+
+			unsigned int program = glCreateProgram();
+			glAttachShader(program, vs);
+			glAttachShader(program, fs);
+			glLinkProgram(program);
+
+			int status;
+			glGetProgramiv(program, GL_LINK_STATUS, &status);
+			if (!status)
+			{
+				char log[1024];
+				glGetProgramInfoLog(program, 1024, NULL, log);
+				LOG_ERROR("Shader program linking error: \n %s", + std::string(log).c_str());
+			}
+
+			glDeleteShader(vs);
+			glDeleteShader(fs);
+			return program;
+		}
+
+		void DeleteProgram(unsigned int program) override { glDeleteProgram(program); }
+
+		void GetProgramInfo(unsigned int program, const char* blockName, unsigned int blockBinding, ProgramInfo& outInfo) override
+		{
+			// query the number of active uniforms and attributes
+			int nrAttributes, nrUniforms;
+			glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &nrAttributes);
+			glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &nrUniforms);
+			outInfo.Attributes.resize(nrAttributes);
+			outInfo.Uniforms.resize(nrUniforms);
+			outInfo.BlockSize = 0;
+
+			// iterate over all active attributes
+			char buffer[128];
+			for (unsigned int i = 0; i < nrAttributes; ++i)
+			{
+				GLenum glType;
+				glGetActiveAttrib(program, i, sizeof(buffer), 0, &outInfo.Attributes[i].Size, &glType, buffer);
+				outInfo.Attributes[i].Name = std::string(buffer);
+				outInfo.Attributes[i].Type = SHADER_TYPE_BOOL;
+
+				outInfo.Attributes[i].Location = glGetAttribLocation(program, buffer);
+			}
+
+			// iterate over all active uniforms
+			for (unsigned int i = 0; i < nrUniforms; ++i)
+			{
+				GLenum glType;
+				glGetActiveUniform(program, i, sizeof(buffer), 0, &outInfo.Uniforms[i].Size, &glType, buffer);
+				outInfo.Uniforms[i].Name = std::string(buffer);
+				outInfo.Uniforms[i].Type = SHADER_TYPE_BOOL;
+
+				outInfo.Uniforms[i].Location = glGetUniformLocation(program, buffer);
+				outInfo.Uniforms[i].BlockOffset = -1;
+			}
+
+			const unsigned int block = glGetUniformBlockIndex(program, blockName);
+			if (block != GL_INVALID_INDEX)
+			{
+				int blockSize;
+				glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+				glUniformBlockBinding(program, block, blockBinding);
+				outInfo.BlockSize = blockSize;
+
+				for (unsigned int i = 0; i < nrUniforms; ++i)
+				{
+					int blockIndex, offset;
+					glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+					glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_OFFSET, &offset);
+					if (blockIndex == static_cast<int>(block))
+						outInfo.Uniforms[i].BlockOffset = offset;
+				}
+			}
+		}
+
+		int GetUniformLocation(unsigned int program, const char* name) override { return glGetUniformLocation(program, name); }
+
+		void SetUniform(int location, SHADER_TYPE type, int count, const void* values) override
+		{
+			const float* floats = static_cast<const float*>(values);
+			switch (type)
+			{
+			case SHADER_TYPE_BOOL:
+			case SHADER_TYPE_INT:
+			case SHADER_TYPE_SAMPLER1D:
+			case SHADER_TYPE_SAMPLER2D:
+			case SHADER_TYPE_SAMPLER3D:
+			case SHADER_TYPE_SAMPLERCUBE:
+				glUniform1iv(location, count, static_cast<const int*>(values));
+				break;
+			case SHADER_TYPE_FLOAT: glUniform1fv(location, count, floats); break;
+			case SHADER_TYPE_VEC2: glUniform2fv(location, count, floats); break;
+			case SHADER_TYPE_VEC3: glUniform3fv(location, count, floats); break;
+			case SHADER_TYPE_VEC4: glUniform4fv(location, count, floats); break;
+			case SHADER_TYPE_MAT2: glUniformMatrix2fv(location, count, GL_FALSE, floats); break;
+			case SHADER_TYPE_MAT3: glUniformMatrix3fv(location, count, GL_FALSE, floats); break;
+			case SHADER_TYPE_MAT4: glUniformMatrix4fv(location, count, GL_FALSE, floats); break;
+			}
+		}
+
+		// buffers
+		unsigned int CreateBuffer() override
+		{
+			unsigned int buffer;
+			glGenBuffers(1, &buffer);
+			return buffer;
+		}
+		void DeleteBuffer(unsigned int buffer) override { glDeleteBuffers(1, &buffer); }
+		void BindBuffer(GLenum target, unsigned int buffer) override { glBindBuffer(target, buffer); }
+		void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override { glBufferData(target, size, data, usage); }
+		void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override { glBufferSubData(target, offset, size, data); }
+		void CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) override { glCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size); }
+		bool SupportsBufferStorage() override { return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage; }
+		void BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) override { glBufferStorage(target, size, data, flags); }
+		void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access) override { return glMapBufferRange(target, offset, size, access); }
+		void UnmapBuffer(GLenum target) override { glUnmapBuffer(target); }
+
+		// fences
+		GLsync CreateFence() override { return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
+		FenceStatus WaitFence(GLsync fence, uint64_t timeout) override
+		{
+			switch (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout))
+			{
+			case GL_ALREADY_SIGNALED:
+			case GL_CONDITION_SATISFIED:
+				return FenceStatus::Signaled;
+			case GL_TIMEOUT_EXPIRED:
+				return FenceStatus::TimedOut;
+			default:
+				return FenceStatus::Failed;
+			}
+		}
+		void DeleteFence(GLsync fence) override { glDeleteSync(fence); }
+
+		// vertex arrays
+		unsigned int CreateVertexArray() override
+		{
+			unsigned int vertexArray;
+			glGenVertexArrays(1, &vertexArray);
+			return vertexArray;
+		}
+		void DeleteVertexArray(unsigned int vertexArray) override { glDeleteVertexArrays(1, &vertexArray); }
+		void EnableVertexAttribute(unsigned int index, int components, GLenum type, bool normalized, int stride, size_t offset) override
+		{
+			glEnableVertexAttribArray(index);
+			glVertexAttribPointer(index, components, type, normalized ? GL_TRUE : GL_FALSE, stride, (GLvoid*)offset);
+		}
+		void EnableIntegerVertexAttribute(unsigned int index, int components, GLenum type, int stride, size_t offset) override
+		{
+			glEnableVertexAttribArray(index);
+			glVertexAttribIPointer(index, components, type, stride, (GLvoid*)offset);
+		}
+		void DisableVertexAttribute(unsigned int index) override { glDisableVertexAttribArray(index); }
+		void VertexAttribDivisor(unsigned int index, unsigned int divisor) override { glVertexAttribDivisor(index, divisor); }
+
+		// textures
+		unsigned int CreateTexture() override
+		{
+			unsigned int texture;
+			glGenTextures(1, &texture);
+			return texture;
+		}
+		void DeleteTexture(unsigned int texture) override { glDeleteTextures(1, &texture); }
+		void TexImage(GLenum target, int level, GLenum internalFormat, int width, int height, int depth, GLenum format, GLenum type, const void* data) override
+		{
+			if (target == GL_TEXTURE_1D)
+				glTexImage1D(target, level, internalFormat, width, 0, format, type, data);
+			else if (target == GL_TEXTURE_3D)
+				glTexImage3D(target, level, internalFormat, width, height, depth, 0, format, type, data);
+			else
+				glTexImage2D(target, level, internalFormat, width, height, 0, format, type, data);
+		}
+		void TexSubImage2D(GLenum target, int level, int width, int height, GLenum format, GLenum type, const void* data) override { glTexSubImage2D(target, level, 0, 0, width, height, format, type, data); }
+		void TexParameter(GLenum target, GLenum name, GLint value) override { glTexParameteri(target, name, value); }
+		void TexParameter(GLenum target, GLenum name, const float* values) override { glTexParameterfv(target, name, values); }
+		void GenerateMipmap(GLenum target) override { glGenerateMipmap(target); }
+
+		// framebuffers
+		unsigned int CreateFramebuffer() override
+		{
+			unsigned int framebuffer;
+			glGenFramebuffers(1, &framebuffer);
+			return framebuffer;
+		}
+		void DeleteFramebuffer(unsigned int framebuffer) override { glDeleteFramebuffers(1, &framebuffer); }
+		void FramebufferTexture2D(GLenum attachment, GLenum textureTarget, unsigned int texture, int level) override { glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, textureTarget, texture, level); }
+		bool IsFramebufferComplete() override { return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE; }
+
+		// drawing
+		void ClearColor(float r, float g, float b, float a) override { glClearColor(r, g, b, a); }
+		void Clear(GLbitfield mask) override { glClear(mask); }
+		void DrawArrays(GLenum mode, int first, int count) override { glDrawArrays(mode, first, count); }
+		void DrawElements(GLenum mode, int count, GLenum type, size_t offset) override { glDrawElements(mode, count, type, (GLvoid*)offset); }
+		void DrawArraysInstanced(GLenum mode, int first, int count, int instanceCount) override { glDrawArraysInstanced(mode, first, count, instanceCount); }
+		void DrawElementsInstanced(GLenum mode, int count, GLenum type, size_t offset, int instanceCount) override { glDrawElementsInstanced(mode, count, type, (GLvoid*)offset, instanceCount); }
+		void DrawElementsBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int baseVertex) override { glDrawElementsBaseVertex(mode, count, type, (GLvoid*)offset, baseVertex); }
+		void DrawElementsInstancedBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int instanceCount, int baseVertex) override { glDrawElementsInstancedBaseVertex(mode, count, type, (GLvoid*)offset, instanceCount, baseVertex); }
+		bool SupportsMultiDrawIndirect() override { return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object); }
+		void MultiDrawElementsIndirect(GLenum mode, GLenum type, size_t offset, int drawCount, int stride) override { glMultiDrawElementsIndirect(mode, type, (GLvoid*)offset, drawCount, stride); }
+
+	private:
+		unsigned int compileShader(const std::string& name, GLenum stage, const std::vector<const char*>& sources)
+		{
+			unsigned int shader = glCreateShader(stage);
+			// all strings are null-terminated so pass NULL as glShaderSource's final argument.
+			glShaderSource(shader, static_cast<GLsizei>(sources.size()), sources.data(), NULL);
+			glCompileShader(shader);
+
+			int status;
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+			if (!status)
+			{
+				char log[1024];
+				glGetShaderInfoLog(shader, 1024, NULL, log);
+				LOG_ERROR("%s shader compilation error at: %s !\n %s", stage == GL_VERTEX_SHADER ? "Vertex" : "Fragment", name.c_str(), std::string(log).c_str());
+			}
+			return shader;
+		}
+	};
+
+	GLRenderDevice s_GLDevice;
+	RenderDevice* s_Device = &s_GLDevice;
+}
+
+RenderDevice& RenderDevice::Get()
+{
+	return *s_Device;
+}
+
+void RenderDevice::Set(RenderDevice* device)
+{
+	s_Device = device ? device : &s_GLDevice;
+}
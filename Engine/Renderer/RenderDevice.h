@@ -0,0 +1,130 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GLStateCache.h"
+#include "Shading/ShadingTypes.h"
+
+/*
+
+  Thin layer between the engine and the graphics API: resource creation, buffer and texture
+  uploads, uniform uploads, draws and clears go through the current device, and so do the
+  state changes the GLStateCache lets through, a device being a GLStateBackend.
+
+  The default device issues everything to GL. A RecordingRenderDevice only records the
+  commands, so scenes render without a GL context and every frame can be measured; set it with
+  Set() before anything creates GL resources. Calls keep the shape and enums of the GL calls
+  they replace, object names are GL names on the GL device and plain counters on others.
+
+*/
+class RenderDevice
+	: public GLStateBackend
+{
+public:
+	// what linking reports about a program.
+	struct ProgramInfo
+	{
+		std::vector<Uniform>         Uniforms;
+		std::vector<VertexAttribute> Attributes;
+		unsigned int                 BlockSize = 0;	// size of the reflected uniform block, 0 without one
+	};
+
+	// outcome of waiting on a fence; a failed wait (e.g. a lost context) never signals later.
+	enum class FenceStatus
+	{
+		Signaled,
+		TimedOut,
+		Failed,
+	};
+
+public:
+	// the device all rendering goes through; the GL device unless another one was set.
+	static RenderDevice& Get();
+	// null restores the GL device.
+	static void Set(RenderDevice* device);
+
+	virtual int GetInteger(GLenum name) = 0;
+	// whether a toggle set through Toggle() is enabled.
+	virtual bool IsEnabled(GLenum state) = 0;
+
+	// programs; every stage is the concatenation of its sources. Compile and link errors are
+	// logged, the program is returned either way.
+	virtual unsigned int CreateProgram(const std::string& name, const std::vector<const char*>& vsSources, const std::vector<const char*>& fsSources) = 0;
+	virtual void DeleteProgram(unsigned int program) = 0;
+	// lists the active uniforms and attributes. Members of the uniform block called blockName
+	// get their std140 offset as BlockOffset and the block is bound to blockBinding.
+	virtual void GetProgramInfo(unsigned int program, const char* blockName, unsigned int blockBinding, ProgramInfo& outInfo) = 0;
+	virtual int GetUniformLocation(unsigned int program, const char* name) = 0;
+	// uploads count values of type to the bound program; values is tightly packed (matrices
+	// column major, bools as ints).
+	virtual void SetUniform(int location, SHADER_TYPE type, int count, const void* values) = 0;
+
+	// buffers; uploads go to the buffer bound to target.
+	virtual unsigned int CreateBuffer() = 0;
+	virtual void DeleteBuffer(unsigned int buffer) = 0;
+	virtual void BindBuffer(GLenum target, unsigned int buffer) = 0;
+	virtual void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) = 0;
+	virtual void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+	// copies between the buffers bound to readTarget and writeTarget; ranges within one buffer
+	// may not overlap.
+	virtual void CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) = 0;
+	// immutable storage and mapping (GL 4.4 or ARB_buffer_storage); BufferStorage may only be
+	// used when SupportsBufferStorage() says so. Mapped pointers stay valid until the unmap.
+	virtual bool SupportsBufferStorage() = 0;
+	virtual void BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) = 0;
+	virtual void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access) = 0;
+	virtual void UnmapBuffer(GLenum target) = 0;
+
+	// fences; a fence is signaled once the commands issued before it completed. WaitFence waits
+	// up to timeout nanoseconds for the fence to signal.
+	virtual GLsync CreateFence() = 0;
+	virtual FenceStatus WaitFence(GLsync fence, uint64_t timeout) = 0;
+	virtual void DeleteFence(GLsync fence) = 0;
+
+	// vertex arrays; attributes are set on the bound vertex array and read the bound array buffer.
+	virtual unsigned int CreateVertexArray() = 0;
+	virtual void DeleteVertexArray(unsigned int vertexArray) = 0;
+	virtual void EnableVertexAttribute(unsigned int index, int components, GLenum type, bool normalized, int stride, size_t offset) = 0;
+	// attribute the shader reads as integers, unconverted.
+	virtual void EnableIntegerVertexAttribute(unsigned int index, int components, GLenum type, int stride, size_t offset) = 0;
+	virtual void DisableVertexAttribute(unsigned int index) = 0;
+	virtual void VertexAttribDivisor(unsigned int index, unsigned int divisor) = 0;
+
+	// textures; the calls below work on the texture bound to target on the active unit. TexImage
+	// picks the 1D, 2D or 3D call from target, with height and depth 0 where they don't apply.
+	virtual unsigned int CreateTexture() = 0;
+	virtual void DeleteTexture(unsigned int texture) = 0;
+	virtual void TexImage(GLenum target, int level, GLenum internalFormat, int width, int height, int depth, GLenum format, GLenum type, const void* data) = 0;
+	virtual void TexSubImage2D(GLenum target, int level, int width, int height, GLenum format, GLenum type, const void* data) = 0;
+	virtual void TexParameter(GLenum target, GLenum name, GLint value) = 0;
+	virtual void TexParameter(GLenum target, GLenum name, const float* values) = 0;
+	virtual void GenerateMipmap(GLenum target) = 0;
+
+	// framebuffers; attachments go to the bound framebuffer.
+	virtual unsigned int CreateFramebuffer() = 0;
+	virtual void DeleteFramebuffer(unsigned int framebuffer) = 0;
+	virtual void FramebufferTexture2D(GLenum attachment, GLenum textureTarget, unsigned int texture, int level) = 0;
+	virtual bool IsFramebufferComplete() = 0;
+
+	// drawing
+	virtual void ClearColor(float r, float g, float b, float a) = 0;
+	virtual void Clear(GLbitfield mask) = 0;
+	virtual void DrawArrays(GLenum mode, int first, int count) = 0;
+	virtual void DrawElements(GLenum mode, int count, GLenum type, size_t offset) = 0;
+	virtual void DrawArraysInstanced(GLenum mode, int first, int count, int instanceCount) = 0;
+	virtual void DrawElementsInstanced(GLenum mode, int count, GLenum type, size_t offset, int instanceCount) = 0;
+	// baseVertex is added to every index read.
+	virtual void DrawElementsBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int baseVertex) = 0;
+	virtual void DrawElementsInstancedBaseVertex(GLenum mode, int count, GLenum type, size_t offset, int instanceCount, int baseVertex) = 0;
+	// multi draw indirect (GL 4.3 or ARB_multi_draw_indirect); drawCount commands are read from
+	// the buffer bound to GL_DRAW_INDIRECT_BUFFER at offset, stride bytes apart (0 when packed).
+	// Only used when SupportsMultiDrawIndirect() says so; the shaders read their per-draw data
+	// from shader storage buffers, which come with the same version.
+	virtual bool SupportsMultiDrawIndirect() = 0;
+	virtual void MultiDrawElementsIndirect(GLenum mode, GLenum type, size_t offset, int drawCount, int stride) = 0;
+};
@@ -1,4 +1,5 @@
 #include "RenderTarget.h"
+#include "RenderDevice.h"
 
 #include "Utils/Logger.h"
 
@@ -8,8 +9,9 @@ RenderTarget::RenderTarget(unsigned int width, unsigned int height, GLenum type,
 	Height = height;
 	Type = type;
 
-	glGenFramebuffers(1, &ID);
-	glBindFramebuffer(GL_FRAMEBUFFER, ID);
+	RenderDevice& device = RenderDevice::Get();
+	ID = device.CreateFramebuffer();
+	device.BindFramebuffer(GL_FRAMEBUFFER, ID);
 	// generate all requested color attachments
 	for (unsigned int i = 0; i < nrColorAttachments; ++i)
 	{
@@ -27,7 +29,7 @@ RenderTarget::RenderTarget(unsigned int width, unsigned int height, GLenum type,
 			internalFormat = GL_RGBA32F;
 		texture.Generate(width, height, internalFormat, GL_RGBA, type, 0);
 
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, texture.ID, 0);
+		device.FramebufferTexture2D(GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, texture.ID, 0);
 		m_ColorAttachments.push_back(texture);
 	}
 	// then generate Depth/Stencil texture if requested
@@ -42,14 +44,14 @@ RenderTarget::RenderTarget(unsigned int width, unsigned int height, GLenum type,
 		texture.Mipmapping = false;
 		texture.Generate(width, height, GL_DEPTH_STENCIL, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 0);
 
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, texture.ID, 0);
+		device.FramebufferTexture2D(GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, texture.ID, 0);
 		m_DepthStencil = texture;
 	}
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	if (!device.IsFramebufferComplete())
 	{
 		LOG_ERROR("Framebuffer not complete!");
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	device.BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 Texture* RenderTarget::GetDepthStencilTexture()
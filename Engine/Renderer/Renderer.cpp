@@ -16,14 +16,28 @@
 #include "Resources/Resources.h"
 
 #include "Utils/Logger.h"
+#include "Utils/Parallel.h"
 
 #include <imgui.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <stack>
 
 
+// uniforms set for every draw; their names are hashed at compile time.
+static constexpr UniformName s_UniformModel("model");
+static constexpr UniformName s_UniformPrevModel("prevModel");
+static constexpr UniformName s_UniformView("view");
+static constexpr UniformName s_UniformProjection("projection");
+static constexpr UniformName s_UniformCamPos("CamPos");
+static constexpr UniformName s_UniformPackedOrigin("PackedOrigin");
+static constexpr UniformName s_UniformPackedExtent("PackedExtent");
+static constexpr UniformName s_UniformShadowsEnabled("ShadowsEnabled");
+static constexpr UniformName s_UniformCascadeCount("CascadeCount");
+static constexpr UniformName s_UniformCascadeSplits("CascadeSplits");
+static constexpr UniformName s_UniformCascadeMatrices[ShadowCascades::MaxCascadeCount] = { "CascadeViewProjection0", "CascadeViewProjection1", "CascadeViewProjection2", "CascadeViewProjection3" };
 
 Renderer::Renderer()
 {
@@ -62,6 +76,7 @@ void Renderer::Init(/*GLADloadproc loadProcFunc*/)
 {
 	// initialize render items
 	m_CommandBuffer = new CommandBuffer(this);
+	m_MaterialBlocks.Init();
 
 	// configure default OpenGL state
 	m_GLCache.SetDepthTest(true);
@@ -189,6 +204,38 @@ void Renderer::PushRender(Mesh* mesh, Material* material, glm::mat4 transform, g
 	m_CommandBuffer->Push(mesh, material, transform, prevFrameTransform, glm::vec3(-99999.0f), glm::vec3(99999.0f), target);
 }
 
+// minimum number of subtrees per worker before recording is split over threads.
+static const unsigned int s_RecordBatchSize = 64;
+
+// pushes the render state of a single mesh node; recorder is the command buffer or one of its buckets.
+template <typename Recorder>
+static void pushNode(Recorder& recorder, SceneNode* node, RenderTarget* target)
+{
+	// only push render command if the child isn't a container node.
+	if (node->Mesh)
+	{
+		glm::vec3 boxMinWorld = node->GetWorldPosition() + (node->GetWorldScale() * node->BoxMin);
+		glm::vec3 boxMaxWorld = node->GetWorldPosition() + (node->GetWorldScale() * node->BoxMax);
+		recorder.Push(node->Mesh, node->Material, node->GetTransform(), node->GetPrevTransform(), boxMinWorld, boxMaxWorld, target);
+	}
+}
+
+// pushes every node of the subtree under node, depth first.
+template <typename Recorder>
+static void pushSubtree(Recorder& recorder, SceneNode* node, RenderTarget* target, std::vector<SceneNode*>& nodeStack)
+{
+	nodeStack.clear();
+	nodeStack.push_back(node);
+	while (!nodeStack.empty())
+	{
+		SceneNode* current = nodeStack.back();
+		nodeStack.pop_back();
+		pushNode(recorder, current, target);
+		for (unsigned int i = 0; i < current->GetChildCount(); ++i)
+			nodeStack.push_back(current->GetChildByIndex(i));
+	}
+}
+
 void Renderer::PushRender(SceneNode* node)
 {
 	// update transform(s) before pushing node to render command buffer
@@ -197,27 +244,88 @@ void Renderer::PushRender(SceneNode* node)
 	// get current render target
 	RenderTarget* target = getCurrentRenderTarget();
 	// traverse through all the scene nodes and for each node: push its render state to the 
-	// command buffer together with a calculated transform matrix.
+	// command buffer together with a calculated transform matrix. Large scenes are recorded in
+	// parallel, every worker records a contiguous range of the root's child subtrees.
+	const unsigned int childCount = node->GetChildCount();
+	const unsigned int workerCount = Utils::GetWorkerCount(childCount, s_RecordBatchSize);
+	if (workerCount <= 1)
+	{
+		std::vector<SceneNode*> nodeStack;
+		pushSubtree(*m_CommandBuffer, node, target, nodeStack);
+		return;
+	}
+
+	m_CommandBuffer->ReserveBuckets(workerCount);
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		CommandBuffer::Bucket& bucket = m_CommandBuffer->GetBucket(worker);
+		if (worker == 0)
+		{
+			pushNode(bucket, node, target);
+		}
+
+		unsigned int begin, end;
+		Utils::GetWorkerRange(childCount, workerCount, worker, begin, end);
+		std::vector<SceneNode*> nodeStack;
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			pushSubtree(bucket, node->GetChildByIndex(i), target, nodeStack);
+		}
+	});
+	m_CommandBuffer->MergeBuckets();
+}
+
+void Renderer::PushOccluder(Mesh* mesh, glm::mat4 transform)
+{
+	const unsigned int* indices = mesh->Indices.empty() ? nullptr : mesh->Indices.data();
+	m_OcclusionCuller.AddOccluder(mesh->Positions.data(), static_cast<unsigned int>(mesh->Positions.size()),
+		indices, static_cast<unsigned int>(mesh->Indices.size()), transform, mesh->Topology == TOPOLOGY::TRIANGLE_STRIP);
+}
+
+void Renderer::PushOccluder(SceneNode* node)
+{
+	node->UpdateTransform(true);
+
 	std::stack<SceneNode*> nodeStack;
 	nodeStack.push(node);
-	for (unsigned int i = 0; i < node->GetChildCount(); ++i)
-		nodeStack.push(node->GetChildByIndex(i));
 	while (!nodeStack.empty())
 	{
-		SceneNode* node = nodeStack.top();
+		SceneNode* current = nodeStack.top();
 		nodeStack.pop();
-		// only push render command if the child isn't a container node.
-		if (node->Mesh)
+		if (current->Mesh)
 		{
-			glm::vec3 boxMinWorld = node->GetWorldPosition() + (node->GetWorldScale() * node->BoxMin);
-			glm::vec3 boxMaxWorld = node->GetWorldPosition() + (node->GetWorldScale() * node->BoxMax);
-			m_CommandBuffer->Push(node->Mesh, node->Material, node->GetTransform(), node->GetPrevTransform(), boxMinWorld, boxMaxWorld, target);
+			PushOccluder(current->Mesh, current->GetTransform());
 		}
-		for (unsigned int i = 0; i < node->GetChildCount(); ++i)
-			nodeStack.push(node->GetChildByIndex(i));
+		for (unsigned int i = 0; i < current->GetChildCount(); ++i)
+			nodeStack.push(current->GetChildByIndex(i));
 	}
 }
 
+void Renderer::PushRender(const std::vector<SceneNode*>& nodes)
+{
+	RenderTarget* target = getCurrentRenderTarget();
+	const unsigned int nodeCount = static_cast<unsigned int>(nodes.size());
+	const unsigned int workerCount = Utils::GetWorkerCount(nodeCount, s_RecordBatchSize);
+
+	// the transforms of disjoint subtrees don't depend on each other, so every worker updates
+	// the ones it records.
+	m_CommandBuffer->ReserveBuckets(workerCount);
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		CommandBuffer::Bucket& bucket = m_CommandBuffer->GetBucket(worker);
+
+		unsigned int begin, end;
+		Utils::GetWorkerRange(nodeCount, workerCount, worker, begin, end);
+		std::vector<SceneNode*> nodeStack;
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			nodes[i]->UpdateTransform(true);
+			pushSubtree(bucket, nodes[i], target, nodeStack);
+		}
+	});
+	m_CommandBuffer->MergeBuckets();
+}
+
 void Renderer::PushPostProcessor(Material* postProcessor)
 {
 	// we only care about the material, mesh as NDC quad is pre-defined.
@@ -236,6 +344,10 @@ void Renderer::AddLight(PointLight* light)
 
 void Renderer::RenderPushedCommands()
 {
+	// framebuffer, vertex array and texture binds of the frame's passes (post-processing
+	// included) go through the cache; resource creation and uploads between frames bind through
+	// the device directly, so the frame starts from unknown state.
+	m_GLCache.Reset();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	/*
@@ -262,6 +374,17 @@ void Renderer::RenderPushedCommands()
 	// update (global) uniform buffers
 	updateGlobalUBOs();
 
+	// draw the occluders on the CPU; culling then also drops commands hidden behind them.
+	if (OcclusionCulling)
+	{
+		m_OcclusionCuller.Render(m_Camera->GetProjection() * m_Camera->GetView());
+		m_CommandBuffer->SetOcclusionCuller(&m_OcclusionCuller);
+	}
+	else
+	{
+		m_CommandBuffer->SetOcclusionCuller(nullptr);
+	}
+
 	// set default GL state
 	m_GLCache.SetBlend(false);
 	m_GLCache.SetCull(true);
@@ -270,16 +393,17 @@ void Renderer::RenderPushedCommands()
 	m_GLCache.SetDepthFunc(GL_LESS);
 
 	// 1. Geometry buffer
-	std::vector<RenderCommand> deferredRenderCommands = m_CommandBuffer->GetDeferredRenderCommands(true);
+	RenderCommandList deferredRenderCommands = m_CommandBuffer->GetDeferredRenderCommands(true);
 	glViewport(0, 0, m_RenderSize.x, m_RenderSize.y);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_GBuffer->ID);
+	m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_GBuffer->ID);
 	unsigned int attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
 	glDrawBuffers(4, attachments);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	m_GLCache.SetPolygonMode(Wireframe ? GL_LINE : GL_FILL);
-	for (unsigned int i = 0; i < deferredRenderCommands.size(); ++i)
+	for (unsigned int i = 0; i < deferredRenderCommands.Size(); ++i)
 	{
-		renderCustomCommand(&deferredRenderCommands[i], nullptr, false);
+		const RenderCommand command = deferredRenderCommands[i];
+		renderCustomCommand(&command, nullptr, false);
 	}
 	m_GLCache.SetPolygonMode(GL_FILL);
 
@@ -293,30 +417,45 @@ void Renderer::RenderPushedCommands()
 	if (Shadows)
 	{
 		m_GLCache.SetCullFace(GL_FRONT);
-		std::vector<RenderCommand> shadowRenderCommands = m_CommandBuffer->GetShadowCastRenderCommands();
-		m_ShadowViewProjections.clear();
+		RenderCommandList shadowRenderCommands = m_CommandBuffer->GetShadowCastRenderCommands();
+		m_ShadowCasterIndices.resize(shadowRenderCommands.Size());
+		m_ShadowCasterDrawCount = 0;
 
+		// the shadow maps are handed out cascade by cascade, so with one light it gets all of them.
 		unsigned int shadowRtIndex = 0;
 		for (int i = 0; i < m_DirectionalLights.size(); ++i)
 		{
 			DirectionalLight* light = m_DirectionalLights[i];
-			if (light->m_castShadows)
+			light->m_shadowCascadeCount = 0;
+			if (light->m_castShadows && shadowRtIndex < m_ShadowRenderTargets.size())
 			{
-				m_MaterialLibrary->dirShadowShader->Use();
-
-				glBindFramebuffer(GL_FRAMEBUFFER, m_ShadowRenderTargets[shadowRtIndex]->ID);
-				glViewport(0, 0, m_ShadowRenderTargets[shadowRtIndex]->Width, m_ShadowRenderTargets[shadowRtIndex]->Height);
-				glClear(GL_DEPTH_BUFFER_BIT);
-
-				glm::mat4 lightProjection = glm::ortho(-20.0f, 20.0f, 20.0f, -20.0f, -15.0f, 20.0f);
-				glm::mat4 lightView = glm::lookAt(-light->m_direction * 10.0f, glm::vec3(0.0), glm::vec3(0, 1, 0));
-				m_DirectionalLights[i]->m_lightSpaceViewPrrojection = lightProjection * lightView;
-				m_DirectionalLights[i]->m_shadowMatRenderTarget = m_ShadowRenderTargets[shadowRtIndex];
-				for (int j = 0; j < shadowRenderCommands.size(); ++j)
+				const unsigned int cascadeCount = std::min(ShadowCascadeSettings.CascadeCount, static_cast<unsigned int>(m_ShadowRenderTargets.size()) - shadowRtIndex);
+				light->m_shadowCascadeCount = ShadowCascades::FitCascades(m_Camera->GetView(), m_Camera->GetProjection(), m_Camera->GetNearPlane(), m_Camera->GetFarPlane(),
+					light->m_direction, ShadowCascadeSettings, cascadeCount, light->m_shadowCascades);
+
+				Shader* shadowShader = m_MaterialLibrary->dirShadowShader;
+				shadowShader->Use();
+				const UniformHandle modelUniform = shadowShader->GetUniform(s_UniformModel);
+				for (unsigned int c = 0; c < light->m_shadowCascadeCount; ++c)
 				{
-					renderShadowCastCommand(&shadowRenderCommands[j], lightProjection, lightView);
+					const ShadowCascades::Cascade& cascade = light->m_shadowCascades[c];
+					RenderTarget* renderTarget = m_ShadowRenderTargets[shadowRtIndex++];
+					light->m_shadowCascadeRenderTargets[c] = renderTarget;
+
+					m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, renderTarget->ID);
+					glViewport(0, 0, renderTarget->Width, renderTarget->Height);
+					glClear(GL_DEPTH_BUFFER_BIT);
+
+					shadowShader->SetMatrix(s_UniformProjection, cascade.Projection);
+					shadowShader->SetMatrix(s_UniformView, cascade.View);
+					const unsigned int casterCount = ShadowCascades::CullCasters(cascade, shadowRenderCommands.Bounds, m_ShadowCasterIndices.data());
+					for (unsigned int j = 0; j < casterCount; ++j)
+					{
+						const unsigned int index = m_ShadowCasterIndices[j];
+						renderShadowCastCommand(shadowRenderCommands.GetMesh(index), shadowRenderCommands.GetTransform(index), modelUniform);
+					}
+					m_ShadowCasterDrawCount += casterCount;
 				}
-				++shadowRtIndex;
 			}
 		}
 		m_GLCache.SetCullFace(GL_BACK);
@@ -327,7 +466,7 @@ void Renderer::RenderPushedCommands()
 	// 3. do post-processing steps before lighting stage (e.g. SSAO)
 	m_PostProcessor->ProcessPreLighting(this, m_GBuffer, m_Camera);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
+	m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
 	glViewport(0, 0, m_CustomTarget->Width, m_CustomTarget->Height);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
@@ -337,9 +476,9 @@ void Renderer::RenderPushedCommands()
 	m_GLCache.SetBlendFunc(GL_ONE, GL_ONE);
 
 	// bind gbuffer
-	m_GBuffer->GetColorTexture(0)->Bind(0);
-	m_GBuffer->GetColorTexture(1)->Bind(1);
-	m_GBuffer->GetColorTexture(2)->Bind(2);
+	m_GBuffer->GetColorTexture(0)->Bind(m_GLCache, 0);
+	m_GBuffer->GetColorTexture(1)->Bind(m_GLCache, 1);
+	m_GBuffer->GetColorTexture(2)->Bind(m_GLCache, 2);
 
 #if 0
 	// ambient lighting
@@ -370,8 +509,8 @@ void Renderer::RenderPushedCommands()
 	m_GLCache.SetBlend(false);
 
 	// 5. blit depth buffer to default for forward rendering
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_GBuffer->ID);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_CustomTarget->ID); // write to default framebuffer
+	m_GLCache.BindFramebuffer(GL_READ_FRAMEBUFFER, m_GBuffer->ID);
+	m_GLCache.BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_CustomTarget->ID); // write to default framebuffer
 	glBlitFramebuffer(
 		0, 0, m_GBuffer->Width, m_GBuffer->Height, 0, 0, m_RenderSize.x, m_RenderSize.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST
 	);
@@ -386,7 +525,7 @@ void Renderer::RenderPushedCommands()
 		if (renderTarget)
 		{
 			glViewport(0, 0, renderTarget->Width, renderTarget->Height);
-			glBindFramebuffer(GL_FRAMEBUFFER, renderTarget->ID);
+			m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, renderTarget->ID);
 			if (renderTarget->HasDepthAndStencil)
 				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 			else
@@ -400,30 +539,32 @@ void Renderer::RenderPushedCommands()
 			// don't render to default framebuffer, but to custom target framebuffer which 
 			// we'll use for post-processing.
 			glViewport(0, 0, m_RenderSize.x, m_RenderSize.y);
-			glBindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
+			m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
 			m_Camera->SetPerspective(m_Camera->GetFov(), m_RenderSize.x / m_RenderSize.y, 0.1,
 				100.0f);
 		}
 
 		// sort all render commands and retrieve the sorted array
-		std::vector<RenderCommand> renderCommands = m_CommandBuffer->GetCustomRenderCommands(renderTarget);
+		RenderCommandList renderCommands = m_CommandBuffer->GetCustomRenderCommands(renderTarget);
 
 		// terate over all the render commands and execute
 		m_GLCache.SetPolygonMode(Wireframe ? GL_LINE : GL_FILL);
-		for (unsigned int i = 0; i < renderCommands.size(); ++i)
+		for (unsigned int i = 0; i < renderCommands.Size(); ++i)
 		{
-			renderCustomCommand(&renderCommands[i], nullptr);
+			const RenderCommand command = renderCommands[i];
+			renderCustomCommand(&command, nullptr);
 		}
 		m_GLCache.SetPolygonMode(GL_FILL);
 	}
 
 	// 7. alpha material pass
 	glViewport(0, 0, m_RenderSize.x, m_RenderSize.y);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
-	std::vector<RenderCommand> alphaRenderCommands = m_CommandBuffer->GetAlphaRenderCommands(true);
-	for (unsigned int i = 0; i < alphaRenderCommands.size(); ++i)
+	m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
+	RenderCommandList alphaRenderCommands = m_CommandBuffer->GetAlphaRenderCommands(true);
+	for (unsigned int i = 0; i < alphaRenderCommands.Size(); ++i)
 	{
-		renderCustomCommand(&alphaRenderCommands[i], nullptr);
+		const RenderCommand command = alphaRenderCommands[i];
+		renderCustomCommand(&command, nullptr);
 	}
 
 	// render light mesh (as visual cue), if requested
@@ -450,7 +591,7 @@ void Renderer::RenderPushedCommands()
 
 	// 9. render debug visuals
 	glViewport(0, 0, m_RenderSize.x, m_RenderSize.y);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
+	m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_CustomTarget->ID);
 	if (LightVolumes)
 	{
 		m_GLCache.SetPolygonMode(GL_LINE);
@@ -479,24 +620,25 @@ void Renderer::RenderPushedCommands()
 	}
 #endif
 	// 10. custom post-processing pass
-	std::vector<RenderCommand> postProcessingCommands = m_CommandBuffer->GetPostProcessingRenderCommands();
-	for (unsigned int i = 0; i < postProcessingCommands.size(); ++i)
+	RenderCommandList postProcessingCommands = m_CommandBuffer->GetPostProcessingRenderCommands();
+	for (unsigned int i = 0; i < postProcessingCommands.Size(); ++i)
 	{
 		// ping-pong between render textures
 		bool even = i % 2 == 0;
 		Blit(even ? m_CustomTarget->GetColorTexture(0) : m_PostProcessTarget1->GetColorTexture(0),
 			even ? m_PostProcessTarget1 : m_CustomTarget,
-			postProcessingCommands[i].Material);
+			postProcessingCommands.GetMaterial(i));
 	}
 
 	// 11. final post-processing steps, blitting to default framebuffer
-	m_PostProcessor->Blit(this, postProcessingCommands.size() % 2 == 0 ? m_CustomTarget->GetColorTexture(0) : m_PostProcessTarget1->GetColorTexture(0));
+	m_PostProcessor->Blit(this, postProcessingCommands.Size() % 2 == 0 ? m_CustomTarget->GetColorTexture(0) : m_PostProcessTarget1->GetColorTexture(0));
 
 	// store view projection as previous view projection for next frame's motion blur
 	m_PrevViewProjection = m_Camera->GetProjection() * m_Camera->GetView();
 
 	// clear the command buffer s.t. the next frame/call can start from an empty slate again.
 	m_CommandBuffer->Clear();
+	m_OcclusionCuller.ClearOccluders();
 
 	// clear render state
 	m_RenderTargetsCustom.clear();
@@ -509,11 +651,15 @@ void Renderer::Blit(Texture* src,
 	Material* material,
 	std::string   textureUniformName)
 {
+	// also used outside of a frame (e.g. PBR baking), right after textures were created and bound
+	// behind the cache's back.
+	m_GLCache.Reset();
+
 	// if a destination target is given, bind to its framebuffer
 	if (dst)
 	{
 		glViewport(0, 0, dst->Width, dst->Height);
-		glBindFramebuffer(GL_FRAMEBUFFER, dst->ID);
+		m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, dst->ID);
 		if (dst->HasDepthAndStencil)
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 		else
@@ -522,7 +668,7 @@ void Renderer::Blit(Texture* src,
 	// else we bind to the default framebuffer
 	else
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, 0);
 		glViewport(0, 0, m_RenderSize.x, m_RenderSize.y);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 	}
@@ -610,7 +756,7 @@ void Renderer::BakeProbes(SceneNode* scene)
 			sceneStack.push(node->GetChildByIndex(i));
 	}
 	commandBuffer.Sort();
-	std::vector<RenderCommand> renderCommands = commandBuffer.GetCustomRenderCommands(nullptr);
+	RenderCommandList renderCommands = commandBuffer.GetCustomRenderCommands(nullptr);
 
 	m_PBR->ClearIrradianceProbes();
 	for (int i = 0; i < m_ProbeSpatials.size(); ++i)
@@ -630,7 +776,7 @@ void Renderer::BakeProbes(SceneNode* scene)
 	}
 }
 
-void Renderer::renderCustomCommand(RenderCommand* command, Camera* customCamera, bool updateGLSettings)
+void Renderer::renderCustomCommand(const RenderCommand* command, Camera* customCamera, bool updateGLSettings)
 {
 	Material* material = command->Material;
 	Mesh* mesh = command->Mesh;
@@ -654,24 +800,26 @@ void Renderer::renderCustomCommand(RenderCommand* command, Camera* customCamera,
 	material->GetShader()->Use();
 	if (customCamera) // pass custom camera specific uniform
 	{
-		material->GetShader()->SetMatrix("projection", customCamera->GetProjection());
-		material->GetShader()->SetMatrix("view", customCamera->GetView());
-		material->GetShader()->SetVector("CamPos", customCamera->GetPosition());
+		material->GetShader()->SetMatrix(s_UniformProjection, customCamera->GetProjection());
+		material->GetShader()->SetMatrix(s_UniformView, customCamera->GetView());
+		material->GetShader()->SetVector(s_UniformCamPos, customCamera->GetPosition());
 	}
-	material->GetShader()->SetMatrix("model", command->Transform);
-	material->GetShader()->SetMatrix("prevModel", command->PrevTransform);
+	material->GetShader()->SetMatrix(s_UniformModel, command->Transform);
+	material->GetShader()->SetMatrix(s_UniformPrevModel, command->PrevTransform);
 
-	material->GetShader()->SetBool("ShadowsEnabled", Shadows);
+	material->GetShader()->SetBool(s_UniformShadowsEnabled, Shadows);
 	if (Shadows && material->Type == MATERIAL_CUSTOM && material->ShadowReceive)
 	{
-		for (int i = 0; i < m_DirectionalLights.size(); ++i)
+		// the forward shaders take the cascades of the first shadowed light.
+		DirectionalLight* shadowLight = nullptr;
+		for (int i = 0; i < m_DirectionalLights.size() && !shadowLight; ++i)
 		{
-			if (m_DirectionalLights[i]->m_shadowMatRenderTarget)
+			if (m_DirectionalLights[i]->m_shadowCascadeCount > 0)
 			{
-				material->GetShader()->SetMatrix("lightShadowViewProjection" + std::to_string(i + 1), m_DirectionalLights[i]->m_lightSpaceViewPrrojection);
-				m_DirectionalLights[i]->m_shadowMatRenderTarget->GetDepthStencilTexture()->Bind(10 + i);
+				shadowLight = m_DirectionalLights[i];
 			}
 		}
+		bindShadowCascades(material->GetShader(), shadowLight, 10);
 	}
 
 	// bind/active uniform sampler/texture objects
@@ -679,43 +827,46 @@ void Renderer::renderCustomCommand(RenderCommand* command, Camera* customCamera,
 	for (auto it = samplers->begin(); it != samplers->end(); ++it)
 	{
 		if (it->second.Type == SHADER_TYPE_SAMPLERCUBE)
-			it->second.TextureCube->Bind(it->second.Unit);
+			it->second.TextureCube->Bind(m_GLCache, it->second.Unit);
 		else
-			it->second.Texture->Bind(it->second.Unit);
+			it->second.Texture->Bind(m_GLCache, it->second.Unit);
 	}
 
-	// set uniform state of material
+	// set uniform state of material; the material block is only uploaded when it changed
+	m_MaterialBlocks.Bind(material, m_GLCache);
 	auto* uniforms = material->GetUniforms();
-	for (auto it = uniforms->begin(); it != uniforms->end(); ++it)
+	const std::vector<UniformHandle>& handles = material->GetUniformHandles();
+	unsigned int index = 0;
+	for (auto it = uniforms->begin(); it != uniforms->end(); ++it, ++index)
 	{
 		switch (it->second.Type)
 		{
 		case SHADER_TYPE_BOOL:
-			material->GetShader()->SetBool(it->first, it->second.Bool);
+			material->GetShader()->SetBool(handles[index], it->second.Bool);
 			break;
 		case SHADER_TYPE_INT:
-			material->GetShader()->SetInt(it->first, it->second.Int);
+			material->GetShader()->SetInt(handles[index], it->second.Int);
 			break;
 		case SHADER_TYPE_FLOAT:
-			material->GetShader()->SetFloat(it->first, it->second.Float);
+			material->GetShader()->SetFloat(handles[index], it->second.Float);
 			break;
 		case SHADER_TYPE_VEC2:
-			material->GetShader()->SetVector(it->first, it->second.Vec2);
+			material->GetShader()->SetVector(handles[index], it->second.Vec2);
 			break;
 		case SHADER_TYPE_VEC3:
-			material->GetShader()->SetVector(it->first, it->second.Vec3);
+			material->GetShader()->SetVector(handles[index], it->second.Vec3);
 			break;
 		case SHADER_TYPE_VEC4:
-			material->GetShader()->SetVector(it->first, it->second.Vec4);
+			material->GetShader()->SetVector(handles[index], it->second.Vec4);
 			break;
 		case SHADER_TYPE_MAT2:
-			material->GetShader()->SetMatrix(it->first, it->second.Mat2);
+			material->GetShader()->SetMatrix(handles[index], it->second.Mat2);
 			break;
 		case SHADER_TYPE_MAT3:
-			material->GetShader()->SetMatrix(it->first, it->second.Mat3);
+			material->GetShader()->SetMatrix(handles[index], it->second.Mat3);
 			break;
 		case SHADER_TYPE_MAT4:
-			material->GetShader()->SetMatrix(it->first, it->second.Mat4);
+			material->GetShader()->SetMatrix(handles[index], it->second.Mat4);
 			break;
 		default:
 			LOG_ERROR("Unrecognized Uniform type set.");
@@ -748,12 +899,12 @@ void Renderer::renderToCubemap(SceneNode* scene,
 			childStack.push(child->GetChildByIndex(i));
 	}
 	commandBuffer.Sort();
-	std::vector<RenderCommand> renderCommands = commandBuffer.GetCustomRenderCommands(nullptr);
+	RenderCommandList renderCommands = commandBuffer.GetCustomRenderCommands(nullptr);
 
 	renderToCubemap(renderCommands, target, position, mipLevel);
 }
 
-void Renderer::renderToCubemap(std::vector<RenderCommand>& renderCommands, TextureCube* target, glm::vec3 position, unsigned int mipLevel)
+void Renderer::renderToCubemap(const RenderCommandList& renderCommands, TextureCube* target, glm::vec3 position, unsigned int mipLevel)
 {
 	// define 6 camera directions/lookup vectors
 	Camera faceCameras[6] = {
@@ -765,11 +916,14 @@ void Renderer::renderToCubemap(std::vector<RenderCommand>& renderCommands, Textu
 		Camera(position, glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
 	};
 
+	// probes are baked outside of a frame, in between texture creation binding behind the cache's back.
+	m_GLCache.Reset();
+
 	// resize target dimensions based on mip level we're rendering.
 	float width = (float)target->FaceWidth * pow(0.5, mipLevel);
 	float height = (float)target->FaceHeight * pow(0.5, mipLevel);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, m_FramebufferCubemap);
+	m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_FramebufferCubemap);
 	glBindRenderbuffer(GL_RENDERBUFFER, m_CubemapDepthRBO);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
@@ -777,7 +931,7 @@ void Renderer::renderToCubemap(std::vector<RenderCommand>& renderCommands, Textu
 
 	// resize relevant buffers
 	glViewport(0, 0, width, height);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_FramebufferCubemap);
+	m_GLCache.BindFramebuffer(GL_FRAMEBUFFER, m_FramebufferCubemap);
 
 	for (unsigned int i = 0; i < 6; ++i)
 	{
@@ -786,25 +940,31 @@ void Renderer::renderToCubemap(std::vector<RenderCommand>& renderCommands, Textu
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 			GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, target->ID, mipLevel);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		for (unsigned int i = 0; i < renderCommands.size(); ++i)
+		for (unsigned int i = 0; i < renderCommands.Size(); ++i)
 		{
 			// cubemap generation only works w/ custom materials 
-			assert(renderCommands[i].Material->Type == MATERIAL_CUSTOM);
-			renderCustomCommand(&renderCommands[i], camera);
+			const RenderCommand command = renderCommands[i];
+			assert(command.Material->Type == MATERIAL_CUSTOM);
+			renderCustomCommand(&command, camera);
 		}
 	}
 }
 
 void Renderer::renderMesh(Mesh* mesh, Shader* shader)
 {
-	glBindVertexArray(mesh->m_VAO);
+	// how the shader decodes the mesh's vertices, see common/vertex_decode.glsl.
+	shader->SetVector(s_UniformPackedOrigin, mesh->m_PackedOrigin);
+	shader->SetVector(s_UniformPackedExtent, mesh->m_PackedExtent);
+
+	m_GLCache.BindVertexArray(mesh->m_VAO);
 	if (mesh->Indices.size() > 0)
 	{
-		glDrawElements(mesh->Topology == TOPOLOGY::TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES, mesh->Indices.size(), GL_UNSIGNED_INT, 0);
+		glDrawElementsBaseVertex(mesh->Topology == TOPOLOGY::TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES, mesh->Indices.size(), GL_UNSIGNED_INT,
+			(GLvoid*)(mesh->m_FirstIndex * sizeof(unsigned int)), mesh->m_BaseVertex);
 	}
 	else
 	{
-		glDrawArrays(mesh->Topology == TOPOLOGY::TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES, 0, mesh->Positions.size());
+		glDrawArrays(mesh->Topology == TOPOLOGY::TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES, mesh->m_BaseVertex, mesh->Positions.size());
 	}
 }
 
@@ -846,9 +1006,9 @@ void Renderer::renderDeferredAmbient()
 	// if irradiance probes are present, use these as ambient lighting
 	if (IrradianceGI && irradianceProbes.size() > 0)
 	{
-		skyCapture->Prefiltered->Bind(4);
-		m_PBR->m_RenderTargetBRDFLUT->GetColorTexture(0)->Bind(5);
-		m_PostProcessor->SSAOOutput->Bind(6);
+		skyCapture->Prefiltered->Bind(m_GLCache, 4);
+		m_PBR->m_RenderTargetBRDFLUT->GetColorTexture(0)->Bind(m_GLCache, 5);
+		m_PostProcessor->SSAOOutput->Bind(m_GLCache, 6);
 
 		m_GLCache.SetCullFace(GL_FRONT);
 		for (int i = 0; i < irradianceProbes.size(); ++i)
@@ -857,7 +1017,7 @@ void Renderer::renderDeferredAmbient()
 			// only render probe if within frustum
 			if (m_Camera->GetFrustum().Intersect(probe->m_position, probe->Radius))
 			{
-				probe->Irradiance->Bind(3);
+				probe->Irradiance->Bind(m_GLCache, 3);
 
 				Shader* irradianceShader = m_MaterialLibrary->deferredIrradianceShader;
 				irradianceShader->Use();
@@ -879,10 +1039,10 @@ void Renderer::renderDeferredAmbient()
 	// otherwise do a full-screen ambient pass
 	else
 	{
-		skyCapture->Irradiance->Bind(3);
-		skyCapture->Prefiltered->Bind(4);
-		m_PBR->m_RenderTargetBRDFLUT->GetColorTexture(0)->Bind(5);
-		m_PostProcessor->SSAOOutput->Bind(6);
+		skyCapture->Irradiance->Bind(m_GLCache, 3);
+		skyCapture->Prefiltered->Bind(m_GLCache, 4);
+		m_PBR->m_RenderTargetBRDFLUT->GetColorTexture(0)->Bind(m_GLCache, 5);
+		m_PostProcessor->SSAOOutput->Bind(m_GLCache, 6);
 
 		Shader* ambientShader = m_MaterialLibrary->deferredAmbientShader;
 		ambientShader->Use();
@@ -901,11 +1061,7 @@ void Renderer::renderDeferredDirLight(DirectionalLight* light)
 	dirShader->SetVector("lightColor", glm::normalize(light->m_color) * light->m_intensity);
 	dirShader->SetBool("ShadowsEnabled", Shadows);
 
-	if (light->m_shadowMatRenderTarget)
-	{
-		dirShader->SetMatrix("lightShadowViewProjection", light->m_lightSpaceViewPrrojection);
-		light->m_shadowMatRenderTarget->GetDepthStencilTexture()->Bind(3);
-	}
+	bindShadowCascades(dirShader, light, 3);
 
 	renderMesh(m_NDCPlane, dirShader);
 }
@@ -928,13 +1084,34 @@ void Renderer::renderDeferredPointLight(PointLight* light)
 	renderMesh(m_DeferredPointMesh, pointShader);
 }
 
-void Renderer::renderShadowCastCommand(RenderCommand* command, const glm::mat4& projection, const glm::mat4& view)
+void Renderer::bindShadowCascades(Shader* shader, DirectionalLight* light, unsigned int firstTextureUnit)
+{
+	const unsigned int cascadeCount = light ? light->m_shadowCascadeCount : 0;
+	shader->SetInt(s_UniformCascadeCount, cascadeCount);
+	if (cascadeCount == 0)
+	{
+		return;
+	}
+
+	glm::vec4 splits;
+	for (unsigned int c = 0; c < ShadowCascades::MaxCascadeCount; ++c)
+	{
+		splits[c] = light->m_shadowCascades[std::min(c, cascadeCount - 1)].SplitFar;
+	}
+	shader->SetVector(s_UniformCascadeSplits, splits);
+
+	for (unsigned int c = 0; c < cascadeCount; ++c)
+	{
+		shader->SetMatrix(s_UniformCascadeMatrices[c], light->m_shadowCascades[c].ViewProjection);
+		light->m_shadowCascadeRenderTargets[c]->GetDepthStencilTexture()->Bind(m_GLCache, firstTextureUnit + c);
+	}
+}
+
+void Renderer::renderShadowCastCommand(Mesh* mesh, const glm::mat4& transform, UniformHandle modelUniform)
 {
 	Shader* shadowShader = m_MaterialLibrary->dirShadowShader;
 
-	shadowShader->SetMatrix("projection", projection);
-	shadowShader->SetMatrix("view", view);
-	shadowShader->SetMatrix("model", command->Transform);
+	shadowShader->SetMatrix(modelUniform, transform);
 
-	renderMesh(command->Mesh, shadowShader);
+	renderMesh(mesh, shadowShader);
 }
@@ -8,6 +8,10 @@
 #include "CommandBuffer.h"
 #include "PBRCapture.h"
 #include "GLStateCache.h"
+#include "MaterialBlockBuffer.h"
+#include "Shading/ShadingTypes.h"
+
+#include "Camera/OcclusionCulling.h"
 
 #include <string>
 
@@ -57,6 +61,8 @@ public:
 	bool LightVolumes = false;
 	bool RenderProbes = false;
 	bool Wireframe = false;
+	bool OcclusionCulling = false;
+	ShadowCascades::Settings ShadowCascadeSettings;
 private:
 	// render state
 	CommandBuffer* m_CommandBuffer{};
@@ -71,10 +77,12 @@ private:
 
 	// materials
 	MaterialLibrary* m_MaterialLibrary;
+	MaterialBlockBuffer m_MaterialBlocks;
 
 	// camera
 	Camera* m_Camera{};
 	glm::mat4 m_PrevViewProjection;
+	OcclusionCuller m_OcclusionCuller;
 
 	// render-targets/post
 	std::vector<RenderTarget*> m_RenderTargetsCustom;
@@ -88,7 +96,8 @@ private:
 
 	// shadow buffers
 	std::vector<RenderTarget*> m_ShadowRenderTargets;
-	std::vector<glm::mat4>    m_ShadowViewProjections;
+	std::vector<unsigned int> m_ShadowCasterIndices;
+	unsigned int m_ShadowCasterDrawCount = 0;
 
 	// pbr
 	PBR* m_PBR{};
@@ -124,13 +133,27 @@ public:
 
 	void PushRender(Mesh* mesh, Material* material, glm::mat4 transform = glm::mat4(), glm::mat4 prevFrameTransform = glm::mat4());
 	void PushRender(SceneNode* node);
+	// pushes several scene graphs at once, recorded in parallel; the nodes must not be each
+	// other's ancestors.
+	void PushRender(const std::vector<SceneNode*>& nodes);
 	void PushPostProcessor(Material* postProcessor);
 
+	// designates the mesh as an occluder for this frame's occlusion culling; best suited are
+	// large, simple meshes like walls and floors. The mesh's positions are read when rendering.
+	void PushOccluder(Mesh* mesh, glm::mat4 transform = glm::mat4());
+	// designates all meshes of the scene graph as occluders for this frame.
+	void PushOccluder(SceneNode* node);
+
 	void AddLight(DirectionalLight* light);
 	void AddLight(PointLight* light);
 
 	void RenderPushedCommands();
 
+	// shadow casters drawn over all cascades in the last frame.
+	unsigned int GetShadowCasterDrawCount() const { return m_ShadowCasterDrawCount; }
+	// occluders drawn and boxes rejected by occlusion culling in the last frame.
+	const OcclusionCuller::Stats& GetOcclusionStats() const { return m_OcclusionCuller.GetStats(); }
+
 	void Blit(Texture* src, RenderTarget* dst = nullptr, Material* material = nullptr, std::string textureUniformName = "TexSrc");
 
 	// pbr
@@ -140,10 +163,10 @@ public:
 	void        BakeProbes(SceneNode* scene = nullptr);
 private:
 	// renderer-specific logic for rendering a custom (forward-pass) command
-	void renderCustomCommand(RenderCommand* command, Camera* customCamera, bool updateGLSettings = true);
+	void renderCustomCommand(const RenderCommand* command, Camera* customCamera, bool updateGLSettings = true);
 	// renderer-specific logic for rendering a list of commands to a target cubemap
 	void renderToCubemap(SceneNode* scene, TextureCube* target, glm::vec3 position = glm::vec3(0.0f), unsigned int mipLevel = 0);
-	void renderToCubemap(std::vector<RenderCommand>& renderCommands, TextureCube* target, glm::vec3 position = glm::vec3(0.0f), unsigned int mipLevel = 0);
+	void renderToCubemap(const RenderCommandList& renderCommands, TextureCube* target, glm::vec3 position = glm::vec3(0.0f), unsigned int mipLevel = 0);
 	// minimal render logic to render a mesh 
 	void renderMesh(Mesh* mesh, Shader* shader);
 	// updates the global uniform buffer objects
@@ -159,8 +182,10 @@ private:
 	// render point light
 	void renderDeferredPointLight(PointLight* light);
 
-	// render mesh for shadow buffer generation
-	void renderShadowCastCommand(RenderCommand* command, const glm::mat4& projection, const glm::mat4& view);
+	// set the shadow cascade uniforms of light (may be null) and bind its shadow maps from firstTextureUnit on
+	void bindShadowCascades(Shader* shader, DirectionalLight* light, unsigned int firstTextureUnit);
+	// render mesh for shadow buffer generation; the cascade's view and projection are already set
+	void renderShadowCastCommand(Mesh* mesh, const glm::mat4& transform, UniformHandle modelUniform);
 };
 
 
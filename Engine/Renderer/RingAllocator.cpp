@@ -0,0 +1,55 @@
+#include "RingAllocator.h"
+
+void RingAllocator::Init(size_t capacity, unsigned int slotCount)
+{
+	m_Capacity = capacity;
+	m_Head = 0;
+	m_Tail = 0;
+	m_FrameStart = 0;
+	m_SlotEnds.assign(slotCount > 0 ? slotCount : 1, 0);
+	// the first BeginFrame() starts at slot 0.
+	m_Slot = GetSlotCount() - 1;
+	m_WrapCount = 0;
+}
+
+void RingAllocator::BeginFrame()
+{
+	m_Slot = GetNextSlot();
+	if (m_SlotEnds[m_Slot] > m_Tail)
+	{
+		m_Tail = m_SlotEnds[m_Slot];
+	}
+	m_FrameStart = m_Head;
+}
+
+void RingAllocator::EndFrame()
+{
+	m_SlotEnds[m_Slot] = m_Head;
+}
+
+size_t RingAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (m_Capacity == 0 || size > m_Capacity)
+	{
+		return InvalidOffset;
+	}
+
+	uint64_t position = alignment > 1 ? (m_Head + alignment - 1) / alignment * alignment : m_Head;
+	bool wrapped = false;
+	if (position % m_Capacity + size > m_Capacity)
+	{
+		// skip the rest of the ring, the allocation starts at offset 0.
+		position = (position / m_Capacity + 1) * m_Capacity;
+		wrapped = true;
+	}
+
+	// the allocation may not reach the oldest bytes still in use.
+	if (position + size - m_Tail > m_Capacity)
+	{
+		return InvalidOffset;
+	}
+
+	m_Head = position + size;
+	m_WrapCount += wrapped;
+	return static_cast<size_t>(position % m_Capacity);
+}
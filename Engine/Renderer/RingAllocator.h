@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+
+  Bookkeeping of a ring of per-frame suballocations, without any GL: hands out aligned offsets
+  into a buffer of a fixed capacity and frees them a whole frame at a time, once the frame
+  that used them is known to be done with them.
+
+  Positions grow monotonically and wrap by the capacity, so an allocation never straddles the
+  end of the buffer; the rest of the ring is skipped instead. Frames are recorded in frame
+  slots: EndFrame() stores where the frame's allocations end in the current slot, and the next
+  BeginFrame() that comes round to the slot again releases everything up to there. The owner
+  waits for whatever guards a slot (a GL fence) before calling BeginFrame() on it.
+
+*/
+class RingAllocator
+{
+public:
+	static const size_t InvalidOffset = ~static_cast<size_t>(0);
+
+public:
+	RingAllocator() = default;
+
+	// capacity must be a multiple of every alignment asked for.
+	void Init(size_t capacity, unsigned int slotCount = 3);
+
+	size_t GetCapacity() const { return m_Capacity; }
+	unsigned int GetSlotCount() const { return static_cast<unsigned int>(m_SlotEnds.size()); }
+	// the slot the next BeginFrame() reuses.
+	unsigned int GetNextSlot() const { return (m_Slot + 1) % GetSlotCount(); }
+	unsigned int GetSlot() const { return m_Slot; }
+
+	// makes the next slot current, releasing the allocations of the frame that last used it.
+	void BeginFrame();
+	// closes the current slot's frame; its allocations stay in use until the slot comes round.
+	void EndFrame();
+
+	// offset of size bytes aligned to alignment, or InvalidOffset when the frames in flight
+	// don't leave enough room.
+	size_t Allocate(size_t size, size_t alignment);
+
+	// bytes in use by the current and in-flight frames, including padding.
+	size_t GetUsed() const { return static_cast<size_t>(m_Head - m_Tail); }
+	// bytes allocated since the current frame began, including padding.
+	size_t GetFrameUsed() const { return static_cast<size_t>(m_Head - m_FrameStart); }
+	// times the head wrapped to the start of the buffer.
+	unsigned int GetWrapCount() const { return m_WrapCount; }
+
+private:
+	size_t m_Capacity = 0;
+	// positions; the offset in the buffer is the position modulo the capacity.
+	uint64_t m_Head = 0;
+	uint64_t m_Tail = 0;
+	uint64_t m_FrameStart = 0;
+	std::vector<uint64_t> m_SlotEnds;
+	unsigned int m_Slot = 0;
+	unsigned int m_WrapCount = 0;
+};
@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 
 #include "Camera/Camera.h"
+#include "Camera/FrustumCulling.h"
 
 #include "Mesh/Mesh.h"
 #include "Scene/SceneNode.h"
@@ -10,15 +11,78 @@
 #include "Shading/Material.h"
 #include "MaterialLibrary.h"
 #include "RenderTarget.h"
+#include "RenderDevice.h"
+#include "GeometryArena.h"
 
 #include "Utils/Logger.h"
+#include "Utils/Parallel.h"
+#include "Utils/RadixSort.h"
 #include "DebugDraw.h"
 
 #include <stack>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
 
 #define ENABLE_GLSTATE_CACHE 1
 
+// uniforms set for every draw; their names are hashed at compile time.
+static constexpr UniformName s_uniformModel("model");
+static constexpr UniformName s_uniformPrevModel("prevModel");
+static constexpr UniformName s_uniformView("view");
+static constexpr UniformName s_uniformProjection("projection");
+static constexpr UniformName s_uniformCamPos("CamPos");
+static constexpr UniformName s_uniformInstanced("Instanced");
+static constexpr UniformName s_uniformPackedOrigin("PackedOrigin");
+static constexpr UniformName s_uniformPackedExtent("PackedExtent");
+static constexpr UniformName s_uniformShadowsEnabled("ShadowsEnabled");
+static constexpr UniformName s_uniformCascadeCount("CascadeCount");
+static constexpr UniformName s_uniformCascadeSplits("CascadeSplits");
+static constexpr UniformName s_uniformCascadeMatrices[ShadowCascades::MaxCascadeCount] = { "CascadeViewProjection0", "CascadeViewProjection1", "CascadeViewProjection2", "CascadeViewProjection3" };
+
+// per-frame data (the global block, instance transforms, indirect draws) of the frames in flight.
+static const size_t s_frameRingCapacity = 16 * 1024 * 1024;
+
+// attribute location of the draw index read by the multi draw shaders.
+static const unsigned int s_drawIndexAttribute = 9;
+
+// meshes of one layout share the vertex array, so their draws fall into the same bucket.
+static IndirectMeshRange getIndirectMeshRange(const Mesh* mesh)
+{
+	IndirectMeshRange range;
+	range.VertexArray = mesh->m_VAO;
+	range.Mode = mesh->Topology == TOPOLOGY::TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+	range.IndexCount = static_cast<unsigned int>(mesh->Indices.size());
+	range.FirstIndex = mesh->m_FirstIndex;
+	range.BaseVertex = mesh->m_BaseVertex;
+	range.PackedOrigin = mesh->m_PackedOrigin;
+	range.PackedExtent = mesh->m_PackedExtent;
+	return range;
+}
+
+// how the shader decodes the mesh's vertices, see common/vertex_decode.glsl.
+static void setVertexDecode(Shader* shader, const Mesh* mesh)
+{
+	shader->SetVector(s_uniformPackedOrigin, mesh->m_PackedOrigin);
+	shader->SetVector(s_uniformPackedExtent, mesh->m_PackedExtent);
+}
+
+// the Global uniform block of common/uniforms.glsl, std140.
+struct GlobalBlock
+{
+	glm::mat4 ViewProjection;
+	glm::mat4 PrevViewProjection;
+	glm::mat4 Projection;
+	glm::mat4 View;
+	glm::mat4 InvView;
+	glm::vec4 CamPos;
+	glm::vec4 DirectionalLights[4 * 2];	// direction, color and intensity
+	glm::vec4 PointLights[8 * 2];		// position, color
+};
+static_assert(sizeof(GlobalBlock) == 720, "GlobalBlock must match the std140 layout of the Global block");
+
 SimpleRenderer::~SimpleRenderer()
 {
 	delete m_materialLibrary;
@@ -27,10 +91,14 @@ SimpleRenderer::~SimpleRenderer()
 	{
 		delete m_ShadowRenderTargets[i];
 	}
+	RenderDevice::Get().DeleteBuffer(m_instanceVBO);
+	RenderDevice::Get().DeleteBuffer(m_indirectVBO);
+	RenderDevice::Get().DeleteBuffer(m_drawIndexVBO);
 }
 
 void SimpleRenderer::Init()
 {
+	RenderDevice& device = RenderDevice::Get();
 	m_materialLibrary = new MaterialLibrary();
 
 	// shadows
@@ -42,15 +110,32 @@ void SimpleRenderer::Init()
 		rt->m_DepthStencil.SetFilterMax(GL_NEAREST);
 		rt->m_DepthStencil.SetWrapMode(GL_CLAMP_TO_BORDER);
 		float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+		device.TexParameter(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 		m_ShadowRenderTargets.push_back(rt);
 	}
 
 	// ubo
-	glGenBuffers(1, &m_GlobalUBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, m_GlobalUBO);
-	glBufferData(GL_UNIFORM_BUFFER, 720, nullptr, GL_STREAM_DRAW);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_GlobalUBO);
+	m_GlobalUBO = device.CreateBuffer();
+	device.BindBuffer(GL_UNIFORM_BUFFER, m_GlobalUBO);
+	device.BufferData(GL_UNIFORM_BUFFER, sizeof(GlobalBlock), nullptr, GL_STREAM_DRAW);
+	device.BindBufferBase(GL_UNIFORM_BUFFER, 0, m_GlobalUBO);
+
+	// per-frame data, the instance buffer takes the transforms that don't fit the ring.
+	m_frameRing.Init(s_frameRingCapacity);
+	m_uniformAlignment = std::max(device.GetInteger(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT), 16);
+	m_instanceVBO = device.CreateBuffer();
+
+	// multi draw indirect, the indirect buffer takes the arrays that don't fit the ring.
+	m_multiDrawSupported = device.SupportsMultiDrawIndirect();
+	if (m_multiDrawSupported)
+	{
+		m_storageAlignment = std::max(device.GetInteger(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT), 16);
+		m_indirectVBO = device.CreateBuffer();
+		m_drawIndexVBO = device.CreateBuffer();
+	}
+
+	// material parameter blocks
+	m_materialBlocks.Init();
 }
 
 void SimpleRenderer::SetCamera(Camera* camera)
@@ -95,7 +180,70 @@ void SimpleRenderer::PushRender(Mesh* mesh, Material* material, glm::mat4 transf
 void SimpleRenderer::PushRender(SceneNode* node)
 {
 	node->UpdateTransform(true);
+	RecordNode(node, m_renderCommands);
+}
+
+void SimpleRenderer::PushOccluder(Mesh* mesh, glm::mat4 transform)
+{
+	const unsigned int* indices = mesh->Indices.empty() ? nullptr : mesh->Indices.data();
+	m_occlusionCuller.AddOccluder(mesh->Positions.data(), static_cast<unsigned int>(mesh->Positions.size()),
+		indices, static_cast<unsigned int>(mesh->Indices.size()), transform, mesh->Topology == TOPOLOGY::TRIANGLE_STRIP);
+}
+
+void SimpleRenderer::PushOccluder(SceneNode* node)
+{
+	node->UpdateTransform(true);
+
+	std::stack<SceneNode*> nodeStack;
+	nodeStack.push(node);
+	while (!nodeStack.empty())
+	{
+		SceneNode* current = nodeStack.top();
+		nodeStack.pop();
+		if (current->Mesh)
+		{
+			PushOccluder(current->Mesh, current->GetTransform());
+		}
+		for (unsigned int i = 0; i < current->GetChildCount(); ++i)
+		{
+			nodeStack.push(current->GetChildByIndex(i));
+		}
+	}
+}
+
+void SimpleRenderer::PushRender(const std::vector<SceneNode*>& nodes)
+{
+	// every worker records a contiguous range of the nodes into its own bucket; the buckets are
+	// appended in worker order, so the commands end up in the same order on every run.
+	const unsigned int nodeCount = static_cast<unsigned int>(nodes.size());
+	const unsigned int workerCount = Utils::GetWorkerCount(nodeCount, 64);
+	if (m_recordBuckets.size() < workerCount)
+	{
+		m_recordBuckets.resize(workerCount);
+	}
+
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(nodeCount, workerCount, worker, begin, end);
+		std::vector<RenderCommand>& bucket = m_recordBuckets[worker];
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			nodes[i]->UpdateTransform(true);
+			RecordNode(nodes[i], bucket);
+		}
+	});
+
+	for (unsigned int worker = 0; worker < workerCount; ++worker)
+	{
+		std::vector<RenderCommand>& bucket = m_recordBuckets[worker];
+		m_renderCommands.insert(m_renderCommands.end(), bucket.begin(), bucket.end());
+		bucket.clear();
+	}
+}
 
+void SimpleRenderer::RecordNode(SceneNode* node, std::vector<RenderCommand>& outCommands) const
+{
 	std::stack<SceneNode*> nodeStack;
 	nodeStack.push(node);
 	while (!nodeStack.empty())
@@ -105,8 +253,6 @@ void SimpleRenderer::PushRender(SceneNode* node)
 
 		if (currentNode->Mesh != nullptr) 
 		{
-			const glm::vec3 boxMinWorld = node->GetWorldPosition() + (node->GetWorldScale() * node->BoxMin);
-			const glm::vec3 boxMaxWorld = node->GetWorldPosition() + (node->GetWorldScale() * node->BoxMax);
 			const glm::vec3 boxMin = node->GetLocalPosition() + (node->GetLocalScale() * node->BoxMin);
 			const glm::vec3 boxMax = node->GetLocalPosition() + (node->GetLocalScale() * node->BoxMax);
 
@@ -117,7 +263,7 @@ void SimpleRenderer::PushRender(SceneNode* node)
 			command.PrevTransform = currentNode->GetPrevTransform();
 			command.BoxMin = boxMin;
 			command.BoxMax = boxMax;
-			m_renderCommands.push_back(command);
+			outCommands.push_back(command);
 		}
 
 		for (SceneNode* childNode : currentNode->GetChildren())
@@ -129,33 +275,49 @@ void SimpleRenderer::PushRender(SceneNode* node)
 
 void SimpleRenderer::RenderPushedCommands()
 {
-	glClearColor(0.2f, 0.2f, 0.6f, 1.0f);
-	glViewport(0, 0, m_renderTargetWidth, m_renderTargetHeight);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	// Update Uniform Buffers.
-	glBindBuffer(GL_UNIFORM_BUFFER, m_GlobalUBO);
+	RenderDevice& device = RenderDevice::Get();
+	m_materialBlocks.ResetStats();
+	m_frameRing.BeginFrame();
+
+	// anything may have changed GL state since the last frame.
+	m_glState.SetEnabled(m_enableGLCache);
+	m_glState.Reset();
+	m_glState.ResetStats();
+
+	device.ClearColor(0.2f, 0.2f, 0.6f, 1.0f);
+	m_glState.SetViewport(0, 0, m_renderTargetWidth, m_renderTargetHeight);
+	m_glState.SetDepthWrite(true);
+	device.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// Update Uniform Buffers: the global block is written once per frame into the ring.
+	GlobalBlock globals = {};
 	// transformation matrices
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), &(m_camera->GetProjection() * m_camera->GetView())[0][0]); // sizeof(glm::mat4) = 64 bytes
-	glBufferSubData(GL_UNIFORM_BUFFER, 64, sizeof(glm::mat4), &m_prevViewProjection[0][0]);
-	glBufferSubData(GL_UNIFORM_BUFFER, 128, sizeof(glm::mat4), &m_camera->GetProjection()[0][0]);
-	glBufferSubData(GL_UNIFORM_BUFFER, 192, sizeof(glm::mat4), &m_camera->GetView()[0][0]);
-	glBufferSubData(GL_UNIFORM_BUFFER, 256, sizeof(glm::mat4), &m_camera->GetView()[0][0]); // TODO: make inv function in math library
+	globals.ViewProjection = m_camera->GetProjection() * m_camera->GetView();
+	globals.PrevViewProjection = m_prevViewProjection;
+	globals.Projection = m_camera->GetProjection();
+	globals.View = m_camera->GetView();
+	globals.InvView = m_camera->GetView(); // TODO: make inv function in math library
 	// scene data
-	glBufferSubData(GL_UNIFORM_BUFFER, 320, sizeof(glm::vec4), &m_camera->GetPosition()[0]);
+	globals.CamPos = glm::vec4(m_camera->GetPosition(), 1.0f);
 	// lighting
-	unsigned int stride = 2 * sizeof(glm::vec4);
 	for (unsigned int i = 0; i < m_DirectionalLights.size() && i < 4; ++i) // no more than 4 directional lights
 	{
-		glBufferSubData(GL_UNIFORM_BUFFER, 336 + i * stride, sizeof(glm::vec4), &m_DirectionalLights[i]->m_direction[0]);
-		glBufferSubData(GL_UNIFORM_BUFFER, 336 + i * stride + sizeof(glm::vec4), sizeof(glm::vec4), &m_DirectionalLights[i]->m_color[0]);
+		globals.DirectionalLights[i * 2] = glm::vec4(m_DirectionalLights[i]->m_direction, 0.0f);
+		globals.DirectionalLights[i * 2 + 1] = glm::vec4(m_DirectionalLights[i]->m_color, m_DirectionalLights[i]->m_intensity);
+	}
+	// No PointLights to add, constrained to max 8 point lights in forward context.
+
+	const FrameRingBuffer::Allocation globalsAllocation = m_frameRing.Upload(&globals, sizeof(globals), m_uniformAlignment);
+	if (globalsAllocation.IsValid())
+	{
+		m_glState.BindUniformBufferRange(0, globalsAllocation.Buffer, globalsAllocation.Offset, sizeof(globals));
+	}
+	else
+	{
+		device.BindBuffer(GL_UNIFORM_BUFFER, m_GlobalUBO);
+		device.BufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(globals), &globals);
+		m_glState.BindUniformBuffer(0, m_GlobalUBO);
 	}
-	// No PointLights to add.
-	//for (unsigned int i = 0; i < m_PointLights.size() && i < 8; ++i) //  constrained to max 8 point lights in forward context
-	//{
-	//	glBufferSubData(GL_UNIFORM_BUFFER, 464 + i * stride, sizeof(glm::vec4), &m_PointLights[i]->m_position[0]);
-	//	glBufferSubData(GL_UNIFORM_BUFFER, 464 + i * stride + sizeof(glm::vec4), sizeof(glm::vec4), &m_PointLights[i]->m_color[0]);
-	//}
 
 	const glm::mat4 view = m_camera->GetView();
 	const glm::mat4 projection = m_camera->GetProjection();
@@ -176,179 +338,191 @@ void SimpleRenderer::RenderPushedCommands()
 	}
 	m_renderCommands.clear();
 
+	// bounds of all solids, shared by the shadow caster culling and the frustum culling.
+	m_cullBounds.Clear();
+	m_cullBounds.Reserve(static_cast<unsigned int>(solids.size()));
+	for (const RenderCommand& rc : solids)
+	{
+		m_cullBounds.Push(rc.BoxMin, rc.BoxMax);
+	}
+
+	m_shadowCasterDrawCount = 0;
 	if (m_enableShadows)
 	{
 		m_glState.SetCullFace(GL_FRONT);
-		m_ShadowViewProjections.clear();
+		m_shadowCasterIndices.resize(solids.size());
 
+		// the shadow maps are handed out cascade by cascade, so with one light it gets all of them.
 		unsigned int shadowRtIndex = 0;
 		for (int i = 0; i < m_DirectionalLights.size(); ++i)
 		{
 			DirectionalLight* light = m_DirectionalLights[i];
-			if (light->m_castShadows)
+			light->m_shadowCascadeCount = 0;
+			if (light->m_castShadows && shadowRtIndex < m_ShadowRenderTargets.size())
 			{
-				m_materialLibrary->dirShadowShader->Use();
-				glBindFramebuffer(GL_FRAMEBUFFER, m_ShadowRenderTargets[shadowRtIndex]->ID);
-				glViewport(0, 0, m_ShadowRenderTargets[shadowRtIndex]->Width, m_ShadowRenderTargets[shadowRtIndex]->Height);
-				glClear(GL_DEPTH_BUFFER_BIT);
-
-				glm::mat4 lightProjection = glm::ortho(-20.0f, 20.0f, 20.0f, -20.0f, -15.0f, 20.0f);
-				glm::mat4 lightView = glm::lookAt(-light->m_direction * 10.0f, glm::vec3(0.0), glm::vec3(0, 1, 0));
-
-				m_DirectionalLights[i]->m_lightSpaceViewPrrojection = lightProjection * lightView;
-				m_DirectionalLights[i]->m_shadowMatRenderTarget = m_ShadowRenderTargets[shadowRtIndex];
-
-				for (int j = 0; j < solids.size(); ++j)
+				const unsigned int cascadeCount = std::min(m_shadowCascadeSettings.CascadeCount, static_cast<unsigned int>(m_ShadowRenderTargets.size()) - shadowRtIndex);
+				light->m_shadowCascadeCount = ShadowCascades::FitCascades(view, projection, m_camera->GetNearPlane(), m_camera->GetFarPlane(),
+					light->m_direction, m_shadowCascadeSettings, cascadeCount, light->m_shadowCascades);
+
+				Shader* shadowShader = m_materialLibrary->dirShadowShader;
+				m_glState.SwitchShader(shadowShader->ID);
+				const UniformHandle modelUniform = shadowShader->GetUniform(s_uniformModel);
+				for (unsigned int c = 0; c < light->m_shadowCascadeCount; ++c)
 				{
-					RenderShadowCastCommand(&solids[j], lightView, lightProjection);
+					const ShadowCascades::Cascade& cascade = light->m_shadowCascades[c];
+					RenderTarget* renderTarget = m_ShadowRenderTargets[shadowRtIndex++];
+					light->m_shadowCascadeRenderTargets[c] = renderTarget;
+
+					m_glState.BindFramebuffer(GL_FRAMEBUFFER, renderTarget->ID);
+					m_glState.SetViewport(0, 0, renderTarget->Width, renderTarget->Height);
+					device.Clear(GL_DEPTH_BUFFER_BIT);
+
+					shadowShader->SetMatrix(s_uniformView, cascade.View);
+					shadowShader->SetMatrix(s_uniformProjection, cascade.Projection);
+					const unsigned int casterCount = ShadowCascades::CullCasters(cascade, m_cullBounds.View(), m_shadowCasterIndices.data());
+					for (unsigned int j = 0; j < casterCount; ++j)
+					{
+						RenderShadowCastCommand(&solids[m_shadowCasterIndices[j]], modelUniform);
+					}
+					m_shadowCasterDrawCount += casterCount;
 				}
-				++shadowRtIndex;
 			}
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		m_glState.BindFramebuffer(GL_FRAMEBUFFER, 0);
 		m_glState.SetCullFace(GL_BACK);
 	}
 
-	glClearColor(0.2f, 0.2f, 0.6f, 1.0f);
-	glViewport(0, 0, m_renderTargetWidth, m_renderTargetHeight);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	device.ClearColor(0.2f, 0.2f, 0.6f, 1.0f);
+	m_glState.SetViewport(0, 0, m_renderTargetWidth, m_renderTargetHeight);
+	device.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// Frustum Culling, all solids in one batch.
+	const bool cullSolids = m_enableFrustumCulling || m_enableOcclusionCulling;
+	m_cullMask.resize(FrustumCulling::GetMaskWordCount(m_cullBounds.Size()));
+	if (m_enableFrustumCulling)
+	{
+		FrustumCulling::CullBoxes(m_camera->GetFrustum(), m_cullBounds.View(), m_cullMask.data());
+	}
+	else
+	{
+		std::fill(m_cullMask.begin(), m_cullMask.end(), ~0u);
+	}
 
-	for (RenderCommand rc : solids)
+	// Occlusion Culling, the occluders are drawn on the CPU and only the solids that survived the
+	// frustum are tested against them.
+	if (m_enableOcclusionCulling)
 	{
+		m_occlusionCuller.Render(projection * view);
+		m_occlusionCuller.CullBoxes(m_cullBounds.View(), m_cullMask.data());
+	}
 
-		// Frustum Culling.
-		if (m_enableFrustumCulling && !m_camera->GetFrustum().Intersect(rc.BoxMin, rc.BoxMax)) {
-			// DebugDraw::AddAABB(rc.BoxMin, rc.BoxMax, { 1.0f, 1.0f, 1.0f, 1.0f });
+	// order the visible solids by shader, material and mesh so equal draws are adjacent, then
+	// collapse them into instanced batches.
+	m_drawKeys.clear();
+	m_drawOrder.clear();
+	for (unsigned int i = 0; i < solids.size(); ++i)
+	{
+		if (cullSolids && (m_cullMask[i / 32] & (1u << (i % 32))) == 0) {
+			// DebugDraw::AddAABB(solids[i].BoxMin, solids[i].BoxMax, { 1.0f, 1.0f, 1.0f, 1.0f });
 			continue;
 		}
 
-		// DebugDraw::AddAABB(rc.BoxMin, rc.BoxMax, { 0.0f, 1.0f, 0.0f, 1.0f });
+		// DebugDraw::AddAABB(solids[i].BoxMin, solids[i].BoxMax, { 0.0f, 1.0f, 0.0f, 1.0f });
 
-		Shader* currentShader = rc.Material->GetShader();
+		const uint64_t shader = solids[i].Material->GetShader()->ID & 0xffff;
+		const uint64_t material = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(solids[i].Material)) * 0x9e3779b97f4a7c15ull) >> 40;
+		// meshes share their vertex array with the others of their layout: the vertex array goes
+		// first so they stay together, the mesh after it so runs of one mesh stay adjacent.
+		const uint64_t vertexArray = solids[i].Mesh->m_VAO & 0xff;
+		const uint64_t mesh = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(solids[i].Mesh)) * 0x9e3779b97f4a7c15ull) >> 48;
+		m_drawKeys.push_back((shader << 48) | (material << 24) | (vertexArray << 16) | mesh);
+		m_drawOrder.push_back(i);
+	}
+	Utils::RadixSort(m_drawKeys, m_drawOrder, 64, m_drawKeysTemp, m_drawOrderTemp);
 
-		if (m_enableGLCache) 
+	// solids whose shader has a multi draw variant and whose mesh is indexed go out as multi
+	// draws, one per state bucket; the rest are batched. Both keep the sorted order.
+	m_indirectOrder.clear();
+	if (m_enableMultiDraw && m_multiDrawSupported)
+	{
+		unsigned int batchedCount = 0;
+		Shader* lastShader = nullptr;
+		bool lastHasVariant = false;
+		for (unsigned int index : m_drawOrder)
 		{
-			m_glState.SetBlend(rc.Material->Blend);
-			if (rc.Material->Blend)
+			const RenderCommand& rc = solids[index];
+			Shader* shader = rc.Material->GetShader();
+			if (shader != lastShader)
 			{
-				m_glState.SetBlendFunc(rc.Material->BlendSrc, rc.Material->BlendDst);
+				lastShader = shader;
+				lastHasVariant = m_materialLibrary->GetMultiDrawShader(shader) != nullptr;
 			}
-			m_glState.SetDepthFunc(rc.Material->DepthCompare);
-			m_glState.SetDepthTest(rc.Material->DepthTest);
-			m_glState.SetCull(rc.Material->Cull);
-			m_glState.SetCullFace(rc.Material->CullFace);
 
-			m_glState.SwitchShader(currentShader->ID);
-		}
-		else 
-		{
-			// Blend
-			if (rc.Material->Blend) 
-			{ 
-				glEnable(GL_BLEND);
-				glBlendFunc(rc.Material->BlendSrc, rc.Material->BlendDst);
-			}
-			else 
-			{ 
-				glDisable(GL_BLEND); 
-			}
-
-			glEnable(rc.Material->Cull);
-			glDepthFunc(rc.Material->DepthCompare);
-			if (rc.Material->DepthTest)
-			{
-				glEnable(GL_DEPTH_TEST);
-			}
-			else
-			{
-				glDisable(GL_DEPTH_TEST);
-			}
-
-			if (rc.Material->Cull)
+			if (lastHasVariant && !rc.Mesh->Indices.empty())
 			{
-				glEnable(GL_CULL_FACE);
+				m_indirectOrder.push_back(index);
 			}
 			else
 			{
-				glDisable(GL_CULL_FACE);
+				m_drawOrder[batchedCount++] = index;
 			}
-			glCullFace(rc.Material->CullFace);
-			currentShader->Use();
 		}
+		m_drawOrder.resize(batchedCount);
+	}
+	m_indirectDraws.Build(solids.data(), m_indirectOrder.data(), static_cast<unsigned int>(m_indirectOrder.size()), &getIndirectMeshRange);
+	if (m_indirectDraws.GetDrawCount() > 0)
+	{
+		RenderIndirectDraws(view, projection, cameraPosition);
+	}
 
-		currentShader->SetMatrix("view", view);
-		currentShader->SetMatrix("projection", projection);
-		currentShader->SetVector("CamPos", cameraPosition);
-
-		currentShader->SetMatrix("model", rc.Transform);
-		currentShader->SetMatrix("prevModel", rc.PrevTransform);
+	m_instanceBatcher.SetMinInstanceCount(m_enableInstancing ? 2 : std::numeric_limits<unsigned int>::max());
+	m_instanceBatcher.Build(solids.data(), m_drawOrder.data(), static_cast<unsigned int>(m_drawOrder.size()), [](Material* material)
+	{
+		return material->GetShader()->HasUniform(s_uniformInstanced);
+	});
 
-		currentShader->SetBool("ShadowsEnabled", m_enableShadows);
-		if (m_enableShadows && rc.Material->Type == MATERIAL_CUSTOM && rc.Material->ShadowReceive)
+	// all instance transforms of the frame go into one range of the ring, or into the instance
+	// buffer, orphaned, when the ring is out of room.
+	const std::vector<glm::mat4>& instanceTransforms = m_instanceBatcher.GetInstanceTransforms();
+	if (!instanceTransforms.empty())
+	{
+		const size_t size = instanceTransforms.size() * sizeof(glm::mat4);
+		const FrameRingBuffer::Allocation instances = m_frameRing.Upload(instanceTransforms.data(), size);
+		if (instances.IsValid())
 		{
-			for (int i = 0; i < m_DirectionalLights.size(); ++i)
-			{
-				if (m_DirectionalLights[i]->m_shadowMatRenderTarget)
-				{
-					currentShader->SetMatrix("lightShadowViewProjection" + std::to_string(i + 1), m_DirectionalLights[i]->m_lightSpaceViewPrrojection);
-					m_DirectionalLights[i]->m_shadowMatRenderTarget->GetDepthStencilTexture()->Bind(10 + i);
-				}
-			}
+			m_instanceBuffer = instances.Buffer;
+			m_instanceBufferOffset = instances.Offset;
 		}
-
-		std::map<std::string, UniformValueSampler>* samplers = rc.Material->GetSamplerUniforms();
-		for (auto it = samplers->begin(), end = samplers->end(); it != end; ++it)
+		else
 		{
-			if (it->second.Type == SHADER_TYPE_SAMPLERCUBE) 
-			{
-				it->second.TextureCube->Bind(it->second.Unit);
-			}
-			else
-			{
-				it->second.Texture->Bind(it->second.Unit);
-			}
+			device.BindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+			device.BufferData(GL_ARRAY_BUFFER, size, instanceTransforms.data(), GL_STREAM_DRAW);
+			m_instanceBuffer = m_instanceVBO;
+			m_instanceBufferOffset = 0;
 		}
+	}
 
-		std::map<std::string, UniformValue>* uniforms = rc.Material->GetUniforms();
-		for (auto it = uniforms->begin(), end = uniforms->end(); it != end; ++it)
+	for (const InstanceBatch& batch : m_instanceBatcher.GetBatches())
+	{
+		Shader* currentShader = batch.Material->GetShader();
+		BindMaterial(batch.Material, view, projection, cameraPosition);
+
+		currentShader->SetBool(s_uniformInstanced, batch.Instanced);
+		if (batch.Instanced)
 		{
-			switch (it->second.Type)
-			{
-			case SHADER_TYPE_BOOL:
-				currentShader->SetBool(it->first, it->second.Bool);
-				break;
-			case SHADER_TYPE_INT:
-				currentShader->SetInt(it->first, it->second.Int);
-				break;
-			case SHADER_TYPE_FLOAT:
-				currentShader->SetFloat(it->first, it->second.Float);
-				break;
-			case SHADER_TYPE_VEC2:
-				currentShader->SetVector(it->first, it->second.Vec2);
-				break;
-			case SHADER_TYPE_VEC3:
-				currentShader->SetVector(it->first, it->second.Vec3);
-				break;
-			case SHADER_TYPE_VEC4:
-				currentShader->SetVector(it->first, it->second.Vec4);
-				break;
-			case SHADER_TYPE_MAT2:
-				currentShader->SetMatrix(it->first, it->second.Mat2);
-				break;
-			case SHADER_TYPE_MAT3:
-				currentShader->SetMatrix(it->first, it->second.Mat3);
-				break;
-			case SHADER_TYPE_MAT4:
-				currentShader->SetMatrix(it->first, it->second.Mat4);
-				break;
-			default:
-				LOG_ERROR("Unrecognized Uniform type set.");
-				break;
-			}
+			setVertexDecode(currentShader, batch.Mesh);
+			RenderMeshInstanced(batch.Mesh, batch.FirstInstance, batch.Count);
 		}
+		else
+		{
+			const RenderCommand& rc = solids[m_drawOrder[batch.FirstCommand]];
+			currentShader->SetMatrix(s_uniformModel, rc.Transform);
+			currentShader->SetMatrix(s_uniformPrevModel, rc.PrevTransform);
+			setVertexDecode(currentShader, rc.Mesh);
 
-		// Render Mesh
-		RenderMesh(rc.Mesh);
+			// Render Mesh
+			RenderMesh(rc.Mesh);
+		}
 	}
 	solids.clear();
 
@@ -484,6 +658,8 @@ void SimpleRenderer::RenderPushedCommands()
 
 	// store view projection as previous view projection for next frame's motion blur
 	m_prevViewProjection = m_camera->GetProjection() * m_camera->GetView();
+	m_occlusionCuller.ClearOccluders();
+	m_frameRing.EndFrame();
 }
 
 void SimpleRenderer::RenderUIMenu()
@@ -491,36 +667,318 @@ void SimpleRenderer::RenderUIMenu()
 	if (ImGui::BeginMenu("Simple Renderer"))
 	{
 		ImGui::Checkbox("Enable Frustum Culling", &m_enableFrustumCulling);
+		ImGui::Text("Culling ISA: %s", FrustumCulling::GetIsaName(FrustumCulling::GetActiveIsa()));
+		ImGui::Checkbox("Enable Occlusion Culling", &m_enableOcclusionCulling);
+		const OcclusionCuller::Stats& occlusionStats = m_occlusionCuller.GetStats();
+		ImGui::Text("Occluders drawn: %u (%u triangles)", occlusionStats.OccludersDrawn, occlusionStats.TrianglesDrawn);
+		ImGui::Text("Occluded: %u of %u tested", occlusionStats.BoxesRejected, occlusionStats.BoxesTested);
 		ImGui::Checkbox("Enable GL Cache", &m_enableGLCache);
 		ImGui::Checkbox("Enable Shadows", &m_enableShadows);
+		int cascadeCount = static_cast<int>(m_shadowCascadeSettings.CascadeCount);
+		if (ImGui::SliderInt("Shadow Cascades", &cascadeCount, 1, ShadowCascades::MaxCascadeCount))
+		{
+			m_shadowCascadeSettings.CascadeCount = static_cast<unsigned int>(cascadeCount);
+		}
+		ImGui::SliderFloat("Cascade Split Lambda", &m_shadowCascadeSettings.SplitLambda, 0.0f, 1.0f);
+		ImGui::Text("Shadow casters drawn: %u", m_shadowCasterDrawCount);
+		ImGui::Checkbox("Enable Instancing", &m_enableInstancing);
+		ImGui::Text("Draws: %u (%u commands instanced)", static_cast<unsigned int>(m_instanceBatcher.GetBatches().size()), m_instanceBatcher.GetInstancedCommandCount());
+		if (m_multiDrawSupported)
+		{
+			ImGui::Checkbox("Enable Multi Draw Indirect", &m_enableMultiDraw);
+			ImGui::Text("Multi draws: %u (%u commands, %u draws)", static_cast<unsigned int>(m_indirectDraws.GetBuckets().size()),
+				static_cast<unsigned int>(m_indirectDraws.GetCommands().size()), m_indirectDraws.GetDrawCount());
+		}
+		ImGui::Text("Material blocks uploaded: %u", m_materialBlocks.GetUploadCount());
+		ImGui::Text("Frame ring: %u KB in %u allocations (%s), %u stalls", static_cast<unsigned int>(m_frameRing.GetFrameBytes() / 1024), m_frameRing.GetFrameAllocationCount(),
+			m_frameRing.IsPersistent() ? "persistent" : "orphaned", m_frameRing.GetStallCount());
+		if (ImGui::TreeNode("Geometry arena"))
+		{
+			GeometryArena& arena = GeometryArena::Get();
+			for (unsigned int i = 0; i < arena.GetPoolCount(); ++i)
+			{
+				const GeometryArena::PoolStats stats = arena.GetPoolStats(i);
+				ImGui::Text("Layout %u (%u byte vertices): %u meshes, %u compactions", stats.Layout, stats.Stride, stats.Vertices.Allocations, stats.Compactions);
+				ImGui::Text("  Vertices: %u / %u KB used, %.0f%% fragmented", static_cast<unsigned int>(stats.Vertices.Used * stats.Stride / 1024),
+					static_cast<unsigned int>(stats.Vertices.Capacity * stats.Stride / 1024), stats.Vertices.GetFragmentation() * 100.0f);
+				ImGui::Text("  Indices: %u / %u KB used, %.0f%% fragmented", static_cast<unsigned int>(stats.Indices.Used * sizeof(unsigned int) / 1024),
+					static_cast<unsigned int>(stats.Indices.Capacity * sizeof(unsigned int) / 1024), stats.Indices.GetFragmentation() * 100.0f);
+			}
+			if (ImGui::Button("Defragment"))
+			{
+				arena.Defragment(0.0f);
+			}
+			ImGui::TreePop();
+		}
+		if (ImGui::TreeNode("GL state calls (issued / skipped)"))
+		{
+			for (int i = 0; i < static_cast<int>(GLStateCache::Call::Count); ++i)
+			{
+				const GLStateCache::Call call = static_cast<GLStateCache::Call>(i);
+				const GLStateCache::CallCount& count = m_glState.GetCallCount(call);
+				ImGui::Text("%s: %u / %u", GLStateCache::GetCallName(call), count.Issued, count.Skipped);
+			}
+			ImGui::TreePop();
+		}
 		ImGui::EndMenu();
 	}
 }
 
-void SimpleRenderer::RenderShadowCastCommand(RenderCommand* rc, const glm::mat4& view, const glm::mat4& projection)
+void SimpleRenderer::BindMaterial(Material* material, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, Shader* shader)
+{
+	Shader* currentShader = shader ? shader : material->GetShader();
+
+	// with the cache disabled every call still goes through it, just unfiltered.
+	m_glState.SetBlend(material->Blend);
+	if (material->Blend)
+	{
+		m_glState.SetBlendFunc(material->BlendSrc, material->BlendDst);
+	}
+	m_glState.SetDepthFunc(material->DepthCompare);
+	m_glState.SetDepthTest(material->DepthTest);
+	m_glState.SetDepthWrite(material->DepthWrite);
+	m_glState.SetCull(material->Cull);
+	m_glState.SetCullFace(material->CullFace);
+
+	m_glState.SwitchShader(currentShader->ID);
+
+	currentShader->SetMatrix(s_uniformView, view);
+	currentShader->SetMatrix(s_uniformProjection, projection);
+	currentShader->SetVector(s_uniformCamPos, cameraPosition);
+
+	currentShader->SetBool(s_uniformShadowsEnabled, m_enableShadows);
+	if (m_enableShadows && material->Type == MATERIAL_CUSTOM && material->ShadowReceive)
+	{
+		// the forward shaders take the cascades of the first shadowed light.
+		DirectionalLight* shadowLight = nullptr;
+		for (int i = 0; i < m_DirectionalLights.size() && !shadowLight; ++i)
+		{
+			if (m_DirectionalLights[i]->m_shadowCascadeCount > 0)
+			{
+				shadowLight = m_DirectionalLights[i];
+			}
+		}
+		BindShadowCascades(currentShader, shadowLight, 10);
+	}
+
+	std::map<std::string, UniformValueSampler>* samplers = material->GetSamplerUniforms();
+	for (auto it = samplers->begin(), end = samplers->end(); it != end; ++it)
+	{
+		if (it->second.Type == SHADER_TYPE_SAMPLERCUBE) 
+		{
+			m_glState.BindTexture(it->second.Unit, GL_TEXTURE_CUBE_MAP, it->second.TextureCube->ID);
+		}
+		else
+		{
+			m_glState.BindTexture(it->second.Unit, it->second.Texture->Target, it->second.Texture->ID);
+		}
+
+		// only the material's own shader was told the texture units.
+		if (currentShader != material->GetShader())
+		{
+			currentShader->SetInt(it->first, it->second.Unit);
+		}
+	}
+
+	// the material block is only uploaded when it changed; what's left are the parameters the
+	// shader doesn't declare in its material block.
+	m_materialBlocks.Bind(material, m_glState);
+
+	std::map<std::string, UniformValue>* uniforms = material->GetUniforms();
+	const std::vector<UniformHandle>& handles = material->GetUniformHandles(currentShader);
+	unsigned int index = 0;
+	for (auto it = uniforms->begin(), end = uniforms->end(); it != end; ++it, ++index)
+	{
+		switch (it->second.Type)
+		{
+		case SHADER_TYPE_BOOL:
+			currentShader->SetBool(handles[index], it->second.Bool);
+			break;
+		case SHADER_TYPE_INT:
+			currentShader->SetInt(handles[index], it->second.Int);
+			break;
+		case SHADER_TYPE_FLOAT:
+			currentShader->SetFloat(handles[index], it->second.Float);
+			break;
+		case SHADER_TYPE_VEC2:
+			currentShader->SetVector(handles[index], it->second.Vec2);
+			break;
+		case SHADER_TYPE_VEC3:
+			currentShader->SetVector(handles[index], it->second.Vec3);
+			break;
+		case SHADER_TYPE_VEC4:
+			currentShader->SetVector(handles[index], it->second.Vec4);
+			break;
+		case SHADER_TYPE_MAT2:
+			currentShader->SetMatrix(handles[index], it->second.Mat2);
+			break;
+		case SHADER_TYPE_MAT3:
+			currentShader->SetMatrix(handles[index], it->second.Mat3);
+			break;
+		case SHADER_TYPE_MAT4:
+			currentShader->SetMatrix(handles[index], it->second.Mat4);
+			break;
+		default:
+			LOG_ERROR("Unrecognized Uniform type set.");
+			break;
+		}
+	}
+}
+
+void SimpleRenderer::BindShadowCascades(Shader* shader, DirectionalLight* light, unsigned int firstTextureUnit)
+{
+	const unsigned int cascadeCount = light ? light->m_shadowCascadeCount : 0;
+	shader->SetInt(s_uniformCascadeCount, cascadeCount);
+	if (cascadeCount == 0)
+	{
+		return;
+	}
+
+	glm::vec4 splits;
+	for (unsigned int c = 0; c < ShadowCascades::MaxCascadeCount; ++c)
+	{
+		splits[c] = light->m_shadowCascades[std::min(c, cascadeCount - 1)].SplitFar;
+	}
+	shader->SetVector(s_uniformCascadeSplits, splits);
+
+	for (unsigned int c = 0; c < cascadeCount; ++c)
+	{
+		shader->SetMatrix(s_uniformCascadeMatrices[c], light->m_shadowCascades[c].ViewProjection);
+		Texture* shadowMap = light->m_shadowCascadeRenderTargets[c]->GetDepthStencilTexture();
+		m_glState.BindTexture(firstTextureUnit + c, shadowMap->Target, shadowMap->ID);
+	}
+}
+
+void SimpleRenderer::RenderShadowCastCommand(RenderCommand* rc, UniformHandle modelUniform)
 {
 	Shader* shadowShader = m_materialLibrary->dirShadowShader;
 
-	shadowShader->SetMatrix("view", view);
-	shadowShader->SetMatrix("projection", projection);
-	shadowShader->SetMatrix("model", rc->Transform);
+	shadowShader->SetMatrix(modelUniform, rc->Transform);
+	setVertexDecode(shadowShader, rc->Mesh);
 
 	RenderMesh(rc->Mesh);
 }
 
 
+void SimpleRenderer::RenderMeshInstanced(Mesh* mesh, unsigned int firstInstance, unsigned int instanceCount)
+{
+	RenderDevice& device = RenderDevice::Get();
+	m_glState.BindVertexArray(mesh->m_VAO);
+
+	// the instance transform is a mat4 attribute taking locations 5 to 8, one column each. GL 3.3
+	// has no base instance, so the batch's range is selected through the attribute offset.
+	device.BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	for (unsigned int column = 0; column < 4; ++column)
+	{
+		const size_t offset = m_instanceBufferOffset + firstInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4);
+		device.EnableVertexAttribute(5 + column, 4, GL_FLOAT, false, sizeof(glm::mat4), offset);
+		device.VertexAttribDivisor(5 + column, 1);
+	}
+
+	const GLenum mode = mesh->Topology == TOPOLOGY::TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+	if (!mesh->Indices.empty())
+	{
+		device.DrawElementsInstancedBaseVertex(mode, mesh->Indices.size(), GL_UNSIGNED_INT, mesh->m_FirstIndex * sizeof(unsigned int), instanceCount, mesh->m_BaseVertex);
+	}
+	else
+	{
+		device.DrawArraysInstanced(mode, mesh->m_BaseVertex, mesh->Positions.size(), instanceCount);
+	}
+
+	// the vertex array is shared with non instanced draws of the mesh.
+	for (unsigned int column = 0; column < 4; ++column)
+	{
+		device.DisableVertexAttribute(5 + column);
+	}
+}
+
+void SimpleRenderer::RenderIndirectDraws(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition)
+{
+	RenderDevice& device = RenderDevice::Get();
+	const std::vector<DrawElementsIndirectCommand>& commands = m_indirectDraws.GetCommands();
+	const std::vector<IndirectDrawData>& drawData = m_indirectDraws.GetDrawData();
+	const std::vector<glm::mat4>& transforms = m_indirectDraws.GetTransforms();
+	const std::vector<IndirectMeshData>& meshData = m_indirectDraws.GetMeshData();
+
+	// commands, per-draw data, transforms and per-mesh data go into one range, the storage
+	// blocks at offsets aligned for binding.
+	const size_t alignment = static_cast<size_t>(m_storageAlignment);
+	const size_t commandsSize = commands.size() * sizeof(DrawElementsIndirectCommand);
+	const size_t drawDataSize = drawData.size() * sizeof(IndirectDrawData);
+	const size_t transformsSize = transforms.size() * sizeof(glm::mat4);
+	const size_t meshDataSize = meshData.size() * sizeof(IndirectMeshData);
+	const size_t drawDataOffset = (commandsSize + alignment - 1) / alignment * alignment;
+	const size_t transformsOffset = (drawDataOffset + drawDataSize + alignment - 1) / alignment * alignment;
+	const size_t meshDataOffset = (transformsOffset + transformsSize + alignment - 1) / alignment * alignment;
+	const size_t size = meshDataOffset + meshDataSize;
+
+	unsigned int buffer = m_indirectVBO;
+	size_t offset = 0;
+	const FrameRingBuffer::Allocation allocation = m_frameRing.Allocate(size, alignment);
+	if (allocation.IsValid())
+	{
+		std::memcpy(allocation.Data, commands.data(), commandsSize);
+		std::memcpy(allocation.Data + drawDataOffset, drawData.data(), drawDataSize);
+		std::memcpy(allocation.Data + transformsOffset, transforms.data(), transformsSize);
+		std::memcpy(allocation.Data + meshDataOffset, meshData.data(), meshDataSize);
+		m_frameRing.Commit(allocation);
+		buffer = allocation.Buffer;
+		offset = allocation.Offset;
+	}
+	else
+	{
+		device.BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectVBO);
+		device.BufferData(GL_DRAW_INDIRECT_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		device.BufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandsSize, commands.data());
+		device.BufferSubData(GL_DRAW_INDIRECT_BUFFER, drawDataOffset, drawDataSize, drawData.data());
+		device.BufferSubData(GL_DRAW_INDIRECT_BUFFER, transformsOffset, transformsSize, transforms.data());
+		device.BufferSubData(GL_DRAW_INDIRECT_BUFFER, meshDataOffset, meshDataSize, meshData.data());
+	}
+
+	// the draw index attribute reads 0, 1, 2, ... from the command's base instance on; the
+	// buffer only grows.
+	if (m_drawIndexCount < drawData.size())
+	{
+		m_drawIndexCount = std::max(static_cast<unsigned int>(drawData.size()), m_drawIndexCount * 2);
+		std::vector<uint32_t> drawIndices(m_drawIndexCount);
+		std::iota(drawIndices.begin(), drawIndices.end(), 0u);
+		device.BindBuffer(GL_ARRAY_BUFFER, m_drawIndexVBO);
+		device.BufferData(GL_ARRAY_BUFFER, drawIndices.size() * sizeof(uint32_t), drawIndices.data(), GL_STATIC_DRAW);
+	}
+
+	device.BindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+	device.BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, buffer, offset + drawDataOffset, drawDataSize);
+	device.BindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, buffer, offset + transformsOffset, transformsSize);
+	device.BindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, buffer, offset + meshDataOffset, meshDataSize);
+
+	for (const IndirectDrawBucket& bucket : m_indirectDraws.GetBuckets())
+	{
+		BindMaterial(bucket.Material, view, projection, cameraPosition, m_materialLibrary->GetMultiDrawShader(bucket.Material->GetShader()));
+
+		m_glState.BindVertexArray(bucket.VertexArray);
+		device.BindBuffer(GL_ARRAY_BUFFER, m_drawIndexVBO);
+		device.EnableIntegerVertexAttribute(s_drawIndexAttribute, 1, GL_UNSIGNED_INT, sizeof(uint32_t), 0);
+		device.VertexAttribDivisor(s_drawIndexAttribute, 1);
+
+		device.MultiDrawElementsIndirect(bucket.Mode, GL_UNSIGNED_INT, offset + bucket.FirstCommand * sizeof(DrawElementsIndirectCommand), bucket.CommandCount, 0);
+
+		// the vertex array is shared with the other draws of its meshes.
+		device.DisableVertexAttribute(s_drawIndexAttribute);
+	}
+}
+
 void SimpleRenderer::RenderMesh(Mesh* mesh)
 {
 	// Render Mesh
-	glBindVertexArray(mesh->m_VAO);
+	m_glState.BindVertexArray(mesh->m_VAO);
 
 	const GLenum mode = mesh->Topology == TOPOLOGY::TRIANGLE_STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
 	if (!mesh->Indices.empty())
 	{
-		glDrawElements(mode, mesh->Indices.size(), GL_UNSIGNED_INT, 0);
+		RenderDevice::Get().DrawElementsBaseVertex(mode, mesh->Indices.size(), GL_UNSIGNED_INT, mesh->m_FirstIndex * sizeof(unsigned int), mesh->m_BaseVertex);
 	}
 	else
 	{
-		glDrawArrays(mode, 0, mesh->Positions.size());
+		RenderDevice::Get().DrawArrays(mode, mesh->m_BaseVertex, mesh->Positions.size());
 	}
 }
\ No newline at end of file
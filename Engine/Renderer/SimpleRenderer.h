@@ -8,6 +8,16 @@
 #include "IRenderer.h"
 #include "RenderCommand.h"
 #include "GLStateCache.h"
+#include "InstanceBatcher.h"
+#include "IndirectDrawBuilder.h"
+#include "MaterialBlockBuffer.h"
+#include "FrameRingBuffer.h"
+
+#include "Shading/ShadingTypes.h"
+
+#include "Camera/FrustumCulling.h"
+#include "Camera/OcclusionCulling.h"
+#include "Lighting/ShadowCascades.h"
 
 #include "DebugDraw.h"
 
@@ -36,6 +46,15 @@ public:
 
 	void PushRender(Mesh* mesh, Material* material, glm::mat4 transform = glm::mat4(1.0f), glm::mat4 prevTransform = glm::mat4(1.0f));
 	void PushRender(SceneNode* node);
+	// pushes several scene graphs at once, recorded in parallel; the nodes must not be each
+	// other's ancestors.
+	void PushRender(const std::vector<SceneNode*>& nodes);
+
+	// designates the mesh as an occluder for this frame's occlusion culling; the mesh's positions
+	// are read when rendering.
+	void PushOccluder(Mesh* mesh, glm::mat4 transform = glm::mat4(1.0f));
+	// designates all meshes of the scene graph as occluders for this frame.
+	void PushOccluder(SceneNode* node);
 
 	void AddLight(DirectionalLight* light) { m_DirectionalLights.push_back(light); }
 
@@ -47,18 +66,62 @@ public:
 	void RenderUIMenu();
 
 private:
-	void RenderShadowCastCommand(RenderCommand* rc, const glm::mat4& view, const glm::mat4& projection);
+	// appends the render commands of the scene graph under node, reading nothing but the nodes.
+	void RecordNode(SceneNode* node, std::vector<RenderCommand>& outCommands) const;
+	// sets the material's render state, shader uniforms and samplers, everything but the transforms;
+	// shader stands in for the material's shader when set.
+	void BindMaterial(Material* material, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, Shader* shader = nullptr);
+	// sets the shadow cascade uniforms and binds the cascade shadow maps from firstTextureUnit on; light may be null.
+	void BindShadowCascades(Shader* shader, DirectionalLight* light, unsigned int firstTextureUnit);
+	// draws a shadow caster with the cascade's view and projection already set.
+	void RenderShadowCastCommand(RenderCommand* rc, UniformHandle modelUniform);
 	void RenderMesh(Mesh* mesh);
+	// draws instanceCount instances of mesh, reading the transforms from the instance buffer starting at firstInstance.
+	void RenderMeshInstanced(Mesh* mesh, unsigned int firstInstance, unsigned int instanceCount);
+	// uploads the arrays of m_indirectDraws and issues a multi draw per bucket.
+	void RenderIndirectDraws(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition);
 
 private:
 	std::vector<RenderCommand> m_renderCommands;
+	// per worker recording buckets, kept to avoid reallocating every frame.
+	std::vector<std::vector<RenderCommand>> m_recordBuckets;
+
+	// frustum culling
+	FrustumCulling::BoundsArray m_cullBounds;
+	std::vector<uint32_t> m_cullMask;
+
+	// occlusion culling, the visible solids are also tested against the occluders pushed this frame.
+	OcclusionCuller m_occlusionCuller;
+
+	// instancing; the visible solids are drawn in m_drawOrder, sorted by m_drawKeys.
+	std::vector<uint64_t> m_drawKeys;
+	std::vector<uint64_t> m_drawKeysTemp;
+	std::vector<unsigned int> m_drawOrder;
+	std::vector<unsigned int> m_drawOrderTemp;
+	InstanceBatcher m_instanceBatcher;
+	unsigned int m_instanceVBO = 0;
+	// where this frame's instance transforms are, the ring or m_instanceVBO.
+	unsigned int m_instanceBuffer = 0;
+	size_t m_instanceBufferOffset = 0;
+
+	// multi draw indirect; the solids taken out of m_drawOrder for it are in m_indirectOrder.
+	std::vector<unsigned int> m_indirectOrder;
+	IndirectDrawBuilder m_indirectDraws;
+	unsigned int m_indirectVBO = 0;
+	// 0, 1, 2, ... for the draw index attribute of the multi draw shaders.
+	unsigned int m_drawIndexVBO = 0;
+	unsigned int m_drawIndexCount = 0;
+	int m_storageAlignment = 256;
+	bool m_multiDrawSupported = false;
 
 	// lighting
 	std::vector<DirectionalLight*> m_DirectionalLights;
 
 	// shadow buffers
 	std::vector<RenderTarget*> m_ShadowRenderTargets;
-	std::vector<glm::mat4>    m_ShadowViewProjections;
+	ShadowCascades::Settings m_shadowCascadeSettings;
+	std::vector<unsigned int> m_shadowCasterIndices;
+	unsigned int m_shadowCasterDrawCount = 0;
 
 	int m_renderTargetHeight;
 	int m_renderTargetWidth;
@@ -68,12 +131,18 @@ private:
 
 	GLStateCache m_glState;
 	MaterialLibrary* m_materialLibrary;
+	MaterialBlockBuffer m_materialBlocks;
 
 	bool m_enableGLCache = true;
 	bool m_enableFrustumCulling = false;
+	bool m_enableOcclusionCulling = false;
 	bool m_enableShadows = true;
+	bool m_enableInstancing = true;
+	bool m_enableMultiDraw = true;
 
-	// ubo
+	// ubo; the global block normally lives in the frame ring, m_GlobalUBO is used when the ring is full.
 	unsigned int m_GlobalUBO;
+	FrameRingBuffer m_frameRing;
+	int m_uniformAlignment = 256;
 };
 
@@ -16,6 +16,7 @@
 
 
 std::vector<Mesh*> MeshLoader::meshStore = std::vector<Mesh*>();
+VERTEX_ENCODING MeshLoader::VertexEncoding = VERTEX_ENCODING::FLOAT;
 
 void MeshLoader::Clean()
 {
@@ -159,6 +160,7 @@ Mesh* MeshLoader::parseMesh(aiMesh* aMesh, const aiScene* aScene, glm::vec3& out
 	mesh->Bitangents = bitangents;
 	mesh->Indices = indices;
 	mesh->Topology = TOPOLOGY::TRIANGLES;
+	mesh->Encoding = VertexEncoding;
 	mesh->Finalize(true);
 
 	out_Min.x = pMin.x;
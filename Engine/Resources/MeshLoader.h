@@ -16,6 +16,7 @@ class IRenderer;
 class SceneNode;
 class Mesh;
 class Material;
+enum class VERTEX_ENCODING;
 
 /*
 
@@ -28,6 +29,10 @@ private:
 	// NOTE(Joey): keep track of all loaded mesh
 	static std::vector<Mesh*> meshStore;
 public:
+	// encoding of the meshes loaded from then on, float by default. Scenes whose materials all
+	// use shaders that include common/vertex_decode.glsl can set PACKED before loading.
+	static VERTEX_ENCODING VertexEncoding;
+
 	static void       Clean();
 	static SceneNode* LoadMesh(IRenderer* renderer, std::string path, bool setDefaultMaterial = true);
 private:
@@ -2,6 +2,7 @@
 
 #include "Shading/Texture.h"
 #include "Shading/TextureCube.h"
+#include "Renderer/RenderDevice.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -124,7 +125,7 @@ TextureCube TextureLoader::LoadTextureCube(std::string top, std::string bottom,
 		}
 	}
 	if (texture.Mipmapping)
-		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+		RenderDevice::Get().GenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
 	return texture;
 }
@@ -2,6 +2,8 @@
 
 #include "Resources/Resources.h"
 
+#include <cstring>
+
 
 
 Material::Material()
@@ -11,7 +13,7 @@ Material::Material()
 
 Material::Material(Shader* shader)
 {
-	m_Shader = shader;
+	SetShader(shader);
 }
 
 Shader* Material::GetShader()
@@ -22,6 +24,10 @@ Shader* Material::GetShader()
 void Material::SetShader(Shader* shader)
 {
 	m_Shader = shader;
+	// a new block layout, the parameters have to be set again.
+	m_Block.assign(shader ? shader->GetMaterialBlockSize() : 0, 0);
+	m_BlockDirty = true;
+	m_UniformHandles.clear();
 }
 
 Material Material::Copy()
@@ -47,26 +53,38 @@ Material Material::Copy()
 
 	copy.m_Uniforms = m_Uniforms;
 	copy.m_SamplerUniforms = m_SamplerUniforms;
+	copy.m_Block = m_Block;
 
 	return copy;
 }
 
-void Material::SetBool(std::string name, bool value)
+void Material::SetBool(UniformName name, bool value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_BOOL;
-	m_Uniforms[name].Bool = value;
+	// std140 bools take 4 bytes.
+	const int block = value ? 1 : 0;
+	if (writeBlock(name, &block, sizeof(int)))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_BOOL;
+	uniform.Bool = value;
 }
 
-void Material::SetInt(std::string name, int value)
+void Material::SetInt(UniformName name, int value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_INT;
-	m_Uniforms[name].Int = value;
+	if (writeBlock(name, &value, sizeof(int)))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_INT;
+	uniform.Int = value;
 }
 
-void Material::SetFloat(std::string name, float value)
+void Material::SetFloat(UniformName name, float value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_FLOAT;
-	m_Uniforms[name].Float = value;
+	if (writeBlock(name, &value, sizeof(float)))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_FLOAT;
+	uniform.Float = value;
 }
 
 void Material::SetTexture(std::string name, Texture* value, unsigned int unit)
@@ -110,40 +128,58 @@ void Material::SetTextureCube(std::string name, TextureCube* value, unsigned int
 	}
 }
 
-void Material::SetVector(std::string name, glm::vec2 value)
+void Material::SetVector(UniformName name, glm::vec2 value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_VEC2;
-	m_Uniforms[name].Vec2 = value;
+	if (writeBlock(name, &value[0], sizeof(glm::vec2)))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_VEC2;
+	uniform.Vec2 = value;
 }
 
-void Material::SetVector(std::string name, glm::vec3 value)
+void Material::SetVector(UniformName name, glm::vec3 value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_VEC3;
-	m_Uniforms[name].Vec3 = value;
+	if (writeBlock(name, &value[0], sizeof(glm::vec3)))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_VEC3;
+	uniform.Vec3 = value;
 }
 
-void Material::SetVector(std::string name, glm::vec4 value)
+void Material::SetVector(UniformName name, glm::vec4 value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_VEC4;
-	m_Uniforms[name].Vec4 = value;
+	if (writeBlock(name, &value[0], sizeof(glm::vec4)))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_VEC4;
+	uniform.Vec4 = value;
 }
 
-void Material::SetMatrix(std::string name, glm::mat2 value)
+void Material::SetMatrix(UniformName name, const glm::mat2& value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_MAT2;
-	m_Uniforms[name].Mat2 = value;
+	if (writeBlock(name, &value[0][0], sizeof(glm::vec2), 2))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_MAT2;
+	uniform.Mat2 = value;
 }
 
-void Material::SetMatrix(std::string name, glm::mat3 value)
+void Material::SetMatrix(UniformName name, const glm::mat3& value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_MAT3;
-	m_Uniforms[name].Mat3 = value;
+	if (writeBlock(name, &value[0][0], sizeof(glm::vec3), 3))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_MAT3;
+	uniform.Mat3 = value;
 }
 
-void Material::SetMatrix(std::string name, glm::mat4 value)
+void Material::SetMatrix(UniformName name, const glm::mat4& value)
 {
-	m_Uniforms[name].Type = SHADER_TYPE_MAT4;
-	m_Uniforms[name].Mat4 = value;
+	if (writeBlock(name, &value[0][0], sizeof(glm::vec4), 4))
+		return;
+	UniformValue& uniform = getUniform(name);
+	uniform.Type = SHADER_TYPE_MAT4;
+	uniform.Mat4 = value;
 }
 
 std::map<std::string, UniformValue>* Material::GetUniforms()
@@ -151,7 +187,65 @@ std::map<std::string, UniformValue>* Material::GetUniforms()
 	return &m_Uniforms;
 }
 
+const std::vector<UniformHandle>& Material::GetUniformHandles(const Shader* shader)
+{
+	if (!shader)
+		shader = m_Shader;
+
+	UniformHandles* found = nullptr;
+	for (UniformHandles& handles : m_UniformHandles)
+	{
+		if (handles.Program == shader)
+		{
+			found = &handles;
+			break;
+		}
+	}
+	if (!found)
+	{
+		m_UniformHandles.push_back({ shader, {} });
+		found = &m_UniformHandles.back();
+	}
+
+	if (found->Handles.size() != m_Uniforms.size())
+	{
+		found->Handles.clear();
+		for (auto it = m_Uniforms.begin(); it != m_Uniforms.end(); ++it)
+		{
+			found->Handles.push_back(shader->GetUniform(it->first));
+		}
+	}
+	return found->Handles;
+}
+
 std::map<std::string, UniformValueSampler>* Material::GetSamplerUniforms()
 {
 	return &m_SamplerUniforms;
 }
+
+bool Material::writeBlock(UniformName name, const void* data, unsigned int size, unsigned int columns)
+{
+	if (m_Block.empty())
+		return false;
+	const int offset = m_Shader->GetMaterialBlockOffset(name);
+	if (offset < 0 || offset + 16 * (columns - 1) + size > m_Block.size())
+		return false;
+
+	// only an actual change makes the block upload again.
+	const unsigned char* source = static_cast<const unsigned char*>(data);
+	for (unsigned int column = 0; column < columns; ++column)
+	{
+		unsigned char* target = &m_Block[offset + 16 * column];
+		if (std::memcmp(target, source + size * column, size) != 0)
+		{
+			std::memcpy(target, source + size * column, size);
+			m_BlockDirty = true;
+		}
+	}
+	return true;
+}
+
+UniformValue& Material::getUniform(UniformName name)
+{
+	return m_Uniforms[std::string(name.Name, name.Length)];
+}
@@ -9,7 +9,9 @@
 #include <GL/glew.h>
 
 #include <map>
+#include <vector>
 
+class MaterialBlockBuffer;
 
 
 enum MaterialType
@@ -28,14 +30,38 @@ enum MaterialType
   object is required for rendering any scene node. The renderer holds a list of common material
   defaults/templates for deriving or creating new materials.
 
+  Parameters the shader declares in its std140 "Material" uniform block are written straight
+  into a packed copy of that block, at the offsets the shader reports; the renderer uploads the
+  block only when it changed and binds it as a single uniform buffer range. Parameters outside
+  the block are kept by name and set as plain uniforms on every draw, through handles resolved
+  once per shader they're drawn with.
+
 */
 class Material
 {
+	friend MaterialBlockBuffer;
 private:
 	// shader state
-	Shader* m_Shader;
+	Shader* m_Shader = nullptr;
 	std::map<std::string, UniformValue>        m_Uniforms;
 	std::map<std::string, UniformValueSampler> m_SamplerUniforms; // NOTE(Joey): process samplers differently 
+
+	// std140 "Material" block data and where it lives in the renderer's MaterialBlockBuffer;
+	// the range belongs to m_BlockOwner, so a copied material never shares the original's range.
+	std::vector<unsigned char> m_Block;
+	bool            m_BlockDirty = true;
+	unsigned int    m_BlockOffset = 0;
+	unsigned int    m_BlockGeneration = 0;
+	const Material* m_BlockOwner = nullptr;
+
+	// handles of m_Uniforms in map order, per shader the material was drawn with; only a new
+	// parameter changes the map's order, so a count mismatch means the handles are outdated.
+	struct UniformHandles
+	{
+		const Shader*              Program;
+		std::vector<UniformHandle> Handles;
+	};
+	std::vector<UniformHandles> m_UniformHandles;
 public:
 	MaterialType Type = MATERIAL_CUSTOM;
 	glm::vec4 Color = glm::vec4(1.0f);
@@ -60,8 +86,6 @@ public:
 	bool ShadowCast = true;
 	bool ShadowReceive = true;
 
-private:
-
 public:
 	Material();
 	Material(Shader* shader);
@@ -71,19 +95,31 @@ public:
 
 	Material Copy();
 
-	void SetBool(std::string name, bool value);
-	void SetInt(std::string name, int value);
-	void SetFloat(std::string name, float value);
+	void SetBool(UniformName name, bool value);
+	void SetInt(UniformName name, int value);
+	void SetFloat(UniformName name, float value);
 	void SetTexture(std::string name, Texture* value, unsigned int unit = 0);
 	void SetTextureCube(std::string name, TextureCube* value, unsigned int unit = 0);
-	void SetVector(std::string name, glm::vec2 value);
-	void SetVector(std::string name, glm::vec3 value);
-	void SetVector(std::string name, glm::vec4 value);
-	void SetMatrix(std::string name, glm::mat2 value);
-	void SetMatrix(std::string name, glm::mat3 value);
-	void SetMatrix(std::string name, glm::mat4 value);
-
+	void SetVector(UniformName name, glm::vec2 value);
+	void SetVector(UniformName name, glm::vec3 value);
+	void SetVector(UniformName name, glm::vec4 value);
+	void SetMatrix(UniformName name, const glm::mat2& value);
+	void SetMatrix(UniformName name, const glm::mat3& value);
+	void SetMatrix(UniformName name, const glm::mat4& value);
+
+	// parameters that aren't part of the shader's material block.
 	std::map<std::string, UniformValue>* GetUniforms();
+	// shader's handles of GetUniforms() in iteration order; shader defaults to the material's.
+	const std::vector<UniformHandle>& GetUniformHandles(const Shader* shader = nullptr);
 	std::map<std::string, UniformValueSampler>* GetSamplerUniforms();
+	// packed std140 material block, empty if the shader has none.
+	const std::vector<unsigned char>& GetBlock() const { return m_Block; }
+
+private:
+	// writes size bytes per column into the material block member name, columns 16 bytes
+	// apart as std140 lays out matrices; returns false if name isn't a member of the block.
+	bool writeBlock(UniformName name, const void* data, unsigned int size, unsigned int columns = 1);
+	// the parameter stored by name, for parameters outside of the material block.
+	UniformValue& getUniform(UniformName name);
 };
 
@@ -1,11 +1,8 @@
 #include "Shader.h"
 
-#include <GL/glew.h>
-
-#include <fstream>
 #include <string>
 
-#include "Utils/Logger.h"
+#include "Renderer/RenderDevice.h"
 
 Shader::Shader()
 {
@@ -20,19 +17,13 @@ Shader::Shader(std::string name, std::string vsCode, std::string fsCode, std::ve
 void Shader::Load(std::string name, std::string vsCode, std::string fsCode, std::vector<std::string> defines)
 {
 	Name = name;
-	// compile both shaders and link them
-	unsigned int vs = glCreateShader(GL_VERTEX_SHADER);
-	unsigned int fs = glCreateShader(GL_FRAGMENT_SHADER);
-	ID = glCreateProgram();
-	int status;
-	char log[1024];
 
 	// if a list of define statements is specified, add these  to the start of the shader 
 	// source, s.t. we can selectively compile different shaders based on the defines we set.
+	std::vector<std::string> vsMergedCode;
+	std::vector<std::string> fsMergedCode;
 	if (defines.size() > 0)
 	{
-		std::vector<std::string> vsMergedCode;
-		std::vector<std::string> fsMergedCode;
 		// first determine if the user supplied a #version  directive at the top of the shader 
 		// code, in which case we  extract it and add it 'before' the list of define code.
 		// the GLSL version specifier is only valid as the first line of the GLSL code; 
@@ -58,203 +49,197 @@ void Shader::Load(std::string name, std::string vsCode, std::string fsCode, std:
 			vsMergedCode.push_back(define);
 			fsMergedCode.push_back(define);
 		}
-		// then addremaining shader code to merged result and pass result to glShaderSource.
-		vsMergedCode.push_back(vsCode);
-		fsMergedCode.push_back(fsCode);
-		// note that we manually build an array of C style  strings as glShaderSource doesn't 
-		// expect it in any other format.
-		// all strings are null-terminated so pass NULL as glShaderSource's final argument.
-		const char** vsStringsC = new const char* [vsMergedCode.size()];
-		const char** fsStringsC = new const char* [fsMergedCode.size()];
-		for (unsigned int i = 0; i < vsMergedCode.size(); ++i)
-			vsStringsC[i] = vsMergedCode[i].c_str();
-		for (unsigned int i = 0; i < fsMergedCode.size(); ++i)
-			fsStringsC[i] = fsMergedCode[i].c_str();
-		glShaderSource(vs, vsMergedCode.size(), vsStringsC, NULL);
-		glShaderSource(fs, fsMergedCode.size(), fsStringsC, NULL);
-		delete[] vsStringsC;
-		delete[] fsStringsC;
-	}
-	else
-	{
-		const char* vsSourceC = vsCode.c_str();
-		const char* fsSourceC = fsCode.c_str();
-		glShaderSource(vs, 1, &vsSourceC, NULL);
-		glShaderSource(fs, 1, &fsSourceC, NULL);
-	}
-	glCompileShader(vs);
-	glCompileShader(fs);
-
-	glGetShaderiv(vs, GL_COMPILE_STATUS, &status);
-	if (!status)
-	{
-		glGetShaderInfoLog(vs, 1024, NULL, log);
-		LOG_ERROR("Vertex shader compilation error at: %s !\n %s", name.c_str(), std::string(log).c_str());
-	}
-	glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
-	if (!status)
-	{
-		glGetShaderInfoLog(fs, 1024, NULL, log);
-		LOG_ERROR("Fragment shader compilation error at: %s !\n%s", name.c_str(), std::string(log).c_str());
 	}
+	// then add remaining shader code to merged result; the device compiles the strings of a
+	// stage as one source.
+	vsMergedCode.push_back(vsCode);
+	fsMergedCode.push_back(fsCode);
 
-	glAttachShader(ID, vs);
-	glAttachShader(ID, fs);
-	glLinkProgram(ID);
+	std::vector<const char*> vsStrings;
+	std::vector<const char*> fsStrings;
+	for (unsigned int i = 0; i < vsMergedCode.size(); ++i)
+		vsStrings.push_back(vsMergedCode[i].c_str());
+	for (unsigned int i = 0; i < fsMergedCode.size(); ++i)
+		fsStrings.push_back(fsMergedCode[i].c_str());
 
-	glGetProgramiv(ID, GL_LINK_STATUS, &status);
-	if (!status)
-	{
-		glGetProgramInfoLog(ID, 1024, NULL, log);
-		LOG_ERROR("Shader program linking error: \n %s", + std::string(log).c_str());
-	}
+	RenderDevice& device = RenderDevice::Get();
+	ID = device.CreateProgram(name, vsStrings, fsStrings);
 
-	glDeleteShader(vs);
-	glDeleteShader(fs);
+	// the "Material" uniform block holds the material parameters; materials lay out their
+	// parameters at the offsets GL reports for its members and bind them as a block range.
+	RenderDevice::ProgramInfo info;
+	device.GetProgramInfo(ID, "Material", MaterialBlockBinding, info);
+	Uniforms = info.Uniforms;
+	Attributes = info.Attributes;
+	m_MaterialBlockSize = info.BlockSize;
 
-	// query the number of active uniforms and attributes
-	int nrAttributes, nrUniforms;
-	glGetProgramiv(ID, GL_ACTIVE_ATTRIBUTES, &nrAttributes);
-	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &nrUniforms);
-	Attributes.resize(nrAttributes);
-	Uniforms.resize(nrUniforms);
+	buildUniformTable();
+}
 
-	// iterate over all active attributes
-	char buffer[128];
-	for (unsigned int i = 0; i < nrAttributes; ++i)
-	{
-		GLenum glType;
-		glGetActiveAttrib(ID, i, sizeof(buffer), 0, &Attributes[i].Size, &glType, buffer);
-		Attributes[i].Name = std::string(buffer);
-		Attributes[i].Type = SHADER_TYPE_BOOL;
+void Shader::Use()
+{
+	RenderDevice::Get().UseProgram(ID);
+}
 
-		Attributes[i].Location = glGetAttribLocation(ID, buffer);
-	}
+bool Shader::HasUniform(UniformName name) const
+{
+	return GetUniform(name).IsValid();
+}
 
-	// iterate over all active uniforms
-	for (unsigned int i = 0; i < nrUniforms; ++i)
-	{
-		GLenum glType;
-		glGetActiveUniform(ID, i, sizeof(buffer), 0, &Uniforms[i].Size, &glType, buffer);
-		Uniforms[i].Name = std::string(buffer);
-		Uniforms[i].Type = SHADER_TYPE_BOOL;
+UniformHandle Shader::GetUniform(UniformName name) const
+{
+	UniformHandle handle;
+	if (const UniformSlot* slot = findUniform(name))
+		handle.Location = slot->Location;
+	return handle;
+}
 
-		Uniforms[i].Location = glGetUniformLocation(ID, buffer);
-	}
+int Shader::GetMaterialBlockOffset(UniformName name) const
+{
+	const UniformSlot* slot = findUniform(name);
+	return slot ? slot->BlockOffset : -1;
 }
 
-void Shader::Use()
+void Shader::SetInt(UniformHandle uniform, int value)
 {
-	glUseProgram(ID);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_INT, 1, &value);
 }
 
-bool Shader::HasUniform(std::string name)
+void Shader::SetBool(UniformHandle uniform, bool value)
 {
-	for (unsigned int i = 0; i < Uniforms.size(); ++i)
+	if (uniform.IsValid())
 	{
-		if (Uniforms[i].Name == name)
-			return true;
+		const int intValue = value;
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_BOOL, 1, &intValue);
 	}
-	return false;
 }
 
-void Shader::SetInt(std::string location, int value)
+void Shader::SetFloat(UniformHandle uniform, float value)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniform1i(loc, value);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_FLOAT, 1, &value);
 }
 
-void Shader::SetBool(std::string location, bool value)
+void Shader::SetVector(UniformHandle uniform, glm::vec2 value)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniform1i(loc, (int)value);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_VEC2, 1, &value[0]);
 }
 
-void Shader::SetFloat(std::string location, float value)
+void Shader::SetVector(UniformHandle uniform, glm::vec3 value)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniform1f(loc, value);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_VEC3, 1, &value[0]);
 }
 
-void Shader::SetVector(std::string location, glm::vec2 value)
+void Shader::SetVector(UniformHandle uniform, glm::vec4 value)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniform2fv(loc, 1, &value[0]);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_VEC4, 1, &value[0]);
 }
 
-void Shader::SetVector(std::string location, glm::vec3 value)
+void Shader::SetVectorArray(UniformHandle uniform, int size, const std::vector<glm::vec2>& values)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniform3fv(loc, 1, &value[0]);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_VEC2, size, &values[0].x);
 }
 
-void Shader::SetVector(std::string location, glm::vec4 value)
+void Shader::SetVectorArray(UniformHandle uniform, int size, const std::vector<glm::vec3>& values)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniform4fv(loc, 1, &value[0]);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_VEC3, size, &values[0].x);
 }
 
-void Shader::SetVectorArray(std::string location, int size, const std::vector<glm::vec2>& values)
+void Shader::SetVectorArray(UniformHandle uniform, int size, const std::vector<glm::vec4>& values)
 {
-	unsigned int loc = glGetUniformLocation(ID, location.c_str());
-	if (loc >= 0)
-	{
-		glUniform2fv(loc, size, (float*)(&values[0].x));
-	}
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_VEC4, size, &values[0].x);
 }
 
-void Shader::SetVectorArray(std::string location, int size, const std::vector<glm::vec3>& values)
+void Shader::SetMatrix(UniformHandle uniform, const glm::mat2& value)
 {
-	unsigned int loc = glGetUniformLocation(ID, location.c_str());
-	if (loc >= 0)
-	{
-		glUniform3fv(loc, size, (float*)(&values[0].x));
-	}
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_MAT2, 1, &value[0][0]);
 }
 
-void Shader::SetVectorArray(std::string location, int size, const std::vector<glm::vec4>& values)
+void Shader::SetMatrix(UniformHandle uniform, const glm::mat3& value)
 {
-	unsigned int loc = glGetUniformLocation(ID, location.c_str());
-	if (loc >= 0)
-	{
-		glUniform4fv(loc, size, (float*)(&values[0].x));
-	}
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_MAT3, 1, &value[0][0]);
+}
+
+void Shader::SetMatrix(UniformHandle uniform, const glm::mat4& value)
+{
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_MAT4, 1, &value[0][0]);
 }
 
-void Shader::SetMatrix(std::string location, glm::mat2 value)
+void Shader::SetMatrixArray(UniformHandle uniform, int size, const glm::mat2* values)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniformMatrix2fv(loc, 1, GL_FALSE, &value[0][0]);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_MAT2, size, &values[0][0][0]);
 }
 
-void Shader::SetMatrix(std::string location, glm::mat3 value)
+void Shader::SetMatrixArray(UniformHandle uniform, int size, const glm::mat3* values)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniformMatrix3fv(loc, 1, GL_FALSE, &value[0][0]);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_MAT3, size, &values[0][0][0]);
 }
 
-void Shader::SetMatrix(std::string location, glm::mat4 value)
+void Shader::SetMatrixArray(UniformHandle uniform, int size, const glm::mat4* values)
 {
-	int loc = getUniformLocation(location);
-	if (loc >= 0)
-		glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]);
+	if (uniform.IsValid())
+		RenderDevice::Get().SetUniform(uniform.Location, SHADER_TYPE_MAT4, size, &values[0][0][0]);
 }
 
-int Shader::getUniformLocation(std::string name)
+void Shader::buildUniformTable()
 {
-	// read from uniform/attribute array as originally obtained from OpenGL
+	// twice the slots of the names it holds (arrays count twice), rounded up to a power of two.
+	size_t slotCount = 4;
+	while (slotCount < Uniforms.size() * 4)
+		slotCount *= 2;
+	m_UniformTable.assign(slotCount, UniformSlot());
+
 	for (unsigned int i = 0; i < Uniforms.size(); ++i)
 	{
-		if (Uniforms[i].Name == name)
-			return Uniforms[i].Location;
+		const std::string& name = Uniforms[i].Name;
+		insertUniform(name, Uniforms[i]);
+		// arrays of basic types are listed as "name[0]" only; they're set through their base name.
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			insertUniform(name.substr(0, name.size() - 3), Uniforms[i]);
+	}
+}
+
+void Shader::insertUniform(const std::string& name, const Uniform& uniform)
+{
+	const uint32_t hash = HashUniformName(name.c_str(), name.size());
+	const size_t mask = m_UniformTable.size() - 1;
+	size_t slot = hash & mask;
+	while (!m_UniformTable[slot].Name.empty())
+	{
+		if (m_UniformTable[slot].Name == name)
+			return;
+		slot = (slot + 1) & mask;
+	}
+	m_UniformTable[slot].Hash = hash;
+	m_UniformTable[slot].Location = static_cast<int>(uniform.Location);
+	m_UniformTable[slot].BlockOffset = uniform.BlockOffset;
+	m_UniformTable[slot].Name = name;
+}
+
+const Shader::UniformSlot* Shader::findUniform(UniformName name) const
+{
+	if (m_UniformTable.empty())
+		return nullptr;
+
+	// the table is never more than half full, so probing always ends at an empty slot.
+	const size_t mask = m_UniformTable.size() - 1;
+	for (size_t slot = name.Hash & mask; !m_UniformTable[slot].Name.empty(); slot = (slot + 1) & mask)
+	{
+		const UniformSlot& entry = m_UniformTable[slot];
+		if (entry.Hash == name.Hash && entry.Name.size() == name.Length && entry.Name.compare(0, name.Length, name.Name, name.Length) == 0)
+			return &entry;
 	}
-	return -1;
+	return nullptr;
 }
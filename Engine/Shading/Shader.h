@@ -10,12 +10,16 @@
 
   Shader object for quickly creating and using a GPU shader object. When compiling/linking a
   shader object from source code, all vertex attributes and uniforms are extracted for saving
-  unnecessary additional CPU->GPU roundtrip times.
+  unnecessary additional CPU->GPU roundtrip times. Uniforms are found through a hashed name
+  table; callers that set the same uniform every frame resolve it once to a UniformHandle.
 
 */
 class Shader
 {
 public:
+	// uniform block binding point of the "Material" block, see MaterialBlockBuffer.
+	static const unsigned int MaterialBlockBinding = 1;
+
 	unsigned int ID;
 	std::string  Name;
 
@@ -30,26 +34,64 @@ public:
 
 	void Use();
 
-	bool HasUniform(std::string name);
-
-	void SetInt(std::string location, int   value);
-	void SetBool(std::string location, bool  value);
-	void SetFloat(std::string location, float value);
-	void SetVector(std::string location, glm::vec2  value);
-	void SetVector(std::string location, glm::vec3  value);
-	void SetVector(std::string location, glm::vec4  value);
-	void SetVectorArray(std::string location, int size, const std::vector<glm::vec2>& values);
-	void SetVectorArray(std::string location, int size, const std::vector<glm::vec3>& values);
-	void SetVectorArray(std::string location, int size, const std::vector<glm::vec4>& values);
-	void SetMatrix(std::string location, glm::mat2 value);
-	void SetMatrix(std::string location, glm::mat3 value);
-	void SetMatrix(std::string location, glm::mat4 value);
-	void SetMatrixArray(std::string location, int size, glm::mat2* values);
-	void SetMatrixArray(std::string location, int size, glm::mat3* values);
-	void SetMatrixArray(std::string location, int size, glm::mat4* values);
+	bool HasUniform(UniformName name) const;
+	// resolves a uniform once, s.t. it can be set every frame without looking up its name.
+	UniformHandle GetUniform(UniformName name) const;
+
+	// size in bytes of the std140 "Material" uniform block, 0 if the shader doesn't declare one.
+	unsigned int GetMaterialBlockSize() const { return m_MaterialBlockSize; }
+	// byte offset of a member of the "Material" block as reported by GL, -1 if it isn't one.
+	int GetMaterialBlockOffset(UniformName name) const;
+
+	void SetInt(UniformHandle uniform, int   value);
+	void SetBool(UniformHandle uniform, bool  value);
+	void SetFloat(UniformHandle uniform, float value);
+	void SetVector(UniformHandle uniform, glm::vec2  value);
+	void SetVector(UniformHandle uniform, glm::vec3  value);
+	void SetVector(UniformHandle uniform, glm::vec4  value);
+	void SetVectorArray(UniformHandle uniform, int size, const std::vector<glm::vec2>& values);
+	void SetVectorArray(UniformHandle uniform, int size, const std::vector<glm::vec3>& values);
+	void SetVectorArray(UniformHandle uniform, int size, const std::vector<glm::vec4>& values);
+	void SetMatrix(UniformHandle uniform, const glm::mat2& value);
+	void SetMatrix(UniformHandle uniform, const glm::mat3& value);
+	void SetMatrix(UniformHandle uniform, const glm::mat4& value);
+	void SetMatrixArray(UniformHandle uniform, int size, const glm::mat2* values);
+	void SetMatrixArray(UniformHandle uniform, int size, const glm::mat3* values);
+	void SetMatrixArray(UniformHandle uniform, int size, const glm::mat4* values);
+
+	// same as the above, looking the uniform up by name in the shader's name table first.
+	void SetInt(UniformName location, int   value) { SetInt(GetUniform(location), value); }
+	void SetBool(UniformName location, bool  value) { SetBool(GetUniform(location), value); }
+	void SetFloat(UniformName location, float value) { SetFloat(GetUniform(location), value); }
+	void SetVector(UniformName location, glm::vec2  value) { SetVector(GetUniform(location), value); }
+	void SetVector(UniformName location, glm::vec3  value) { SetVector(GetUniform(location), value); }
+	void SetVector(UniformName location, glm::vec4  value) { SetVector(GetUniform(location), value); }
+	void SetVectorArray(UniformName location, int size, const std::vector<glm::vec2>& values) { SetVectorArray(GetUniform(location), size, values); }
+	void SetVectorArray(UniformName location, int size, const std::vector<glm::vec3>& values) { SetVectorArray(GetUniform(location), size, values); }
+	void SetVectorArray(UniformName location, int size, const std::vector<glm::vec4>& values) { SetVectorArray(GetUniform(location), size, values); }
+	void SetMatrix(UniformName location, const glm::mat2& value) { SetMatrix(GetUniform(location), value); }
+	void SetMatrix(UniformName location, const glm::mat3& value) { SetMatrix(GetUniform(location), value); }
+	void SetMatrix(UniformName location, const glm::mat4& value) { SetMatrix(GetUniform(location), value); }
+	void SetMatrixArray(UniformName location, int size, const glm::mat2* values) { SetMatrixArray(GetUniform(location), size, values); }
+	void SetMatrixArray(UniformName location, int size, const glm::mat3* values) { SetMatrixArray(GetUniform(location), size, values); }
+	void SetMatrixArray(UniformName location, int size, const glm::mat4* values) { SetMatrixArray(GetUniform(location), size, values); }
 private:
-	// retrieves uniform location from pre-stored uniform locations and reports an error if a 
-	// non-uniform is set.
-	int getUniformLocation(std::string name);
+	// open addressing hash table over the active uniform names, built when linking; arrays are
+	// also found by their name without the "[0]" suffix. Empty slots have an empty name.
+	struct UniformSlot
+	{
+		uint32_t    Hash = 0;
+		int         Location = -1;
+		int         BlockOffset = -1;
+		std::string Name;
+	};
+	std::vector<UniformSlot> m_UniformTable;
+	unsigned int m_MaterialBlockSize = 0;
+
+	// (re)builds the uniform name table from Uniforms.
+	void buildUniformTable();
+	void insertUniform(const std::string& name, const Uniform& uniform);
+	// returns the slot of the named uniform, null if there is none.
+	const UniformSlot* findUniform(UniformName name) const;
 };
 
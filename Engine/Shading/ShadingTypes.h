@@ -2,6 +2,8 @@
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 
@@ -31,6 +33,7 @@ struct Uniform
 	std::string  Name;
 	int          Size;
 	unsigned int Location;
+	int          BlockOffset = -1; // byte offset in the material block, -1 outside of it
 };
 
 struct UniformValue
@@ -76,3 +79,64 @@ struct VertexAttribute
 	unsigned int Location;
 };
 
+// 32 bit FNV-1a hash of a uniform name; constexpr so names known at compile time are hashed by
+// the compiler.
+constexpr uint32_t HashUniformName(const char* name, size_t length)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= static_cast<unsigned char>(name[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+constexpr size_t GetUniformNameLength(const char* name, size_t capacity)
+{
+	size_t length = 0;
+	while (length < capacity && name[length] != '\0')
+	{
+		++length;
+	}
+	return length;
+}
+
+/*
+
+  Uniform name together with its hash, which is all a shader needs to find the uniform in its
+  name table. Declared constexpr from a string literal the hash is computed at compile time;
+  built from a std::string it's hashed once, without copying. Only keeps a pointer to the
+  characters, so it shouldn't outlive the string it was made from.
+
+*/
+struct UniformName
+{
+	const char* Name;
+	size_t      Length;
+	uint32_t    Hash;
+
+	template <size_t N>
+	constexpr UniformName(const char (&name)[N])
+		: Name(name), Length(GetUniformNameLength(name, N)), Hash(HashUniformName(name, GetUniformNameLength(name, N)))
+	{
+	}
+	UniformName(const std::string& name)
+		: Name(name.c_str()), Length(name.size()), Hash(HashUniformName(name.c_str(), name.size()))
+	{
+	}
+};
+
+/*
+
+  Uniform of a specific shader resolved with Shader::GetUniform(); setting a uniform through
+  its handle skips the name lookup altogether. Invalid when the shader has no such (active)
+  uniform, in which case setting it does nothing.
+
+*/
+struct UniformHandle
+{
+	int Location = -1;
+
+	bool IsValid() const { return Location >= 0; }
+};
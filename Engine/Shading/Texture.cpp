@@ -1,5 +1,7 @@
 #include "Texture.h"
 
+#include "Renderer/RenderDevice.h"
+
 #include <assert.h>
 
 
@@ -16,7 +18,7 @@ Texture::~Texture()
 
 void Texture::Generate(unsigned int width, GLenum internalFormat, GLenum format, GLenum type, void* data)
 {
-	glGenTextures(1, &ID);
+	ID = RenderDevice::Get().CreateTexture();
 
 	Width = width;
 	Height = 0;
@@ -27,18 +29,18 @@ void Texture::Generate(unsigned int width, GLenum internalFormat, GLenum format,
 
 	assert(Target == GL_TEXTURE_1D);
 	Bind();
-	glTexImage1D(Target, 0, internalFormat, width, 0, format, type, data);
-	glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, FilterMin);
-	glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, FilterMax);
-	glTexParameteri(Target, GL_TEXTURE_WRAP_S, WrapS);
+	RenderDevice::Get().TexImage(Target, 0, internalFormat, width, 0, 0, format, type, data);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MIN_FILTER, FilterMin);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MAG_FILTER, FilterMax);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_S, WrapS);
 	if (Mipmapping)
-		glGenerateMipmap(Target);
+		RenderDevice::Get().GenerateMipmap(Target);
 	Unbind();
 }
 
 void Texture::Generate(unsigned int width, unsigned int height, GLenum internalFormat, GLenum format, GLenum type, void* data)
 {
-	glGenTextures(1, &ID);
+	ID = RenderDevice::Get().CreateTexture();
 
 	Width = width;
 	Height = height;
@@ -49,19 +51,19 @@ void Texture::Generate(unsigned int width, unsigned int height, GLenum internalF
 
 	assert(Target == GL_TEXTURE_2D);
 	Bind();
-	glTexImage2D(Target, 0, internalFormat, width, height, 0, format, type, data);
-	glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, FilterMin);
-	glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, FilterMax);
-	glTexParameteri(Target, GL_TEXTURE_WRAP_S, WrapS);
-	glTexParameteri(Target, GL_TEXTURE_WRAP_T, WrapT);
+	RenderDevice::Get().TexImage(Target, 0, internalFormat, width, height, 0, format, type, data);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MIN_FILTER, FilterMin);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MAG_FILTER, FilterMax);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_S, WrapS);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_T, WrapT);
 	if (Mipmapping)
-		glGenerateMipmap(Target);
+		RenderDevice::Get().GenerateMipmap(Target);
 	Unbind();
 }
 
 void Texture::Generate(unsigned int width, unsigned int height, unsigned int depth, GLenum internalFormat, GLenum format, GLenum type, void* data)
 {
-	glGenTextures(1, &ID);
+	ID = RenderDevice::Get().CreateTexture();
 
 	Width = width;
 	Height = height;
@@ -72,14 +74,14 @@ void Texture::Generate(unsigned int width, unsigned int height, unsigned int dep
 
 	assert(Target == GL_TEXTURE_3D);
 	Bind();
-	glTexImage3D(Target, 0, internalFormat, width, height, depth, 0, format, type, data);
-	glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, FilterMin);
-	glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, FilterMax);
-	glTexParameteri(Target, GL_TEXTURE_WRAP_S, WrapS);
-	glTexParameteri(Target, GL_TEXTURE_WRAP_T, WrapT);
-	glTexParameteri(Target, GL_TEXTURE_WRAP_R, WrapR);
+	RenderDevice::Get().TexImage(Target, 0, internalFormat, width, height, depth, format, type, data);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MIN_FILTER, FilterMin);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MAG_FILTER, FilterMax);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_S, WrapS);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_T, WrapT);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_R, WrapR);
 	if (Mipmapping)
-		glGenerateMipmap(Target);
+		RenderDevice::Get().GenerateMipmap(Target);
 	Unbind();
 }
 
@@ -88,30 +90,35 @@ void Texture::Resize(unsigned int width, unsigned int height, unsigned int depth
 	Bind();
 	if (Target == GL_TEXTURE_1D)
 	{
-		glTexImage1D(GL_TEXTURE_1D, 0, InternalFormat, width, 0, Format, Type, 0);
+		RenderDevice::Get().TexImage(GL_TEXTURE_1D, 0, InternalFormat, width, 0, 0, Format, Type, 0);
 	}
 	else if (Target == GL_TEXTURE_2D)
 	{
 		assert(height > 0);
-		glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, width, height, 0, Format, Type, 0);
+		RenderDevice::Get().TexImage(GL_TEXTURE_2D, 0, InternalFormat, width, height, 0, Format, Type, 0);
 	}
 	else if (Target == GL_TEXTURE_3D)
 	{
 		assert(height > 0 && depth > 0);
-		glTexImage3D(GL_TEXTURE_3D, 0, InternalFormat, width, height, depth, 0, Format, Type, 0);
+		RenderDevice::Get().TexImage(GL_TEXTURE_3D, 0, InternalFormat, width, height, depth, Format, Type, 0);
 	}
 }
 
 void Texture::Bind(int unit)
 {
 	if (unit >= 0)
-		glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(Target, ID);
+		RenderDevice::Get().ActiveTexture(unit);
+	RenderDevice::Get().BindTexture(Target, ID);
+}
+
+void Texture::Bind(GLStateCache& cache, unsigned int unit)
+{
+	cache.BindTexture(unit, Target, ID);
 }
 
 void Texture::Unbind()
 {
-	glBindTexture(Target, 0);
+	RenderDevice::Get().BindTexture(Target, 0);
 }
 
 void Texture::SetWrapMode(GLenum wrapMode, bool bind)
@@ -121,23 +128,23 @@ void Texture::SetWrapMode(GLenum wrapMode, bool bind)
 	if (Target == GL_TEXTURE_1D)
 	{
 		WrapS = wrapMode;
-		glTexParameteri(Target, GL_TEXTURE_WRAP_S, wrapMode);
+		RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_S, wrapMode);
 	}
 	else if (Target == GL_TEXTURE_2D)
 	{
 		WrapS = wrapMode;
 		WrapT = wrapMode;
-		glTexParameteri(Target, GL_TEXTURE_WRAP_S, wrapMode);
-		glTexParameteri(Target, GL_TEXTURE_WRAP_T, wrapMode);
+		RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_S, wrapMode);
+		RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_T, wrapMode);
 	}
 	else if (Target == GL_TEXTURE_3D)
 	{
 		WrapS = wrapMode;
 		WrapT = wrapMode;
 		WrapR = wrapMode;
-		glTexParameteri(Target, GL_TEXTURE_WRAP_S, wrapMode);
-		glTexParameteri(Target, GL_TEXTURE_WRAP_T, wrapMode);
-		glTexParameteri(Target, GL_TEXTURE_WRAP_R, wrapMode);
+		RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_S, wrapMode);
+		RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_T, wrapMode);
+		RenderDevice::Get().TexParameter(Target, GL_TEXTURE_WRAP_R, wrapMode);
 	}
 }
 
@@ -145,13 +152,13 @@ void Texture::SetFilterMin(GLenum filter, bool bind)
 {
 	if (bind)
 		Bind();
-	glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, filter);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MIN_FILTER, filter);
 }
 
 void Texture::SetFilterMax(GLenum filter, bool bind)
 {
 	if (bind)
 		Bind();
-	glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, filter);
+	RenderDevice::Get().TexParameter(Target, GL_TEXTURE_MAG_FILTER, filter);
 }
 
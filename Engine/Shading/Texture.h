@@ -2,6 +2,7 @@
 
 #include <GL/glew.h>
 
+class GLStateCache;
 
 /*
 
@@ -44,6 +45,8 @@ public:
 	void Resize(unsigned int width, unsigned int height = 0, unsigned int depth = 0);
 
 	void Bind(int unit = -1);
+	// binds to unit through cache, which skips the bind if the texture is bound there already.
+	void Bind(GLStateCache& cache, unsigned int unit);
 	void Unbind();
 
 	// update relevant texture state
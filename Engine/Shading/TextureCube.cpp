@@ -1,5 +1,7 @@
 #include "TextureCube.h"
 
+#include "Renderer/RenderDevice.h"
+
 
 
 TextureCube::TextureCube()
@@ -14,7 +16,7 @@ TextureCube::~TextureCube()
 
 void TextureCube::DefaultInitialize(unsigned int width, unsigned int height, GLenum format, GLenum type, bool mipmap)
 {
-	glGenTextures(1, &ID);
+	ID = RenderDevice::Get().CreateTexture();
 
 	FaceWidth = width;
 	FaceHeight = height;
@@ -32,24 +34,24 @@ void TextureCube::DefaultInitialize(unsigned int width, unsigned int height, GLe
 		InternalFormat = GL_RGBA32F;
 
 	Bind();
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, FilterMin);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, FilterMax);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, WrapS);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, WrapT);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, WrapR);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, FilterMin);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, FilterMax);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, WrapS);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, WrapT);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, WrapR);
 
 	for (unsigned int i = 0; i < 6; ++i)
 	{
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, InternalFormat, width, height, 0, format, type, NULL);
+		RenderDevice::Get().TexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, InternalFormat, width, height, 0, format, type, NULL);
 	}
 	if (mipmap)
-		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+		RenderDevice::Get().GenerateMipmap(GL_TEXTURE_CUBE_MAP);
 }
 
 void TextureCube::GenerateFace(GLenum face, unsigned int width, unsigned int height, GLenum format, GLenum type, unsigned char* data)
 {
 	if (FaceWidth == 0)
-		glGenTextures(1, &ID);
+		ID = RenderDevice::Get().CreateTexture();
 
 	FaceWidth = width;
 	FaceHeight = height;
@@ -58,19 +60,19 @@ void TextureCube::GenerateFace(GLenum face, unsigned int width, unsigned int hei
 
 	Bind();
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, FilterMin);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, FilterMax);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, WrapS);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, WrapT);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, WrapR);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, FilterMin);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, FilterMax);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, WrapS);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, WrapT);
+	RenderDevice::Get().TexParameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, WrapR);
 
-	glTexImage2D(face, 0, format, width, height, 0, format, type, data);
+	RenderDevice::Get().TexImage(face, 0, format, width, height, 0, format, type, data);
 }
 
 void TextureCube::SetMipFace(GLenum face, unsigned int width, unsigned int height, GLenum format, GLenum type, unsigned int mipLevel, unsigned char* data)
 {
 	Bind();
-	glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mipLevel, 0, 0, width, height, format, type, data);
+	RenderDevice::Get().TexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mipLevel, width, height, format, type, data);
 }
 
 void TextureCube::Resize(unsigned int width, unsigned int height)
@@ -80,17 +82,22 @@ void TextureCube::Resize(unsigned int width, unsigned int height)
 
 	Bind();
 	for (unsigned int i = 0; i < 6; ++i)
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, Format, width, height, 0, Format, Type, NULL);
+		RenderDevice::Get().TexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, Format, width, height, 0, Format, Type, NULL);
 }
 
 void TextureCube::Bind(int unit)
 {
 	if (unit >= 0)
-		glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+		RenderDevice::Get().ActiveTexture(unit);
+	RenderDevice::Get().BindTexture(GL_TEXTURE_CUBE_MAP, ID);
+}
+
+void TextureCube::Bind(GLStateCache& cache, unsigned int unit)
+{
+	cache.BindTexture(unit, GL_TEXTURE_CUBE_MAP, ID);
 }
 
 void TextureCube::Unbind()
 {
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	RenderDevice::Get().BindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
@@ -4,6 +4,7 @@
 
 #include <vector>
 
+class GLStateCache;
 
 class TextureCube
 {
@@ -40,6 +41,8 @@ public:
 	void Resize(unsigned int width, unsigned int height);
 
 	void Bind(int unit = -1);
+	// binds to unit through cache, which skips the bind if the texture is bound there already.
+	void Bind(GLStateCache& cache, unsigned int unit);
 	void Unbind();
 };
 
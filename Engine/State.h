@@ -114,9 +114,12 @@ public:
 		plasmaOrb->SetPosition(glm::vec3(0.0f, 0.0f, 0.0f));
 		plasmaOrb->SetScale(0.6f);
 
-		m_qTree = QuadTree(glm::vec3(0.0f), 50.0f);
+		m_qTree = QuadTree(glm::vec2(0.0f), 50.0f);
 		m_oTree = Octree(glm::vec3(0.0f), 50.0f);
 
+		std::vector<bvh::Bounds> nodeBounds;
+		nodeBounds.reserve(1000);
+
 		const float spacing = 7.2f;
 		for (int x = 0; x < 10; ++x)
 		{
@@ -133,6 +136,7 @@ public:
 					const float randomScale = MathUtils::Rand(0.5f, 2.3f);
 					node->SetScale(randomScale);
 
+					const unsigned int nodeIndex = static_cast<unsigned int>(m_randomNodes.size());
 					m_randomNodes.push_back(node);
 
 					glm::vec3 min = { position.x + node->BoxMin.x * randomScale, position.y + node->BoxMin.y * randomScale, position.z + node->BoxMin.z * randomScale};
@@ -141,14 +145,17 @@ public:
 
 					DebugDraw::AddAABB(min, max, green);
 
-					m_qTree.Insert(position);
-					m_oTree.Insert(position);
+					m_qTree.Insert(nodeIndex, position);
+					m_oTree.Insert(nodeIndex, AABB(min, max));
 
-					m_bvhTree.InsertNode(x * z * y, AABB(min, max));
+					nodeBounds.push_back(bvh::Bounds(min, max));
 				}
 			}
 		}
 
+		// the grid is static, bulk build the bvh instead of inserting nodes one by one.
+		m_bvhTree = bvh::BuildLinear(nodeBounds.data(), static_cast<int>(nodeBounds.size()));
+
 		//// - background
 		// Skybox* background = new Skybox();
 		//PBRCapture* pbrEnv = rendererPtr->GetSkypCature();
@@ -264,13 +271,19 @@ public:
 
 		if (m_drawBVH)
 		{
-			// draw octree
-			auto nodes = m_bvhTree.GetNodes();
+			// draw bvh
+			const std::vector<bvh::Node>& nodes = m_bvhTree.GetNodes();
 			const unsigned int oSize = static_cast<unsigned int>(nodes.size());
 			for (unsigned int i = 0; i < oSize; ++i)
 			{
-				auto box = nodes[i]->box;
-				DebugDraw::AddAABB(box.GetMin(), box.GetMax());
+				if (nodes[i].height < 0)
+				{
+					// free node
+					continue;
+				}
+
+				const bvh::Bounds& box = nodes[i].box;
+				DebugDraw::AddAABB(box.min, box.max);
 			}
 		}
 
@@ -298,9 +311,21 @@ public:
 			//renderer->PushRender(plasmaOrb);
 			//renderer->PushRender(background);
 
-			for (SceneNode* node : m_randomNodes)
+			if (m_cullWithBVH)
+			{
+				// only push what the bvh finds inside the camera frustum
+				m_visibleNodes.clear();
+				m_bvhTree.CullFrustum(m_camera.GetFrustum(), m_visibleNodes);
+				m_visibleSceneNodes.clear();
+				for (int nodeIndex : m_visibleNodes)
+				{
+					m_visibleSceneNodes.push_back(m_randomNodes[nodeIndex]);
+				}
+				renderer->PushRender(m_visibleSceneNodes);
+			}
+			else
 			{
-				renderer->PushRender(node);
+				renderer->PushRender(m_randomNodes);
 			}
 		}
 
@@ -340,6 +365,7 @@ public:
 				ImGui::Checkbox("Draw Octree", &m_drawOctree);
 				ImGui::Checkbox("Draw BVH", &m_drawBVH);
 				ImGui::Checkbox("Draw Grid", &m_drawGrid);
+				ImGui::Checkbox("Cull Objects with BVH", &m_cullWithBVH);
 				ImGui::EndMenu();
 			}
 			renderer->RenderUIMenu();
@@ -376,6 +402,8 @@ private:
 	DirectionalLight m_directionalLight;
 
 	std::vector<SceneNode*> m_randomNodes;
+	std::vector<int> m_visibleNodes;
+	std::vector<SceneNode*> m_visibleSceneNodes;
 
 	bool m_inputGrabMouse = false;
 	float m_inputMoveUp = 0.0f;
@@ -388,6 +416,7 @@ private:
 	bool m_drawOctree = false;
 	bool m_drawBVH = false;
 	bool m_drawGrid = true;
+	bool m_cullWithBVH = true;
 
 	QuadTree m_qTree;
 	Octree m_oTree;
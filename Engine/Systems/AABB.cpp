@@ -221,9 +221,8 @@ bool AABB::Intersects(const AABB& aabb) const
 	{
 		if (m_max.y >= aabb.m_min.y && m_min.y <= aabb.m_max.y)
 		{
-			return false;
+			return (m_max.z >= aabb.m_min.z) && (m_min.z <= aabb.m_max.z);
 		}
-		return (m_max.z >= aabb.m_min.z) && (m_min.z <= aabb.m_max.z);
 	}
 	return false;
 }
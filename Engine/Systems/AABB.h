@@ -46,7 +46,7 @@ public:
 		glm::vec3 r;
 		r.x = a.x < b.x ? a.x : b.x;
 		r.y = a.y < b.y ? a.y : b.y;
-		r.x = a.z < b.z ? a.z : b.z;
+		r.z = a.z < b.z ? a.z : b.z;
 		return r;
 	}
 
@@ -55,7 +55,7 @@ public:
 		glm::vec3 r;
 		r.x = a.x > b.x ? a.x : b.x;
 		r.y = a.y > b.y ? a.y : b.y;
-		r.x = a.z > b.z ? a.z : b.z;
+		r.z = a.z > b.z ? a.z : b.z;
 		return r;
 	}
 
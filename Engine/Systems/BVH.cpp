@@ -1,7 +1,1062 @@
-
 #include "BVH.h"
 
+#include "Camera/FrustumCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <functional>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_PACKET_SSE 1
+#include <immintrin.h>
+#else
+#define BVH_PACKET_SSE 0
+#endif
+
 namespace bvh
 {
-	int Tree::nullIndex = -1;
-}
\ No newline at end of file
+	const int Tree::nullIndex = -1;
+
+	namespace
+	{
+		struct RayStackEntry
+		{
+			int index;
+			float tNear;
+		};
+
+		// traversal stack on the call stack for the usual tree depths, moving to the heap when a
+		// degenerate tree goes deeper.
+		template <typename T>
+		class GrowableStack
+		{
+		public:
+			GrowableStack()
+				: m_stack(m_array)
+				, m_count(0)
+				, m_capacity(Tree::maxStackSize)
+			{ }
+
+			GrowableStack(const GrowableStack&) = delete;
+			GrowableStack& operator=(const GrowableStack&) = delete;
+
+			void Push(const T& element)
+			{
+				if (m_count == m_capacity)
+				{
+					if (m_stack == m_array)
+					{
+						m_heap.assign(m_array, m_array + m_count);
+					}
+					m_capacity *= 2;
+					m_heap.resize(m_capacity);
+					m_stack = m_heap.data();
+				}
+				m_stack[m_count++] = element;
+			}
+
+			T Pop()
+			{
+				assert(m_count > 0);
+				return m_stack[--m_count];
+			}
+
+			bool IsEmpty() const { return m_count == 0; }
+
+		private:
+			T* m_stack;
+			T m_array[Tree::maxStackSize];
+			std::vector<T> m_heap;
+			int m_count;
+			int m_capacity;
+		};
+
+		Vec3 Inverse(const Vec3& direction)
+		{
+			// divisions by zero give infinities, which the slab test handles.
+			return Vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		}
+
+		// slab test; true when the ray enters the box within [0, maxT], outTNear is the entry distance.
+		bool IntersectRay(const Bounds& box, const Vec3& origin, const Vec3& invDirection, float maxT, float& outTNear)
+		{
+			float tNear = 0.0f;
+			float tFar = maxT;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float t1 = (box.min[axis] - origin[axis]) * invDirection[axis];
+				const float t2 = (box.max[axis] - origin[axis]) * invDirection[axis];
+				tNear = std::max(tNear, std::min(t1, t2));
+				tFar = std::min(tFar, std::max(t1, t2));
+			}
+			outTNear = tNear;
+			return tNear <= tFar;
+		}
+
+		// ray packet in SoA layout, padded to a multiple of 4 lanes. padding lanes have a negative
+		// best distance so they never hit anything.
+		struct PacketLanes
+		{
+			float originX[RayPacket::maxSize];
+			float originY[RayPacket::maxSize];
+			float originZ[RayPacket::maxSize];
+			float invX[RayPacket::maxSize];
+			float invY[RayPacket::maxSize];
+			float invZ[RayPacket::maxSize];
+			float bestT[RayPacket::maxSize];
+			int laneCount;
+		};
+
+		// slab test of all lanes at once. returns a bit per lane that enters the box closer than
+		// its best distance, the entry distances are written to outTNear.
+		unsigned int IntersectPacket(const Bounds& box, const PacketLanes& lanes, float* outTNear)
+		{
+			unsigned int mask = 0;
+#if BVH_PACKET_SSE
+			for (int lane = 0; lane < lanes.laneCount; lane += 4)
+			{
+				__m128 tNear = _mm_setzero_ps();
+				__m128 tFar = _mm_loadu_ps(lanes.bestT + lane);
+
+				const __m128 originX = _mm_loadu_ps(lanes.originX + lane);
+				const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.min.x), originX), _mm_loadu_ps(lanes.invX + lane));
+				const __m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.max.x), originX), _mm_loadu_ps(lanes.invX + lane));
+				tNear = _mm_max_ps(tNear, _mm_min_ps(t1x, t2x));
+				tFar = _mm_min_ps(tFar, _mm_max_ps(t1x, t2x));
+
+				const __m128 originY = _mm_loadu_ps(lanes.originY + lane);
+				const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.min.y), originY), _mm_loadu_ps(lanes.invY + lane));
+				const __m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.max.y), originY), _mm_loadu_ps(lanes.invY + lane));
+				tNear = _mm_max_ps(tNear, _mm_min_ps(t1y, t2y));
+				tFar = _mm_min_ps(tFar, _mm_max_ps(t1y, t2y));
+
+				const __m128 originZ = _mm_loadu_ps(lanes.originZ + lane);
+				const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.min.z), originZ), _mm_loadu_ps(lanes.invZ + lane));
+				const __m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.max.z), originZ), _mm_loadu_ps(lanes.invZ + lane));
+				tNear = _mm_max_ps(tNear, _mm_min_ps(t1z, t2z));
+				tFar = _mm_min_ps(tFar, _mm_max_ps(t1z, t2z));
+
+				_mm_storeu_ps(outTNear + lane, tNear);
+				mask |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar))) << lane;
+			}
+#else
+			for (int lane = 0; lane < lanes.laneCount; ++lane)
+			{
+				const Vec3 origin(lanes.originX[lane], lanes.originY[lane], lanes.originZ[lane]);
+				const Vec3 invDirection(lanes.invX[lane], lanes.invY[lane], lanes.invZ[lane]);
+				if (IntersectRay(box, origin, invDirection, lanes.bestT[lane], outTNear[lane]))
+				{
+					mask |= 1u << lane;
+				}
+			}
+#endif
+			return mask;
+		}
+
+		// nearest entry distance over the lanes in mask.
+		float MinLaneT(unsigned int mask, const float* tNear)
+		{
+			float t = FLT_MAX;
+			for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+			{
+				if (mask & 1u)
+				{
+					t = std::min(t, tNear[lane]);
+				}
+			}
+			return t;
+		}
+	}
+
+	Tree::Tree(float aabbMargin, float displacementMultiplier)
+		: nodeCount(0)
+		, proxyCount(0)
+		, rootIndex(nullIndex)
+		, m_cullStats()
+		, m_freeList(nullIndex)
+		, m_aabbMargin(aabbMargin)
+		, m_displacementMultiplier(displacementMultiplier)
+	{
+	}
+
+	int Tree::InsertNode(int objectIndex, const AABB& box)
+	{
+		return InsertNode(objectIndex, Bounds(box));
+	}
+
+	int Tree::InsertNode(int objectIndex, const Bounds& box)
+	{
+		const int leafIndex = AllocateNode();
+		Node& leaf = m_nodes[leafIndex];
+		leaf.box = Bounds(box.min - Vec3(m_aabbMargin), box.max + Vec3(m_aabbMargin));
+		leaf.objectIndex = objectIndex;
+		leaf.height = 0;
+
+		InsertLeaf(leafIndex);
+		++proxyCount;
+		return leafIndex;
+	}
+
+	void Tree::Remove(int proxyId)
+	{
+		assert(proxyId >= 0 && proxyId < static_cast<int>(m_nodes.size()));
+		assert(m_nodes[proxyId].IsLeaf());
+
+		RemoveLeaf(proxyId);
+		FreeNode(proxyId);
+		--proxyCount;
+	}
+
+	bool Tree::MoveProxy(int proxyId, const AABB& box, const Vec3& displacement)
+	{
+		return MoveProxy(proxyId, Bounds(box), displacement);
+	}
+
+	bool Tree::MoveProxy(int proxyId, const Bounds& box, const Vec3& displacement)
+	{
+		assert(proxyId >= 0 && proxyId < static_cast<int>(m_nodes.size()));
+		assert(m_nodes[proxyId].IsLeaf());
+
+		// extend the box by the margin and predict the motion along the displacement.
+		Bounds fatBox(box.min - Vec3(m_aabbMargin), box.max + Vec3(m_aabbMargin));
+		const Vec3 d = displacement * m_displacementMultiplier;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (d[axis] < 0.0f)
+			{
+				fatBox.min[axis] += d[axis];
+			}
+			else
+			{
+				fatBox.max[axis] += d[axis];
+			}
+		}
+
+		const Bounds& treeBox = m_nodes[proxyId].box;
+		if (treeBox.Contains(box))
+		{
+			// the tree box still holds the object, but it might be too large when the object
+			// was moving fast and has slowed down since.
+			const Vec3 hugeMargin(4.0f * m_aabbMargin);
+			const Bounds hugeBox(fatBox.min - hugeMargin, fatBox.max + hugeMargin);
+			if (hugeBox.Contains(treeBox))
+			{
+				return false;
+			}
+		}
+
+		RemoveLeaf(proxyId);
+		m_nodes[proxyId].box = fatBox;
+		InsertLeaf(proxyId);
+		return true;
+	}
+
+	void Tree::Clear()
+	{
+		m_nodes.clear();
+		m_searchHeap.clear();
+		m_cullPlanes.clear();
+		m_freeList = nullIndex;
+		nodeCount = 0;
+		proxyCount = 0;
+		rootIndex = nullIndex;
+	}
+
+	float Tree::ComputeCost() const
+	{
+		float cost = 0.0f;
+		const int size = static_cast<int>(m_nodes.size());
+		for (int i = 0; i < size; ++i)
+		{
+			if (m_nodes[i].height > 0)
+			{
+				cost += m_nodes[i].box.Area();
+			}
+		}
+		return cost;
+	}
+
+	float Tree::GetAreaRatio() const
+	{
+		if (rootIndex == nullIndex)
+		{
+			return 0.0f;
+		}
+
+		const float rootArea = m_nodes[rootIndex].box.Area();
+		return rootArea > 0.0f ? ComputeCost() / rootArea : 0.0f;
+	}
+
+	int Tree::GetHeight() const
+	{
+		return rootIndex == nullIndex ? 0 : m_nodes[rootIndex].height;
+	}
+
+	int Tree::GetMaxBalance() const
+	{
+		int maxBalance = 0;
+		const int size = static_cast<int>(m_nodes.size());
+		for (int i = 0; i < size; ++i)
+		{
+			const Node& node = m_nodes[i];
+			if (node.height <= 1)
+			{
+				continue;
+			}
+
+			const int balance = std::abs(m_nodes[node.child2].height - m_nodes[node.child1].height);
+			maxBalance = std::max(maxBalance, balance);
+		}
+		return maxBalance;
+	}
+
+	void Tree::Validate() const
+	{
+		if (rootIndex != nullIndex)
+		{
+			assert(m_nodes[rootIndex].parentIndex == nullIndex);
+			ValidateNode(rootIndex);
+		}
+
+		int freeCount = 0;
+		for (int index = m_freeList; index != nullIndex; index = m_nodes[index].parentIndex)
+		{
+			assert(m_nodes[index].height == -1);
+			++freeCount;
+		}
+		assert(nodeCount + freeCount == static_cast<int>(m_nodes.size()));
+		(void)freeCount;
+	}
+
+	int Tree::CullFrustum(const glm::vec4 planes[6], std::vector<int>& outObjects)
+	{
+		/*
+
+		  Top-down walk that carries a mask of the planes a node still has to be tested against.
+		  A node fully inside a plane passes that knowledge to its children, and once a node is
+		  inside all of them its whole subtree is emitted without further tests. The plane that
+		  rejected a node last time is tested first, consecutive frames tend to reject with it.
+
+		*/
+		const unsigned int allPlanes = (1u << 6) - 1;
+
+		m_cullStats = CullStats();
+		if (rootIndex == nullIndex)
+		{
+			return 0;
+		}
+
+		if (m_cullPlanes.size() < m_nodes.size())
+		{
+			m_cullPlanes.resize(m_nodes.size(), 0);
+		}
+
+		const size_t firstObject = outObjects.size();
+
+		m_cullStack.clear();
+		m_cullStack.push_back({ rootIndex, allPlanes });
+		while (!m_cullStack.empty())
+		{
+			const CullEntry entry = m_cullStack.back();
+			m_cullStack.pop_back();
+
+			const Node& node = m_nodes[entry.index];
+			++m_cullStats.nodesVisited;
+
+			unsigned int planeMask = entry.planeMask;
+			bool rejected = false;
+
+			// test the cached plane first, then the rest of the mask.
+			const unsigned int cachedPlane = m_cullPlanes[entry.index];
+			for (unsigned int i = 0; i < 6 && !rejected; ++i)
+			{
+				const unsigned int p = i == 0 ? cachedPlane : (i <= cachedPlane ? i - 1 : i);
+				if ((planeMask & (1u << p)) == 0)
+				{
+					continue;
+				}
+
+				++m_cullStats.planeTests;
+				const glm::vec4& plane = planes[p];
+
+				// positive vertex outside means the box is outside, same test as CameraFrustum::Intersect.
+				const Vec3 positive(
+					plane.x >= 0.0f ? node.box.max.x : node.box.min.x,
+					plane.y >= 0.0f ? node.box.max.y : node.box.min.y,
+					plane.z >= 0.0f ? node.box.max.z : node.box.min.z);
+				if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.0f)
+				{
+					m_cullPlanes[entry.index] = static_cast<unsigned char>(p);
+					rejected = true;
+					break;
+				}
+
+				// negative vertex inside means the box is fully inside this plane.
+				const Vec3 negative(
+					plane.x >= 0.0f ? node.box.min.x : node.box.max.x,
+					plane.y >= 0.0f ? node.box.min.y : node.box.max.y,
+					plane.z >= 0.0f ? node.box.min.z : node.box.max.z);
+				if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w >= 0.0f)
+				{
+					planeMask &= ~(1u << p);
+				}
+			}
+
+			if (rejected)
+			{
+				continue;
+			}
+
+			if (node.IsLeaf())
+			{
+				outObjects.push_back(node.objectIndex);
+			}
+			else if (planeMask == 0)
+			{
+				++m_cullStats.subtreesAccepted;
+				EmitSubtree(entry.index, outObjects);
+			}
+			else
+			{
+				m_cullStack.push_back({ node.child2, planeMask });
+				m_cullStack.push_back({ node.child1, planeMask });
+			}
+		}
+
+		return static_cast<int>(outObjects.size() - firstObject);
+	}
+
+	int Tree::CullFrustum(const CameraFrustum& frustum, std::vector<int>& outObjects)
+	{
+		glm::vec4 planes[6];
+		FrustumCulling::GetPlanes(frustum, planes);
+		return CullFrustum(planes, outObjects);
+	}
+
+	void Tree::EmitSubtree(int index, std::vector<int>& outObjects)
+	{
+		// shares the cull stack, everything above the current top belongs to this subtree.
+		const size_t base = m_cullStack.size();
+		m_cullStack.push_back({ index, 0 });
+		while (m_cullStack.size() > base)
+		{
+			const Node& node = m_nodes[m_cullStack.back().index];
+			m_cullStack.pop_back();
+
+			if (node.IsLeaf())
+			{
+				outObjects.push_back(node.objectIndex);
+			}
+			else
+			{
+				m_cullStack.push_back({ node.child2, 0 });
+				m_cullStack.push_back({ node.child1, 0 });
+			}
+		}
+	}
+
+	int Tree::AllocateNode()
+	{
+		int index;
+		if (m_freeList != nullIndex)
+		{
+			index = m_freeList;
+			m_freeList = m_nodes[index].parentIndex;
+		}
+		else
+		{
+			index = static_cast<int>(m_nodes.size());
+			m_nodes.push_back(Node());
+		}
+
+		Node& node = m_nodes[index];
+		node.objectIndex = nullIndex;
+		node.parentIndex = nullIndex;
+		node.child1 = nullIndex;
+		node.child2 = nullIndex;
+		node.height = 0;
+		++nodeCount;
+		return index;
+	}
+
+	void Tree::FreeNode(int index)
+	{
+		Node& node = m_nodes[index];
+		node.parentIndex = m_freeList;
+		node.child1 = nullIndex;
+		node.child2 = nullIndex;
+		node.height = -1;
+		m_freeList = index;
+		--nodeCount;
+	}
+
+	void Tree::InsertLeaf(int leafIndex)
+	{
+		if (rootIndex == nullIndex)
+		{
+			rootIndex = leafIndex;
+			m_nodes[leafIndex].parentIndex = nullIndex;
+			return;
+		}
+
+		// stage 1: find the best sibling for the new leaf
+		const Bounds leafBox = m_nodes[leafIndex].box;
+		const int sibling = PickBest(leafBox);
+
+		// stage 2: create new parent
+		const int oldParent = m_nodes[sibling].parentIndex;
+		const int newParent = AllocateNode();
+		{
+			Node& parent = m_nodes[newParent];
+			parent.parentIndex = oldParent;
+			parent.box = Bounds::Union(leafBox, m_nodes[sibling].box);
+			parent.height = m_nodes[sibling].height + 1;
+			parent.child1 = sibling;
+			parent.child2 = leafIndex;
+		}
+
+		if (oldParent != nullIndex)
+		{
+			// the sibling was not the root
+			if (m_nodes[oldParent].child1 == sibling)
+			{
+				m_nodes[oldParent].child1 = newParent;
+			}
+			else
+			{
+				m_nodes[oldParent].child2 = newParent;
+			}
+		}
+		else
+		{
+			// the sibling was the root
+			rootIndex = newParent;
+		}
+
+		m_nodes[sibling].parentIndex = newParent;
+		m_nodes[leafIndex].parentIndex = newParent;
+
+		// stage 3: walk back up the tree refitting AABBs
+		Refit(newParent);
+	}
+
+	void Tree::RemoveLeaf(int leafIndex)
+	{
+		if (leafIndex == rootIndex)
+		{
+			rootIndex = nullIndex;
+			return;
+		}
+
+		const int parent = m_nodes[leafIndex].parentIndex;
+		const int grandParent = m_nodes[parent].parentIndex;
+		const int sibling = m_nodes[parent].child1 == leafIndex ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+		if (grandParent != nullIndex)
+		{
+			// destroy the parent and connect the sibling to the grand parent.
+			if (m_nodes[grandParent].child1 == parent)
+			{
+				m_nodes[grandParent].child1 = sibling;
+			}
+			else
+			{
+				m_nodes[grandParent].child2 = sibling;
+			}
+			m_nodes[sibling].parentIndex = grandParent;
+			FreeNode(parent);
+
+			Refit(grandParent);
+		}
+		else
+		{
+			rootIndex = sibling;
+			m_nodes[sibling].parentIndex = nullIndex;
+			FreeNode(parent);
+		}
+
+		m_nodes[leafIndex].parentIndex = nullIndex;
+	}
+
+	void Tree::Refit(int index)
+	{
+		while (index != nullIndex)
+		{
+			Node& node = m_nodes[index];
+			const Node& child1 = m_nodes[node.child1];
+			const Node& child2 = m_nodes[node.child2];
+
+			node.box = Bounds::Union(child1.box, child2.box);
+			node.height = 1 + std::max(child1.height, child2.height);
+
+			Rotate(index);
+
+			index = node.parentIndex;
+		}
+	}
+
+	void Tree::Rotate(int index)
+	{
+		/*
+
+		  Tree rotations swap a child of A with one of the grand children on the other side,
+		  whenever that shrinks the surface area of the child that changed. A's box stays the
+		  same so the ancestors are unaffected.
+
+		        A
+		      /   \
+		     B     C
+		    / \   / \
+		   D   E F   G
+
+		*/
+		Node& A = m_nodes[index];
+		if (A.height < 2)
+		{
+			return;
+		}
+
+		enum Rotation { None, BF, BG, CD, CE };
+		Rotation best = None;
+		float bestDiff = 0.0f;
+
+		const int iB = A.child1;
+		const int iC = A.child2;
+		Node& B = m_nodes[iB];
+		Node& C = m_nodes[iC];
+
+		if (C.height > 0)
+		{
+			const float areaC = C.box.Area();
+			const Bounds& F = m_nodes[C.child1].box;
+			const Bounds& G = m_nodes[C.child2].box;
+
+			// B <-> F leaves C = B + G
+			const float diffBF = Bounds::Union(B.box, G).Area() - areaC;
+			if (diffBF < bestDiff)
+			{
+				best = BF;
+				bestDiff = diffBF;
+			}
+
+			// B <-> G leaves C = F + B
+			const float diffBG = Bounds::Union(B.box, F).Area() - areaC;
+			if (diffBG < bestDiff)
+			{
+				best = BG;
+				bestDiff = diffBG;
+			}
+		}
+
+		if (B.height > 0)
+		{
+			const float areaB = B.box.Area();
+			const Bounds& D = m_nodes[B.child1].box;
+			const Bounds& E = m_nodes[B.child2].box;
+
+			// C <-> D leaves B = C + E
+			const float diffCD = Bounds::Union(C.box, E).Area() - areaB;
+			if (diffCD < bestDiff)
+			{
+				best = CD;
+				bestDiff = diffCD;
+			}
+
+			// C <-> E leaves B = D + C
+			const float diffCE = Bounds::Union(C.box, D).Area() - areaB;
+			if (diffCE < bestDiff)
+			{
+				best = CE;
+				bestDiff = diffCE;
+			}
+		}
+
+		switch (best)
+		{
+		case BF:
+		case BG:
+		{
+			const int iF = C.child1;
+			const int iG = C.child2;
+			const int iSwap = best == BF ? iF : iG;
+			const int iKeep = best == BF ? iG : iF;
+
+			A.child1 = iSwap;
+			if (best == BF)
+			{
+				C.child1 = iB;
+			}
+			else
+			{
+				C.child2 = iB;
+			}
+			B.parentIndex = iC;
+			m_nodes[iSwap].parentIndex = index;
+
+			C.box = Bounds::Union(B.box, m_nodes[iKeep].box);
+			C.height = 1 + std::max(B.height, m_nodes[iKeep].height);
+			A.height = 1 + std::max(C.height, m_nodes[iSwap].height);
+			break;
+		}
+		case CD:
+		case CE:
+		{
+			const int iD = B.child1;
+			const int iE = B.child2;
+			const int iSwap = best == CD ? iD : iE;
+			const int iKeep = best == CD ? iE : iD;
+
+			A.child2 = iSwap;
+			if (best == CD)
+			{
+				B.child1 = iC;
+			}
+			else
+			{
+				B.child2 = iC;
+			}
+			C.parentIndex = iB;
+			m_nodes[iSwap].parentIndex = index;
+
+			B.box = Bounds::Union(C.box, m_nodes[iKeep].box);
+			B.height = 1 + std::max(C.height, m_nodes[iKeep].height);
+			A.height = 1 + std::max(B.height, m_nodes[iSwap].height);
+			break;
+		}
+		case None:
+		default:
+			break;
+		}
+	}
+
+	int Tree::PickBest(const Bounds& box)
+	{
+		/*
+
+		  Branch and bound search for the sibling with the lowest SAH cost. Choosing node X as
+		  the sibling costs the area of (X + leaf) plus the area every ancestor of X grows by,
+		  the inherited cost. Any node below X costs at least leafArea + the inherited cost of
+		  its parent, so subtrees whose lower bound can't beat the best cost are skipped.
+
+		*/
+		const float leafArea = box.Area();
+
+		int best = rootIndex;
+		float bestCost = Bounds::Union(m_nodes[rootIndex].box, box).Area();
+
+		m_searchHeap.clear();
+		m_searchHeap.push_back({ 0.0f, rootIndex });
+		while (!m_searchHeap.empty())
+		{
+			std::pop_heap(m_searchHeap.begin(), m_searchHeap.end(), std::greater<Candidate>());
+			const Candidate candidate = m_searchHeap.back();
+			m_searchHeap.pop_back();
+
+			if (candidate.inheritedCost + leafArea >= bestCost)
+			{
+				// the heap is ordered by lower bound, nothing left can do better.
+				break;
+			}
+
+			const Node& node = m_nodes[candidate.index];
+			const float unionArea = Bounds::Union(node.box, box).Area();
+			const float directCost = unionArea + candidate.inheritedCost;
+			if (directCost < bestCost)
+			{
+				bestCost = directCost;
+				best = candidate.index;
+			}
+
+			if (!node.IsLeaf())
+			{
+				const float childInheritedCost = candidate.inheritedCost + unionArea - node.box.Area();
+				if (childInheritedCost + leafArea < bestCost)
+				{
+					m_searchHeap.push_back({ childInheritedCost, node.child1 });
+					std::push_heap(m_searchHeap.begin(), m_searchHeap.end(), std::greater<Candidate>());
+					m_searchHeap.push_back({ childInheritedCost, node.child2 });
+					std::push_heap(m_searchHeap.begin(), m_searchHeap.end(), std::greater<Candidate>());
+				}
+			}
+		}
+
+		return best;
+	}
+
+	void Tree::ValidateNode(int index) const
+	{
+		const Node& node = m_nodes[index];
+		if (node.IsLeaf())
+		{
+			assert(node.child2 == nullIndex);
+			assert(node.height == 0);
+			return;
+		}
+
+		const Node& child1 = m_nodes[node.child1];
+		const Node& child2 = m_nodes[node.child2];
+		assert(child1.parentIndex == index);
+		assert(child2.parentIndex == index);
+		assert(node.height == 1 + std::max(child1.height, child2.height));
+		assert(node.box.Contains(child1.box) && node.box.Contains(child2.box));
+		(void)child1;
+		(void)child2;
+
+		ValidateNode(node.child1);
+		ValidateNode(node.child2);
+	}
+
+	bool Tree::RayCast(const Vec3& origin, const Vec3& direction, float maxDistance, RayHit& outHit, HitMode mode, const RayCallback& callback) const
+	{
+		outHit.proxyId = nullIndex;
+		outHit.objectIndex = nullIndex;
+		outHit.t = maxDistance;
+
+		if (rootIndex == nullIndex)
+		{
+			return false;
+		}
+
+		const Vec3 invDirection = Inverse(direction);
+		float bestT = maxDistance;
+
+		float rootT;
+		if (!IntersectRay(m_nodes[rootIndex].box, origin, invDirection, bestT, rootT))
+		{
+			return false;
+		}
+
+		GrowableStack<RayStackEntry> stack;
+		stack.Push({ rootIndex, rootT });
+		while (!stack.IsEmpty())
+		{
+			const RayStackEntry entry = stack.Pop();
+			if (entry.tNear > bestT)
+			{
+				// a closer hit was found after this node was pushed
+				continue;
+			}
+
+			const Node& node = m_nodes[entry.index];
+			if (node.IsLeaf())
+			{
+				float t = entry.tNear;
+				if (callback && !callback(node.objectIndex, origin, direction, bestT, t))
+				{
+					continue;
+				}
+				if (t > bestT)
+				{
+					continue;
+				}
+
+				bestT = t;
+				outHit.proxyId = entry.index;
+				outHit.objectIndex = node.objectIndex;
+				outHit.t = t;
+				if (mode == HitMode::Any)
+				{
+					return true;
+				}
+				continue;
+			}
+
+			float t1, t2;
+			const bool hit1 = IntersectRay(m_nodes[node.child1].box, origin, invDirection, bestT, t1);
+			const bool hit2 = IntersectRay(m_nodes[node.child2].box, origin, invDirection, bestT, t2);
+
+			// push the far child first so the near one is visited next.
+			if (hit1 && hit2)
+			{
+				if (t1 <= t2)
+				{
+					stack.Push({ node.child2, t2 });
+					stack.Push({ node.child1, t1 });
+				}
+				else
+				{
+					stack.Push({ node.child1, t1 });
+					stack.Push({ node.child2, t2 });
+				}
+			}
+			else if (hit1)
+			{
+				stack.Push({ node.child1, t1 });
+			}
+			else if (hit2)
+			{
+				stack.Push({ node.child2, t2 });
+			}
+		}
+
+		return outHit.proxyId != nullIndex;
+	}
+
+	bool Tree::SegmentCast(const Vec3& p1, const Vec3& p2, RayHit& outHit, HitMode mode, const RayCallback& callback) const
+	{
+		return RayCast(p1, p2 - p1, 1.0f, outHit, mode, callback);
+	}
+
+	int Tree::RayCastPacket(const RayPacket& packet, RayHit* outHits, const RayCallback& callback) const
+	{
+		assert(packet.size >= 0 && packet.size <= RayPacket::maxSize);
+
+		PacketLanes lanes;
+		lanes.laneCount = (packet.size + 3) & ~3;
+		for (int lane = 0; lane < lanes.laneCount; ++lane)
+		{
+			const bool active = lane < packet.size;
+			const Vec3 origin = active ? packet.origins[lane] : Vec3(0.0f);
+			const Vec3 invDirection = active ? Inverse(packet.directions[lane]) : Vec3(1.0f);
+			lanes.originX[lane] = origin.x;
+			lanes.originY[lane] = origin.y;
+			lanes.originZ[lane] = origin.z;
+			lanes.invX[lane] = invDirection.x;
+			lanes.invY[lane] = invDirection.y;
+			lanes.invZ[lane] = invDirection.z;
+			lanes.bestT[lane] = active ? packet.maxDistances[lane] : -1.0f;
+
+			if (active)
+			{
+				outHits[lane].proxyId = nullIndex;
+				outHits[lane].objectIndex = nullIndex;
+				outHits[lane].t = packet.maxDistances[lane];
+			}
+		}
+
+		if (rootIndex == nullIndex || packet.size == 0)
+		{
+			return 0;
+		}
+
+		float tNear[RayPacket::maxSize];
+		unsigned int rootMask = IntersectPacket(m_nodes[rootIndex].box, lanes, tNear);
+		if (rootMask == 0)
+		{
+			return 0;
+		}
+
+		GrowableStack<RayStackEntry> stack;
+		stack.Push({ rootIndex, MinLaneT(rootMask, tNear) });
+		while (!stack.IsEmpty())
+		{
+			const RayStackEntry entry = stack.Pop();
+
+			float farthestBestT = -1.0f;
+			for (int lane = 0; lane < packet.size; ++lane)
+			{
+				farthestBestT = std::max(farthestBestT, lanes.bestT[lane]);
+			}
+			if (entry.tNear > farthestBestT)
+			{
+				continue;
+			}
+
+			const Node& node = m_nodes[entry.index];
+			if (node.IsLeaf())
+			{
+				// children are only pushed with their own hit mask computed, redo it for the
+				// lanes' current best distances.
+				unsigned int mask = IntersectPacket(node.box, lanes, tNear);
+				for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+				{
+					if ((mask & 1u) == 0)
+					{
+						continue;
+					}
+
+					float t = tNear[lane];
+					if (callback && !callback(node.objectIndex, packet.origins[lane], packet.directions[lane], lanes.bestT[lane], t))
+					{
+						continue;
+					}
+					if (t > lanes.bestT[lane])
+					{
+						continue;
+					}
+
+					lanes.bestT[lane] = t;
+					outHits[lane].proxyId = entry.index;
+					outHits[lane].objectIndex = node.objectIndex;
+					outHits[lane].t = t;
+				}
+				continue;
+			}
+
+			float tNear1[RayPacket::maxSize];
+			float tNear2[RayPacket::maxSize];
+			const unsigned int mask1 = IntersectPacket(m_nodes[node.child1].box, lanes, tNear1);
+			const unsigned int mask2 = IntersectPacket(m_nodes[node.child2].box, lanes, tNear2);
+			const float t1 = MinLaneT(mask1, tNear1);
+			const float t2 = MinLaneT(mask2, tNear2);
+
+			// the child the packet reaches first is visited next.
+			if (mask1 != 0 && mask2 != 0)
+			{
+				if (t1 <= t2)
+				{
+					stack.Push({ node.child2, t2 });
+					stack.Push({ node.child1, t1 });
+				}
+				else
+				{
+					stack.Push({ node.child1, t1 });
+					stack.Push({ node.child2, t2 });
+				}
+			}
+			else if (mask1 != 0)
+			{
+				stack.Push({ node.child1, t1 });
+			}
+			else if (mask2 != 0)
+			{
+				stack.Push({ node.child2, t2 });
+			}
+		}
+
+		int hitCount = 0;
+		for (int lane = 0; lane < packet.size; ++lane)
+		{
+			if (outHits[lane].proxyId != nullIndex)
+			{
+				++hitCount;
+			}
+		}
+		return hitCount;
+	}
+
+	void Tree::Overlap(const Bounds& box, std::vector<int>& outObjects) const
+	{
+		if (rootIndex == nullIndex)
+		{
+			return;
+		}
+
+		GrowableStack<int> stack;
+		stack.Push(rootIndex);
+		while (!stack.IsEmpty())
+		{
+			const Node& node = m_nodes[stack.Pop()];
+			if (!node.box.Overlaps(box))
+			{
+				continue;
+			}
+
+			if (node.IsLeaf())
+			{
+				outObjects.push_back(node.objectIndex);
+			}
+			else
+			{
+				stack.Push(node.child2);
+				stack.Push(node.child1);
+			}
+		}
+	}
+
+	void Tree::Overlap(const AABB& box, std::vector<int>& outObjects) const
+	{
+		Overlap(Bounds(box), outObjects);
+	}
+}
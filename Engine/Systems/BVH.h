@@ -1,282 +1,226 @@
-
 #pragma once
 
 #include "AABB.h"
 #include "Utils/MathUtils.h"
 
+#include <functional>
 #include <vector>
-#include <stack>
-#include <queue>
+
+class CameraFrustum;
 
 namespace bvh
 {
 	using Vec3 = glm::vec3;
+	struct Bounds;
 	struct Node;
 	struct Tree;
 
-	struct Node
+	// light weight box used by the tree nodes; AABB keeps its corner points on the heap, which
+	// is too expensive to copy around per node.
+	struct Bounds
 	{
-		AABB box;
-		int objectIndex;
-		int parentIndex;
-		int child1;
-		int child2;
-		bool isLeaf;
-	};
-
-	struct Tree
-	{
-		static int nullIndex;
+		Bounds() = default;
+		Bounds(const Vec3& min, const Vec3& max)
+			: min(min), max(max)
+		{ }
+		explicit Bounds(const AABB& aabb)
+			: min(aabb.GetMin()), max(aabb.GetMax())
+		{ }
+
+		float Area() const
+		{
+			const Vec3 d = max - min;
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
 
-		void InsertNode(int objectIndex, AABB box)
+		bool Contains(const Bounds& other) const
 		{
-			int leafIndex = CreateNode(objectIndex, box);
-			if (nodeCount == 1)
-			{
-				rootIndex = leafIndex;
-				return;
-			}
-
-			// stage 1: find the best sibling for the new leaf
-			int sibling = 0;
-			for (int i = 0; i < nodeCount; ++i)
-			{
-				// sibling = PickBest(tree, leafIndex, i);
-			}
-
-			// stage 2: create new parent
-			int oldParent = m_nodes[sibling]->parentIndex;
-			int newParent = CreateInternalNode();
-
-			m_nodes[newParent]->parentIndex = oldParent;
-			m_nodes[newParent]->box = AABB::Union(m_nodes[sibling]->box, m_nodes[leafIndex]->box);
-
-			if (m_nodes[sibling]->parentIndex == nullIndex)
-			{
-				// the sibling was the root
-				m_nodes[newParent]->child1 = sibling;
-				m_nodes[newParent]->child2 = leafIndex;
-
-				m_nodes[sibling]->parentIndex = newParent;
-				m_nodes[leafIndex]->parentIndex = newParent;
-
-				rootIndex = newParent;
-			}
-			else
-			{
-				// the sibling was not the root
-				if (m_nodes[oldParent]->child1 == sibling)
-				{
-					m_nodes[oldParent]->child1 = newParent;
-				}
-				else
-				{
-					m_nodes[oldParent]->child2 = newParent;
-				}
-
-				m_nodes[newParent]->child1 = sibling;
-				m_nodes[newParent]->child2 = leafIndex;
-				m_nodes[sibling]->parentIndex = newParent;
-				m_nodes[leafIndex]->parentIndex = newParent;
-			}
-
-			// stages 3: walk back up the tree refitting AABBs
-			int index = m_nodes[leafIndex]->parentIndex;
-			while (index != nullIndex)
-			{
-				int child1 = m_nodes[index]->child1;
-				int child2 = m_nodes[index]->child2;
-
-				// Rotate(index);
-
-				m_nodes[index]->box = AABB::Union(m_nodes[child1]->box, m_nodes[child2]->box);
-				index = m_nodes[index]->parentIndex;
-			}
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+				&& other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
 		}
 
-		int CreateNode(int objectIndex, AABB box) 
+		bool Overlaps(const Bounds& other) const
 		{
-			Node* node = new Node();
-			node->box = box;
-			node->objectIndex = objectIndex;
-			node->child1 = nullIndex;
-			node->child2 = nullIndex;
-			node->parentIndex = nullIndex;
-			node->isLeaf = true;
-
-			m_nodes.push_back(node);
-			nodeCount = m_nodes.size();
-			return nodeCount -1;
+			return min.x <= other.max.x && max.x >= other.min.x
+				&& min.y <= other.max.y && max.y >= other.min.y
+				&& min.z <= other.max.z && max.z >= other.min.z;
 		}
 
-		int CreateInternalNode()
+		static Bounds Union(const Bounds& a, const Bounds& b)
 		{
-			Node* node = new Node();
-			node->box = AABB();
-			node->objectIndex = nullIndex;
-			node->child1 = nullIndex;
-			node->child2 = nullIndex;
-			node->parentIndex = nullIndex;
-			node->isLeaf = false;
-
-			m_nodes.push_back(node);
-			nodeCount = m_nodes.size();
-			return nodeCount-1;
+			return Bounds(glm::min(a.min, b.min), glm::max(a.max, b.max));
 		}
 
-		const std::vector<Node*>& GetNodes() const { return m_nodes; }
+		Vec3 min;
+		Vec3 max;
+	};
 
-		std::vector<Node*> m_nodes;
-		Node* nodes;
-		int nodeCount;
-		int rootIndex;
+	struct Node
+	{
+		bool IsLeaf() const { return child1 == -1; }
+
+		Bounds box;
+		int objectIndex;
+		int parentIndex;	// next free node while the node sits in the free list
+		int child1;
+		int child2;
+		int height;			// leaf = 0, free node = -1
 	};
 
-#if 0
-	float ComputeCost(Tree tree)
+	struct RayHit
 	{
-		float cost = 0.0f;
-		for (int i = 0; i < tree.nodeCount; ++i)
-		{
-			if (!tree.nodes[i].isLeaf) 
-			{
-				cost += tree.nodes[i].box.Area();
-			}
-		}
-		return cost;
-	}
+		int proxyId;
+		int objectIndex;
+		float t;		// hit distance in units of the ray direction, a fraction for segments
+	};
 
-	bool TreeRayCast(Tree tree, Vec3 p1, Vec3 p2)
+	enum class HitMode
 	{
-		std::stack<int> stack;
-		stack.push(tree.rootIndex);
-		while (!stack.empty())
-		{
-			int index = stack.top();
-			stack.pop();
-
-			//if (!TestOverlap(tree.nodes[index].box, p1, p2))
-			{
-				continue;
-			}
-
-			// we hit an AABB
-			if (tree.nodes[index].isLeaf)
-			{
-				int objectIndex = tree.nodes[index].objectIndex;
-				//if (RayCast(objects[objectIndex], p1, p2))
-				{
-					// we hit the Object inside the AABB
-					return true;
-				}
-			}
-			else
-			{
-				// Not a leaf, so add children to be checked against.
-				stack.push(tree.nodes[index].child1);
-				stack.push(tree.nodes[index].child2);
-			}
-		}
-		return false;
-	}
+		Closest,	// keep searching for the nearest hit
+		Any			// stop at the first hit, for line of sight checks
+	};
+
+	// per object ray test called for leaves whose box is hit. returns true and the distance in
+	// outT when the object itself is hit closer than maxT.
+	using RayCallback = std::function<bool(int objectIndex, const Vec3& origin, const Vec3& direction, float maxT, float& outT)>;
 
-	int PickBest(Tree tree, int leaf, int nodeIndex)
+	// up to maxSize coherent rays traced through the tree together.
+	struct RayPacket
 	{
-		float inheritedCost = 0.0f;
-		while( nodeIndex >= 0 ) {
-			inheritedCost += tree.nodes[nodeIndex].box.Area();
-			nodeIndex--;
-		}
+		static const int maxSize = 8;
 
-		float directCost = AABB::Union(tree.nodes[leaf].box, tree.nodes[nodeIndex].box).Area();
-		//if (directCost + inheritedCost < cBest)
-		{
-		//	cBest = directCost + inheritedCost;
-		}
+		Vec3 origins[maxSize];
+		Vec3 directions[maxSize];
+		float maxDistances[maxSize];
+		int size;
+	};
 
-		float lowerBoundCost = AABB::Union(tree.nodes[tree.nodes[nodeIndex].child1].box,
-			tree.nodes[tree.nodes[nodeIndex].child2].box).Area();
-		//if (lowerBoundCost > cBest)
-		{
-			return nodeIndex;
-		}
-	}
+	/*
 
-	int AllocateLeafNode(Tree tree, int objectIndex, AABB box)
-	{
-		Node* node = new Node();
-		node->box = box;
-		node->objectIndex = objectIndex;
-		node->child1 = nullIndex;
-		node->child2 = nullIndex;
-		node->parentIndex = nullIndex;
-		node->isLeaf = true;
-		return 0;
-	}
-
-	void InsertLeaf(Tree tree, int objectIndex, AABB box)
+	  Dynamic AABB tree. Leaves (proxies) store a fattened box of the object so small motions
+	  don't need a reinsertion. Siblings for new leaves are picked with a branch and bound
+	  search over the surface area heuristic and the tree is kept balanced with rotations
+	  while refitting. Nodes live in a single pool with a free list, the proxy ID of an object
+	  is the index of its leaf node.
+
+	*/
+	struct Tree
 	{
-		int leafIndex = AllocateLeafNode(tree, objectIndex, box);
-		if (tree.nodeCount == 0)
-		{
-			tree.rootIndex = leafIndex;
-			return;
-		}
+		static const int nullIndex;
+		// entries of the query traversal stacks kept on the call stack; deeper trees spill to the heap.
+		static const int maxStackSize = 256;
 
-		// stage 1: find the best sibling for the new leaf
-		int sibling = 0;
-		if (tree.nodeCount > 0) {
-			// cBest = AABB::Union(tree.nodes[0].box, tree.nodes[leafIndex].box).Area();
-		}
-		for (int i = 0; i < tree.nodeCount; ++i)
-		{
-			sibling = PickBest(tree, leafIndex, i);
-		}
+		Tree(float aabbMargin = 0.1f, float displacementMultiplier = 4.0f);
+
+		// inserts an object and returns its proxy ID.
+		int InsertNode(int objectIndex, const AABB& box);
+		int InsertNode(int objectIndex, const Bounds& box);
+
+		void Remove(int proxyId);
+
+		// updates the bounds of a proxy; returns true when the proxy had to be reinserted.
+		bool MoveProxy(int proxyId, const AABB& box, const Vec3& displacement = Vec3(0.0f));
+		bool MoveProxy(int proxyId, const Bounds& box, const Vec3& displacement = Vec3(0.0f));
+
+		void Clear();
+
+		const Bounds& GetFatBounds(int proxyId) const { return m_nodes[proxyId].box; }
+		int GetObjectIndex(int proxyId) const { return m_nodes[proxyId].objectIndex; }
+
+		// sum of the surface area of all internal nodes; the quantity SAH insertion minimizes.
+		float ComputeCost() const;
+		// cost relative to the root area.
+		float GetAreaRatio() const;
+		int GetHeight() const;
+		int GetMaxBalance() const;
+		int GetProxyCount() const { return proxyCount; }
+		void Validate() const;
+
+		const std::vector<Node>& GetNodes() const { return m_nodes; }
 
-		// stage 2: create new parent
-		int oldParent = 0;// tree.nodes[sibling].parentIndex;
-		int newParent = 0;// AllocateInternalNode(tree);
-		tree.nodes[newParent].parentIndex = oldParent;
-		tree.nodes[newParent].box = AABB::Union(box, tree.nodes[sibling].box);
-		//if (oldParent != nullIndex)
+		struct CullStats
 		{
-			// the sibling was not the root
-			if (tree.nodes[oldParent].child1 == sibling)
-			{
-				tree.nodes[oldParent].child1 = newParent;
-			}
-			else
-			{ 
-				tree.nodes[oldParent].child2 = newParent;
-			}
-
-			tree.nodes[newParent].child1 = sibling;
-			tree.nodes[newParent].child2 = leafIndex;
-			tree.nodes[sibling].parentIndex = newParent;
-			tree.nodes[leafIndex].parentIndex = newParent;
-		}
-		// else
+			int nodesVisited;
+			int planeTests;
+			int subtreesAccepted;	// fully inside subtrees emitted without plane tests
+		};
+
+		// appends the objectIndex of every proxy whose box is inside or intersects the frustum.
+		// planes face inward, xyz = normal and w = d. returns the number of objects appended.
+		int CullFrustum(const glm::vec4 planes[6], std::vector<int>& outObjects);
+		int CullFrustum(const CameraFrustum& frustum, std::vector<int>& outObjects);
+		const CullStats& GetCullStats() const { return m_cullStats; }
+
+		// ray queries visit the nearer child first; without a callback the leaf box is the hit.
+		bool RayCast(const Vec3& origin, const Vec3& direction, float maxDistance, RayHit& outHit,
+			HitMode mode = HitMode::Closest, const RayCallback& callback = nullptr) const;
+		bool SegmentCast(const Vec3& p1, const Vec3& p2, RayHit& outHit,
+			HitMode mode = HitMode::Closest, const RayCallback& callback = nullptr) const;
+		// closest hit for every ray of the packet, misses get proxyId nullIndex. returns the hit count.
+		int RayCastPacket(const RayPacket& packet, RayHit* outHits, const RayCallback& callback = nullptr) const;
+
+		// appends the objectIndex of every proxy overlapping the box.
+		void Overlap(const Bounds& box, std::vector<int>& outObjects) const;
+		void Overlap(const AABB& box, std::vector<int>& outObjects) const;
+
+		std::vector<Node> m_nodes;
+		int nodeCount;
+		int proxyCount;
+		int rootIndex;
+
+	private:
+		int AllocateNode();
+		void FreeNode(int index);
+
+		void InsertLeaf(int leafIndex);
+		void RemoveLeaf(int leafIndex);
+		void Refit(int index);
+		void Rotate(int index);
+
+		int PickBest(const Bounds& box);
+
+		void ValidateNode(int index) const;
+
+		void EmitSubtree(int index, std::vector<int>& outObjects);
+
+		struct Candidate
 		{
-			// the sibling was the root
-			tree.nodes[newParent].child1 = sibling;
-			tree.nodes[newParent].child2 = leafIndex;
-			tree.nodes[sibling].parentIndex = newParent;
-			tree.nodes[leafIndex].parentIndex = newParent;
-			tree.rootIndex = newParent;
-		}
+			float inheritedCost;
+			int index;
+
+			bool operator>(const Candidate& rhs) const { return inheritedCost > rhs.inheritedCost; }
+		};
+
+		std::vector<Candidate> m_searchHeap;
 
-		// stages 3: walk back up the tree refitting AABBs
-		int index = tree.nodes[leafIndex].parentIndex;
-		//while (index != nullIndex)
+		struct CullEntry
 		{
-			int child1 = tree.nodes[index].child1;
-			int child2 = tree.nodes[index].child2;
+			int index;
+			unsigned int planeMask;	// planes the node isn't known to be fully inside of
+		};
+
+		std::vector<CullEntry> m_cullStack;
+		// plane that last rejected each node, tested first on the next query.
+		std::vector<unsigned char> m_cullPlanes;
+		CullStats m_cullStats;
+
+		int m_freeList;
+		float m_aabbMargin;
+		float m_displacementMultiplier;
+	};
 
-			// Rotate(index);
+	/*
 
-			tree.nodes[index].box = AABB::Union(tree.nodes[child1].box, tree.nodes[child2].box);
-			index = tree.nodes[index].parentIndex;
-		}
-	}
-#endif
+	  Linear BVH bulk build for static content. Centroids are mapped to Morton codes (30 bit
+	  for small inputs, 63 bit otherwise), radix sorted in parallel and the hierarchy is
+	  emitted with Karras' split search before a bottom-up refit.
+
+	  The result uses the dynamic tree's node layout: internal nodes fill [0, count - 1) with
+	  the root at 0, leaves fill [count - 1, 2 * count - 1). Leaves keep the tight input boxes
+	  and their objectIndex is the position in the input array. The returned tree can still be
+	  edited with InsertNode, Remove and MoveProxy.
+
+	*/
+	Tree BuildLinear(const AABB* boxes, int count);
+	Tree BuildLinear(const Bounds* boxes, int count);
 }
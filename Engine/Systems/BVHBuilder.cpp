@@ -0,0 +1,282 @@
+#include "BVH.h"
+
+#include "Utils/Parallel.h"
+#include "Utils/RadixSort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace bvh
+{
+	namespace
+	{
+		const unsigned int s_minBatchSize = 4096;
+		// inputs up to this size are sorted on 30 bit codes, 4 radix passes instead of 8.
+		const int s_maxShortCodeCount = 1 << 16;
+
+		int CountLeadingZeros(uint64_t value)
+		{
+			if (value == 0)
+			{
+				return 64;
+			}
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return 63 - static_cast<int>(index);
+#else
+			return __builtin_clzll(value);
+#endif
+		}
+
+		// spreads the lower 10 bits of v so there are two zero bits between each.
+		uint64_t ExpandBits10(uint64_t v)
+		{
+			v &= 0x3ff;
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		}
+
+		// spreads the lower 21 bits of v so there are two zero bits between each.
+		uint64_t ExpandBits21(uint64_t v)
+		{
+			v &= 0x1fffff;
+			v = (v | v << 32) & 0x001f00000000ffffull;
+			v = (v | v << 16) & 0x001f0000ff0000ffull;
+			v = (v | v << 8) & 0x100f00f00f00f00full;
+			v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+			v = (v | v << 2) & 0x1249249249249249ull;
+			return v;
+		}
+
+		uint64_t Morton(const Vec3& normalized, int bitsPerAxis)
+		{
+			const float scale = static_cast<float>(1u << bitsPerAxis);
+			const float limit = scale - 1.0f;
+			const uint64_t x = static_cast<uint64_t>(std::min(std::max(normalized.x * scale, 0.0f), limit));
+			const uint64_t y = static_cast<uint64_t>(std::min(std::max(normalized.y * scale, 0.0f), limit));
+			const uint64_t z = static_cast<uint64_t>(std::min(std::max(normalized.z * scale, 0.0f), limit));
+
+			if (bitsPerAxis == 10)
+			{
+				return (ExpandBits10(x) << 2) | (ExpandBits10(y) << 1) | ExpandBits10(z);
+			}
+			return (ExpandBits21(x) << 2) | (ExpandBits21(y) << 1) | ExpandBits21(z);
+		}
+
+		// length of the common prefix of the codes at i and j, the index breaks ties between
+		// duplicate codes. -1 when j is out of range.
+		int Delta(const std::vector<uint64_t>& keys, int i, int j)
+		{
+			if (j < 0 || j >= static_cast<int>(keys.size()))
+			{
+				return -1;
+			}
+
+			const uint64_t a = keys[i];
+			const uint64_t b = keys[j];
+			if (a == b)
+			{
+				return 64 + CountLeadingZeros(static_cast<uint64_t>(i ^ j));
+			}
+			return CountLeadingZeros(a ^ b);
+		}
+
+		// Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees".
+		void BuildInternalNode(std::vector<Node>& nodes, const std::vector<uint64_t>& keys, int i)
+		{
+			const int leafOffset = static_cast<int>(keys.size()) - 1;
+
+			// direction of the range covered by node i
+			const int d = Delta(keys, i, i + 1) - Delta(keys, i, i - 1) >= 0 ? 1 : -1;
+
+			// upper bound for the range length
+			const int deltaMin = Delta(keys, i, i - d);
+			int lengthMax = 2;
+			while (Delta(keys, i, i + lengthMax * d) > deltaMin)
+			{
+				lengthMax *= 2;
+			}
+
+			// binary search the other end of the range
+			int length = 0;
+			for (int t = lengthMax / 2; t > 0; t /= 2)
+			{
+				if (Delta(keys, i, i + (length + t) * d) > deltaMin)
+				{
+					length += t;
+				}
+			}
+			const int j = i + length * d;
+
+			// binary search the split position
+			const int deltaNode = Delta(keys, i, j);
+			int split = 0;
+			int t = length;
+			do
+			{
+				t = (t + 1) / 2;
+				if (Delta(keys, i, i + (split + t) * d) > deltaNode)
+				{
+					split += t;
+				}
+			} while (t > 1);
+			const int gamma = i + split * d + std::min(d, 0);
+
+			const int left = std::min(i, j) == gamma ? leafOffset + gamma : gamma;
+			const int right = std::max(i, j) == gamma + 1 ? leafOffset + gamma + 1 : gamma + 1;
+
+			Node& node = nodes[i];
+			node.objectIndex = Tree::nullIndex;
+			node.child1 = left;
+			node.child2 = right;
+			nodes[left].parentIndex = i;
+			nodes[right].parentIndex = i;
+		}
+	}
+
+	Tree BuildLinear(const AABB* boxes, int count)
+	{
+		std::vector<Bounds> bounds(std::max(count, 0));
+		Utils::ParallelFor(static_cast<unsigned int>(bounds.size()), s_minBatchSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				bounds[i] = Bounds(boxes[i]);
+			}
+		});
+		return BuildLinear(bounds.data(), count);
+	}
+
+	Tree BuildLinear(const Bounds* boxes, int count)
+	{
+		Tree tree;
+		if (count <= 0)
+		{
+			return tree;
+		}
+
+		const unsigned int n = static_cast<unsigned int>(count);
+		const unsigned int workerCount = Utils::GetWorkerCount(n, s_minBatchSize);
+
+		// centroid bounds
+		std::vector<Bounds> workerBounds(workerCount, Bounds(Vec3(FLT_MAX), Vec3(-FLT_MAX)));
+		Utils::ParallelRun(workerCount, [&](unsigned int worker)
+		{
+			unsigned int begin, end;
+			Utils::GetWorkerRange(n, workerCount, worker, begin, end);
+			Bounds& local = workerBounds[worker];
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				const Vec3 centroid = (boxes[i].min + boxes[i].max) * 0.5f;
+				local.min = glm::min(local.min, centroid);
+				local.max = glm::max(local.max, centroid);
+			}
+		});
+
+		Bounds centroidBounds = workerBounds[0];
+		for (unsigned int worker = 1; worker < workerCount; ++worker)
+		{
+			centroidBounds = Bounds::Union(centroidBounds, workerBounds[worker]);
+		}
+
+		const Vec3 extent = centroidBounds.max - centroidBounds.min;
+		const Vec3 invExtent(
+			extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+			extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+			extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+		// morton codes
+		const int bitsPerAxis = count <= s_maxShortCodeCount ? 10 : 21;
+		std::vector<uint64_t> keys(n);
+		std::vector<unsigned int> indices(n);
+		Utils::ParallelFor(n, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				const Vec3 centroid = (boxes[i].min + boxes[i].max) * 0.5f;
+				keys[i] = Morton((centroid - centroidBounds.min) * invExtent, bitsPerAxis);
+				indices[i] = i;
+			}
+		});
+
+		Utils::RadixSort(keys, indices, bitsPerAxis * 3);
+
+		// leaves
+		const int leafOffset = count - 1;
+		std::vector<Node>& nodes = tree.m_nodes;
+		nodes.resize(2 * n - 1);
+		Utils::ParallelFor(n, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				Node& leaf = nodes[leafOffset + i];
+				leaf.box = boxes[indices[i]];
+				leaf.objectIndex = static_cast<int>(indices[i]);
+				leaf.parentIndex = Tree::nullIndex;
+				leaf.child1 = Tree::nullIndex;
+				leaf.child2 = Tree::nullIndex;
+				leaf.height = 0;
+			}
+		});
+
+		// hierarchy
+		nodes[0].parentIndex = Tree::nullIndex;
+		Utils::ParallelFor(n - 1, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				BuildInternalNode(nodes, keys, static_cast<int>(i));
+			}
+		});
+
+		// bottom-up refit; the second child to reach a node computes it, so every internal
+		// node is written once after both of its children are done.
+		if (n > 1)
+		{
+			std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[n - 1]);
+			for (unsigned int i = 0; i < n - 1; ++i)
+			{
+				visits[i].store(0, std::memory_order_relaxed);
+			}
+
+			Utils::ParallelFor(n, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int i = begin; i < end; ++i)
+				{
+					int index = nodes[leafOffset + i].parentIndex;
+					while (index != Tree::nullIndex)
+					{
+						if (visits[index].fetch_add(1, std::memory_order_acq_rel) == 0)
+						{
+							break;
+						}
+
+						Node& node = nodes[index];
+						const Node& child1 = nodes[node.child1];
+						const Node& child2 = nodes[node.child2];
+						node.box = Bounds::Union(child1.box, child2.box);
+						node.height = 1 + std::max(child1.height, child2.height);
+						index = node.parentIndex;
+					}
+				}
+			});
+		}
+
+		tree.nodeCount = static_cast<int>(nodes.size());
+		tree.proxyCount = count;
+		tree.rootIndex = 0;
+		return tree;
+	}
+}
@@ -3,8 +3,6 @@
 #include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
 
-#include <GL/glew.h>
-
 #include <vector>
 
 #include "Plane.h"
@@ -46,6 +44,7 @@ public:
 	glm::vec3 IntersectionPoint(const Plane& a, const Plane& b, const Plane& c);
 
 	const std::vector<glm::vec3> GetCorners() const { return corners; }
+	const std::vector<Plane>& GetPlanes() const { return planes; }
 
 private:
 	glm::mat4 viewProj;
@@ -0,0 +1,448 @@
+#include "Broadphase.h"
+
+#include "Utils/Parallel.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	const unsigned int s_minBatchSize = 1024;
+	// the sweep axis only changes when another axis has this much more variance.
+	const double s_axisHysteresis = 1.25;
+	// insertion sort gives up and sorts from scratch after this many shifts per element.
+	const size_t s_maxShiftsPerElement = 8;
+}
+
+Broadphase::Broadphase()
+	: m_freeObject(-1)
+	, m_multithreaded(true)
+{
+}
+
+Broadphase::~Broadphase()
+{
+}
+
+bool Broadphase::Insert(unsigned int id, const AABB& bounds)
+{
+	return Insert(id, bounds.GetMin(), bounds.GetMax());
+}
+
+bool Broadphase::Insert(unsigned int id, const glm::vec3& min, const glm::vec3& max)
+{
+	if (m_objectLookup.find(id) != m_objectLookup.end())
+	{
+		return false;
+	}
+
+	int objectIndex = m_freeObject;
+	if (objectIndex >= 0)
+	{
+		m_freeObject = m_objects[objectIndex].nextFree;
+	}
+	else
+	{
+		objectIndex = static_cast<int>(m_objects.size());
+		m_objects.push_back(Object());
+	}
+
+	Object& object = m_objects[objectIndex];
+	object.min = min;
+	object.max = max;
+	object.id = id;
+	object.nextFree = -1;
+	object.alive = true;
+
+	m_objectLookup[id] = objectIndex;
+	OnInsert(objectIndex);
+	return true;
+}
+
+bool Broadphase::Remove(unsigned int id)
+{
+	auto it = m_objectLookup.find(id);
+	if (it == m_objectLookup.end())
+	{
+		return false;
+	}
+
+	const int objectIndex = it->second;
+	m_objectLookup.erase(it);
+	m_objects[objectIndex].alive = false;
+	OnRemove(objectIndex);
+	m_pendingFree.push_back(objectIndex);
+	return true;
+}
+
+bool Broadphase::Update(unsigned int id, const AABB& bounds)
+{
+	return Update(id, bounds.GetMin(), bounds.GetMax());
+}
+
+bool Broadphase::Update(unsigned int id, const glm::vec3& min, const glm::vec3& max)
+{
+	auto it = m_objectLookup.find(id);
+	if (it == m_objectLookup.end())
+	{
+		return false;
+	}
+
+	Object& object = m_objects[it->second];
+	const glm::vec3 displacement = (min + max - object.min - object.max) * 0.5f;
+	object.min = min;
+	object.max = max;
+	OnUpdate(it->second, displacement);
+	return true;
+}
+
+void Broadphase::Clear()
+{
+	// drops the pairs as well, without reporting them as removed.
+	m_objects.clear();
+	m_objectLookup.clear();
+	m_freeObject = -1;
+	m_pendingFree.clear();
+	m_pairKeys.clear();
+	m_pairs.clear();
+	m_addedPairs.clear();
+	m_removedPairs.clear();
+	OnClear();
+}
+
+bool Broadphase::Contains(unsigned int id) const
+{
+	return m_objectLookup.find(id) != m_objectLookup.end();
+}
+
+void Broadphase::UpdatePairs()
+{
+	m_newPairKeys.clear();
+	FindPairs(m_newPairKeys);
+	std::sort(m_newPairKeys.begin(), m_newPairKeys.end());
+	m_newPairKeys.erase(std::unique(m_newPairKeys.begin(), m_newPairKeys.end()), m_newPairKeys.end());
+
+	auto toPair = [](uint64_t key) { return BroadphasePair{ static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key) }; };
+
+	// both lists are sorted, one merge pass finds what was added and removed.
+	m_addedPairs.clear();
+	m_removedPairs.clear();
+	size_t oldIndex = 0;
+	size_t newIndex = 0;
+	while (oldIndex < m_pairKeys.size() || newIndex < m_newPairKeys.size())
+	{
+		if (newIndex == m_newPairKeys.size() || (oldIndex < m_pairKeys.size() && m_pairKeys[oldIndex] < m_newPairKeys[newIndex]))
+		{
+			m_removedPairs.push_back(toPair(m_pairKeys[oldIndex++]));
+		}
+		else if (oldIndex == m_pairKeys.size() || m_newPairKeys[newIndex] < m_pairKeys[oldIndex])
+		{
+			m_addedPairs.push_back(toPair(m_newPairKeys[newIndex++]));
+		}
+		else
+		{
+			++oldIndex;
+			++newIndex;
+		}
+	}
+
+	m_pairKeys.swap(m_newPairKeys);
+	m_pairs.resize(m_pairKeys.size());
+	for (size_t i = 0; i < m_pairKeys.size(); ++i)
+	{
+		m_pairs[i] = toPair(m_pairKeys[i]);
+	}
+
+	// the backends have let go of removed objects by now.
+	for (int objectIndex : m_pendingFree)
+	{
+		m_objects[objectIndex].nextFree = m_freeObject;
+		m_freeObject = objectIndex;
+	}
+	m_pendingFree.clear();
+}
+
+uint64_t Broadphase::GetPairKey(unsigned int idA, unsigned int idB)
+{
+	if (idA > idB)
+	{
+		std::swap(idA, idB);
+	}
+	return (static_cast<uint64_t>(idA) << 32) | idB;
+}
+
+bool Broadphase::Overlaps(const Object& a, const Object& b)
+{
+	return a.min.x <= b.max.x && a.max.x >= b.min.x
+		&& a.min.y <= b.max.y && a.max.y >= b.min.y
+		&& a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+unsigned int Broadphase::GetWorkerCount(unsigned int count) const
+{
+	return m_multithreaded ? Utils::GetWorkerCount(count, s_minBatchSize) : 1;
+}
+
+SweepAndPrune::SweepAndPrune()
+	: m_axis(0)
+	, m_lastSortShifts(0)
+{
+}
+
+SweepAndPrune::~SweepAndPrune()
+{
+}
+
+void SweepAndPrune::OnInsert(int objectIndex)
+{
+	// appended unsorted; the next update's insertion sort moves it into place.
+	const Object& object = m_objects[objectIndex];
+	m_endpoints.push_back({ object.min[m_axis], object.max[m_axis], objectIndex });
+}
+
+void SweepAndPrune::OnRemove(int /*objectIndex*/)
+{
+	// dead endpoints are dropped by the next Refresh.
+}
+
+void SweepAndPrune::OnUpdate(int /*objectIndex*/, const glm::vec3& /*displacement*/)
+{
+	// endpoints are refreshed from the objects in one pass per update.
+}
+
+void SweepAndPrune::OnClear()
+{
+	m_endpoints.clear();
+	m_axis = 0;
+	m_lastSortShifts = 0;
+}
+
+void SweepAndPrune::FindPairs(std::vector<uint64_t>& outPairs)
+{
+	const int axis = PickAxis();
+	const bool axisChanged = axis != m_axis;
+	m_axis = axis;
+
+	Refresh();
+	Sort(axisChanged);
+
+	const unsigned int count = static_cast<unsigned int>(m_endpoints.size());
+	const unsigned int workerCount = GetWorkerCount(count);
+	if (workerCount <= 1)
+	{
+		Sweep(0, count, outPairs);
+		return;
+	}
+
+	m_workerPairs.resize(workerCount);
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(count, workerCount, worker, begin, end);
+		m_workerPairs[worker].clear();
+		Sweep(begin, end, m_workerPairs[worker]);
+	});
+
+	for (const std::vector<uint64_t>& pairs : m_workerPairs)
+	{
+		outPairs.insert(outPairs.end(), pairs.begin(), pairs.end());
+	}
+}
+
+int SweepAndPrune::PickAxis() const
+{
+	// accumulated in double, float loses the variance of far away objects.
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	double sumSq[3] = { 0.0, 0.0, 0.0 };
+	size_t count = 0;
+	for (const Object& object : m_objects)
+	{
+		if (!object.alive)
+		{
+			continue;
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const double center = (static_cast<double>(object.min[axis]) + object.max[axis]) * 0.5;
+			sum[axis] += center;
+			sumSq[axis] += center * center;
+		}
+		++count;
+	}
+	if (count < 2)
+	{
+		return m_axis;
+	}
+
+	double variance[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const double mean = sum[axis] / count;
+		variance[axis] = sumSq[axis] / count - mean * mean;
+	}
+
+	int best = m_axis;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (variance[axis] > variance[best] && variance[axis] > variance[m_axis] * s_axisHysteresis)
+		{
+			best = axis;
+		}
+	}
+	return best;
+}
+
+void SweepAndPrune::Refresh()
+{
+	// drops removed objects without disturbing the order of the others.
+	size_t write = 0;
+	for (size_t read = 0; read < m_endpoints.size(); ++read)
+	{
+		const int objectIndex = m_endpoints[read].object;
+		const Object& object = m_objects[objectIndex];
+		if (!object.alive)
+		{
+			continue;
+		}
+		m_endpoints[write++] = { object.min[m_axis], object.max[m_axis], objectIndex };
+	}
+	m_endpoints.resize(write);
+}
+
+void SweepAndPrune::Sort(bool force)
+{
+	auto less = [](const Endpoint& a, const Endpoint& b) { return a.min < b.min; };
+
+	m_lastSortShifts = 0;
+	if (force)
+	{
+		std::sort(m_endpoints.begin(), m_endpoints.end(), less);
+		return;
+	}
+
+	const size_t count = m_endpoints.size();
+	const size_t maxShifts = count * s_maxShiftsPerElement;
+	for (size_t i = 1; i < count; ++i)
+	{
+		const Endpoint endpoint = m_endpoints[i];
+		size_t j = i;
+		while (j > 0 && endpoint.min < m_endpoints[j - 1].min)
+		{
+			m_endpoints[j] = m_endpoints[j - 1];
+			--j;
+		}
+		m_endpoints[j] = endpoint;
+
+		m_lastSortShifts += i - j;
+		if (m_lastSortShifts > maxShifts)
+		{
+			// incoherent motion or a big batch of inserts; the prefix is sorted, the rest isn't.
+			std::sort(m_endpoints.begin(), m_endpoints.end(), less);
+			return;
+		}
+	}
+}
+
+void SweepAndPrune::Sweep(unsigned int begin, unsigned int end, std::vector<uint64_t>& outPairs) const
+{
+	const unsigned int count = static_cast<unsigned int>(m_endpoints.size());
+	for (unsigned int i = begin; i < end; ++i)
+	{
+		const Endpoint& endpoint = m_endpoints[i];
+		const Object& object = m_objects[endpoint.object];
+		for (unsigned int j = i + 1; j < count && m_endpoints[j].min <= endpoint.max; ++j)
+		{
+			const Object& other = m_objects[m_endpoints[j].object];
+			if (Overlaps(object, other))
+			{
+				outPairs.push_back(GetPairKey(object.id, other.id));
+			}
+		}
+	}
+}
+
+BVHBroadphase::BVHBroadphase(float aabbMargin, float displacementMultiplier)
+	: m_tree(aabbMargin, displacementMultiplier)
+{
+}
+
+BVHBroadphase::~BVHBroadphase()
+{
+}
+
+void BVHBroadphase::OnInsert(int objectIndex)
+{
+	if (m_proxies.size() <= static_cast<size_t>(objectIndex))
+	{
+		m_proxies.resize(objectIndex + 1, bvh::Tree::nullIndex);
+	}
+
+	const Object& object = m_objects[objectIndex];
+	m_proxies[objectIndex] = m_tree.InsertNode(objectIndex, bvh::Bounds(object.min, object.max));
+}
+
+void BVHBroadphase::OnRemove(int objectIndex)
+{
+	m_tree.Remove(m_proxies[objectIndex]);
+	m_proxies[objectIndex] = bvh::Tree::nullIndex;
+}
+
+void BVHBroadphase::OnUpdate(int objectIndex, const glm::vec3& displacement)
+{
+	const Object& object = m_objects[objectIndex];
+	m_tree.MoveProxy(m_proxies[objectIndex], bvh::Bounds(object.min, object.max), displacement);
+}
+
+void BVHBroadphase::OnClear()
+{
+	m_tree.Clear();
+	m_proxies.clear();
+}
+
+void BVHBroadphase::FindPairs(std::vector<uint64_t>& outPairs)
+{
+	const unsigned int count = static_cast<unsigned int>(m_objects.size());
+	const unsigned int workerCount = GetWorkerCount(count);
+	m_workerPairs.resize(workerCount);
+	m_workerCandidates.resize(workerCount);
+
+	// a tight box overlaps the other's fat box whenever the tight boxes overlap, so each pair
+	// is found from both sides; only the lower slot reports it.
+	Utils::ParallelRun(workerCount, [&](unsigned int worker)
+	{
+		unsigned int begin, end;
+		Utils::GetWorkerRange(count, workerCount, worker, begin, end);
+		std::vector<uint64_t>& pairs = m_workerPairs[worker];
+		std::vector<int>& candidates = m_workerCandidates[worker];
+		pairs.clear();
+
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			const Object& object = m_objects[i];
+			if (!object.alive)
+			{
+				continue;
+			}
+
+			candidates.clear();
+			m_tree.Overlap(bvh::Bounds(object.min, object.max), candidates);
+			for (int candidate : candidates)
+			{
+				if (candidate <= static_cast<int>(i))
+				{
+					continue;
+				}
+				const Object& other = m_objects[candidate];
+				if (Overlaps(object, other))
+				{
+					pairs.push_back(GetPairKey(object.id, other.id));
+				}
+			}
+		}
+	});
+
+	for (const std::vector<uint64_t>& pairs : m_workerPairs)
+	{
+		outPairs.insert(outPairs.end(), pairs.begin(), pairs.end());
+	}
+}
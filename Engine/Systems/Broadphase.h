@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AABB.h"
+#include "BVH.h"
+
+struct BroadphasePair
+{
+	unsigned int idA;	// always the smaller ID
+	unsigned int idB;
+};
+
+/*
+
+  Broadphase collision detection: finds every pair of objects whose bounds overlap.
+
+  Objects are added, moved and removed by ID between calls to UpdatePairs, which finds the
+  current pairs and diffs them against the previous call, so triggers and proximity events can
+  react to pairs that started or stopped overlapping. Pairs of a removed object are reported
+  as removed on the next update.
+
+  The pair search is up to the backend: SweepAndPrune for many small, coherently moving objects
+  and BVHBroadphase for scenes with very uneven object sizes or large static parts.
+
+*/
+class Broadphase
+{
+public:
+	Broadphase();
+	virtual ~Broadphase();
+
+	bool Insert(unsigned int id, const AABB& bounds);
+	bool Insert(unsigned int id, const glm::vec3& min, const glm::vec3& max);
+	bool Remove(unsigned int id);
+	bool Update(unsigned int id, const AABB& bounds);
+	bool Update(unsigned int id, const glm::vec3& min, const glm::vec3& max);
+	void Clear();
+
+	bool Contains(unsigned int id) const;
+	size_t GetObjectCount() const { return m_objectLookup.size(); }
+
+	// finds all overlapping pairs and the pairs added and removed since the last call.
+	void UpdatePairs();
+
+	// sorted by idA, then idB.
+	const std::vector<BroadphasePair>& GetPairs() const { return m_pairs; }
+	const std::vector<BroadphasePair>& GetAddedPairs() const { return m_addedPairs; }
+	const std::vector<BroadphasePair>& GetRemovedPairs() const { return m_removedPairs; }
+
+	// splits the pair search over worker threads once there are enough objects.
+	void SetMultithreaded(bool multithreaded) { m_multithreaded = multithreaded; }
+	bool IsMultithreaded() const { return m_multithreaded; }
+
+	virtual const char* GetName() const = 0;
+
+protected:
+	struct Object
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		unsigned int id;
+		int nextFree;
+		bool alive;
+	};
+
+	// backends mirror the object set through these. removed slots aren't reused before the
+	// next FindPairs, so backends can drop them lazily.
+	virtual void OnInsert(int objectIndex) = 0;
+	virtual void OnRemove(int objectIndex) = 0;
+	virtual void OnUpdate(int objectIndex, const glm::vec3& displacement) = 0;
+	virtual void OnClear() = 0;
+
+	// appends the key of every overlapping pair once, in any order.
+	virtual void FindPairs(std::vector<uint64_t>& outPairs) = 0;
+
+	static uint64_t GetPairKey(unsigned int idA, unsigned int idB);
+	static bool Overlaps(const Object& a, const Object& b);
+
+	// worker count for count items, 1 when multithreading is off.
+	unsigned int GetWorkerCount(unsigned int count) const;
+
+protected:
+	std::vector<Object> m_objects;
+	std::unordered_map<unsigned int, int> m_objectLookup;
+
+private:
+	int m_freeObject;
+	std::vector<int> m_pendingFree;
+
+	std::vector<uint64_t> m_pairKeys;
+	std::vector<uint64_t> m_newPairKeys;
+	std::vector<BroadphasePair> m_pairs;
+	std::vector<BroadphasePair> m_addedPairs;
+	std::vector<BroadphasePair> m_removedPairs;
+
+	bool m_multithreaded;
+};
+
+/*
+
+  Incremental sort and sweep. Objects are kept sorted by their lower bound on one axis; a
+  pair can only overlap if their intervals on that axis do, so the sweep compares each object
+  only with the following ones until their lower bound passes its upper bound.
+
+  The order is kept between updates and repaired with an insertion sort, which is close to
+  linear when objects move coherently; it falls back to a full sort when too many elements
+  have to move. The sweep axis is the one where the object centers have the highest variance,
+  with some hysteresis so it doesn't flip every frame. The multithreaded path splits the
+  sorted list into contiguous ranges along the axis, each worker sweeps the objects starting
+  in its range.
+
+*/
+class SweepAndPrune
+	: public Broadphase
+{
+public:
+	SweepAndPrune();
+	~SweepAndPrune() override;
+
+	int GetSweepAxis() const { return m_axis; }
+	// elements moved by the insertion sort in the last update.
+	size_t GetLastSortShifts() const { return m_lastSortShifts; }
+
+	const char* GetName() const override { return "Sweep and prune"; }
+
+protected:
+	void OnInsert(int objectIndex) override;
+	void OnRemove(int objectIndex) override;
+	void OnUpdate(int objectIndex, const glm::vec3& displacement) override;
+	void OnClear() override;
+
+	void FindPairs(std::vector<uint64_t>& outPairs) override;
+
+private:
+	struct Endpoint
+	{
+		float min;
+		float max;
+		int object;
+	};
+
+	int PickAxis() const;
+	void Refresh();
+	void Sort(bool force);
+	void Sweep(unsigned int begin, unsigned int end, std::vector<uint64_t>& outPairs) const;
+
+private:
+	std::vector<Endpoint> m_endpoints;
+	std::vector<std::vector<uint64_t>> m_workerPairs;
+
+	int m_axis;
+	size_t m_lastSortShifts;
+};
+
+/*
+
+  Pair search on the dynamic AABB tree. Every object owns a fattened proxy, so small motions
+  don't touch the tree, and every object queries the tree with its tight bounds. The queries
+  are read only and run in parallel on the multithreaded path.
+
+*/
+class BVHBroadphase
+	: public Broadphase
+{
+public:
+	BVHBroadphase(float aabbMargin = 0.1f, float displacementMultiplier = 4.0f);
+	~BVHBroadphase() override;
+
+	const bvh::Tree& GetTree() const { return m_tree; }
+
+	const char* GetName() const override { return "Dynamic BVH"; }
+
+protected:
+	void OnInsert(int objectIndex) override;
+	void OnRemove(int objectIndex) override;
+	void OnUpdate(int objectIndex, const glm::vec3& displacement) override;
+	void OnClear() override;
+
+	void FindPairs(std::vector<uint64_t>& outPairs) override;
+
+private:
+	bvh::Tree m_tree;
+	std::vector<int> m_proxies;		// proxy of each object slot
+	std::vector<std::vector<uint64_t>> m_workerPairs;
+	std::vector<std::vector<int>> m_workerCandidates;
+};
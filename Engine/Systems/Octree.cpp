@@ -1,157 +1,569 @@
 #include "Octree.h"
 
 #include "BoundingFrustum.h"
+#include "Plane.h"
 
-Octree::Octree()
-	: Octree(glm::vec3(0.0f), 0.0f)
+namespace
 {
+	bool Overlaps(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax)
+	{
+		return aMin.x <= bMax.x && aMax.x >= bMin.x
+			&& aMin.y <= bMax.y && aMax.y >= bMin.y
+			&& aMin.z <= bMax.z && aMax.z >= bMin.z;
+	}
+
+	bool Encloses(const glm::vec3& outerMin, const glm::vec3& outerMax, const glm::vec3& innerMin, const glm::vec3& innerMax)
+	{
+		return innerMin.x >= outerMin.x && innerMax.x <= outerMax.x
+			&& innerMin.y >= outerMin.y && innerMax.y <= outerMax.y
+			&& innerMin.z >= outerMin.z && innerMax.z <= outerMax.z;
+	}
+
+	// same plane convention as AABB::Intersects(Plane), planes point out of the frustum.
+	ContainmentType Classify(const std::vector<Plane>& planes, const glm::vec3& min, const glm::vec3& max)
+	{
+		bool intersects = false;
+		const size_t planeCount = planes.size();
+		for (size_t i = 0; i < planeCount; ++i)
+		{
+			const glm::vec3& n = planes[i].normal;
+			const glm::vec3 pos(n.x >= 0.0f ? max.x : min.x, n.y >= 0.0f ? max.y : min.y, n.z >= 0.0f ? max.z : min.z);
+			const glm::vec3 neg(n.x >= 0.0f ? min.x : max.x, n.y >= 0.0f ? min.y : max.y, n.z >= 0.0f ? min.z : max.z);
+
+			if (glm::dot(n, neg) + planes[i].d > 0.0f)
+			{
+				return ContainmentType::Disjoint;
+			}
+			if (glm::dot(n, pos) + planes[i].d >= 0.0f)
+			{
+				intersects = true;
+			}
+		}
+		return intersects ? ContainmentType::Intersects : ContainmentType::Contains;
+	}
 }
 
+Octree::Octree()
+	: Octree(glm::vec3(0.0f), 1.0f)
+{
+}
 
-Octree::Octree(const glm::vec3& position, float halfSize)
-	: m_position(position), m_halfSize(halfSize)
-	, m_upFrontLeft(nullptr)
-	, m_upFrontRight(nullptr)
-	, m_upBackLeft(nullptr)
-	, m_upBackRight(nullptr)
-	, m_downFrontLeft(nullptr)
-	, m_downFrontRight(nullptr)
-	, m_downBackLeft(nullptr)
-	, m_downBackRight(nullptr)
+Octree::Octree(const glm::vec3& position, float halfSize, unsigned int leafCapacity, unsigned int maxDepth, float looseness)
+	: m_freeObject(-1)
+	, m_leafCapacity(leafCapacity > 0 ? leafCapacity : 1)
+	, m_maxDepth(maxDepth < s_maxDepthLimit ? maxDepth : s_maxDepthLimit)
+	, m_looseness(looseness > 1.0f ? looseness : 1.0f)
 {
-	m_storePos = glm::vec3(0.0f);
-	m_bounds = AABB(m_position, halfSize);
+	Node root;
+	root.center = position;
+	root.halfSize = halfSize;
+	root.parent = -1;
+	root.firstChild = -1;
+	root.firstObject = -1;
+	root.objectCount = 0;
+	root.subtreeCount = 0;
+	root.depth = 0;
+	m_nodes.push_back(root);
 }
 
 Octree::~Octree()
 {
 }
 
-void Octree::Subdivide()
+bool Octree::Insert(unsigned int id, const AABB& bounds)
+{
+	if (m_objectLookup.find(id) != m_objectLookup.end())
+	{
+		return false;
+	}
+
+	const int objectIndex = AllocateObject();
+	Object& object = m_objects[objectIndex];
+	object.id = id;
+	object.min = bounds.GetMin();
+	object.max = bounds.GetMax();
+
+	m_objectLookup[id] = objectIndex;
+	InsertObject(objectIndex, 0);
+	return true;
+}
+
+bool Octree::Remove(unsigned int id)
 {
-	const glm::vec3 ufl = (m_position + (m_position + glm::vec3(-m_halfSize, m_halfSize, m_halfSize))) * 0.5f;
-	const glm::vec3 ufr = (m_position + (m_position + glm::vec3(m_halfSize, m_halfSize, m_halfSize))) * 0.5f;
-	const glm::vec3 ubl = (m_position + (m_position + glm::vec3(-m_halfSize, m_halfSize, -m_halfSize))) * 0.5f;
-	const glm::vec3 ubr = (m_position + (m_position + glm::vec3(m_halfSize, m_halfSize, -m_halfSize))) * 0.5f;
+	auto it = m_objectLookup.find(id);
+	if (it == m_objectLookup.end())
+	{
+		return false;
+	}
 
-	const glm::vec3 dfl = (m_position + (m_position + glm::vec3(-m_halfSize, -m_halfSize, m_halfSize))) * 0.5f;
-	const glm::vec3 dfr = (m_position + (m_position + glm::vec3(m_halfSize, -m_halfSize, m_halfSize))) * 0.5f;
-	const glm::vec3 dbl = (m_position + (m_position + glm::vec3(-m_halfSize, -m_halfSize, -m_halfSize))) * 0.5f;
-	const glm::vec3 dbr = (m_position + (m_position + glm::vec3(m_halfSize, -m_halfSize, -m_halfSize))) * 0.5f;
+	const int objectIndex = it->second;
+	const int nodeIndex = m_objects[objectIndex].node;
+	m_objectLookup.erase(it);
 
-	m_upFrontLeft = std::make_shared<Octree>(ufl, m_halfSize * 0.5f);
-	m_upFrontRight = std::make_shared<Octree>(ufr, m_halfSize * 0.5f);
-	m_upBackLeft = std::make_shared<Octree>(ubl, m_halfSize * 0.5f);
-	m_upBackRight = std::make_shared<Octree>(ubr, m_halfSize * 0.5f);
-	m_downFrontLeft = std::make_shared<Octree>(dfl, m_halfSize * 0.5f);
-	m_downFrontRight = std::make_shared<Octree>(dfr, m_halfSize * 0.5f);
-	m_downBackLeft = std::make_shared<Octree>(dbl, m_halfSize * 0.5f);
-	m_downBackRight = std::make_shared<Octree>(dbr, m_halfSize * 0.5f);
+	UnlinkObject(objectIndex);
+	for (int n = nodeIndex; n >= 0; n = m_nodes[n].parent)
+	{
+		m_nodes[n].subtreeCount--;
+	}
+
+	m_objects[objectIndex].node = -1;
+	m_objects[objectIndex].next = m_freeObject;
+	m_freeObject = objectIndex;
+
+	TryCollapse(nodeIndex);
+	return true;
 }
 
-bool Octree::Insert(const glm::vec3& position)
+bool Octree::Update(unsigned int id, const AABB& bounds)
 {
-	if (m_bounds.Contains(position) == ContainmentType::Disjoint)
+	auto it = m_objectLookup.find(id);
+	if (it == m_objectLookup.end())
 	{
 		return false;
 	}
 
-	if (m_upFrontLeft == nullptr && m_storePos == glm::vec3(0.0f))
+	const int objectIndex = it->second;
+	const int nodeIndex = m_objects[objectIndex].node;
+	const glm::vec3 min = bounds.GetMin();
+	const glm::vec3 max = bounds.GetMax();
+
+	// small motions keep the object where it is as long as its node still encloses it and
+	// it did not shrink into one of the children.
+	const Node& node = m_nodes[nodeIndex];
+	bool stays = nodeIndex == 0 || FitsNode(node, min, max);
+	if (stays && node.firstChild >= 0)
+	{
+		const int child = node.firstChild + ChildOctant(node, (min + max) * 0.5f);
+		stays = !FitsNode(m_nodes[child], min, max);
+	}
+
+	m_objects[objectIndex].min = min;
+	m_objects[objectIndex].max = max;
+	if (stays)
 	{
-		m_storePos = position;
 		return true;
 	}
 
-	if (m_upFrontLeft == nullptr)
+	UnlinkObject(objectIndex);
+	for (int n = nodeIndex; n >= 0; n = m_nodes[n].parent)
+	{
+		m_nodes[n].subtreeCount--;
+	}
+
+	InsertObject(objectIndex, 0);
+	TryCollapse(nodeIndex);
+	return true;
+}
+
+void Octree::Clear()
+{
+	Node root = m_nodes[0];
+	root.firstChild = -1;
+	root.firstObject = -1;
+	root.objectCount = 0;
+	root.subtreeCount = 0;
+
+	m_nodes.clear();
+	m_nodes.push_back(root);
+	m_objects.clear();
+	m_freeBlocks.clear();
+	m_freeObject = -1;
+	m_objectLookup.clear();
+}
+
+bool Octree::Contains(unsigned int id) const
+{
+	return m_objectLookup.find(id) != m_objectLookup.end();
+}
+
+void Octree::Search(const AABB& aabb, std::vector<unsigned int>& outResult) const
+{
+	const glm::vec3 queryMin = aabb.GetMin();
+	const glm::vec3 queryMax = aabb.GetMax();
+
+	int stack[s_maxDepthLimit * 7 + 8];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
 	{
-		Subdivide();
+		const int nodeIndex = stack[--top];
+		const Node& node = m_nodes[nodeIndex];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
+
+		// the root also keeps objects that fall outside its loose bounds, so it is never
+		// accepted or rejected as a whole.
+		if (nodeIndex != 0)
+		{
+			const glm::vec3 loose(node.halfSize * m_looseness);
+			const glm::vec3 looseMin = node.center - loose;
+			const glm::vec3 looseMax = node.center + loose;
+			if (!Overlaps(queryMin, queryMax, looseMin, looseMax))
+			{
+				continue;
+			}
+			if (Encloses(queryMin, queryMax, looseMin, looseMax))
+			{
+				EmitSubtree(nodeIndex, outResult);
+				continue;
+			}
+		}
+
+		for (int i = node.firstObject; i >= 0; i = m_objects[i].next)
+		{
+			const Object& object = m_objects[i];
+			if (Overlaps(queryMin, queryMax, object.min, object.max))
+			{
+				outResult.push_back(object.id);
+			}
+		}
+
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 8; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
 	}
+}
+
+void Octree::Search(const BoundingFrustum& frustum, std::vector<unsigned int>& outResult) const
+{
+	const std::vector<Plane>& planes = frustum.GetPlanes();
+
+	int stack[s_maxDepthLimit * 7 + 8];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const int nodeIndex = stack[--top];
+		const Node& node = m_nodes[nodeIndex];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
 
-	if (m_upFrontLeft->Insert(position)) return true;
-	if (m_upFrontRight->Insert(position)) return true;
-	if (m_upBackLeft->Insert(position)) return true;
-	if (m_upBackRight->Insert(position)) return true;
-	if (m_downFrontLeft->Insert(position)) return true;
-	if (m_downFrontRight->Insert(position)) return true;
-	if (m_downBackLeft->Insert(position)) return true;
-	if (m_downBackRight->Insert(position)) return true;
+		if (nodeIndex != 0)
+		{
+			const glm::vec3 loose(node.halfSize * m_looseness);
+			const ContainmentType containment = Classify(planes, node.center - loose, node.center + loose);
+			if (containment == ContainmentType::Disjoint)
+			{
+				continue;
+			}
+			if (containment == ContainmentType::Contains)
+			{
+				EmitSubtree(nodeIndex, outResult);
+				continue;
+			}
+		}
 
-	return false;
+		for (int i = node.firstObject; i >= 0; i = m_objects[i].next)
+		{
+			const Object& object = m_objects[i];
+			if (Classify(planes, object.min, object.max) != ContainmentType::Disjoint)
+			{
+				outResult.push_back(object.id);
+			}
+		}
+
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 8; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
+	}
 }
 
-void Octree::Search(const AABB& aabb, std::vector<glm::vec3>& outResult)
+void Octree::GetAllBoundingBoxes(std::vector<AABB>& outResult) const
 {
-	if (m_bounds.Contains(aabb) == ContainmentType::Disjoint)
+	int stack[s_maxDepthLimit * 7 + 8];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
 	{
-		return;
+		const Node& node = m_nodes[stack[--top]];
+		outResult.push_back(AABB(node.center, node.halfSize));
+
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 8; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
 	}
+}
 
-	// check objects at this bounds level#
-	if (aabb.Contains(m_storePos) != ContainmentType::Disjoint)
+size_t Octree::GetMemoryUsage() const
+{
+	const size_t lookupEntry = sizeof(std::pair<const unsigned int, int>) + sizeof(void*) * 2;
+	return m_nodes.capacity() * sizeof(Node)
+		+ m_objects.capacity() * sizeof(Object)
+		+ m_freeBlocks.capacity() * sizeof(int)
+		+ m_objectLookup.bucket_count() * sizeof(void*)
+		+ m_objectLookup.size() * lookupEntry;
+}
+
+int Octree::AllocateObject()
+{
+	if (m_freeObject >= 0)
 	{
-		outResult.push_back(m_storePos);
+		const int objectIndex = m_freeObject;
+		m_freeObject = m_objects[objectIndex].next;
+		return objectIndex;
 	}
 
-	if (m_upFrontLeft == nullptr)
+	m_objects.push_back(Object());
+	return static_cast<int>(m_objects.size()) - 1;
+}
+
+int Octree::AllocateChildren(int parentIndex)
+{
+	int first;
+	if (!m_freeBlocks.empty())
 	{
-		return;
+		first = m_freeBlocks.back();
+		m_freeBlocks.pop_back();
+	}
+	else
+	{
+		first = static_cast<int>(m_nodes.size());
+		m_nodes.resize(m_nodes.size() + 8);
 	}
 
-	m_upFrontLeft->Search(aabb, outResult);
-	m_upFrontRight->Search(aabb, outResult);
-	m_upBackLeft->Search(aabb, outResult);
-	m_upBackRight->Search(aabb, outResult);
+	const Node parent = m_nodes[parentIndex];
+	const float childHalfSize = parent.halfSize * 0.5f;
+	for (int c = 0; c < 8; ++c)
+	{
+		const glm::vec3 offset(
+			(c & 1) ? childHalfSize : -childHalfSize,
+			(c & 2) ? childHalfSize : -childHalfSize,
+			(c & 4) ? childHalfSize : -childHalfSize);
 
-	m_downFrontLeft->Search(aabb, outResult);
-	m_downFrontRight->Search(aabb, outResult);
-	m_downBackLeft->Search(aabb, outResult);
-	m_downBackRight->Search(aabb, outResult);
+		Node& child = m_nodes[first + c];
+		child.center = parent.center + offset;
+		child.halfSize = childHalfSize;
+		child.parent = parentIndex;
+		child.firstChild = -1;
+		child.firstObject = -1;
+		child.objectCount = 0;
+		child.subtreeCount = 0;
+		child.depth = parent.depth + 1;
+	}
+
+	m_nodes[parentIndex].firstChild = first;
+	return first;
 }
 
-void Octree::Search(const BoundingFrustum& frustum, std::vector<glm::vec3>& outResult)
+void Octree::FreeChildren(int nodeIndex)
 {
-	if (frustum.Contains(m_bounds) == ContainmentType::Disjoint)
+	const int first = m_nodes[nodeIndex].firstChild;
+	if (first < 0)
 	{
 		return;
 	}
 
-	// check objects at this bounds level#
-	// while no BoundingSphere, this BoundingBox is a Generous aproximation of the spheres.
-	// if (frustum.Contains(BoundingBox(m_storePos, 1.0f)) != ContainmentType::Disjoint)
-	if (frustum.Contains(m_storePos) != ContainmentType::Disjoint)
+	for (int c = 0; c < 8; ++c)
+	{
+		FreeChildren(first + c);
+	}
+
+	m_freeBlocks.push_back(first);
+	m_nodes[nodeIndex].firstChild = -1;
+}
+
+void Octree::InsertObject(int objectIndex, int nodeIndex)
+{
+	const glm::vec3 min = m_objects[objectIndex].min;
+	const glm::vec3 max = m_objects[objectIndex].max;
+	const glm::vec3 center = (min + max) * 0.5f;
+
+	// descend while the object fits in the child cell its center falls into.
+	while (m_nodes[nodeIndex].firstChild >= 0)
+	{
+		const Node& node = m_nodes[nodeIndex];
+		const int child = node.firstChild + ChildOctant(node, center);
+		if (!FitsNode(m_nodes[child], min, max))
+		{
+			break;
+		}
+		nodeIndex = child;
+	}
+
+	LinkObject(objectIndex, nodeIndex);
+	for (int n = nodeIndex; n >= 0; n = m_nodes[n].parent)
+	{
+		m_nodes[n].subtreeCount++;
+	}
+
+	const Node& node = m_nodes[nodeIndex];
+	if (node.firstChild < 0 && node.objectCount > m_leafCapacity && node.depth < m_maxDepth)
+	{
+		Split(nodeIndex);
+	}
+}
+
+void Octree::LinkObject(int objectIndex, int nodeIndex)
+{
+	Node& node = m_nodes[nodeIndex];
+	Object& object = m_objects[objectIndex];
+
+	object.node = nodeIndex;
+	object.prev = -1;
+	object.next = node.firstObject;
+	if (node.firstObject >= 0)
+	{
+		m_objects[node.firstObject].prev = objectIndex;
+	}
+	node.firstObject = objectIndex;
+	node.objectCount++;
+}
+
+void Octree::UnlinkObject(int objectIndex)
+{
+	Object& object = m_objects[objectIndex];
+	Node& node = m_nodes[object.node];
+
+	if (object.prev >= 0)
+	{
+		m_objects[object.prev].next = object.next;
+	}
+	else
+	{
+		node.firstObject = object.next;
+	}
+	if (object.next >= 0)
+	{
+		m_objects[object.next].prev = object.prev;
+	}
+
+	object.prev = -1;
+	object.next = -1;
+	node.objectCount--;
+}
+
+void Octree::Split(int nodeIndex)
+{
+	const int first = AllocateChildren(nodeIndex);
+
+	int objectIndex = m_nodes[nodeIndex].firstObject;
+	while (objectIndex >= 0)
+	{
+		const int next = m_objects[objectIndex].next;
+		const Object& object = m_objects[objectIndex];
+
+		const int child = first + ChildOctant(m_nodes[nodeIndex], (object.min + object.max) * 0.5f);
+		if (FitsNode(m_nodes[child], object.min, object.max))
+		{
+			UnlinkObject(objectIndex);
+			LinkObject(objectIndex, child);
+			m_nodes[child].subtreeCount++;
+		}
+		objectIndex = next;
+	}
+
+	for (int c = 0; c < 8; ++c)
+	{
+		const Node& child = m_nodes[first + c];
+		if (child.objectCount > m_leafCapacity && child.depth < m_maxDepth)
+		{
+			Split(first + c);
+		}
+	}
+}
+
+void Octree::TryCollapse(int nodeIndex)
+{
+	// find the highest ancestor whose whole subtree fits in a single leaf again.
+	int target = -1;
+	int n = m_nodes[nodeIndex].firstChild >= 0 ? nodeIndex : m_nodes[nodeIndex].parent;
+	while (n >= 0 && m_nodes[n].subtreeCount <= m_leafCapacity)
+	{
+		target = n;
+		n = m_nodes[n].parent;
+	}
+
+	if (target < 0)
 	{
-		outResult.push_back(m_storePos);
+		return;
 	}
 
-	if (m_upFrontLeft == nullptr)
+	GatherSubtree(target, target);
+	FreeChildren(target);
+}
+
+void Octree::GatherSubtree(int nodeIndex, int targetIndex)
+{
+	const int first = m_nodes[nodeIndex].firstChild;
+	if (first < 0)
 	{
 		return;
 	}
 
-	m_upFrontLeft->Search(frustum, outResult);
-	m_upFrontRight->Search(frustum, outResult);
-	m_upBackLeft->Search(frustum, outResult);
-	m_upBackRight->Search(frustum, outResult);
+	for (int c = 0; c < 8; ++c)
+	{
+		const int childIndex = first + c;
+		while (m_nodes[childIndex].firstObject >= 0)
+		{
+			const int objectIndex = m_nodes[childIndex].firstObject;
+			UnlinkObject(objectIndex);
+			LinkObject(objectIndex, targetIndex);
+		}
+		m_nodes[childIndex].subtreeCount = 0;
+		GatherSubtree(childIndex, targetIndex);
+	}
+}
 
-	m_downFrontLeft->Search(frustum, outResult);
-	m_downFrontRight->Search(frustum, outResult);
-	m_downBackLeft->Search(frustum, outResult);
-	m_downBackRight->Search(frustum, outResult);
+bool Octree::FitsNode(const Node& node, const glm::vec3& min, const glm::vec3& max) const
+{
+	const glm::vec3 extent = (max - min) * 0.5f;
+	const float largestExtent = glm::max(extent.x, glm::max(extent.y, extent.z));
+	if (largestExtent > node.halfSize * (m_looseness - 1.0f))
+	{
+		return false;
+	}
+
+	const glm::vec3 offset = glm::abs((min + max) * 0.5f - node.center);
+	return offset.x <= node.halfSize && offset.y <= node.halfSize && offset.z <= node.halfSize;
 }
 
-void Octree::GetAllBoundingBoxes(std::vector<AABB>& outResult)
+int Octree::ChildOctant(const Node& node, const glm::vec3& center) const
 {
-	outResult.push_back(m_bounds);
+	return (center.x >= node.center.x ? 1 : 0)
+		| (center.y >= node.center.y ? 2 : 0)
+		| (center.z >= node.center.z ? 4 : 0);
+}
 
-	if (m_upFrontLeft == nullptr) return;
+void Octree::EmitSubtree(int nodeIndex, std::vector<unsigned int>& outResult) const
+{
+	int stack[s_maxDepthLimit * 7 + 8];
+	int top = 0;
+	stack[top++] = nodeIndex;
+	while (top > 0)
+	{
+		const Node& node = m_nodes[stack[--top]];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
 
-	m_upFrontLeft->GetAllBoundingBoxes(outResult);
-	m_upFrontRight->GetAllBoundingBoxes(outResult);
-	m_upBackLeft->GetAllBoundingBoxes(outResult);
-	m_upBackRight->GetAllBoundingBoxes(outResult);
+		for (int i = node.firstObject; i >= 0; i = m_objects[i].next)
+		{
+			outResult.push_back(m_objects[i].id);
+		}
 
-	m_downFrontLeft->GetAllBoundingBoxes(outResult);
-	m_downFrontRight->GetAllBoundingBoxes(outResult);
-	m_downBackLeft->GetAllBoundingBoxes(outResult);
-	m_downBackRight->GetAllBoundingBoxes(outResult);
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 8; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
+	}
 }
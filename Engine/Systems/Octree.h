@@ -1,6 +1,6 @@
 #pragma once
 
-#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -9,35 +9,93 @@
 
 class BoundingFrustum;
 
+/*
 
+  Loose, bucketed octree indexing objects by ID and bounds.
+
+  Every node's loose bounds are its tight cell scaled by the looseness factor, so an object is
+  stored in the deepest node whose cell contains its center and whose loose bounds contain its
+  extent. Leaves hold up to leafCapacity objects before they split; removals collapse subtrees
+  that fall back under capacity. Nodes live in one pool, children are allocated in contiguous
+  blocks of 8 and objects are linked through an index based list, so no per-node allocations
+  happen once the pools have grown.
+
+*/
 class Octree
 {
 public:
 	Octree();
-	Octree(const glm::vec3& position, float halfSize);
+	Octree(const glm::vec3& position, float halfSize, unsigned int leafCapacity = 8, unsigned int maxDepth = 8, float looseness = 2.0f);
 	~Octree();
 
-	void Subdivide();
-	bool Insert(const glm::vec3& pos);
-	void Search(const AABB& aabb, std::vector<glm::vec3>& outResult);
-	void Search(const BoundingFrustum& frustum, std::vector<glm::vec3>& outResult);
+	bool Insert(unsigned int id, const AABB& bounds);
+	bool Remove(unsigned int id);
+	// moves an object; stays in its node when the new bounds still fit it.
+	bool Update(unsigned int id, const AABB& bounds);
+	void Clear();
+
+	bool Contains(unsigned int id) const;
+
+	void Search(const AABB& aabb, std::vector<unsigned int>& outResult) const;
+	void Search(const BoundingFrustum& frustum, std::vector<unsigned int>& outResult) const;
+
+	void GetAllBoundingBoxes(std::vector<AABB>& outResult) const;
 
-	void GetAllBoundingBoxes(std::vector<AABB>& outResult);
+	size_t GetObjectCount() const { return m_objectLookup.size(); }
+	size_t GetNodeCount() const { return m_nodes.size() - m_freeBlocks.size() * 8; }
+	size_t GetMemoryUsage() const;
+
+	static const unsigned int s_maxDepthLimit = 16;
 
 private:
-	glm::vec3 m_position;
-	float m_halfSize;
-	AABB m_bounds;
-
-	glm::vec3 m_storePos;
-
-	std::shared_ptr<Octree> m_upFrontLeft;
-	std::shared_ptr<Octree> m_upFrontRight;
-	std::shared_ptr<Octree> m_upBackLeft;
-	std::shared_ptr<Octree> m_upBackRight;
-	std::shared_ptr<Octree> m_downFrontLeft;
-	std::shared_ptr<Octree> m_downFrontRight;
-	std::shared_ptr<Octree> m_downBackLeft;
-	std::shared_ptr<Octree> m_downBackRight;
-};
+	struct Node
+	{
+		glm::vec3 center;
+		float halfSize;
+		int parent;
+		int firstChild;				// first of 8 contiguous children, -1 for leaves
+		int firstObject;			// head of this node's object list
+		unsigned int objectCount;	// objects stored directly in this node
+		unsigned int subtreeCount;	// objects stored in this node and all of its descendants
+		unsigned int depth;
+	};
+
+	struct Object
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		unsigned int id;
+		int node;
+		int prev;
+		int next;
+	};
+
+	int AllocateObject();
+	int AllocateChildren(int parentIndex);
+	void FreeChildren(int nodeIndex);
 
+	void InsertObject(int objectIndex, int nodeIndex);
+	void LinkObject(int objectIndex, int nodeIndex);
+	void UnlinkObject(int objectIndex);
+
+	void Split(int nodeIndex);
+	void TryCollapse(int nodeIndex);
+	void GatherSubtree(int nodeIndex, int targetIndex);
+
+	bool FitsNode(const Node& node, const glm::vec3& min, const glm::vec3& max) const;
+	int ChildOctant(const Node& node, const glm::vec3& center) const;
+
+	void EmitSubtree(int nodeIndex, std::vector<unsigned int>& outResult) const;
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<Object> m_objects;
+	std::vector<int> m_freeBlocks;
+	int m_freeObject;
+
+	std::unordered_map<unsigned int, int> m_objectLookup;
+
+	unsigned int m_leafCapacity;
+	unsigned int m_maxDepth;
+	float m_looseness;
+};
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <GL/glew.h>
 
 #include "GeomDefines.h"
 
@@ -1,101 +1,586 @@
-
 #include "QuadTree.h"
 
+#include <algorithm>
+
+namespace
+{
+	// squared distance from a point to the square cell around center.
+	float DistanceSqToCell(const glm::vec2& pos, const glm::vec2& center, float halfSize)
+	{
+		const glm::vec2 d = glm::max(glm::abs(pos - center) - glm::vec2(halfSize), glm::vec2(0.0f));
+		return glm::dot(d, d);
+	}
+
+	float DistanceSq(const glm::vec2& a, const glm::vec2& b)
+	{
+		const glm::vec2 d = a - b;
+		return glm::dot(d, d);
+	}
+}
+
 QuadTree::QuadTree()
 	: QuadTree(glm::vec2(0.0f), 1.0f)
 {
 }
 
-QuadTree::QuadTree(const glm::vec2& origin, float halfSize)
-	: m_position(origin), m_halfSize(halfSize), m_storePos(0.0f)
-	, m_topLeft(nullptr)
-	, m_topRight(nullptr)
-	, m_bottomLeft(nullptr)
-	, m_bottomRight(nullptr)
+QuadTree::QuadTree(const glm::vec2& origin, float halfSize, unsigned int leafCapacity, unsigned int maxDepth)
+	: m_freeEntry(-1)
+	, m_leafCapacity(leafCapacity > 0 ? leafCapacity : 1)
+	, m_maxDepth(maxDepth < s_maxDepthLimit ? maxDepth : s_maxDepthLimit)
 {
-	// point on quadTree plane
-	m_bounds = Rect(m_position, halfSize);
+	Node root;
+	root.center = origin;
+	root.halfSize = halfSize;
+	root.parent = -1;
+	root.firstChild = -1;
+	root.firstEntry = -1;
+	root.entryCount = 0;
+	root.subtreeCount = 0;
+	root.depth = 0;
+	m_nodes.push_back(root);
 }
 
 QuadTree::~QuadTree()
 {
 }
 
-void QuadTree::Subdivide()
+bool QuadTree::Insert(unsigned int id, const glm::vec2& pos)
 {
-	const glm::vec2 tl = (m_position + (m_position + glm::vec2(-m_halfSize, m_halfSize))) * 0.5f;
-	const glm::vec2 tr = (m_position + (m_position + glm::vec2(m_halfSize, m_halfSize))) * 0.5f;
-	const glm::vec2 bl = (m_position + (m_position + glm::vec2(-m_halfSize, -m_halfSize))) * 0.5f;
-	const glm::vec2 br = (m_position + (m_position + glm::vec2(m_halfSize, -m_halfSize))) * 0.5f;
+	if (!InsideNode(m_nodes[0], pos) || m_entryLookup.find(id) != m_entryLookup.end())
+	{
+		return false;
+	}
+
+	const int entryIndex = AllocateEntry();
+	Entry& entry = m_entries[entryIndex];
+	entry.id = id;
+	entry.pos = pos;
 
-	m_topLeft = std::make_shared<QuadTree>(tl, m_halfSize * 0.5f);
-	m_topRight = std::make_shared<QuadTree>(tr, m_halfSize * 0.5f);
-	m_bottomLeft = std::make_shared<QuadTree>(bl, m_halfSize * 0.5f);
-	m_bottomRight = std::make_shared<QuadTree>(br, m_halfSize * 0.5f);
+	m_entryLookup[id] = entryIndex;
+	InsertEntry(entryIndex);
+	return true;
 }
 
-bool QuadTree::Insert(const glm::vec3& pos)
+bool QuadTree::Insert(unsigned int id, const glm::vec3& pos)
 {
 	// use on the QuadTree Plane
-	const glm::vec3 pos0 = glm::vec3(pos.x, 0.0f, pos.z);
-	const glm::vec2 p = glm::vec2(pos.x, pos.z);
-	if (!m_bounds.Intersect(p))
+	return Insert(id, glm::vec2(pos.x, pos.z));
+}
+
+bool QuadTree::Remove(unsigned int id)
+{
+	auto it = m_entryLookup.find(id);
+	if (it == m_entryLookup.end())
 	{
 		return false;
 	}
 
-	if (m_storePos == glm::vec3(0.0f) && m_topLeft == nullptr)
+	const int entryIndex = it->second;
+	const int nodeIndex = m_entries[entryIndex].node;
+	m_entryLookup.erase(it);
+
+	UnlinkEntry(entryIndex);
+	for (int n = nodeIndex; n >= 0; n = m_nodes[n].parent)
+	{
+		m_nodes[n].subtreeCount--;
+	}
+
+	m_entries[entryIndex].node = -1;
+	m_entries[entryIndex].next = m_freeEntry;
+	m_freeEntry = entryIndex;
+
+	TryCollapse(nodeIndex);
+	return true;
+}
+
+bool QuadTree::Update(unsigned int id, const glm::vec2& pos)
+{
+	auto it = m_entryLookup.find(id);
+	if (it == m_entryLookup.end() || !InsideNode(m_nodes[0], pos))
+	{
+		return false;
+	}
+
+	const int entryIndex = it->second;
+	const int nodeIndex = m_entries[entryIndex].node;
+	m_entries[entryIndex].pos = pos;
+
+	// entries only live in leaves, so staying inside the leaf cell is enough.
+	if (InsideNode(m_nodes[nodeIndex], pos))
 	{
-		m_storePos = pos0;
 		return true;
 	}
 
-	if (m_topLeft == nullptr)
+	UnlinkEntry(entryIndex);
+	for (int n = nodeIndex; n >= 0; n = m_nodes[n].parent)
+	{
+		m_nodes[n].subtreeCount--;
+	}
+
+	InsertEntry(entryIndex);
+	TryCollapse(nodeIndex);
+	return true;
+}
+
+bool QuadTree::Update(unsigned int id, const glm::vec3& pos)
+{
+	return Update(id, glm::vec2(pos.x, pos.z));
+}
+
+void QuadTree::Clear()
+{
+	Node root = m_nodes[0];
+	root.firstChild = -1;
+	root.firstEntry = -1;
+	root.entryCount = 0;
+	root.subtreeCount = 0;
+
+	m_nodes.clear();
+	m_nodes.push_back(root);
+	m_entries.clear();
+	m_freeBlocks.clear();
+	m_freeEntry = -1;
+	m_entryLookup.clear();
+}
+
+bool QuadTree::Contains(unsigned int id) const
+{
+	return m_entryLookup.find(id) != m_entryLookup.end();
+}
+
+void QuadTree::Search(const Rect& range, std::vector<unsigned int>& outResult) const
+{
+	const glm::vec2 queryMin = range.GetMin();
+	const glm::vec2 queryMax = range.GetMax();
+
+	int stack[s_maxDepthLimit * 3 + 4];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
 	{
-		Subdivide();
+		const int nodeIndex = stack[--top];
+		const Node& node = m_nodes[nodeIndex];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
+
+		const glm::vec2 nodeMin = node.center - glm::vec2(node.halfSize);
+		const glm::vec2 nodeMax = node.center + glm::vec2(node.halfSize);
+		if (nodeMin.x > queryMax.x || nodeMax.x < queryMin.x || nodeMin.y > queryMax.y || nodeMax.y < queryMin.y)
+		{
+			continue;
+		}
+		if (nodeMin.x >= queryMin.x && nodeMax.x <= queryMax.x && nodeMin.y >= queryMin.y && nodeMax.y <= queryMax.y)
+		{
+			EmitSubtree(nodeIndex, outResult);
+			continue;
+		}
+
+		for (int i = node.firstEntry; i >= 0; i = m_entries[i].next)
+		{
+			const glm::vec2& pos = m_entries[i].pos;
+			if (pos.x >= queryMin.x && pos.x <= queryMax.x && pos.y >= queryMin.y && pos.y <= queryMax.y)
+			{
+				outResult.push_back(m_entries[i].id);
+			}
+		}
+
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
 	}
+}
 
-	if (m_topLeft->Insert(pos0)) return true;
-	if (m_topRight->Insert(pos0)) return true;
-	if (m_bottomLeft->Insert(pos0)) return true;
-	if (m_bottomRight->Insert(pos0)) return true;
+void QuadTree::SearchRadius(const glm::vec2& center, float radius, std::vector<unsigned int>& outResult) const
+{
+	const float radiusSq = radius * radius;
 
-	return false;
+	int stack[s_maxDepthLimit * 3 + 4];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const int nodeIndex = stack[--top];
+		const Node& node = m_nodes[nodeIndex];
+		if (node.subtreeCount == 0 || DistanceSqToCell(center, node.center, node.halfSize) > radiusSq)
+		{
+			continue;
+		}
+
+		// the cell is inside the circle when its farthest corner is.
+		const glm::vec2 farCorner = glm::abs(center - node.center) + glm::vec2(node.halfSize);
+		if (glm::dot(farCorner, farCorner) <= radiusSq)
+		{
+			EmitSubtree(nodeIndex, outResult);
+			continue;
+		}
+
+		for (int i = node.firstEntry; i >= 0; i = m_entries[i].next)
+		{
+			if (DistanceSq(m_entries[i].pos, center) <= radiusSq)
+			{
+				outResult.push_back(m_entries[i].id);
+			}
+		}
+
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
+	}
 }
 
-void QuadTree::Search(const Rect& range, std::vector<glm::vec3>& outResult)
+void QuadTree::FindNearest(const glm::vec2& pos, unsigned int k, std::vector<unsigned int>& outResult) const
 {
-	if (!m_bounds.Intersect(range))
+	/*
+
+	  Depth first search visiting the children nearest first. The k best candidates so far are
+	  kept in a max-heap, so the current worst is on top; once it is full, cells farther away
+	  than the worst candidate are skipped.
+
+	*/
+	outResult.clear();
+	m_nearestHeap.clear();
+	if (k == 0)
 	{
 		return;
 	}
 
-	// check objects at this bounds level#
-	if (range.Intersect(glm::vec2(m_storePos.x, m_storePos.z)))
+	struct StackEntry
 	{
-		outResult.push_back(m_storePos);
+		int node;
+		float distanceSq;
+	};
+
+	StackEntry stack[s_maxDepthLimit * 3 + 4];
+	int top = 0;
+	stack[top++] = { 0, DistanceSqToCell(pos, m_nodes[0].center, m_nodes[0].halfSize) };
+	while (top > 0)
+	{
+		const StackEntry current = stack[--top];
+		const Node& node = m_nodes[current.node];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
+		if (m_nearestHeap.size() == k && current.distanceSq >= m_nearestHeap.front().distanceSq)
+		{
+			continue;
+		}
+
+		for (int i = node.firstEntry; i >= 0; i = m_entries[i].next)
+		{
+			const Neighbour candidate = { DistanceSq(m_entries[i].pos, pos), m_entries[i].id };
+			if (m_nearestHeap.size() < k)
+			{
+				m_nearestHeap.push_back(candidate);
+				std::push_heap(m_nearestHeap.begin(), m_nearestHeap.end());
+			}
+			else if (candidate < m_nearestHeap.front())
+			{
+				std::pop_heap(m_nearestHeap.begin(), m_nearestHeap.end());
+				m_nearestHeap.back() = candidate;
+				std::push_heap(m_nearestHeap.begin(), m_nearestHeap.end());
+			}
+		}
+
+		if (node.firstChild >= 0)
+		{
+			StackEntry children[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				const Node& child = m_nodes[node.firstChild + c];
+				children[c] = { node.firstChild + c, DistanceSqToCell(pos, child.center, child.halfSize) };
+			}
+
+			// push the farthest first so the nearest child is visited next.
+			std::sort(children, children + 4, [](const StackEntry& a, const StackEntry& b) { return a.distanceSq > b.distanceSq; });
+			for (int c = 0; c < 4; ++c)
+			{
+				stack[top++] = children[c];
+			}
+		}
+	}
+
+	std::sort_heap(m_nearestHeap.begin(), m_nearestHeap.end());
+	outResult.reserve(m_nearestHeap.size());
+	for (const Neighbour& neighbour : m_nearestHeap)
+	{
+		outResult.push_back(neighbour.id);
+	}
+}
+
+void QuadTree::GetAllBoundingBoxes(std::vector<Rect>& outResult) const
+{
+	int stack[s_maxDepthLimit * 3 + 4];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& node = m_nodes[stack[--top]];
+		outResult.push_back(Rect(node.center, node.halfSize));
+
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
 	}
+}
+
+size_t QuadTree::GetMemoryUsage() const
+{
+	const size_t lookupEntry = sizeof(std::pair<const unsigned int, int>) + sizeof(void*) * 2;
+	return m_nodes.capacity() * sizeof(Node)
+		+ m_entries.capacity() * sizeof(Entry)
+		+ m_freeBlocks.capacity() * sizeof(int)
+		+ m_nearestHeap.capacity() * sizeof(Neighbour)
+		+ m_entryLookup.bucket_count() * sizeof(void*)
+		+ m_entryLookup.size() * lookupEntry;
+}
 
-	if (m_topLeft == nullptr)
+int QuadTree::AllocateEntry()
+{
+	if (m_freeEntry >= 0)
+	{
+		const int entryIndex = m_freeEntry;
+		m_freeEntry = m_entries[entryIndex].next;
+		return entryIndex;
+	}
+
+	m_entries.push_back(Entry());
+	return static_cast<int>(m_entries.size()) - 1;
+}
+
+int QuadTree::AllocateChildren(int parentIndex)
+{
+	int first;
+	if (!m_freeBlocks.empty())
+	{
+		first = m_freeBlocks.back();
+		m_freeBlocks.pop_back();
+	}
+	else
+	{
+		first = static_cast<int>(m_nodes.size());
+		m_nodes.resize(m_nodes.size() + 4);
+	}
+
+	const Node parent = m_nodes[parentIndex];
+	const float childHalfSize = parent.halfSize * 0.5f;
+	for (int c = 0; c < 4; ++c)
+	{
+		const glm::vec2 offset(
+			(c & 1) ? childHalfSize : -childHalfSize,
+			(c & 2) ? childHalfSize : -childHalfSize);
+
+		Node& child = m_nodes[first + c];
+		child.center = parent.center + offset;
+		child.halfSize = childHalfSize;
+		child.parent = parentIndex;
+		child.firstChild = -1;
+		child.firstEntry = -1;
+		child.entryCount = 0;
+		child.subtreeCount = 0;
+		child.depth = parent.depth + 1;
+	}
+
+	m_nodes[parentIndex].firstChild = first;
+	return first;
+}
+
+void QuadTree::FreeChildren(int nodeIndex)
+{
+	const int first = m_nodes[nodeIndex].firstChild;
+	if (first < 0)
 	{
 		return;
 	}
 
-	m_topLeft->Search(range, outResult);
-	m_topRight->Search(range, outResult);
-	m_bottomLeft->Search(range, outResult);
-	m_bottomRight->Search(range, outResult);
+	for (int c = 0; c < 4; ++c)
+	{
+		FreeChildren(first + c);
+	}
+
+	m_freeBlocks.push_back(first);
+	m_nodes[nodeIndex].firstChild = -1;
 }
 
-void QuadTree::GetAllBoundingBoxes(std::vector<Rect>& outResult)
+void QuadTree::InsertEntry(int entryIndex)
 {
-	outResult.push_back(m_bounds);
+	const glm::vec2 pos = m_entries[entryIndex].pos;
 
-	if (m_topLeft == nullptr) return;
+	int nodeIndex = 0;
+	while (m_nodes[nodeIndex].firstChild >= 0)
+	{
+		const Node& node = m_nodes[nodeIndex];
+		nodeIndex = node.firstChild + ChildQuadrant(node, pos);
+	}
+
+	LinkEntry(entryIndex, nodeIndex);
+	for (int n = nodeIndex; n >= 0; n = m_nodes[n].parent)
+	{
+		m_nodes[n].subtreeCount++;
+	}
+
+	const Node& node = m_nodes[nodeIndex];
+	if (node.entryCount > m_leafCapacity && node.depth < m_maxDepth)
+	{
+		Split(nodeIndex);
+	}
+}
+
+void QuadTree::LinkEntry(int entryIndex, int nodeIndex)
+{
+	Node& node = m_nodes[nodeIndex];
+	Entry& entry = m_entries[entryIndex];
+
+	entry.node = nodeIndex;
+	entry.prev = -1;
+	entry.next = node.firstEntry;
+	if (node.firstEntry >= 0)
+	{
+		m_entries[node.firstEntry].prev = entryIndex;
+	}
+	node.firstEntry = entryIndex;
+	node.entryCount++;
+}
+
+void QuadTree::UnlinkEntry(int entryIndex)
+{
+	Entry& entry = m_entries[entryIndex];
+	Node& node = m_nodes[entry.node];
+
+	if (entry.prev >= 0)
+	{
+		m_entries[entry.prev].next = entry.next;
+	}
+	else
+	{
+		node.firstEntry = entry.next;
+	}
+	if (entry.next >= 0)
+	{
+		m_entries[entry.next].prev = entry.prev;
+	}
 
-	m_topLeft->GetAllBoundingBoxes(outResult);
-	m_topRight->GetAllBoundingBoxes(outResult);
-	m_bottomLeft->GetAllBoundingBoxes(outResult);
-	m_bottomRight->GetAllBoundingBoxes(outResult);
+	entry.prev = -1;
+	entry.next = -1;
+	node.entryCount--;
 }
 
+void QuadTree::Split(int nodeIndex)
+{
+	const int first = AllocateChildren(nodeIndex);
+
+	// points always fit a child, so the node is emptied into its children.
+	while (m_nodes[nodeIndex].firstEntry >= 0)
+	{
+		const int entryIndex = m_nodes[nodeIndex].firstEntry;
+		const int child = first + ChildQuadrant(m_nodes[nodeIndex], m_entries[entryIndex].pos);
+		UnlinkEntry(entryIndex);
+		LinkEntry(entryIndex, child);
+		m_nodes[child].subtreeCount++;
+	}
+
+	for (int c = 0; c < 4; ++c)
+	{
+		const Node& child = m_nodes[first + c];
+		if (child.entryCount > m_leafCapacity && child.depth < m_maxDepth)
+		{
+			Split(first + c);
+		}
+	}
+}
+
+void QuadTree::TryCollapse(int nodeIndex)
+{
+	// find the highest ancestor whose whole subtree fits in a single leaf again.
+	int target = -1;
+	int n = m_nodes[nodeIndex].firstChild >= 0 ? nodeIndex : m_nodes[nodeIndex].parent;
+	while (n >= 0 && m_nodes[n].subtreeCount <= m_leafCapacity)
+	{
+		target = n;
+		n = m_nodes[n].parent;
+	}
+
+	if (target < 0)
+	{
+		return;
+	}
+
+	GatherSubtree(target, target);
+	FreeChildren(target);
+}
+
+void QuadTree::GatherSubtree(int nodeIndex, int targetIndex)
+{
+	const int first = m_nodes[nodeIndex].firstChild;
+	if (first < 0)
+	{
+		return;
+	}
+
+	for (int c = 0; c < 4; ++c)
+	{
+		const int childIndex = first + c;
+		while (m_nodes[childIndex].firstEntry >= 0)
+		{
+			const int entryIndex = m_nodes[childIndex].firstEntry;
+			UnlinkEntry(entryIndex);
+			LinkEntry(entryIndex, targetIndex);
+		}
+		m_nodes[childIndex].subtreeCount = 0;
+		GatherSubtree(childIndex, targetIndex);
+	}
+}
+
+bool QuadTree::InsideNode(const Node& node, const glm::vec2& pos) const
+{
+	const glm::vec2 offset = glm::abs(pos - node.center);
+	return offset.x <= node.halfSize && offset.y <= node.halfSize;
+}
+
+int QuadTree::ChildQuadrant(const Node& node, const glm::vec2& pos) const
+{
+	return (pos.x >= node.center.x ? 1 : 0)
+		| (pos.y >= node.center.y ? 2 : 0);
+}
+
+void QuadTree::EmitSubtree(int nodeIndex, std::vector<unsigned int>& outResult) const
+{
+	int stack[s_maxDepthLimit * 3 + 4];
+	int top = 0;
+	stack[top++] = nodeIndex;
+	while (top > 0)
+	{
+		const Node& node = m_nodes[stack[--top]];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
+
+		for (int i = node.firstEntry; i >= 0; i = m_entries[i].next)
+		{
+			outResult.push_back(m_entries[i].id);
+		}
+
+		if (node.firstChild >= 0)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				stack[top++] = node.firstChild + c;
+			}
+		}
+	}
+}
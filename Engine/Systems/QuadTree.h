@@ -1,35 +1,111 @@
 #pragma once
 
-#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/glm.hpp>
 
 #include "Rect.h"
 
+/*
+
+  Bucketed point quadtree on the xz plane, indexing entries by ID.
+
+  Leaves hold up to leafCapacity entries before they split into four; removals collapse
+  subtrees that fall back under capacity. Nodes live in one pool with children allocated in
+  contiguous blocks of 4, entries are linked through an index based list, and queries use
+  fixed size stacks, so nothing is allocated per query once the pools have grown.
+
+*/
 class QuadTree
 {
 public:
 	QuadTree();
-	QuadTree(const glm::vec2& origin, float halfSize);
+	QuadTree(const glm::vec2& origin, float halfSize, unsigned int leafCapacity = 8, unsigned int maxDepth = 12);
 	~QuadTree();
 
-	void Subdivide();
-	bool Insert(const glm::vec3& pos);
-	void Search(const Rect& range, std::vector<glm::vec3>& outResult);
+	// positions outside the tree bounds are rejected. 3D positions are projected on the xz plane.
+	bool Insert(unsigned int id, const glm::vec2& pos);
+	bool Insert(unsigned int id, const glm::vec3& pos);
+	bool Remove(unsigned int id);
+	// moves an entry; fails and leaves it in place when the new position is outside the tree.
+	bool Update(unsigned int id, const glm::vec2& pos);
+	bool Update(unsigned int id, const glm::vec3& pos);
+	void Clear();
+
+	bool Contains(unsigned int id) const;
+
+	void Search(const Rect& range, std::vector<unsigned int>& outResult) const;
+	void SearchRadius(const glm::vec2& center, float radius, std::vector<unsigned int>& outResult) const;
+	// k nearest entries to pos, nearest first. the result replaces the contents of outResult.
+	void FindNearest(const glm::vec2& pos, unsigned int k, std::vector<unsigned int>& outResult) const;
 
-	void GetAllBoundingBoxes(std::vector<Rect>& outResult);
+	void GetAllBoundingBoxes(std::vector<Rect>& outResult) const;
+
+	size_t GetEntryCount() const { return m_entryLookup.size(); }
+	size_t GetNodeCount() const { return m_nodes.size() - m_freeBlocks.size() * 4; }
+	size_t GetMemoryUsage() const;
+
+	static const unsigned int s_maxDepthLimit = 24;
 
 private:
-	glm::vec2 m_position;
-	float m_halfSize;
-	Rect m_bounds;
+	struct Node
+	{
+		glm::vec2 center;
+		float halfSize;
+		int parent;
+		int firstChild;				// first of 4 contiguous children, -1 for leaves
+		int firstEntry;				// head of this leaf's entry list
+		unsigned int entryCount;	// entries stored directly in this node
+		unsigned int subtreeCount;	// entries stored in this node and all of its descendants
+		unsigned int depth;
+	};
 
-	glm::vec3 m_storePos;
+	struct Entry
+	{
+		glm::vec2 pos;
+		unsigned int id;
+		int node;
+		int prev;
+		int next;
+	};
 
-	std::shared_ptr<QuadTree> m_topLeft;
-	std::shared_ptr<QuadTree> m_topRight;
-	std::shared_ptr<QuadTree> m_bottomLeft;
-	std::shared_ptr<QuadTree> m_bottomRight;
-};
+	struct Neighbour
+	{
+		float distanceSq;
+		unsigned int id;
+
+		bool operator<(const Neighbour& rhs) const { return distanceSq < rhs.distanceSq; }
+	};
+
+	int AllocateEntry();
+	int AllocateChildren(int parentIndex);
+	void FreeChildren(int nodeIndex);
 
+	void InsertEntry(int entryIndex);
+	void LinkEntry(int entryIndex, int nodeIndex);
+	void UnlinkEntry(int entryIndex);
+
+	void Split(int nodeIndex);
+	void TryCollapse(int nodeIndex);
+	void GatherSubtree(int nodeIndex, int targetIndex);
+
+	bool InsideNode(const Node& node, const glm::vec2& pos) const;
+	int ChildQuadrant(const Node& node, const glm::vec2& pos) const;
+
+	void EmitSubtree(int nodeIndex, std::vector<unsigned int>& outResult) const;
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<Entry> m_entries;
+	std::vector<int> m_freeBlocks;
+	int m_freeEntry;
+
+	std::unordered_map<unsigned int, int> m_entryLookup;
+
+	// bounded max-heap of the current k best candidates, reused between FindNearest calls.
+	mutable std::vector<Neighbour> m_nearestHeap;
+
+	unsigned int m_leafCapacity;
+	unsigned int m_maxDepth;
+};
@@ -0,0 +1,761 @@
+#include "SpatialHashGrid.h"
+
+#include "Camera/CameraFrustum.h"
+#include "Camera/FrustumCulling.h"
+#include "Utils/Parallel.h"
+#include "Utils/RadixSort.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	const unsigned int s_minBatchSize = 4096;
+	const size_t s_minTableSize = 64;
+	const int s_cellLimit = 1 << (SpatialHashGrid::s_cellBits - 1);
+
+	bool Overlaps(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax)
+	{
+		return aMin.x <= bMax.x && aMax.x >= bMin.x
+			&& aMin.y <= bMax.y && aMax.y >= bMin.y
+			&& aMin.z <= bMax.z && aMax.z >= bMin.z;
+	}
+
+	// same test as CameraFrustum::Intersect(boxMin, boxMax), planes face inward.
+	bool InsideFrustum(const glm::vec4 planes[6], const glm::vec3& min, const glm::vec3& max)
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			const glm::vec4& p = planes[i];
+			const glm::vec3 positive(p.x >= 0.0f ? max.x : min.x, p.y >= 0.0f ? max.y : min.y, p.z >= 0.0f ? max.z : min.z);
+			if (p.x * positive.x + p.y * positive.y + p.z * positive.z + p.w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// point shared by three planes; false when they don't meet in a single point.
+	bool IntersectPlanes(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, glm::vec3& outPoint)
+	{
+		const glm::vec3 na(a), nb(b), nc(c);
+		const glm::vec3 bCrossC = glm::cross(nb, nc);
+		const float f = -glm::dot(na, bCrossC);
+		if (std::fabs(f) < 1e-6f)
+		{
+			return false;
+		}
+		outPoint = (bCrossC * a.w + glm::cross(nc, na) * b.w + glm::cross(na, nb) * c.w) / f;
+		return std::isfinite(outPoint.x) && std::isfinite(outPoint.y) && std::isfinite(outPoint.z);
+	}
+
+	int ToCell(float value, float invCellSize)
+	{
+		const float cell = std::floor(value * invCellSize);
+		if (!(cell >= -static_cast<float>(s_cellLimit)))
+		{
+			return -s_cellLimit;
+		}
+		if (cell >= static_cast<float>(s_cellLimit - 1))
+		{
+			return s_cellLimit - 1;
+		}
+		return static_cast<int>(cell);
+	}
+
+	uint64_t GetRangeCellCount(const glm::ivec3& min, const glm::ivec3& max)
+	{
+		if (max.x < min.x || max.y < min.y || max.z < min.z)
+		{
+			return 0;
+		}
+		return static_cast<uint64_t>(max.x - min.x + 1) * static_cast<uint64_t>(max.y - min.y + 1) * static_cast<uint64_t>(max.z - min.z + 1);
+	}
+}
+
+const uint64_t SpatialHashGrid::s_emptyKey = ~0ull;
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+	: m_cellCount(0)
+	, m_freeEntry(-1)
+	, m_freeEntryCount(0)
+	, m_freeObject(-1)
+	, m_queryStamp(0)
+	, m_cellSize(cellSize)
+	, m_invCellSize(1.0f / cellSize)
+{
+	assert(cellSize > 0.0f);
+}
+
+SpatialHashGrid::~SpatialHashGrid()
+{
+}
+
+bool SpatialHashGrid::Insert(unsigned int id, const AABB& bounds)
+{
+	return Insert(id, bounds.GetMin(), bounds.GetMax());
+}
+
+bool SpatialHashGrid::Insert(unsigned int id, const glm::vec3& min, const glm::vec3& max)
+{
+	if (m_objectLookup.find(id) != m_objectLookup.end())
+	{
+		return false;
+	}
+
+	const int objectIndex = AllocateObject();
+	Object& object = m_objects[objectIndex];
+	const Range range = GetCellRange(min, max);
+	object.min = min;
+	object.max = max;
+	object.cellMin = range.min;
+	object.cellMax = range.max;
+	object.id = id;
+	object.firstEntry = -1;
+
+	m_objectLookup[id] = objectIndex;
+	LinkObject(objectIndex);
+	return true;
+}
+
+bool SpatialHashGrid::Remove(unsigned int id)
+{
+	auto it = m_objectLookup.find(id);
+	if (it == m_objectLookup.end())
+	{
+		return false;
+	}
+
+	const int objectIndex = it->second;
+	m_objectLookup.erase(it);
+	UnlinkObject(objectIndex);
+
+	// free objects cover an empty cell range, Rebuild skips them without a separate flag.
+	Object& object = m_objects[objectIndex];
+	object.cellMin = glm::ivec3(0);
+	object.cellMax = glm::ivec3(-1);
+	object.firstEntry = m_freeObject;
+	m_freeObject = objectIndex;
+	return true;
+}
+
+bool SpatialHashGrid::Update(unsigned int id, const AABB& bounds)
+{
+	return Update(id, bounds.GetMin(), bounds.GetMax());
+}
+
+bool SpatialHashGrid::Update(unsigned int id, const glm::vec3& min, const glm::vec3& max)
+{
+	auto it = m_objectLookup.find(id);
+	if (it == m_objectLookup.end())
+	{
+		return false;
+	}
+
+	const int objectIndex = it->second;
+	Object& object = m_objects[objectIndex];
+	object.min = min;
+	object.max = max;
+
+	const Range range = GetCellRange(min, max);
+	if (range.min == object.cellMin && range.max == object.cellMax)
+	{
+		return true;
+	}
+
+	UnlinkObject(objectIndex);
+	m_objects[objectIndex].cellMin = range.min;
+	m_objects[objectIndex].cellMax = range.max;
+	LinkObject(objectIndex);
+	return true;
+}
+
+void SpatialHashGrid::Clear()
+{
+	m_cells.clear();
+	m_cellCount = 0;
+	m_entries.clear();
+	m_freeEntry = -1;
+	m_freeEntryCount = 0;
+	m_objects.clear();
+	m_freeObject = -1;
+	m_objectLookup.clear();
+	m_queryStamps.clear();
+	m_queryStamp = 0;
+}
+
+/*
+
+  The rebuild throws away every cell entry and regenerates them for all objects:
+
+  1. map the IDs to objects in parallel (lookups only), then add the unknown ones.
+  2. write the new bounds and cell ranges in parallel.
+  3. prefix sum the cell count of every object; object o owns the slots [offset[o], offset[o + 1]).
+  4. write a (cell key, slot) pair per slot in parallel and radix sort the pairs by cell.
+  5. the sorted position of a slot becomes its entry index, so every cell's entries end up
+     contiguous; the cell lists and the per object chains are linked in parallel.
+  6. insert one table cell per run of equal keys.
+
+*/
+void SpatialHashGrid::Rebuild(const unsigned int* ids, const glm::vec3* mins, const glm::vec3* maxs, unsigned int count)
+{
+	m_rebuildObjects.resize(count);
+	Utils::ParallelFor(count, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			auto it = m_objectLookup.find(ids[i]);
+			m_rebuildObjects[i] = it != m_objectLookup.end() ? it->second : -1;
+		}
+	});
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (m_rebuildObjects[i] < 0)
+		{
+			const int objectIndex = AllocateObject();
+			m_objects[objectIndex].id = ids[i];
+			m_objectLookup[ids[i]] = objectIndex;
+			m_rebuildObjects[i] = objectIndex;
+		}
+	}
+
+	Utils::ParallelFor(count, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			Object& object = m_objects[m_rebuildObjects[i]];
+			const Range range = GetCellRange(mins[i], maxs[i]);
+			object.min = mins[i];
+			object.max = maxs[i];
+			object.cellMin = range.min;
+			object.cellMax = range.max;
+		}
+	});
+
+	const unsigned int objectCount = static_cast<unsigned int>(m_objects.size());
+	m_rebuildOffsets.resize(objectCount + 1);
+	uint64_t slotCount = 0;
+	for (unsigned int o = 0; o < objectCount; ++o)
+	{
+		m_rebuildOffsets[o] = static_cast<unsigned int>(slotCount);
+		slotCount += GetRangeCellCount(m_objects[o].cellMin, m_objects[o].cellMax);
+	}
+	assert(slotCount < static_cast<uint64_t>(INT32_MAX));
+	const unsigned int totalSlots = static_cast<unsigned int>(slotCount);
+	m_rebuildOffsets[objectCount] = totalSlots;
+
+	m_sortKeys.resize(totalSlots);
+	m_sortEntries.resize(totalSlots);
+	Utils::ParallelFor(objectCount, s_minBatchSize / 8, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int o = begin; o < end; ++o)
+		{
+			const Object& object = m_objects[o];
+			unsigned int slot = m_rebuildOffsets[o];
+			for (int z = object.cellMin.z; z <= object.cellMax.z; ++z)
+			{
+				for (int y = object.cellMin.y; y <= object.cellMax.y; ++y)
+				{
+					for (int x = object.cellMin.x; x <= object.cellMax.x; ++x)
+					{
+						m_sortKeys[slot] = GetCellKey(x, y, z);
+						m_sortEntries[slot] = static_cast<int>(slot);
+						++slot;
+					}
+				}
+			}
+		}
+	});
+
+	Utils::RadixSort(m_sortKeys, m_sortEntries, s_cellBits * 3, m_sortTempKeys, m_sortTempEntries);
+
+	// m_sortTempEntries is free after the sort; reuse it as the slot -> entry map.
+	std::vector<int>& entryOfSlot = m_sortTempEntries;
+	entryOfSlot.resize(totalSlots);
+	Utils::ParallelFor(totalSlots, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			entryOfSlot[m_sortEntries[i]] = static_cast<int>(i);
+		}
+	});
+
+	m_entries.resize(totalSlots);
+	m_freeEntry = -1;
+	m_freeEntryCount = 0;
+
+	Utils::ParallelFor(objectCount, s_minBatchSize / 8, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int o = begin; o < end; ++o)
+		{
+			const unsigned int first = m_rebuildOffsets[o];
+			const unsigned int last = m_rebuildOffsets[o + 1];
+			// only free objects cover no cells; they keep their free list link.
+			if (first == last)
+			{
+				continue;
+			}
+			m_objects[o].firstEntry = entryOfSlot[first];
+			for (unsigned int slot = first; slot < last; ++slot)
+			{
+				Entry& entry = m_entries[entryOfSlot[slot]];
+				entry.object = static_cast<int>(o);
+				entry.nextOfObject = slot + 1 < last ? entryOfSlot[slot + 1] : -1;
+			}
+		}
+	});
+
+	Utils::ParallelFor(totalSlots, s_minBatchSize, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			Entry& entry = m_entries[i];
+			entry.key = m_sortKeys[i];
+			entry.prev = i > 0 && m_sortKeys[i - 1] == entry.key ? static_cast<int>(i - 1) : -1;
+			entry.next = i + 1 < totalSlots && m_sortKeys[i + 1] == entry.key ? static_cast<int>(i + 1) : -1;
+		}
+	});
+
+	size_t runCount = 0;
+	for (unsigned int i = 0; i < totalSlots; ++i)
+	{
+		runCount += i == 0 || m_sortKeys[i - 1] != m_sortKeys[i];
+	}
+
+	std::fill(m_cells.begin(), m_cells.end(), Cell{ s_emptyKey, -1, 0 });
+	m_cellCount = 0;
+	Reserve(runCount);
+	for (unsigned int i = 0; i < totalSlots;)
+	{
+		unsigned int end = i + 1;
+		while (end < totalSlots && m_sortKeys[end] == m_sortKeys[i])
+		{
+			++end;
+		}
+		const int slot = FindOrAddCell(m_sortKeys[i]);
+		m_cells[slot].firstEntry = static_cast<int>(i);
+		m_cells[slot].entryCount = end - i;
+		i = end;
+	}
+}
+
+bool SpatialHashGrid::Contains(unsigned int id) const
+{
+	return m_objectLookup.find(id) != m_objectLookup.end();
+}
+
+void SpatialHashGrid::Search(const AABB& aabb, std::vector<unsigned int>& outResult) const
+{
+	const glm::vec3 min = aabb.GetMin();
+	const glm::vec3 max = aabb.GetMax();
+	const unsigned int stamp = NextQueryStamp();
+
+	ForEachCell(GetCellRange(min, max), [&](const Cell& cell)
+	{
+		for (int e = cell.firstEntry; e >= 0; e = m_entries[e].next)
+		{
+			const int objectIndex = m_entries[e].object;
+			if (m_queryStamps[objectIndex] == stamp)
+			{
+				continue;
+			}
+			m_queryStamps[objectIndex] = stamp;
+
+			const Object& object = m_objects[objectIndex];
+			if (Overlaps(object.min, object.max, min, max))
+			{
+				outResult.push_back(object.id);
+			}
+		}
+	});
+}
+
+void SpatialHashGrid::Search(const CameraFrustum& frustum, std::vector<unsigned int>& outResult) const
+{
+	glm::vec4 planes[6];
+	FrustumCulling::GetPlanes(frustum, planes);
+
+	// the cell range comes from the corners of the volume the planes enclose; CameraFrustum's
+	// own corners don't always match its planes.
+	Range range = { glm::ivec3(-s_cellLimit), glm::ivec3(s_cellLimit - 1) };
+	glm::vec3 min(FLT_MAX);
+	glm::vec3 max(-FLT_MAX);
+	bool bounded = true;
+	for (int corner = 0; corner < 8 && bounded; ++corner)
+	{
+		// left/right, top/bottom, near/far
+		glm::vec3 point;
+		bounded = IntersectPlanes(planes[corner & 1], planes[2 + ((corner >> 1) & 1)], planes[4 + (corner >> 2)], point);
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	if (bounded)
+	{
+		range = GetCellRange(min, max);
+	}
+
+	const unsigned int stamp = NextQueryStamp();
+	ForEachCell(range, [&](const Cell& cell)
+	{
+		const glm::vec3 cellMin = glm::vec3(GetCellCoord(cell.key)) * m_cellSize;
+		if (!InsideFrustum(planes, cellMin, cellMin + glm::vec3(m_cellSize)))
+		{
+			return;
+		}
+
+		for (int e = cell.firstEntry; e >= 0; e = m_entries[e].next)
+		{
+			const int objectIndex = m_entries[e].object;
+			if (m_queryStamps[objectIndex] == stamp)
+			{
+				continue;
+			}
+			m_queryStamps[objectIndex] = stamp;
+
+			const Object& object = m_objects[objectIndex];
+			if (InsideFrustum(planes, object.min, object.max))
+			{
+				outResult.push_back(object.id);
+			}
+		}
+	});
+}
+
+void SpatialHashGrid::SearchSphere(const glm::vec3& center, float radius, std::vector<unsigned int>& outResult) const
+{
+	const float radiusSq = radius * radius;
+	const unsigned int stamp = NextQueryStamp();
+
+	ForEachCell(GetCellRange(center - glm::vec3(radius), center + glm::vec3(radius)), [&](const Cell& cell)
+	{
+		for (int e = cell.firstEntry; e >= 0; e = m_entries[e].next)
+		{
+			const int objectIndex = m_entries[e].object;
+			if (m_queryStamps[objectIndex] == stamp)
+			{
+				continue;
+			}
+			m_queryStamps[objectIndex] = stamp;
+
+			const Object& object = m_objects[objectIndex];
+			const glm::vec3 d = glm::clamp(center, object.min, object.max) - center;
+			if (glm::dot(d, d) <= radiusSq)
+			{
+				outResult.push_back(object.id);
+			}
+		}
+	});
+}
+
+size_t SpatialHashGrid::GetMemoryUsage() const
+{
+	const size_t lookupEntry = sizeof(std::pair<const unsigned int, int>) + sizeof(void*) * 2;
+	return m_cells.capacity() * sizeof(Cell)
+		+ m_entries.capacity() * sizeof(Entry)
+		+ m_objects.capacity() * sizeof(Object)
+		+ m_queryStamps.capacity() * sizeof(unsigned int)
+		+ m_objectLookup.bucket_count() * sizeof(void*)
+		+ m_objectLookup.size() * lookupEntry
+		+ m_rebuildObjects.capacity() * sizeof(int)
+		+ m_rebuildOffsets.capacity() * sizeof(unsigned int)
+		+ (m_sortKeys.capacity() + m_sortTempKeys.capacity()) * sizeof(uint64_t)
+		+ (m_sortEntries.capacity() + m_sortTempEntries.capacity()) * sizeof(int);
+}
+
+int SpatialHashGrid::AllocateObject()
+{
+	if (m_freeObject >= 0)
+	{
+		const int objectIndex = m_freeObject;
+		m_freeObject = m_objects[objectIndex].firstEntry;
+		m_objects[objectIndex].firstEntry = -1;
+		return objectIndex;
+	}
+
+	Object object;
+	object.min = glm::vec3(0.0f);
+	object.max = glm::vec3(0.0f);
+	object.cellMin = glm::ivec3(0);
+	object.cellMax = glm::ivec3(-1);
+	object.id = 0;
+	object.firstEntry = -1;
+	m_objects.push_back(object);
+	m_queryStamps.push_back(0);
+	return static_cast<int>(m_objects.size()) - 1;
+}
+
+int SpatialHashGrid::AllocateEntry()
+{
+	if (m_freeEntry >= 0)
+	{
+		const int entryIndex = m_freeEntry;
+		m_freeEntry = m_entries[entryIndex].nextOfObject;
+		--m_freeEntryCount;
+		return entryIndex;
+	}
+
+	m_entries.push_back(Entry());
+	return static_cast<int>(m_entries.size()) - 1;
+}
+
+void SpatialHashGrid::LinkObject(int objectIndex)
+{
+	const glm::ivec3 cellMin = m_objects[objectIndex].cellMin;
+	const glm::ivec3 cellMax = m_objects[objectIndex].cellMax;
+	for (int z = cellMin.z; z <= cellMax.z; ++z)
+	{
+		for (int y = cellMin.y; y <= cellMax.y; ++y)
+		{
+			for (int x = cellMin.x; x <= cellMax.x; ++x)
+			{
+				const uint64_t key = GetCellKey(x, y, z);
+				const int entryIndex = AllocateEntry();
+				Cell& cell = m_cells[FindOrAddCell(key)];
+				Object& object = m_objects[objectIndex];
+
+				Entry& entry = m_entries[entryIndex];
+				entry.key = key;
+				entry.object = objectIndex;
+				entry.prev = -1;
+				entry.next = cell.firstEntry;
+				entry.nextOfObject = object.firstEntry;
+
+				if (cell.firstEntry >= 0)
+				{
+					m_entries[cell.firstEntry].prev = entryIndex;
+				}
+				cell.firstEntry = entryIndex;
+				++cell.entryCount;
+				object.firstEntry = entryIndex;
+			}
+		}
+	}
+}
+
+void SpatialHashGrid::UnlinkObject(int objectIndex)
+{
+	int entryIndex = m_objects[objectIndex].firstEntry;
+	while (entryIndex >= 0)
+	{
+		Entry& entry = m_entries[entryIndex];
+		const int slot = FindCell(entry.key);
+		assert(slot >= 0);
+		Cell& cell = m_cells[slot];
+
+		if (entry.prev >= 0)
+		{
+			m_entries[entry.prev].next = entry.next;
+		}
+		else
+		{
+			cell.firstEntry = entry.next;
+		}
+		if (entry.next >= 0)
+		{
+			m_entries[entry.next].prev = entry.prev;
+		}
+
+		if (--cell.entryCount == 0)
+		{
+			EraseCell(slot);
+		}
+
+		const int nextIndex = entry.nextOfObject;
+		entry.nextOfObject = m_freeEntry;
+		m_freeEntry = entryIndex;
+		++m_freeEntryCount;
+		entryIndex = nextIndex;
+	}
+	m_objects[objectIndex].firstEntry = -1;
+}
+
+SpatialHashGrid::Range SpatialHashGrid::GetCellRange(const glm::vec3& min, const glm::vec3& max) const
+{
+	Range range;
+	range.min = glm::ivec3(ToCell(min.x, m_invCellSize), ToCell(min.y, m_invCellSize), ToCell(min.z, m_invCellSize));
+	range.max = glm::ivec3(ToCell(max.x, m_invCellSize), ToCell(max.y, m_invCellSize), ToCell(max.z, m_invCellSize));
+	// inverted bounds still cover one cell, so every live object owns at least one entry.
+	range.max = glm::max(range.max, range.min);
+	return range;
+}
+
+uint64_t SpatialHashGrid::GetCellKey(int x, int y, int z)
+{
+	const uint64_t mask = (1ull << s_cellBits) - 1;
+	return (static_cast<uint64_t>(x + s_cellLimit) & mask) << (s_cellBits * 2)
+		| (static_cast<uint64_t>(y + s_cellLimit) & mask) << s_cellBits
+		| (static_cast<uint64_t>(z + s_cellLimit) & mask);
+}
+
+glm::ivec3 SpatialHashGrid::GetCellCoord(uint64_t key)
+{
+	const uint64_t mask = (1ull << s_cellBits) - 1;
+	return glm::ivec3(
+		static_cast<int>((key >> (s_cellBits * 2)) & mask) - s_cellLimit,
+		static_cast<int>((key >> s_cellBits) & mask) - s_cellLimit,
+		static_cast<int>(key & mask) - s_cellLimit);
+}
+
+uint64_t SpatialHashGrid::Hash(uint64_t key)
+{
+	// splitmix64 finalizer; neighbouring cells differ in few bits and linear probing needs them spread.
+	key ^= key >> 30;
+	key *= 0xbf58476d1ce4e5b9ull;
+	key ^= key >> 27;
+	key *= 0x94d049bb133111ebull;
+	key ^= key >> 31;
+	return key;
+}
+
+int SpatialHashGrid::FindCell(uint64_t key) const
+{
+	if (m_cells.empty())
+	{
+		return -1;
+	}
+
+	const size_t mask = m_cells.size() - 1;
+	for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask)
+	{
+		if (m_cells[slot].key == key)
+		{
+			return static_cast<int>(slot);
+		}
+		if (m_cells[slot].key == s_emptyKey)
+		{
+			return -1;
+		}
+	}
+}
+
+int SpatialHashGrid::FindOrAddCell(uint64_t key)
+{
+	Reserve(m_cellCount + 1);
+
+	const size_t mask = m_cells.size() - 1;
+	for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask)
+	{
+		Cell& cell = m_cells[slot];
+		if (cell.key == key)
+		{
+			return static_cast<int>(slot);
+		}
+		if (cell.key == s_emptyKey)
+		{
+			cell.key = key;
+			cell.firstEntry = -1;
+			cell.entryCount = 0;
+			++m_cellCount;
+			return static_cast<int>(slot);
+		}
+	}
+}
+
+void SpatialHashGrid::EraseCell(int slot)
+{
+	// backward shift deletion: pull later cells of the probe chain into the hole so lookups
+	// never need tombstones.
+	const size_t mask = m_cells.size() - 1;
+	size_t hole = static_cast<size_t>(slot);
+	for (size_t next = (hole + 1) & mask; m_cells[next].key != s_emptyKey; next = (next + 1) & mask)
+	{
+		const size_t home = Hash(m_cells[next].key) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			m_cells[hole] = m_cells[next];
+			hole = next;
+		}
+	}
+	m_cells[hole] = Cell{ s_emptyKey, -1, 0 };
+	--m_cellCount;
+}
+
+void SpatialHashGrid::Reserve(size_t cellCount)
+{
+	// keep the load factor at or below one half.
+	if (cellCount * 2 <= m_cells.size())
+	{
+		return;
+	}
+
+	size_t size = std::max(s_minTableSize, m_cells.size());
+	while (size < cellCount * 2)
+	{
+		size *= 2;
+	}
+
+	std::vector<Cell> cells(size, Cell{ s_emptyKey, -1, 0 });
+	cells.swap(m_cells);
+
+	const size_t mask = size - 1;
+	for (const Cell& cell : cells)
+	{
+		if (cell.key == s_emptyKey)
+		{
+			continue;
+		}
+		size_t slot = Hash(cell.key) & mask;
+		while (m_cells[slot].key != s_emptyKey)
+		{
+			slot = (slot + 1) & mask;
+		}
+		m_cells[slot] = cell;
+	}
+}
+
+template <typename Func>
+void SpatialHashGrid::ForEachCell(const Range& range, const Func& func) const
+{
+	const uint64_t rangeCount = GetRangeCellCount(range.min, range.max);
+	if (rangeCount == 0 || m_cellCount == 0)
+	{
+		return;
+	}
+
+	if (rangeCount > m_cells.size())
+	{
+		for (const Cell& cell : m_cells)
+		{
+			if (cell.key == s_emptyKey)
+			{
+				continue;
+			}
+			const glm::ivec3 coord = GetCellCoord(cell.key);
+			if (coord.x >= range.min.x && coord.x <= range.max.x
+				&& coord.y >= range.min.y && coord.y <= range.max.y
+				&& coord.z >= range.min.z && coord.z <= range.max.z)
+			{
+				func(cell);
+			}
+		}
+		return;
+	}
+
+	for (int z = range.min.z; z <= range.max.z; ++z)
+	{
+		for (int y = range.min.y; y <= range.max.y; ++y)
+		{
+			for (int x = range.min.x; x <= range.max.x; ++x)
+			{
+				const int slot = FindCell(GetCellKey(x, y, z));
+				if (slot >= 0)
+				{
+					func(m_cells[slot]);
+				}
+			}
+		}
+	}
+}
+
+unsigned int SpatialHashGrid::NextQueryStamp() const
+{
+	if (++m_queryStamp == 0)
+	{
+		std::fill(m_queryStamps.begin(), m_queryStamps.end(), 0u);
+		m_queryStamp = 1;
+	}
+	return m_queryStamp;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AABB.h"
+
+class CameraFrustum;
+
+/*
+
+  Uniform spatial hash grid indexing objects by ID and bounds.
+
+  An object is referenced from every cell its bounds touch. Occupied cells live in an open
+  addressing table (linear probing, backward shift deletion) keyed by the packed cell
+  coordinate, each holding an index based list of cell entries. Every object also chains its
+  own entries, so insert, update and remove cost O(cells touched) regardless of the object
+  count, and an update that stays within the same cells only rewrites the bounds.
+
+  For scenes where most objects move every frame, Rebuild refreshes the bounds of many objects
+  at once: (cell, entry) pairs are generated in parallel, radix sorted by cell and every run of
+  equal cells is linked in place, which keeps the entries of a cell contiguous in memory.
+
+  The cell size should be around the size of a typical object; objects much larger than a cell
+  are referenced from many cells.
+
+*/
+class SpatialHashGrid
+{
+public:
+	SpatialHashGrid(float cellSize = 4.0f);
+	~SpatialHashGrid();
+
+	bool Insert(unsigned int id, const AABB& bounds);
+	bool Insert(unsigned int id, const glm::vec3& min, const glm::vec3& max);
+	bool Remove(unsigned int id);
+	// moves an object; only touches the cell lists when the set of covered cells changes.
+	bool Update(unsigned int id, const AABB& bounds);
+	bool Update(unsigned int id, const glm::vec3& min, const glm::vec3& max);
+	void Clear();
+
+	// updates (or inserts) the bounds of count objects in one go and relinks every cell.
+	// objects not listed keep their bounds. IDs must be unique within a call.
+	void Rebuild(const unsigned int* ids, const glm::vec3* mins, const glm::vec3* maxs, unsigned int count);
+
+	bool Contains(unsigned int id) const;
+
+	// every query reports an object once, even when it spans several visited cells.
+	void Search(const AABB& aabb, std::vector<unsigned int>& outResult) const;
+	void Search(const CameraFrustum& frustum, std::vector<unsigned int>& outResult) const;
+	void SearchSphere(const glm::vec3& center, float radius, std::vector<unsigned int>& outResult) const;
+
+	float GetCellSize() const { return m_cellSize; }
+	size_t GetObjectCount() const { return m_objectLookup.size(); }
+	size_t GetCellCount() const { return m_cellCount; }
+	size_t GetEntryCount() const { return m_entries.size() - m_freeEntryCount; }
+	size_t GetMemoryUsage() const;
+
+	// cell coordinates are clamped to this many bits per axis (signed).
+	static const int s_cellBits = 21;
+
+private:
+	struct Cell
+	{
+		uint64_t key;		// packed cell coordinate, s_emptyKey for unused slots
+		int firstEntry;
+		unsigned int entryCount;
+	};
+
+	struct Entry
+	{
+		uint64_t key;
+		int object;
+		int prev;			// neighbours within the cell's list
+		int next;
+		int nextOfObject;	// next entry of the same object, next free entry in the free list
+	};
+
+	struct Object
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		glm::ivec3 cellMin;
+		glm::ivec3 cellMax;
+		unsigned int id;
+		int firstEntry;		// next free object while the object sits in the free list
+	};
+
+	struct Range
+	{
+		glm::ivec3 min;
+		glm::ivec3 max;
+	};
+
+	int AllocateObject();
+	int AllocateEntry();
+
+	void LinkObject(int objectIndex);
+	void UnlinkObject(int objectIndex);
+
+	Range GetCellRange(const glm::vec3& min, const glm::vec3& max) const;
+	static uint64_t GetCellKey(int x, int y, int z);
+	static glm::ivec3 GetCellCoord(uint64_t key);
+	static uint64_t Hash(uint64_t key);
+
+	int FindCell(uint64_t key) const;
+	int FindOrAddCell(uint64_t key);
+	void EraseCell(int slot);
+	void Reserve(size_t cellCount);
+
+	// calls func(cell) for every occupied cell inside the range; walks the table instead when
+	// the range covers more cells than there are slots.
+	template <typename Func>
+	void ForEachCell(const Range& range, const Func& func) const;
+
+	unsigned int NextQueryStamp() const;
+
+private:
+	std::vector<Cell> m_cells;
+	size_t m_cellCount;
+
+	std::vector<Entry> m_entries;
+	int m_freeEntry;
+	size_t m_freeEntryCount;
+
+	std::vector<Object> m_objects;
+	int m_freeObject;
+
+	std::unordered_map<unsigned int, int> m_objectLookup;
+
+	// per object stamp of the last query that reported it, to skip duplicates across cells.
+	mutable std::vector<unsigned int> m_queryStamps;
+	mutable unsigned int m_queryStamp;
+
+	// rebuild scratch, kept to avoid reallocating every frame.
+	std::vector<int> m_rebuildObjects;
+	std::vector<unsigned int> m_rebuildOffsets;
+	std::vector<uint64_t> m_sortKeys;
+	std::vector<int> m_sortEntries;
+	std::vector<uint64_t> m_sortTempKeys;
+	std::vector<int> m_sortTempEntries;
+
+	float m_cellSize;
+	float m_invCellSize;
+
+	static const uint64_t s_emptyKey;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace Utils
+{
+	/*
+
+	  Standard allocator that counts every allocation made through it into an external counter.
+	  Containers that should stop allocating once they reach a steady state (per-frame buffers
+	  reused across frames) share one counter, so a caller can compare it between frames.
+
+	  There's deliberately no default constructor: a container that isn't handed the counter
+	  won't compile rather than silently going uncounted.
+
+	*/
+	template <typename T>
+	class CountingAllocator
+	{
+	public:
+		using value_type = T;
+
+		explicit CountingAllocator(std::atomic<size_t>* counter) : m_counter(counter) {}
+
+		template <typename U>
+		CountingAllocator(const CountingAllocator<U>& other) : m_counter(other.GetCounter()) {}
+
+		T* allocate(size_t count)
+		{
+			m_counter->fetch_add(1, std::memory_order_relaxed);
+			return std::allocator<T>().allocate(count);
+		}
+
+		void deallocate(T* pointer, size_t count)
+		{
+			std::allocator<T>().deallocate(pointer, count);
+		}
+
+		std::atomic<size_t>* GetCounter() const { return m_counter; }
+
+		template <typename U>
+		bool operator==(const CountingAllocator<U>& other) const { return m_counter == other.GetCounter(); }
+		template <typename U>
+		bool operator!=(const CountingAllocator<U>& other) const { return m_counter != other.GetCounter(); }
+
+	private:
+		std::atomic<size_t>* m_counter;
+	};
+}
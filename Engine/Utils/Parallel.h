@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace Utils
+{
+	// number of workers worth using for count items when each one should get at least minBatchSize.
+	static unsigned int GetWorkerCount(unsigned int count, unsigned int minBatchSize)
+	{
+		const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+		const unsigned int batches = std::max(1u, count / std::max(1u, minBatchSize));
+		return std::min(hardware, batches);
+	}
+
+	// contiguous [begin, end) range of worker out of workerCount for count items.
+	static void GetWorkerRange(unsigned int count, unsigned int workerCount, unsigned int worker, unsigned int& begin, unsigned int& end)
+	{
+		const unsigned long long total = count;
+		begin = static_cast<unsigned int>(total * worker / workerCount);
+		end = static_cast<unsigned int>(total * (worker + 1) / workerCount);
+	}
+
+	// runs func(worker) for every worker in [0, workerCount) and waits for all of them.
+	// the calling thread runs worker 0.
+	template <typename Func>
+	void ParallelRun(unsigned int workerCount, const Func& func)
+	{
+		if (workerCount <= 1)
+		{
+			func(0u);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		threads.reserve(workerCount - 1);
+		for (unsigned int worker = 1; worker < workerCount; ++worker)
+		{
+			threads.emplace_back([&func, worker]() { func(worker); });
+		}
+
+		func(0u);
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// runs func(begin, end) over contiguous ranges of [0, count) in parallel.
+	template <typename Func>
+	void ParallelFor(unsigned int count, unsigned int minBatchSize, const Func& func)
+	{
+		const unsigned int workerCount = GetWorkerCount(count, minBatchSize);
+		ParallelRun(workerCount, [&](unsigned int worker)
+		{
+			unsigned int begin, end;
+			GetWorkerRange(count, workerCount, worker, begin, end);
+			func(begin, end);
+		});
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Utils
+{
+	/*
+
+	  LSD radix sort of (key, value) pairs on 8 bit digits, only the lower keyBits of the keys
+	  are sorted on. Every pass builds per worker histograms over contiguous ranges, turns them
+	  into per worker offsets and scatters. Workers own disjoint, ordered output slots per digit,
+	  so each pass stays stable. Passes where every key shares the digit are skipped.
+
+	  The temp vectors are scratch space; callers sorting every frame keep them around so the
+	  sort doesn't allocate once they have grown.
+
+	*/
+	template <typename Value, typename KeyAllocator, typename ValueAllocator>
+	void RadixSort(std::vector<uint64_t, KeyAllocator>& keys, std::vector<Value, ValueAllocator>& values, int keyBits,
+		std::vector<uint64_t, KeyAllocator>& tempKeys, std::vector<Value, ValueAllocator>& tempValues, unsigned int minBatchSize = 4096)
+	{
+		const unsigned int count = static_cast<unsigned int>(keys.size());
+		const unsigned int workerCount = GetWorkerCount(count, minBatchSize);
+
+		tempKeys.resize(count);
+		tempValues.resize(count);
+
+		unsigned int localHistograms[256];
+		std::vector<unsigned int> sharedHistograms;
+		unsigned int* histograms = localHistograms;
+		if (workerCount > 1)
+		{
+			sharedHistograms.resize(workerCount * 256);
+			histograms = sharedHistograms.data();
+		}
+
+		const int passCount = (keyBits + 7) / 8;
+		for (int pass = 0; pass < passCount; ++pass)
+		{
+			const int shift = pass * 8;
+
+			std::fill(histograms, histograms + workerCount * 256, 0u);
+			ParallelRun(workerCount, [&](unsigned int worker)
+			{
+				unsigned int begin, end;
+				GetWorkerRange(count, workerCount, worker, begin, end);
+				unsigned int* histogram = &histograms[worker * 256];
+				for (unsigned int i = begin; i < end; ++i)
+				{
+					++histogram[(keys[i] >> shift) & 0xff];
+				}
+			});
+
+			bool trivial = false;
+			for (unsigned int digit = 0; digit < 256; ++digit)
+			{
+				unsigned int digitCount = 0;
+				for (unsigned int worker = 0; worker < workerCount; ++worker)
+				{
+					digitCount += histograms[worker * 256 + digit];
+				}
+				if (digitCount == count)
+				{
+					trivial = true;
+					break;
+				}
+				if (digitCount > 0)
+				{
+					break;
+				}
+			}
+			if (trivial)
+			{
+				continue;
+			}
+
+			unsigned int offset = 0;
+			for (unsigned int digit = 0; digit < 256; ++digit)
+			{
+				for (unsigned int worker = 0; worker < workerCount; ++worker)
+				{
+					const unsigned int digitCount = histograms[worker * 256 + digit];
+					histograms[worker * 256 + digit] = offset;
+					offset += digitCount;
+				}
+			}
+
+			ParallelRun(workerCount, [&](unsigned int worker)
+			{
+				unsigned int begin, end;
+				GetWorkerRange(count, workerCount, worker, begin, end);
+				unsigned int* offsets = &histograms[worker * 256];
+				for (unsigned int i = begin; i < end; ++i)
+				{
+					const unsigned int slot = offsets[(keys[i] >> shift) & 0xff]++;
+					tempKeys[slot] = keys[i];
+					tempValues[slot] = values[i];
+				}
+			});
+
+			keys.swap(tempKeys);
+			values.swap(tempValues);
+		}
+	}
+
+	template <typename Value, typename KeyAllocator, typename ValueAllocator>
+	void RadixSort(std::vector<uint64_t, KeyAllocator>& keys, std::vector<Value, ValueAllocator>& values, int keyBits)
+	{
+		std::vector<uint64_t, KeyAllocator> tempKeys(keys.get_allocator());
+		std::vector<Value, ValueAllocator> tempValues(values.get_allocator());
+		RadixSort(keys, values, keyBits, tempKeys, tempValues);
+	}
+}
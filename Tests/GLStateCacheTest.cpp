@@ -0,0 +1,125 @@
+#include "Renderer/GLStateCache.h"
+#include "Renderer/RecordingRenderDevice.h"
+#include "Shading/Texture.h"
+#include "Shading/TextureCube.h"
+
+#include <cstdio>
+
+/*
+
+  Test of the GL state cache against a recording backend (see GLStateCache.h).
+
+  Binds like the deferred renderer's passes issue them go through a cache that forwards to a
+  RecordingRenderDevice, so what reached the backend can be compared with what the cache let
+  through: repeated binds have to be skipped and counted as such, changed ones issued, and the
+  cache has to forget everything on Reset() and filter nothing while disabled. Returns non zero
+  if any of the checks fails.
+
+*/
+namespace
+{
+	typedef RecordingRenderDevice::Op Op;
+	typedef GLStateCache::Call Call;
+
+	bool check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", what);
+		}
+		return condition;
+	}
+
+	unsigned int recorded(const RecordingRenderDevice& device, Op op)
+	{
+		return device.GetFrameStats().OpCounts[static_cast<int>(op)];
+	}
+
+	bool counted(const GLStateCache& cache, Call call, unsigned int issued, unsigned int skipped)
+	{
+		const GLStateCache::CallCount& count = cache.GetCallCount(call);
+		return count.Issued == issued && count.Skipped == skipped;
+	}
+
+	bool checkSkipped()
+	{
+		RecordingRenderDevice device;
+		GLStateCache cache;
+		cache.SetBackend(&device);
+		device.BeginFrame();
+
+		Texture albedo;
+		albedo.ID = 7;
+		TextureCube irradiance;
+		irradiance.ID = 8;
+
+		// a frame's worth of passes rebinding the same targets, vertex array and textures.
+		for (int pass = 0; pass < 3; ++pass)
+		{
+			cache.BindFramebuffer(GL_FRAMEBUFFER, 1);
+			cache.BindVertexArray(2);
+			albedo.Bind(cache, 0);
+			irradiance.Bind(cache, 3);
+		}
+		// the depth blit binds read and draw framebuffer apart; only the read one changes.
+		cache.BindFramebuffer(GL_READ_FRAMEBUFFER, 4);
+		cache.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 1);
+
+		bool ok = check(counted(cache, Call::Framebuffer, 2, 3), "framebuffer binds not skipped");
+		ok &= check(counted(cache, Call::VertexArray, 1, 2), "vertex array binds not skipped");
+		ok &= check(counted(cache, Call::Texture, 2, 4), "texture binds not skipped");
+
+		// exactly the issued calls reached the backend.
+		ok &= check(recorded(device, Op::BindFramebuffer) == 2, "skipped framebuffer binds recorded");
+		ok &= check(recorded(device, Op::BindVertexArray) == 1, "skipped vertex array binds recorded");
+		ok &= check(recorded(device, Op::BindTexture) == 2 && recorded(device, Op::ActiveTexture) == 2, "skipped texture binds recorded");
+
+		// another texture on a bound unit goes through.
+		Texture normal;
+		normal.ID = 9;
+		normal.Bind(cache, 0);
+		ok &= check(counted(cache, Call::Texture, 3, 4) && recorded(device, Op::BindTexture) == 3, "changed texture bind skipped");
+
+		// after a reset the first bind always goes through.
+		cache.Reset();
+		cache.BindVertexArray(2);
+		ok &= check(counted(cache, Call::VertexArray, 2, 2) && recorded(device, Op::BindVertexArray) == 2, "bind after a reset skipped");
+
+		cache.ResetStats();
+		ok &= check(counted(cache, Call::VertexArray, 0, 0), "call counts not reset");
+		return ok;
+	}
+
+	bool checkDisabled()
+	{
+		RecordingRenderDevice device;
+		GLStateCache cache;
+		cache.SetBackend(&device);
+		cache.SetEnabled(false);
+		device.BeginFrame();
+
+		Texture albedo;
+		albedo.ID = 7;
+		for (int pass = 0; pass < 3; ++pass)
+		{
+			cache.BindFramebuffer(GL_FRAMEBUFFER, 1);
+			cache.BindVertexArray(2);
+			albedo.Bind(cache, 0);
+		}
+
+		bool ok = check(counted(cache, Call::Framebuffer, 3, 0) && counted(cache, Call::VertexArray, 3, 0) && counted(cache, Call::Texture, 3, 0),
+			"disabled cache skipped calls");
+		ok &= check(recorded(device, Op::BindFramebuffer) == 3 && recorded(device, Op::BindVertexArray) == 3 && recorded(device, Op::BindTexture) == 3,
+			"disabled cache held back calls");
+		return ok;
+	}
+}
+
+int main()
+{
+	bool ok = checkSkipped();
+	ok &= checkDisabled();
+
+	std::printf(ok ? "gl state cache: passed\n" : "gl state cache: failed\n");
+	return ok ? 0 : 1;
+}
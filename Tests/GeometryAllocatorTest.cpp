@@ -0,0 +1,170 @@
+#include "Renderer/GeometryAllocator.h"
+
+#include <cstdio>
+#include <vector>
+
+/*
+
+  Test of the range bookkeeping behind the GeometryArena (see GeometryAllocator.h).
+
+  Allocations are placed and freed by hand, so every offset below is known up front: freed
+  ranges have to be reused best fit and merge with their free neighbours, Defragment() has to
+  pack the allocations in offset order and report the moves to copy, and the stats have to
+  follow along. Returns non zero if any of the checks fails.
+
+*/
+namespace
+{
+	typedef GeometryAllocator::Handle Handle;
+
+	bool check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", what);
+		}
+		return condition;
+	}
+
+	bool near(float value, float expected)
+	{
+		return value > expected - 1e-5f && value < expected + 1e-5f;
+	}
+
+	bool checkBestFit()
+	{
+		GeometryAllocator allocator;
+		allocator.Init(105);
+		const Handle a = allocator.Allocate(10);
+		const Handle b = allocator.Allocate(20);
+		const Handle c = allocator.Allocate(5);
+		const Handle d = allocator.Allocate(30);
+		const Handle e = allocator.Allocate(5);
+		bool ok = check(allocator.GetOffset(a) == 0 && allocator.GetOffset(b) == 10 && allocator.GetOffset(c) == 30 &&
+			allocator.GetOffset(d) == 35 && allocator.GetOffset(e) == 65, "allocations not placed back to back");
+
+		// free blocks of 20 at 10, 30 at 35 and 35 at 70; each allocation takes the smallest it fits in.
+		allocator.Free(b);
+		allocator.Free(d);
+		ok &= check(!allocator.IsValid(b) && !allocator.IsValid(d), "freed handles still valid");
+		const Handle f = allocator.Allocate(18);
+		ok &= check(allocator.GetOffset(f) == 10, "18 elements not placed in the 20 element block");
+		const Handle g = allocator.Allocate(25);
+		ok &= check(allocator.GetOffset(g) == 35, "25 elements not placed in the 30 element block");
+		const Handle h = allocator.Allocate(31);
+		ok &= check(allocator.GetOffset(h) == 70, "31 elements not placed in the tail block");
+		ok &= check(f == d || f == b, "freed handle not reused");
+
+		ok &= check(allocator.Allocate(0) == GeometryAllocator::InvalidHandle, "empty allocation succeeded");
+		ok &= check(allocator.Allocate(6) == GeometryAllocator::InvalidHandle, "allocation larger than any free block succeeded");
+		ok &= check(allocator.GetUsed() == 94, "used elements off");
+		return ok;
+	}
+
+	bool checkCoalescing()
+	{
+		GeometryAllocator allocator;
+		allocator.Init(100);
+		const Handle a = allocator.Allocate(10);
+		const Handle b = allocator.Allocate(10);
+		const Handle c = allocator.Allocate(10);
+
+		// c merges with the free tail, a stays on its own.
+		allocator.Free(a);
+		allocator.Free(c);
+		GeometryAllocator::Stats stats = allocator.GetStats();
+		bool ok = check(stats.FreeBlocks == 2 && stats.LargestFree == 80, "freed range not merged with the block after it");
+
+		// b merges with both neighbours.
+		allocator.Free(b);
+		stats = allocator.GetStats();
+		ok &= check(stats.FreeBlocks == 1 && stats.LargestFree == 100 && stats.Used == 0 && stats.Allocations == 0, "freed range not merged with both neighbours");
+		const Handle all = allocator.Allocate(100);
+		ok &= check(allocator.IsValid(all) && allocator.GetOffset(all) == 0, "merged free space not allocatable as a whole");
+
+		// new space merges with a free end of the buffer.
+		allocator.Free(all);
+		allocator.Grow(120);
+		stats = allocator.GetStats();
+		ok &= check(stats.Capacity == 120 && stats.FreeBlocks == 1 && stats.LargestFree == 120, "grown space not merged with the free end");
+		return ok;
+	}
+
+	bool checkMetrics()
+	{
+		GeometryAllocator allocator;
+		allocator.Init(100);
+		const Handle a = allocator.Allocate(25);
+		const Handle b = allocator.Allocate(25);
+		const Handle c = allocator.Allocate(25);
+		const Handle d = allocator.Allocate(25);
+
+		GeometryAllocator::Stats stats = allocator.GetStats();
+		bool ok = check(near(stats.GetUtilisation(), 1.0f) && near(stats.GetFragmentation(), 0.0f) && stats.Allocations == 4 && stats.FreeBlocks == 0, "stats of a full buffer off");
+
+		// half of it free, in two equal blocks.
+		allocator.Free(b);
+		allocator.Free(d);
+		stats = allocator.GetStats();
+		ok &= check(near(stats.GetUtilisation(), 0.5f) && near(stats.GetFragmentation(), 0.5f) && stats.LargestFree == 25 && stats.FreeBlocks == 2, "stats of a fragmented buffer off");
+		ok &= check(allocator.Allocate(30) == GeometryAllocator::InvalidHandle, "allocation larger than the largest free block succeeded");
+
+		allocator.Free(a);
+		allocator.Free(c);
+		stats = allocator.GetStats();
+		ok &= check(near(stats.GetUtilisation(), 0.0f) && near(stats.GetFragmentation(), 0.0f) && stats.FreeBlocks == 1, "stats of an empty buffer off");
+
+		GeometryAllocator empty;
+		ok &= check(near(empty.GetStats().GetUtilisation(), 0.0f) && near(empty.GetStats().GetFragmentation(), 0.0f), "stats of an uninitialized allocator off");
+		return ok;
+	}
+
+	bool checkDefragment()
+	{
+		GeometryAllocator allocator;
+		allocator.Init(100);
+		const Handle a = allocator.Allocate(10);
+		const Handle b = allocator.Allocate(10);
+		const Handle c = allocator.Allocate(20);
+		const Handle d = allocator.Allocate(10);
+		const Handle e = allocator.Allocate(15);
+		allocator.Free(a);
+		allocator.Free(d);
+
+		std::vector<GeometryAllocator::Move> moves;
+		allocator.Defragment(moves);
+
+		// b, c and e slide down over the holes a and d left, in offset order.
+		bool ok = check(moves.size() == 3, "moves of the allocations after the holes missing");
+		if (moves.size() == 3)
+		{
+			ok &= check(moves[0].Allocation == b && moves[0].From == 10 && moves[0].To == 0 && moves[0].Size == 10, "move of b off");
+			ok &= check(moves[1].Allocation == c && moves[1].From == 20 && moves[1].To == 10 && moves[1].Size == 20, "move of c off");
+			ok &= check(moves[2].Allocation == e && moves[2].From == 50 && moves[2].To == 30 && moves[2].Size == 15, "move of e off");
+		}
+		ok &= check(allocator.GetOffset(b) == 0 && allocator.GetOffset(c) == 10 && allocator.GetOffset(e) == 30, "handles not updated to their new offsets");
+		ok &= check(allocator.GetSize(c) == 20 && allocator.IsValid(e), "handles changed by defragmenting");
+
+		const GeometryAllocator::Stats stats = allocator.GetStats();
+		ok &= check(stats.FreeBlocks == 1 && stats.LargestFree == 55 && near(stats.GetFragmentation(), 0.0f), "free space not in one block at the end");
+		const Handle f = allocator.Allocate(55);
+		ok &= check(allocator.IsValid(f) && allocator.GetOffset(f) == 45, "free block at the end not allocatable");
+
+		// already packed, nothing to move.
+		moves.clear();
+		allocator.Defragment(moves);
+		ok &= check(moves.empty(), "packed allocations moved");
+		return ok;
+	}
+}
+
+int main()
+{
+	bool ok = checkBestFit();
+	ok &= checkCoalescing();
+	ok &= checkMetrics();
+	ok &= checkDefragment();
+
+	std::printf(ok ? "geometry allocator: passed\n" : "geometry allocator: failed\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include "Camera/OcclusionCulling.h"
+#include "Camera/FrustumCulling.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdint>
+#include <cstdio>
+
+/*
+
+  Watertightness test of the occlusion culler's rasterizer (see OcclusionCulling.h).
+
+  A wall made of two triangles faces the camera head on, so the pixel centers along the
+  diagonal lie exactly on the edge the triangles share. Every pixel the wall covers has to get
+  its depth, and boxes behind the wall have to be rejected, with the SSE kernel as well as with
+  the culling kernels forced to scalar. Returns non zero if any of the checks fails.
+
+*/
+namespace
+{
+	const unsigned int s_Width = 320;
+	const unsigned int s_Height = 180;
+
+	const float s_WallDistance = 10.0f;
+	const float s_WallHalfSize = 5.0f;
+
+	bool check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", what);
+		}
+		return condition;
+	}
+
+	bool checkWall(FrustumCulling::Isa isa)
+	{
+		FrustumCulling::SetActiveIsa(isa);
+		std::printf("occlusion culling: %s kernel\n", FrustumCulling::GetIsaName(FrustumCulling::GetActiveIsa()));
+
+		// square pixels, so the wall is a square on screen as well and its diagonal runs through
+		// pixel centers.
+		const glm::mat4 projection = glm::perspective(glm::radians(60.0f), static_cast<float>(s_Width) / s_Height, 0.1f, 100.0f);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		const glm::vec3 positions[4] =
+		{
+			glm::vec3(-s_WallHalfSize, -s_WallHalfSize, -s_WallDistance),
+			glm::vec3( s_WallHalfSize, -s_WallHalfSize, -s_WallDistance),
+			glm::vec3( s_WallHalfSize,  s_WallHalfSize, -s_WallDistance),
+			glm::vec3(-s_WallHalfSize,  s_WallHalfSize, -s_WallDistance),
+		};
+		const unsigned int indices[6] = { 0, 1, 2, 2, 3, 0 };
+
+		OcclusionCuller culler(s_Width, s_Height);
+		culler.AddOccluder(positions, 4, indices, 6, glm::mat4(1.0f));
+		culler.Render(projection * view);
+
+		bool ok = check(culler.GetStats().TrianglesDrawn == 2, "both wall triangles drawn");
+
+		// every pixel center within the wall's screen rectangle, which includes the diagonal.
+		const glm::vec4 corner = projection * view * glm::vec4(positions[2], 1.0f);
+		const float halfExtent = corner.y / corner.w * 0.5f * s_Height;
+		const int firstX = static_cast<int>(s_Width * 0.5f - halfExtent) + 1;
+		const int lastX = static_cast<int>(s_Width * 0.5f + halfExtent) - 1;
+		const int firstY = static_cast<int>(s_Height * 0.5f - halfExtent) + 1;
+		const int lastY = static_cast<int>(s_Height * 0.5f + halfExtent) - 1;
+		unsigned int cracks = 0;
+		for (int y = firstY; y <= lastY; ++y)
+		{
+			const float* row = culler.GetDepthBuffer() + y * culler.GetDepthStride();
+			for (int x = firstX; x <= lastX; ++x)
+			{
+				cracks += row[x] >= 1.0f;
+			}
+		}
+		std::printf("  %u uncovered pixels within the wall\n", cracks);
+		ok &= check(cracks == 0, "pixels within the wall left uncovered");
+
+		// boxes behind the wall, centered and straddling the diagonal, and one beside it.
+		ok &= check(!culler.IsVisible(glm::vec3(-1.0f, -1.0f, -16.0f), glm::vec3(1.0f, 1.0f, -14.0f)), "box behind the wall visible");
+		ok &= check(!culler.IsVisible(glm::vec3(-3.0f, -3.0f, -20.0f), glm::vec3(3.0f, 3.0f, -12.0f)), "large box behind the wall visible");
+		ok &= check(!culler.IsVisible(glm::vec3(1.0f, 1.0f, -13.0f), glm::vec3(1.5f, 1.5f, -12.5f)), "box behind the diagonal visible");
+		ok &= check(culler.IsVisible(glm::vec3(-1.0f, -1.0f, -9.0f), glm::vec3(1.0f, 1.0f, -8.0f)), "box in front of the wall hidden");
+		ok &= check(culler.IsVisible(glm::vec3(20.0f, -1.0f, -42.0f), glm::vec3(22.0f, 1.0f, -40.0f)), "box beside the wall hidden");
+
+		FrustumCulling::BoundsArray boxes;
+		boxes.Push(glm::vec3(-1.0f, -1.0f, -16.0f), glm::vec3(1.0f, 1.0f, -14.0f));
+		boxes.Push(glm::vec3(-1.0f, -1.0f, -9.0f), glm::vec3(1.0f, 1.0f, -8.0f));
+		uint32_t mask = 0x3;
+		ok &= check(culler.CullBoxes(boxes.View(), &mask) == 1 && mask == 0x2, "CullBoxes disagrees with IsVisible");
+		return ok;
+	}
+}
+
+int main()
+{
+	bool ok = checkWall(FrustumCulling::GetSupportedIsa());
+	ok &= checkWall(FrustumCulling::Isa::Scalar);
+
+	std::printf(ok ? "occlusion culling: passed\n" : "occlusion culling: failed\n");
+	return ok ? 0 : 1;
+}
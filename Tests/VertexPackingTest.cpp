@@ -0,0 +1,328 @@
+#include "Mesh/VertexPacking.h"
+#include "Camera/FrustumCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+/*
+
+  Round trip test of the packed vertex encodings (see VertexPacking.h).
+
+  Random and edge case attributes are packed into interleaved vertices the way Mesh lays out
+  VERTEX_ENCODING::PACKED, once with the SSE2 encoders and once with the culling kernels
+  forced to scalar. Both must give the same bytes, and unpacking them must stay within the
+  error bounds below. Returns non zero if any of the checks fails.
+
+*/
+namespace
+{
+	using namespace VertexPacking;
+
+	// offsets of the attributes within a packed vertex, as Mesh::finalizePacked lays them out.
+	const unsigned int s_UVOffset = PositionSize;
+	const unsigned int s_NormalOffset = s_UVOffset + UVSize;
+	const unsigned int s_TangentOffset = s_NormalOffset + NormalSize;
+	const unsigned int s_Stride = s_TangentOffset + TangentSize;
+
+	const unsigned int s_RandomCount = 100003;
+	// the measured worst case of the octahedral encodings is about 2.1 quantization steps.
+	const double s_OctahedralSteps = 2.5;
+
+	// splitmix64, same as the spatial benchmark; <random>'s distributions differ between
+	// standard libraries.
+	class Random
+	{
+	public:
+		explicit Random(uint64_t seed)
+			: m_state(seed)
+		{ }
+
+		uint64_t Next()
+		{
+			uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			return z ^ (z >> 31);
+		}
+
+		// [0, 1)
+		float Float() { return static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f); }
+		float Range(float min, float max) { return min + (max - min) * Float(); }
+
+		glm::vec3 Direction()
+		{
+			for (;;)
+			{
+				const glm::vec3 v(Range(-1.0f, 1.0f), Range(-1.0f, 1.0f), Range(-1.0f, 1.0f));
+				const float lengthSq = glm::dot(v, v);
+				if (lengthSq > 0.01f && lengthSq <= 1.0f)
+				{
+					return v / std::sqrt(lengthSq);
+				}
+			}
+		}
+
+	private:
+		uint64_t m_state;
+	};
+
+	struct Vertices
+	{
+		std::vector<glm::vec3> Positions;
+		std::vector<glm::vec2> UV;
+		std::vector<glm::vec3> Normals;
+		std::vector<glm::vec3> Tangents;
+		std::vector<glm::vec3> Bitangents;
+		glm::vec3 Origin;
+		glm::vec3 Extent;
+	};
+
+	bool check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", what);
+		}
+		return condition;
+	}
+
+	// in double precision, and without acos so errors near 0 don't drown in rounding.
+	double angleBetween(const glm::vec3& a, const glm::vec3& b)
+	{
+		const double ax = a.x, ay = a.y, az = a.z;
+		const double bx = b.x, by = b.y, bz = b.z;
+		const double cx = ay * bz - az * by;
+		const double cy = az * bx - ax * bz;
+		const double cz = ax * by - ay * bx;
+		return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), ax * bx + ay * by + az * bz);
+	}
+
+	// the largest error of rounding value to the nearest half: half a unit in the last place of
+	// its binade, subnormals having the fixed step of 2^-24.
+	double halfRoundingError(float value)
+	{
+		int exponent;
+		std::frexp(std::fabs(value), &exponent);
+		return std::ldexp(0.5, std::max(exponent - 1, -14) - 10);
+	}
+
+	void addEdgeCases(Vertices& vertices)
+	{
+		// the lower hemisphere folds onto the corners of the octahedral square; its pole, signed
+		// zeros, directions just below the equator and zero length vectors are the edge cases.
+		const glm::vec3 directions[] =
+		{
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-0.0f, -0.0f, -1.0f),
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(-1.0f, -1.0f, -1.0f),
+			glm::vec3(1.0f, 0.0f, -1e-6f), glm::vec3(0.0f, -1.0f, -1e-6f), glm::vec3(0.7f, -0.7f, -1e-3f),
+			glm::vec3(1e-3f, 2e-3f, -1.0f), glm::vec3(-1e-6f, 1e-6f, -1.0f),
+			glm::vec3(250.0f, -1000.0f, -30.0f), glm::vec3(1e-4f, -3e-4f, -2e-4f),
+			glm::vec3(0.0f), glm::vec3(-0.0f)
+		};
+		// exact halves, ties, the ends of the half range, subnormals and the specials.
+		const float inf = std::numeric_limits<float>::infinity();
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		const float uvs[] =
+		{
+			0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 1.0f + 1.0f / 2048.0f, 1.0f + 3.0f / 2048.0f, 2048.0f + 1.0f,
+			65504.0f, -65504.0f, 65519.0f, 65520.0f, -65520.0f, 1e6f, inf, -inf, nan, -nan,
+			6.1035156e-5f, 6.0975552e-5f, 5.9604645e-8f, -5.9604645e-8f, 2.9802322e-8f, 8.940697e-8f, 1e-7f, -3e-6f, 1e-10f,
+			std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::min()
+		};
+
+		const unsigned int directionCount = sizeof(directions) / sizeof(directions[0]);
+		const unsigned int uvCount = sizeof(uvs) / sizeof(uvs[0]);
+		const unsigned int count = std::max(directionCount, (uvCount + 1) / 2) * 2;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			const glm::vec3 direction = directions[i % directionCount];
+			vertices.Positions.push_back(glm::vec3(0.0f));
+			vertices.UV.push_back(glm::vec2(uvs[(2 * i) % uvCount], uvs[(2 * i + 1) % uvCount]));
+			vertices.Normals.push_back(direction);
+			vertices.Tangents.push_back(direction);
+			// every direction once per handedness, and degenerate bitangents on the zero vectors.
+			vertices.Bitangents.push_back(glm::cross(direction, glm::vec3(0.0f, 1.0f, 0.0f)) * (i < directionCount ? 1.0f : -1.0f));
+		}
+	}
+
+	void addRandom(Vertices& vertices, unsigned int count, Random& random)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			const glm::vec3 normal = random.Direction();
+			const glm::vec3 tangent = glm::normalize(random.Direction() * 0.5f + glm::vec3(normal.y, normal.z, -normal.x));
+			const float handedness = random.Float() < 0.5f ? -1.0f : 1.0f;
+
+			// one axis of the box is flat, the others far apart in size.
+			vertices.Positions.push_back(glm::vec3(random.Range(-50.0f, 30.0f), 2.5f, random.Range(-1000.0f, 1000.0f)));
+			vertices.UV.push_back(glm::vec2(random.Range(-8.0f, 8.0f), std::ldexp(random.Range(1.0f, 2.0f), static_cast<int>(random.Next() % 40) - 24)));
+			vertices.Normals.push_back(normal);
+			vertices.Tangents.push_back(tangent);
+			vertices.Bitangents.push_back(glm::cross(normal, tangent) * handedness);
+		}
+	}
+
+	void pack(const Vertices& vertices, unsigned int count, FrustumCulling::Isa isa, std::vector<uint8_t>& out)
+	{
+		FrustumCulling::SetActiveIsa(isa);
+		out.assign(count * s_Stride, 0xcd);
+		PackPositions(vertices.Positions.data(), count, vertices.Origin, vertices.Extent, out.data(), s_Stride);
+		PackUVs(vertices.UV.data(), count, out.data() + s_UVOffset, s_Stride);
+		PackNormals(vertices.Normals.data(), count, out.data() + s_NormalOffset, s_Stride);
+		PackTangents(vertices.Tangents.data(), vertices.Normals.data(), vertices.Bitangents.data(), count, out.data() + s_TangentOffset, s_Stride);
+	}
+
+	bool checkHalfConversion()
+	{
+		bool ok = true;
+		const float inf = std::numeric_limits<float>::infinity();
+		ok &= check(FloatToHalf(inf) == 0x7c00 && FloatToHalf(-inf) == 0xfc00, "infinity to half");
+		ok &= check(FloatToHalf(1e6f) == 0x7c00 && FloatToHalf(65520.0f) == 0x7c00 && FloatToHalf(65519.0f) == 0x7bff, "half overflow");
+		ok &= check((FloatToHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7fff) > 0x7c00, "NaN to half");
+		ok &= check(FloatToHalf(5.9604645e-8f) == 0x0001 && FloatToHalf(2.9802322e-8f) == 0x0000 && FloatToHalf(8.940697e-8f) == 0x0002, "half subnormal rounding");
+		ok &= check(FloatToHalf(-0.0f) == 0x8000 && FloatToHalf(-1e-10f) == 0x8000, "half signed zero");
+		ok &= check(HalfToFloat(0x7c00) == inf && HalfToFloat(0xfc00) == -inf, "half to infinity");
+
+		// every half survives the round trip through float, NaNs as NaNs.
+		unsigned int mismatches = 0;
+		for (uint32_t half = 0; half <= 0xffff; ++half)
+		{
+			const float value = HalfToFloat(static_cast<uint16_t>(half));
+			const bool nan = (half & 0x7c00) == 0x7c00 && (half & 0x3ff) != 0;
+			if (nan ? !std::isnan(value) || (FloatToHalf(value) & 0x7fff) <= 0x7c00 : FloatToHalf(value) != half)
+			{
+				++mismatches;
+			}
+		}
+		ok &= check(mismatches == 0, "half round trip");
+		return ok;
+	}
+}
+
+int main()
+{
+	Vertices vertices;
+	addEdgeCases(vertices);
+	const unsigned int edgeCaseCount = static_cast<unsigned int>(vertices.Positions.size());
+	Random random(1);
+	addRandom(vertices, s_RandomCount, random);
+	const unsigned int count = static_cast<unsigned int>(vertices.Positions.size());
+
+	// the edge cases sit at the random box's origin, so they don't widen it on the flat axis.
+	glm::vec3 boxMin(std::numeric_limits<float>::max());
+	glm::vec3 boxMax(-std::numeric_limits<float>::max());
+	for (unsigned int i = edgeCaseCount; i < count; ++i)
+	{
+		boxMin = glm::min(boxMin, vertices.Positions[i]);
+		boxMax = glm::max(boxMax, vertices.Positions[i]);
+	}
+	for (unsigned int i = 0; i < edgeCaseCount; ++i)
+	{
+		vertices.Positions[i] = i % 2 ? boxMin : boxMax;
+	}
+	vertices.Origin = boxMin;
+	vertices.Extent = boxMax - boxMin;
+
+	const FrustumCulling::Isa simd = FrustumCulling::GetSupportedIsa();
+	std::printf("vertex packing: %u vertices, %s against scalar\n", count, FrustumCulling::GetIsaName(simd));
+
+	bool ok = checkHalfConversion();
+
+	// the SIMD encoders take 4 vertices at a time; short counts exercise the scalar tails.
+	std::vector<uint8_t> packedSIMD, packedScalar;
+	const unsigned int counts[] = { 1, 3, 4, 5, 8, 9, count };
+	for (unsigned int n : counts)
+	{
+		pack(vertices, n, simd, packedSIMD);
+		pack(vertices, n, FrustumCulling::Isa::Scalar, packedScalar);
+		ok &= check(packedSIMD == packedScalar, "SIMD and scalar encoders differ");
+	}
+
+	double positionError[3] = { 0.0, 0.0, 0.0 };
+	double uvError = 0.0;
+	double normalError = 0.0;
+	double tangentError = 0.0;
+	unsigned int uvMismatches = 0;
+	unsigned int zeroMismatches = 0;
+	unsigned int handednessMismatches = 0;
+	unsigned int paddingMismatches = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const uint8_t* vertex = packedScalar.data() + i * s_Stride;
+
+		const glm::vec3 position = UnpackPosition(vertex, vertices.Origin, vertices.Extent);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			positionError[axis] = std::max(positionError[axis], static_cast<double>(std::fabs(position[axis] - vertices.Positions[i][axis])));
+		}
+		paddingMismatches += vertex[6] != 0 || vertex[7] != 0;
+
+		// beyond the largest half the result is infinity, NaNs stay NaN; the rest rounds.
+		const glm::vec2 uv = UnpackUV(vertex + s_UVOffset);
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			const float expected = vertices.UV[i][axis];
+			if (std::isnan(expected) || std::fabs(expected) >= 65520.0f)
+			{
+				uvMismatches += std::isnan(expected) ? !std::isnan(uv[axis]) : uv[axis] != std::copysign(std::numeric_limits<float>::infinity(), expected);
+				continue;
+			}
+			const double error = std::fabs(static_cast<double>(uv[axis]) - expected);
+			uvMismatches += error > halfRoundingError(expected) || std::signbit(uv[axis]) != std::signbit(expected);
+			uvError = std::max(uvError, error / halfRoundingError(expected));
+		}
+
+		const glm::vec3 normal = UnpackNormal(vertex + s_NormalOffset);
+		const glm::vec4 tangent = UnpackTangent(vertex + s_TangentOffset);
+		if (glm::dot(vertices.Normals[i], vertices.Normals[i]) == 0.0f)
+		{
+			// zero length vectors have no direction; they come back as +z.
+			zeroMismatches += normal != glm::vec3(0.0f, 0.0f, 1.0f) || glm::vec3(tangent) != glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+		else
+		{
+			normalError = std::max(normalError, angleBetween(normal, vertices.Normals[i]));
+			tangentError = std::max(tangentError, angleBetween(glm::vec3(tangent), vertices.Tangents[i]));
+		}
+
+		const float handedness = glm::dot(glm::cross(vertices.Normals[i], vertices.Tangents[i]), vertices.Bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+		handednessMismatches += tangent.w != handedness;
+	}
+
+	// a position rounds to the nearest of PositionMax steps over the box, flat axes to the origin.
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		std::printf("position %c: max error %g, step %g\n", "xyz"[axis], positionError[axis], vertices.Extent[axis] / PositionMax);
+		ok &= check(positionError[axis] <= vertices.Extent[axis] / PositionMax, "position error beyond a quantization step");
+	}
+	ok &= check(vertices.Extent.y == 0.0f, "no flat axis in the random positions");
+	ok &= check(paddingMismatches == 0, "position padding not zero");
+
+	std::printf("uv: max error %g of a rounding step\n", uvError);
+	ok &= check(uvMismatches == 0, "uv beyond half float rounding");
+
+	std::printf("normal: max error %g degrees, tangent: max error %g degrees\n", normalError * 180.0 / 3.14159265358979, tangentError * 180.0 / 3.14159265358979);
+	ok &= check(normalError <= s_OctahedralSteps / NormalMax, "normal error beyond the octahedral bound");
+	ok &= check(tangentError <= s_OctahedralSteps / TangentMax, "tangent error beyond the octahedral bound");
+	ok &= check(zeroMismatches == 0, "zero length vector not decoded as +z");
+	ok &= check(handednessMismatches == 0, "tangent handedness flipped");
+
+	// without normals or bitangents every tangent is right handed.
+	std::vector<uint8_t> tangents(count * TangentSize);
+	PackTangents(vertices.Tangents.data(), nullptr, nullptr, count, tangents.data(), TangentSize);
+	unsigned int leftHanded = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		leftHanded += UnpackTangent(tangents.data() + i * TangentSize).w != 1.0f;
+	}
+	ok &= check(leftHanded == 0, "left handed tangent without a frame");
+
+	std::printf(ok ? "vertex packing: passed\n" : "vertex packing: failed\n");
+	return ok ? 0 : 1;
+}